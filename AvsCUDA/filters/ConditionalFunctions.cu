@@ -10,6 +10,7 @@
 #include "CommonFunctions.h"
 #include "VectorFunctions.cuh"
 #include "ReduceKernel.cuh"
+#include "ScratchArena.h"
 
 #pragma region AveragePlane CUDA
 enum {
@@ -197,12 +198,8 @@ public:
       else // worst case
         sum_in_32bits = ((__int64)total_pixels * (__int64(1) << bits_per_pixel)) <= std::numeric_limits<int>::max();
 
-      VideoInfo workvi = VideoInfo();
-      workvi.pixel_type = VideoInfo::CS_BGR32;
-      workvi.width = 4;
-      workvi.height = 1; // 16bytes
-      PVideoFrame work = env->NewVideoFrame(workvi);
-      void* workbuf = work->GetWritePtr();
+      ScratchBuffer work(16, env);
+      void* workbuf = work.GetWritePtr();
 
       int maxv = ((1 << bits_per_pixel) - 1);
 
@@ -508,12 +505,8 @@ public:
       else // worst case check
         sum_in_32bits = ((__int64)total_pixels * ((__int64(1) << bits_per_pixel) - 1)) <= std::numeric_limits<int>::max();
 
-      VideoInfo workvi = VideoInfo();
-      workvi.pixel_type = VideoInfo::CS_BGR32;
-      workvi.width = 4;
-      workvi.height = 1; // 16bytes
-      PVideoFrame work = env->NewVideoFrame(workvi);
-      void* workbuf = work->GetWritePtr();
+      ScratchBuffer work(16, env);
+      void* workbuf = work.GetWritePtr();
 
       int maxv = ((1 << bits_per_pixel) - 1);
       bool is_rgb = (vi.IsRGB32() || vi.IsRGB64());
@@ -670,12 +663,8 @@ public:
       else // worst case check
         sum_in_32bits = ((__int64)total_pixels * ((__int64(1) << bits_per_pixel) - 1)) <= std::numeric_limits<int>::max();
 
-      VideoInfo workvi = VideoInfo();
-      workvi.pixel_type = VideoInfo::CS_BGR32;
-      workvi.width = 4;
-      workvi.height = 1; // 16bytes
-      PVideoFrame work = env->NewVideoFrame(workvi);
-      void* workbuf = work->GetWritePtr();
+      ScratchBuffer work(16, env);
+      void* workbuf = work.GetWritePtr();
 
       int maxv = ((1 << bits_per_pixel) - 1);
       bool is_rgb = (vi.IsRGB32() || vi.IsRGB64());
@@ -885,12 +874,8 @@ public:
       int buffersize = real_buffersize = (1 << min(16, bits_per_pixel));
       int pitch = src->GetPitch(plane) / pixelsize;
 
-      VideoInfo workvi = VideoInfo();
-      workvi.pixel_type = VideoInfo::CS_BGR32;
-      workvi.width = 256;
-      workvi.height = nblocks(buffersize * sizeof(int), workvi.width * 4);
-      PVideoFrame work = env->NewVideoFrame(workvi);
-      int* workbuf = reinterpret_cast<int*>(work->GetWritePtr());
+      ScratchBuffer work(buffersize * sizeof(int), env);
+      int* workbuf = work.Get<int>();
       accum_buf = std::unique_ptr<int[]>(new int[buffersize]);
 
 
@@ -886,7 +886,7 @@ void launch_resize_h_planar(
 		pixel_offset, pixel_coefficient, target_width, target_height, limit, filter_size);
 }
 
-std::unique_ptr<DeviceLocalData<float>> make_h_coeff_for_cuda(
+std::shared_ptr<DeviceLocalData<float>> make_h_coeff_for_cuda(
 	const float* pixel_coefficient, int filter_size, int target_width, PNeoEnv env)
 {
 	int aligned_width = (target_width + 31) & ~31;
@@ -901,8 +901,7 @@ std::unique_ptr<DeviceLocalData<float>> make_h_coeff_for_cuda(
 		}
 	}
 
-	return std::unique_ptr<DeviceLocalData<float>>(
-		new DeviceLocalData<float>(data.get(), aligned_width * filter_size, env));
+	return DeviceLocalData<float>::GetShared(data.get(), aligned_width * filter_size, env);
 }
 
 //-------- 128 bit float Horizontals
@@ -1811,8 +1810,8 @@ FilteredResizeH::FilteredResizeH(PClip _child, double subrange_left, double subr
 	}
 
 	// CUDA (copy pixel_coefficient before modificatioin)
-	dev_program_luma.pixel_offset = std::unique_ptr<DeviceLocalData<int>>(
-		new DeviceLocalData<int>(resampling_program_luma->pixel_offset, target_width, env));
+	dev_program_luma.pixel_offset = DeviceLocalData<int>::GetShared(
+		resampling_program_luma->pixel_offset, target_width, env);
 	if (resampling_program_luma->pixel_coefficient_float) {
 		dev_program_luma.pixel_coefficient = make_h_coeff_for_cuda(
 			resampling_program_luma->pixel_coefficient_float, 
@@ -1820,9 +1819,8 @@ FilteredResizeH::FilteredResizeH(PClip _child, double subrange_left, double subr
 	}
 	if (resampling_program_chroma) {
 		int chroma_target_width = target_width >> vi.GetPlaneWidthSubsampling(PLANAR_U);
-		dev_program_chroma.pixel_offset = std::unique_ptr<DeviceLocalData<int>>(
-			new DeviceLocalData<int>(resampling_program_chroma->pixel_offset,
-				chroma_target_width, env));
+		dev_program_chroma.pixel_offset = DeviceLocalData<int>::GetShared(
+			resampling_program_chroma->pixel_offset, chroma_target_width, env);
 		if (resampling_program_chroma->pixel_coefficient_float) {
 			dev_program_chroma.pixel_coefficient = make_h_coeff_for_cuda(
 				resampling_program_chroma->pixel_coefficient_float,
@@ -2318,22 +2316,21 @@ FilteredResizeV::FilteredResizeV(PClip _child, double subrange_top, double subra
 	}
 
 	// CUDA
-	dev_program_luma.pixel_offset = std::unique_ptr<DeviceLocalData<int>>(
-		new DeviceLocalData<int>(resampling_program_luma->pixel_offset, target_height, env));
+	dev_program_luma.pixel_offset = DeviceLocalData<int>::GetShared(
+		resampling_program_luma->pixel_offset, target_height, env);
 	if (resampling_program_luma->pixel_coefficient_float) {
-		dev_program_luma.pixel_coefficient = std::unique_ptr<DeviceLocalData<float>>(
-			new DeviceLocalData<float>(resampling_program_luma->pixel_coefficient_float,
-				resampling_program_luma->filter_size * target_height, env));
+		dev_program_luma.pixel_coefficient = DeviceLocalData<float>::GetShared(
+			resampling_program_luma->pixel_coefficient_float,
+			resampling_program_luma->filter_size * target_height, env);
 	}
 	if (resampling_program_chroma) {
 		int chroma_target_height = target_height >> vi.GetPlaneHeightSubsampling(PLANAR_U);
-		dev_program_chroma.pixel_offset = std::unique_ptr<DeviceLocalData<int>>(
-			new DeviceLocalData<int>(resampling_program_chroma->pixel_offset, 
-				chroma_target_height, env));
+		dev_program_chroma.pixel_offset = DeviceLocalData<int>::GetShared(
+			resampling_program_chroma->pixel_offset, chroma_target_height, env);
 		if (resampling_program_chroma->pixel_coefficient_float) {
-			dev_program_chroma.pixel_coefficient = std::unique_ptr<DeviceLocalData<float>>(
-				new DeviceLocalData<float>(resampling_program_chroma->pixel_coefficient_float,
-					resampling_program_chroma->filter_size * chroma_target_height, env));
+			dev_program_chroma.pixel_coefficient = DeviceLocalData<float>::GetShared(
+				resampling_program_chroma->pixel_coefficient_float,
+				resampling_program_chroma->filter_size * chroma_target_height, env);
 		}
 	}
 
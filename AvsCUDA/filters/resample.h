@@ -53,9 +53,10 @@ typedef void (*DevResampler)(
 // Turn function pointer -- copied from turn.h
 typedef void (*TurnFuncPtr) (const BYTE *srcp, BYTE *dstp, int width, int height, int src_pitch, int dst_pitch);
 
+// coefficient tables are shared among resizers with the same program (DeviceLocalData::GetShared)
 struct DevResamplingProgram {
-	std::unique_ptr<DeviceLocalData<int>> pixel_offset;
-	std::unique_ptr<DeviceLocalData<float>> pixel_coefficient;
+	std::shared_ptr<DeviceLocalData<int>> pixel_offset;
+	std::shared_ptr<DeviceLocalData<float>> pixel_coefficient;
 };
 
 /**
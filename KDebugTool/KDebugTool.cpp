@@ -3,11 +3,18 @@
 
 #define NOMINMAX
 #include <windows.h>
+#include <psapi.h>
 
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
 #include <string>
 
 #include "DebugWriter.h"
 
+#pragma comment(lib, "psapi.lib")
+
 static void init_console()
 {
   AllocConsole();
@@ -15,34 +22,249 @@ static void init_console()
   freopen("CONIN$", "r", stdin);
 }
 
+// Time̖OƂ̗݌viKBenchŕ\j
+// self ͒ŌĂ΂ꂽʂTime̎Ԃ́iXbhŌĂ΂ꂽj
+struct TimeStat {
+  int count;
+  double total;
+  double self;
+};
+
+static std::mutex g_timeMutex;
+static std::map<std::string, TimeStat> g_timeStats;
+static thread_local double t_childSec = 0;
+
+static double GetSec(const LARGE_INTEGER& before, const LARGE_INTEGER& after)
+{
+  LARGE_INTEGER liFreq;
+  QueryPerformanceFrequency(&liFreq);
+  return (double)(after.QuadPart - before.QuadPart) / liFreq.QuadPart;
+}
+
 class Time : public GenericVideoFilter {
   std::string name;
+  bool print;
 public:
-  Time(PClip _child, const char* name, IScriptEnvironment* env)
+  Time(PClip _child, const char* name, bool print, IScriptEnvironment* env)
     : GenericVideoFilter(_child)
     , name(name)
+    , print(print)
   { }
 
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env)
   {
-    LARGE_INTEGER liBefore, liAfter, liFreq;
+    LARGE_INTEGER liBefore, liAfter;
+
+    double parentChildSec = t_childSec;
+    t_childSec = 0;
 
     QueryPerformanceCounter(&liBefore);
 
-    PVideoFrame frame = child->GetFrame(n, env);
+    PVideoFrame frame;
+    try {
+      frame = child->GetFrame(n, env);
+    }
+    catch (...) {
+      t_childSec = parentChildSec;
+      throw;
+    }
 
     QueryPerformanceCounter(&liAfter);
-    QueryPerformanceFrequency(&liFreq);
 
-    double sec = (double)(liAfter.QuadPart - liBefore.QuadPart) / liFreq.QuadPart;
-    printf("[%5d] N:%5d %s: %.1f ms\n", GetCurrentThreadId(), n, name.c_str(), sec * 1000);
+    double sec = GetSec(liBefore, liAfter);
+    double selfSec = sec - t_childSec;
+    t_childSec = parentChildSec + sec;
+
+    {
+      std::lock_guard<std::mutex> lock(g_timeMutex);
+      TimeStat& stat = g_timeStats[name];
+      stat.count++;
+      stat.total += sec;
+      stat.self += selfSec;
+    }
+
+    if (print) {
+      printf("[%5d] N:%5d %s: %.1f ms\n", GetCurrentThreadId(), n, name.c_str(), sec * 1000);
+    }
 
     return frame;
   }
 };
 
 AVSValue __cdecl Create_Time(AVSValue args, void* user_data, IScriptEnvironment* env) {
-  return new Time(args[0].AsClip(), args[1].AsString("Time"), env);
+  return new Time(args[0].AsClip(), args[1].AsString("Time"), args[2].AsBool(true), env);
+}
+
+// x`}[Np̍NbviYUV420 8`16bitj
+// ΂߂ɓs͗lɃOf[VƃnbṼmCY悹
+// ƍׂeNX`̂œTfmCYׂ̕fނɋ߂Ȃ
+class KSynthClip : public IClip {
+  VideoInfo vi;
+
+  static uint32_t Hash(int x, int y, int n)
+  {
+    uint32_t h = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)n * 83492791u;
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    return h;
+  }
+
+  template <typename pixel_t>
+  void FillPlane(pixel_t* dst, int pitch, int width, int height, int n, int plane)
+  {
+    int shift = vi.BitsPerComponent() - 8;
+    int maxv = (1 << vi.BitsPerComponent()) - 1;
+    // F͉𑜓xȂ̂œ
+    int step = (plane == 0) ? 4 : 2;
+    int block = (plane == 0) ? 32 : 16;
+    int lo = (plane == 0) ? 64 : 96 + plane * 8;
+    int hi = (plane == 0) ? 176 : 144 - plane * 8;
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        int bx = (x + n * step) / block;
+        int by = (y + n * step / 2) / block;
+        int v = ((bx + by) & 1) ? hi : lo;
+        v += (x + y) * 32 / (width + height);
+        v <<= shift;
+        v += (int)(Hash(x, y, n * 4 + plane) & ((16 << shift) - 1)) - (8 << shift);
+        dst[x + y * pitch] = (pixel_t)std::max(0, std::min(maxv, v));
+      }
+    }
+  }
+
+  template <typename pixel_t>
+  void Fill(PVideoFrame& dst, int n)
+  {
+    static const int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+    for (int p = 0; p < 3; ++p) {
+      FillPlane<pixel_t>(reinterpret_cast<pixel_t*>(dst->GetWritePtr(planes[p])),
+        dst->GetPitch(planes[p]) / sizeof(pixel_t),
+        dst->GetRowSize(planes[p]) / sizeof(pixel_t), dst->GetHeight(planes[p]), n, p);
+    }
+  }
+
+public:
+  KSynthClip(int width, int height, int bits, int length, IScriptEnvironment* env)
+  {
+    memset(&vi, 0, sizeof(vi));
+    switch (bits) {
+    case 8: vi.pixel_type = VideoInfo::CS_YV12; break;
+    case 10: vi.pixel_type = VideoInfo::CS_YUV420P10; break;
+    case 12: vi.pixel_type = VideoInfo::CS_YUV420P12; break;
+    case 14: vi.pixel_type = VideoInfo::CS_YUV420P14; break;
+    case 16: vi.pixel_type = VideoInfo::CS_YUV420P16; break;
+    default: env->ThrowError("[KSynthClip] bits must be 8,10,12,14,16");
+    }
+    if (width <= 0 || height <= 0 || (width & 1) || (height & 1)) {
+      env->ThrowError("[KSynthClip] width and height must be positive and even");
+    }
+    vi.width = width;
+    vi.height = height;
+    vi.num_frames = length;
+    vi.fps_numerator = 30000;
+    vi.fps_denominator = 1001;
+    vi.SetFieldBased(false);
+  }
+
+  PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env)
+  {
+    PVideoFrame dst = env->NewVideoFrame(vi);
+    if (vi.ComponentSize() == 1) {
+      Fill<uint8_t>(dst, n);
+    }
+    else {
+      Fill<uint16_t>(dst, n);
+    }
+    return dst;
+  }
+
+  bool __stdcall GetParity(int n) { return false; }
+  void __stdcall GetAudio(void* buf, __int64 start, __int64 count, IScriptEnvironment* env) { }
+  const VideoInfo& __stdcall GetVideoInfo() { return vi; }
+
+  int __stdcall SetCacheHints(int cachehints, int frame_range) {
+    if (cachehints == CACHE_GET_MTMODE) {
+      return MT_NICE_FILTER;
+    }
+    return 0;
+  }
+
+  static AVSValue __cdecl Create(AVSValue args, void* user_data, IScriptEnvironment* env)
+  {
+    return new KSynthClip(
+      args[0].AsInt(1920), // width
+      args[1].AsInt(1080), // height
+      args[2].AsInt(8), // bits
+      args[3].AsInt(1000), // length
+      env);
+  }
+};
+
+// clipframesɎ擾āAfpsATime̋ԂƂ̎ԁAvZX̃\
+// ŏwarmup̓obt@mۂȂǂ̂ŌvȂ
+// ʂ̕Ԃ
+static AVSValue __cdecl KBench(AVSValue args, void* user_data, IScriptEnvironment* env)
+{
+  PClip clip = args[0].AsClip();
+  int frames = args[1].AsInt(100);
+  int warmup = args[2].AsInt(5);
+  std::string name = args[3].AsString("KBench");
+  const VideoInfo& vi = clip->GetVideoInfo();
+
+  warmup = std::max(0, std::min(warmup, vi.num_frames - 1));
+  frames = std::min(frames, vi.num_frames - warmup);
+  if (frames <= 0) {
+    env->ThrowError("[KBench] no frames to measure");
+  }
+
+  for (int i = 0; i < warmup; ++i) {
+    clip->GetFrame(i, env);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(g_timeMutex);
+    g_timeStats.clear();
+  }
+
+  PROCESS_MEMORY_COUNTERS_EX memBefore = { 0 }, memAfter = { 0 };
+  GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&memBefore, sizeof(memBefore));
+
+  LARGE_INTEGER liBefore, liAfter;
+  QueryPerformanceCounter(&liBefore);
+
+  for (int i = warmup; i < warmup + frames; ++i) {
+    clip->GetFrame(i, env);
+  }
+
+  QueryPerformanceCounter(&liAfter);
+  GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&memAfter, sizeof(memAfter));
+
+  double sec = GetSec(liBefore, liAfter);
+  const double MB = 1024.0 * 1024.0;
+
+  char buf[512];
+  std::string result;
+  sprintf(buf, "[%s] %dx%d %dbit %d frames: %.2f fps (%.2f ms/frame)\n",
+    name.c_str(), vi.width, vi.height, vi.BitsPerComponent(), frames, frames / sec, sec * 1000 / frames);
+  result += buf;
+  sprintf(buf, "  memory: private %+.1f MB (now %.1f MB, peak %.1f MB)\n",
+    ((double)memAfter.PrivateUsage - (double)memBefore.PrivateUsage) / MB,
+    memAfter.PrivateUsage / MB, memAfter.PeakPagefileUsage / MB);
+  result += buf;
+
+  {
+    std::lock_guard<std::mutex> lock(g_timeMutex);
+    for (auto& entry : g_timeStats) {
+      const TimeStat& stat = entry.second;
+      sprintf(buf, "  %-24s: self %8.2f ms/frame total %8.2f ms/frame (%d calls)\n",
+        entry.first.c_str(), stat.self * 1000 / frames, stat.total * 1000 / frames, stat.count);
+      result += buf;
+    }
+  }
+
+  printf("%s", result.c_str());
+  return env->SaveString(result.c_str());
 }
 
 class ImageCompare : GenericVideoFilter
@@ -222,7 +444,7 @@ public:
         CompareRGB<uint16_t>(dst, frame1, frame2, env);
       }
     }
-
+
     return dst;
   }
 
@@ -247,8 +469,10 @@ extern "C" __declspec(dllexport) const char* __stdcall AvisynthPluginInit3(IScri
   AVS_linkage = vectors;
   //init_console();
   
-  env->AddFunction("Time", "c[name]s", Create_Time, 0);
+  env->AddFunction("Time", "c[name]s[print]b", Create_Time, 0);
   env->AddFunction("ImageCompare", "cc[thresh]f[chroma]b[alpha]b[offX]i[offY]i", ImageCompare::Create, 0);
+  env->AddFunction("KSynthClip", "[width]i[height]i[bits]i[length]i", KSynthClip::Create, 0);
+  env->AddFunction("KBench", "c[frames]i[warmup]i[name]s", KBench, 0);
 
   return "K Debug Plugin";
 }
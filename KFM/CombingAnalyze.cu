@@ -3,6 +3,8 @@
 #include <avisynth.h>
 
 #include <algorithm>
+#include <chrono>
+#include <vector>
 
 #include "CommonFunctions.h"
 #include "KFM.h"
@@ -142,6 +144,14 @@ void cpu_analyze_frame(uchar2* __restrict__ flag, int fpitch,
   }
 }
 
+bool IsAVX2Available();
+
+// CombingAnalyzeAVX.cpp
+template<typename pixel_t, bool parity>
+void cpu_analyze_frame_avx2(uchar2* flag, int fpitch,
+  const pixel_t* f0, const pixel_t* f1,
+  int pitch, int nBlkX, int nBlkY, int shift);
+
 template<typename pixel_t, bool parity>
 __global__ void kl_analyze_frame(uchar2* __restrict__ flag, int fpitch,
   const pixel_t* __restrict__ f0, const pixel_t* __restrict__ f1,
@@ -280,6 +290,14 @@ class KFMSuper : public KFMFilterBase
         combeV, fpitchUV, f0V, f1V, pitchUV, widthUV, heightUV, shift);
       DEBUG_SYNC;
     }
+    else if (IsAVX2Available()) {
+      cpu_analyze_frame_avx2<pixel_t, parity>(
+        combeY, fpitchY, f0Y, f1Y, pitchY, width, height, shift);
+      cpu_analyze_frame_avx2<pixel_t, parity>(
+        combeU, fpitchUV, f0U, f1U, pitchUV, widthUV, heightUV, shift);
+      cpu_analyze_frame_avx2<pixel_t, parity>(
+        combeV, fpitchUV, f0V, f1V, pitchUV, widthUV, heightUV, shift);
+    }
     else {
       cpu_analyze_frame<pixel_t, parity>(
         combeY, fpitchY, f0Y, f1Y, pitchY, width, height, shift);
@@ -536,6 +554,12 @@ void cpu_count_cmflags(FMCount* __restrict__ dst,
   }
 }
 
+// CombingAnalyzeAVX.cpp
+void cpu_count_cmflags_avx2(FMCount* dst,
+  const uchar2* combe0, const uchar2* combe1, int pitch,
+  int width, int height, int parity,
+  int threshM, int threshS, int threshLS);
+
 class KPreCycleAnalyze : public KFMFilterBase
 {
   VideoInfo combevi;
@@ -607,6 +631,12 @@ public:
         fmcnt, combe0V, combe1V, pitchUV, widthUV, heightUV, parity, prmC.threshM, prmC.threshS, prmC.threshLS);
       DEBUG_SYNC;
     }
+    else if (IsAVX2Available()) {
+      memset(fmcnt, 0x00, sizeof(FMCount) * 2);
+      cpu_count_cmflags_avx2(fmcnt, combe0Y, combe1Y, pitch, width, height, parity, prmY.threshM, prmY.threshS, prmY.threshLS);
+      cpu_count_cmflags_avx2(fmcnt, combe0U, combe1U, pitchUV, widthUV, heightUV, parity, prmC.threshM, prmC.threshS, prmC.threshLS);
+      cpu_count_cmflags_avx2(fmcnt, combe0V, combe1V, pitchUV, widthUV, heightUV, parity, prmC.threshM, prmC.threshS, prmC.threshLS);
+    }
     else {
       memset(fmcnt, 0x00, sizeof(FMCount) * 2);
       cpu_count_cmflags(fmcnt, combe0Y, combe1Y, pitch, width, height, parity, prmY.threshM, prmY.threshS, prmY.threshLS);
@@ -637,6 +667,117 @@ public:
   }
 };
 
+// KFMSuper,KPreCycleAnalyzeCPUJ[l̃}CNx`}[N
+// 1920x10801v[CłAVX2łŌvAʂvȂ΃G[
+template <typename pixel_t>
+static std::string CombeBench(int iterations, int bits, PNeoEnv env)
+{
+  enum { WIDTH = 1920, HEIGHT = 1080 };
+  const int nBlkX = WIDTH / DC_OVERLAP;
+  const int nBlkY = HEIGHT / DC_OVERLAP;
+  const int pitch = WIDTH + 64;
+  const int fpitch = nBlkX + 32;
+  const int shift = bits - 8 + 4;
+
+  // c̃Of[VɃmCY悹
+  std::vector<pixel_t> f0(pitch * HEIGHT), f1(pitch * HEIGHT);
+  unsigned int rnd = 2463534242u;
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < pitch; ++x) {
+      int base = (x + y) & 0xFF;
+      rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;
+      f0[x + y * pitch] = (pixel_t)(std::min(base + (int)(rnd & 31), 255) << (bits - 8));
+      rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;
+      f1[x + y * pitch] = (pixel_t)(std::min(base + (int)(rnd & 31), 255) << (bits - 8));
+    }
+  }
+
+  typedef void(*ANALYZE)(uchar2*, int, const pixel_t*, const pixel_t*, int, int, int, int);
+  typedef void(*COUNT)(FMCount*, const uchar2*, const uchar2*, int, int, int, int, int, int, int);
+  struct Impl {
+    const char* name;
+    ANALYZE analyze[2];
+    COUNT count;
+  };
+  std::vector<Impl> impls;
+  impls.push_back({ "C",
+    { cpu_analyze_frame<pixel_t, false>, cpu_analyze_frame<pixel_t, true> }, cpu_count_cmflags });
+  if (IsAVX2Available()) {
+    impls.push_back({ "AVX2",
+      { cpu_analyze_frame_avx2<pixel_t, false>, cpu_analyze_frame_avx2<pixel_t, true> }, cpu_count_cmflags_avx2 });
+  }
+
+  std::vector<uchar2> refFlag[2];
+  FMCount refCount[2];
+  std::string result;
+  char buf[256];
+
+  for (int i = 0; i < (int)impls.size(); ++i) {
+    const Impl& impl = impls[i];
+    std::vector<uchar2> flag[2];
+    FMCount count[2];
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+      for (int parity = 0; parity < 2; ++parity) {
+        flag[parity].assign(fpitch * nBlkY * 2, uchar2());
+        impl.analyze[parity](flag[parity].data(), fpitch, f0.data(), f1.data(), pitch, nBlkX, nBlkY, shift);
+      }
+    }
+    auto mid = std::chrono::high_resolution_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+      memset(count, 0, sizeof(count));
+      impl.count(count, flag[0].data() + fpitch + 1, flag[1].data() + fpitch + 1, fpitch,
+        nBlkX - 1, nBlkY * 2 - 1, 1, 20, 12, 36);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    if (i == 0) {
+      for (int parity = 0; parity < 2; ++parity) {
+        refFlag[parity] = flag[parity];
+      }
+      memcpy(refCount, count, sizeof(count));
+    }
+    else {
+      for (int parity = 0; parity < 2; ++parity) {
+        if (memcmp(flag[parity].data(), refFlag[parity].data(), sizeof(uchar2) * flag[parity].size())) {
+          env->ThrowError("[KFMCombeBench] %dbit %s: analyze_framěʂCƈv܂", bits, impl.name);
+        }
+      }
+      if (memcmp(count, refCount, sizeof(count))) {
+        env->ThrowError("[KFMCombeBench] %dbit %s: count_cmflagšʂCƈv܂", bits, impl.name);
+      }
+    }
+
+    double analyzeMs = std::chrono::duration<double, std::milli>(mid - start).count() / (iterations * 2);
+    double countMs = std::chrono::duration<double, std::milli>(end - mid).count() / iterations;
+    sprintf(buf, "%2dbit %-4s: analyze_frame %8.3f ms/plane count_cmflags %8.3f ms/plane\n",
+      bits, impl.name, analyzeMs, countMs);
+    printf("%s", buf);
+    result += buf;
+  }
+
+  return result;
+}
+
+static AVSValue __cdecl KFMCombeBench(AVSValue args, void* user_data, IScriptEnvironment* env_)
+{
+  PNeoEnv env = env_;
+  int bits = args[0].AsInt(8);
+  int iterations = args[1].AsInt(100);
+  std::string result;
+  if (bits == 8) {
+    result = CombeBench<uint8_t>(iterations, bits, env);
+  }
+  else if (bits > 8 && bits <= 16) {
+    result = CombeBench<uint16_t>(iterations, bits, env);
+  }
+  else {
+    env->ThrowError("[KFMCombeBench] Unsupported bits %d", bits);
+  }
+  return env->SaveString(result.c_str());
+}
+
 class KPreCycleAnalyzeShow : public KFMFilterBase
 {
   PClip fmclip;
@@ -1993,6 +2134,7 @@ void AddFuncCombingAnalyze(IScriptEnvironment* env)
   env->AddFunction("KPreCycleAnalyze", "c[threshMY]i[threshSY]i[threshMC]i[threshSC]i", KPreCycleAnalyze::Create, 0);
   env->AddFunction("KPreCycleAnalyzeShow", "cc", KPreCycleAnalyzeShow::Create, 0);
   env->AddFunction("KFMSuperShow", "c[threshMY]i[threshSY]i[threshMC]i[threshSC]i", KFMSuperShow::Create, 0);
+  env->AddFunction("KFMCombeBench", "[bits]i[iterations]i", KFMCombeBench, 0);
 
   env->AddFunction("KTelecine", "cc[show]b", KTelecine::Create, 0);
   env->AddFunction("KTelecineSuper", "cc", KTelecineSuper::Create, 0);
@@ -0,0 +1,235 @@
+#include <stdint.h>
+#include <avisynth.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <immintrin.h>
+#include <vector_types.h>
+
+#include "KFM.h"
+
+// KFMSuperKPreCycleAnalyzeCPU(AVX2)
+// ʂCombingAnalyze.cucpu_analyze_frame,cpu_count_cmflagsƊSɈv
+
+enum {
+  DC_OVERLAP = 4,
+  DC_BLOCK_SIZE = 8,
+};
+
+// 8bit16bitɍL16񂸂A16bit32bitɍL8񂸂
+// 8bitł1combe16bitɎ܂
+template <typename pixel_t> struct CombeAVX2 { };
+
+template <> struct CombeAVX2<uint8_t> {
+  enum { COLS = 16 };
+  static __m256i load(const uint8_t* p) { return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p)); }
+  static __m256i add(__m256i a, __m256i b) { return _mm256_add_epi16(a, b); }
+  static __m256i sub(__m256i a, __m256i b) { return _mm256_sub_epi16(a, b); }
+  static __m256i absdiff(__m256i a, __m256i b) { return _mm256_abs_epi16(_mm256_sub_epi16(a, b)); }
+
+  // 4̎wW̗񂲂Ƃ̒l4񂸂 [O[v][wW] ̏ŏ
+  static void store_groups(int* dst, __m256i m0, __m256i m1, __m256i m2, __m256i m3) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    // 2񂸂
+    __m256i h01 = _mm256_hadd_epi32(_mm256_madd_epi16(m0, ones), _mm256_madd_epi16(m1, ones));
+    __m256i h23 = _mm256_hadd_epi32(_mm256_madd_epi16(m2, ones), _mm256_madd_epi16(m3, ones));
+    // h01 = [m0g0 m0g1 m1g0 m1g1 | m0g2 m0g3 m1g2 m1g3]
+    __m256i lo = _mm256_unpacklo_epi32(h01, h23);
+    __m256i hi = _mm256_unpackhi_epi32(h01, h23);
+    __m256i g02 = _mm256_unpacklo_epi32(lo, hi); // [g0 | g2]
+    __m256i g13 = _mm256_unpackhi_epi32(lo, hi); // [g1 | g3]
+    _mm256_storeu_si256((__m256i*)(dst + 0), _mm256_permute2x128_si256(g02, g13, 0x20));
+    _mm256_storeu_si256((__m256i*)(dst + 8), _mm256_permute2x128_si256(g02, g13, 0x31));
+  }
+};
+
+template <> struct CombeAVX2<uint16_t> {
+  enum { COLS = 8 };
+  static __m256i load(const uint16_t* p) { return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p)); }
+  static __m256i add(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+  static __m256i sub(__m256i a, __m256i b) { return _mm256_sub_epi32(a, b); }
+  static __m256i absdiff(__m256i a, __m256i b) { return _mm256_abs_epi32(_mm256_sub_epi32(a, b)); }
+
+  static void store_groups(int* dst, __m256i m0, __m256i m1, __m256i m2, __m256i m3) {
+    __m256i h01 = _mm256_hadd_epi32(m0, m1);
+    __m256i h23 = _mm256_hadd_epi32(m2, m3);
+    // [m0g0 m1g0 m2g0 m3g0 | m0g1 m1g1 m2g1 m3g1]
+    _mm256_storeu_si256((__m256i*)dst, _mm256_hadd_epi32(h01, h23));
+  }
+};
+
+template <typename K>
+static __m256i calc_combe_avx2(
+  __m256i L0, __m256i L1, __m256i L2, __m256i L3,
+  __m256i L4, __m256i L5, __m256i L6, __m256i L7)
+{
+  auto d01 = K::absdiff(L0, L1);
+  auto d67 = K::absdiff(L6, L7);
+  auto diff8 = K::absdiff(L0, L7);
+  auto diffT = K::add(K::add(K::add(d01, K::absdiff(L1, L2)), K::add(K::absdiff(L2, L3), K::absdiff(L3, L4))),
+    K::add(K::add(K::absdiff(L4, L5), K::absdiff(L5, L6)), d67));
+  auto diffE = K::add(K::add(K::absdiff(L0, L2), K::absdiff(L2, L4)), K::add(K::absdiff(L4, L6), d67));
+  auto diffO = K::add(K::add(d01, K::absdiff(L1, L3)), K::add(K::absdiff(L3, L5), K::absdiff(L5, L7)));
+  // (diffT - diff8) - (diffE - diff8) - (diffO - diff8)
+  return K::sub(K::add(diffT, diff8), K::add(diffE, diffO));
+}
+
+template <typename K>
+static __m256i calc_diff_avx2(
+  __m256i L00, __m256i L10, __m256i L01, __m256i L11,
+  __m256i L02, __m256i L12, __m256i L03, __m256i L13)
+{
+  return K::add(K::add(K::absdiff(L00, L10), K::absdiff(L01, L11)),
+    K::add(K::absdiff(L02, L12), K::absdiff(L03, L13)));
+}
+
+// 8ubN4wWVtgEOaătO2sɏ
+// s[k] = [ubN2k 4wW | ubN2k+1 4wW]
+static void store_flags_avx2(uchar2* top, uchar2* bottom, const __m256i* s, __m128i shift)
+{
+  __m256i a = _mm256_packs_epi32(_mm256_sra_epi32(s[0], shift), _mm256_sra_epi32(s[1], shift));
+  __m256i b = _mm256_packs_epi32(_mm256_sra_epi32(s[2], shift), _mm256_sra_epi32(s[3], shift));
+  // 00A255傫̂255ɂȂ
+  __m256i v = _mm256_packus_epi16(a, b);
+  // lane0 = ubN0,2,4,6 lane1 = ubN1,3,5,7 eubN [top.x top.y bottom.x bottom.y]
+  const __m256i order = _mm256_setr_epi8(
+    0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15,
+    0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+  v = _mm256_shuffle_epi8(v, order);
+  __m128i lo = _mm256_castsi256_si128(v);
+  __m128i hi = _mm256_extracti128_si256(v, 1);
+  _mm_storeu_si128((__m128i*)top, _mm_unpacklo_epi16(lo, hi));
+  _mm_storeu_si128((__m128i*)bottom, _mm_unpackhi_epi16(lo, hi));
+}
+
+template<typename pixel_t, bool parity>
+void cpu_analyze_frame_avx2(uchar2* flag, int fpitch,
+  const pixel_t* f0, const pixel_t* f1,
+  int pitch, int nBlkX, int nBlkY, int shift)
+{
+  typedef CombeAVX2<pixel_t> K;
+
+  // 4񂲂Ƃ̍viubNׂ͗荇2O[v̍vj
+  // es1񂾂ǂ4wW𓯎ɌvZ
+  int numCols = nBlkX * DC_OVERLAP;
+  int numGroups = (numCols + K::COLS - 1) / K::COLS * K::COLS / DC_OVERLAP;
+  std::vector<int> groups((numGroups + 1) * 4);
+  const __m128i vshift = _mm_cvtsi32_si128(shift);
+
+  for (int by = 0; by < nBlkY - 1; ++by) {
+    int y = by * DC_OVERLAP;
+
+    for (int x = 0; x < numCols; x += K::COLS) {
+      auto T00 = K::load(&f0[x + (y + 0) * pitch]);
+      auto B00 = K::load(&f0[x + (y + 1) * pitch]);
+      auto T01 = K::load(&f0[x + (y + 2) * pitch]);
+      auto B01 = K::load(&f0[x + (y + 3) * pitch]);
+      auto T02 = K::load(&f0[x + (y + 4) * pitch]);
+      auto B02 = K::load(&f0[x + (y + 5) * pitch]);
+      auto T03 = K::load(&f0[x + (y + 6) * pitch]);
+      auto B03 = K::load(&f0[x + (y + 7) * pitch]);
+      auto T10 = K::load(&f1[x + (y + 0) * pitch]);
+      auto B10 = K::load(&f1[x + (y + 1) * pitch]);
+      auto T11 = K::load(&f1[x + (y + 2) * pitch]);
+      auto B11 = K::load(&f1[x + (y + 3) * pitch]);
+      auto T12 = K::load(&f1[x + (y + 4) * pitch]);
+      auto B12 = K::load(&f1[x + (y + 5) * pitch]);
+      auto T13 = K::load(&f1[x + (y + 6) * pitch]);
+      auto B13 = K::load(&f1[x + (y + 7) * pitch]);
+
+      auto self = calc_combe_avx2<K>(T00, B00, T01, B01, T02, B02, T03, B03);
+      __m256i m0, m2;
+      if (parity) { // TFF: B0 <-> T1
+        m0 = self;
+        m2 = calc_combe_avx2<K>(T10, B00, T11, B01, T12, B02, T13, B03);
+      }
+      else { // BFF: T0 <-> B1
+        m0 = calc_combe_avx2<K>(T00, B10, T01, B11, T02, B12, T03, B13);
+        m2 = self;
+      }
+      auto m1 = calc_diff_avx2<K>(T00, T10, T01, T11, T02, T12, T03, T13);
+      auto m3 = calc_diff_avx2<K>(B00, B10, B01, B11, B02, B12, B03, B13);
+
+      K::store_groups(&groups[x / DC_OVERLAP * 4], m0, m1, m2, m3);
+    }
+
+    uchar2* top = &flag[1 + (2 * (by + 1) + 0) * fpitch];
+    uchar2* bottom = &flag[1 + (2 * (by + 1) + 1) * fpitch];
+    const int* g = groups.data();
+
+    int bx = 0;
+    for (; bx + 8 <= nBlkX - 1; bx += 8) {
+      __m256i s[4];
+      for (int k = 0; k < 4; ++k) {
+        s[k] = _mm256_add_epi32(
+          _mm256_loadu_si256((const __m256i*)&g[(bx + 2 * k) * 4]),
+          _mm256_loadu_si256((const __m256i*)&g[(bx + 2 * k + 1) * 4]));
+      }
+      store_flags_avx2(&top[bx], &bottom[bx], s, vshift);
+    }
+    for (; bx < nBlkX - 1; ++bx) {
+      int sum[4];
+      for (int i = 0; i < 4; ++i) {
+        sum[i] = g[bx * 4 + i] + g[(bx + 1) * 4 + i];
+      }
+      top[bx].x = (uint8_t)std::min(std::max(sum[0] >> shift, 0), 255);
+      top[bx].y = (uint8_t)std::min(std::max(sum[1] >> shift, 0), 255);
+      bottom[bx].x = (uint8_t)std::min(std::max(sum[2] >> shift, 0), 255);
+      bottom[bx].y = (uint8_t)std::min(std::max(sum[3] >> shift, 0), 255);
+    }
+  }
+}
+
+template void cpu_analyze_frame_avx2<uint8_t, false>(uchar2* flag, int fpitch,
+  const uint8_t* f0, const uint8_t* f1, int pitch, int nBlkX, int nBlkY, int shift);
+template void cpu_analyze_frame_avx2<uint8_t, true>(uchar2* flag, int fpitch,
+  const uint8_t* f0, const uint8_t* f1, int pitch, int nBlkX, int nBlkY, int shift);
+template void cpu_analyze_frame_avx2<uint16_t, false>(uchar2* flag, int fpitch,
+  const uint16_t* f0, const uint16_t* f1, int pitch, int nBlkX, int nBlkY, int shift);
+template void cpu_analyze_frame_avx2<uint16_t, true>(uchar2* flag, int fpitch,
+  const uint16_t* f0, const uint16_t* f1, int pitch, int nBlkX, int nBlkY, int shift);
+
+// v >= thresh ̃oCg}XN
+// thresh0ȉȂSA255傫0ɂȂ
+static inline unsigned int ge_mask_epu8(__m256i v, int thresh)
+{
+  if (thresh <= 0) return 0xFFFFFFFFu;
+  if (thresh > 255) return 0;
+  __m256i t = _mm256_set1_epi8((char)thresh);
+  return (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(v, t), v));
+}
+
+void cpu_count_cmflags_avx2(FMCount* dst,
+  const uchar2* combe0, const uchar2* combe1, int pitch,
+  int width, int height, int parity,
+  int threshM, int threshS, int threshLS)
+{
+  // uchar2 [x(shima) y(move)] Ȃ̂ŋoCgxAoCgy
+  const unsigned int MASK_X = 0x55555555u;
+  const unsigned int MASK_Y = 0xAAAAAAAAu;
+
+  for (int i = 0; i < 2; ++i) {
+    const uchar2* combe = (i == 0) ? combe0 : combe1;
+    int move = 0, shima = 0, lshima = 0;
+    for (int by = 0; by < height; ++by) {
+      const uchar2* row = &combe[by * pitch];
+      int bx = 0;
+      for (; bx + 16 <= width; bx += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)&row[bx]);
+        move += _mm_popcnt_u32(ge_mask_epu8(v, threshM) & MASK_Y);
+        shima += _mm_popcnt_u32(ge_mask_epu8(v, threshS) & MASK_X);
+        lshima += _mm_popcnt_u32(ge_mask_epu8(v, threshLS) & MASK_X);
+      }
+      for (; bx < width; ++bx) {
+        auto v = row[bx];
+        if (v.y >= threshM) move++;
+        if (v.x >= threshS) shima++;
+        if (v.x >= threshLS) lshima++;
+      }
+    }
+    dst[i ^ !parity].move += move;
+    dst[i ^ !parity].shima += shima;
+    dst[i ^ !parity].lshima += lshima;
+  }
+}
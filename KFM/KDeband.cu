@@ -4,6 +4,9 @@
 
 #include <memory>
 #include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
 
 #include "DeviceLocalData.h"
 #include "CommonFunctions.h"
@@ -12,8 +15,12 @@
 #include "Copy.h"
 
 #include "Frame.h"
+#include "ThreadPool.h"
 
 #include "DeviceLocalData.cpp"
+#include "ThreadPool.cpp"
+
+bool IsAVX2Available();
 
 int GetDeviceTypes(const PClip& clip);
 
@@ -261,20 +268,59 @@ static __device__ __host__ int random_range(uint8_t random, char range) {
   return ((((range << 1) + 1) * (int)random) >> 8) - range;
 }
 
-template <typename pixel_t, int sample_mode, bool blur_first>
-void cpu_reduce_banding(
+// e[ȗɍW痐irand_hash=truej
+// 8bitƎ8bitꂼrefA,refB̗Ɏg
+// AVX2(KDebandAVX.cpp)deband_hash_avx2ƓlɂȂ邱
+static __device__ __host__ uint32_t deband_hash(int x, int y) {
+  uint32_t h = ((uint32_t)x * 0x9E3779B1u) ^ ((uint32_t)y * 0x85EBCA77u);
+  h ^= h >> 16;
+  h *= 0x7FEB352Du;
+  h ^= h >> 15;
+  h *= 0x846CA68Bu;
+  h ^= h >> 16;
+  return h;
+}
+
+// e[u͉fDEBAND_RAND_PER_PIXEL width*heightׂ
+// pitchɂ炸y*width+xňipitch>width̃v[Ńe[u͂ݏoȂ悤Ɂj
+enum { DEBAND_RAND_PER_PIXEL = 2 };
+
+template <bool rand_hash>
+static __device__ __host__ void deband_random(
+  const uint8_t* rand, int rand_step, int rand_offset, int x, int y, int& randA, int& randB)
+{
+  if (rand_hash) {
+    uint32_t h = deband_hash(x, y);
+    randA = h & 0xFF;
+    randB = (h >> 8) & 0xFF;
+  }
+  else {
+    randA = rand[rand_offset + rand_step * 0];
+    randB = rand[rand_offset + rand_step * 1];
+  }
+}
+
+template <typename pixel_t, int sample_mode, bool blur_first, bool rand_hash>
+void cpu_reduce_banding_avx2(
   pixel_t* dst, const pixel_t* src, const uint8_t* rand,
-  int width, int height, int pitch, int range, int thresh, PNeoEnv env)
+  int width, int height, int pitch, int range, int thresh, int ystart, int yend);
+
+template <typename pixel_t, int sample_mode, bool blur_first, bool rand_hash>
+void cpu_reduce_banding_rows(
+  pixel_t* dst, const pixel_t* src, const uint8_t* rand,
+  int width, int height, int pitch, int range, int thresh, int xstart, int ystart, int yend)
 {
   int rand_step = width * height;
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
+  for (int y = ystart; y < yend; ++y) {
+    for (int x = xstart; x < width; ++x) {
       int offset = y * pitch + x;
 
       int range_limited = min(min(range, y), min(height - y - 1, min(x, width - x - 1)));
-      int refA = random_range(rand[offset + rand_step * 0], range_limited);
-      int refB = random_range(rand[offset + rand_step * 1], range_limited);
+      int randA, randB;
+      deband_random<rand_hash>(rand, rand_step, y * width + x, x, y, randA, randB);
+      int refA = random_range(randA, range_limited);
+      int refB = random_range(randB, range_limited);
 
       int src_val = src[offset];
       int avg, diff;
@@ -320,7 +366,26 @@ void cpu_reduce_banding(
   }
 }
 
-template <typename pixel_t, int sample_mode, bool blur_first>
+template <typename pixel_t, int sample_mode, bool blur_first, bool rand_hash>
+void cpu_reduce_banding(
+  pixel_t* dst, const pixel_t* src, const uint8_t* rand,
+  int width, int height, int pitch, int range, int thresh, PNeoEnv env)
+{
+  const bool avx2 = IsAVX2Available();
+  ThreadPool::GetInstance().ParallelRows(height, 16, [=](int ystart, int yend) {
+    int xstart = 0;
+    if (avx2) {
+      // AVX2ł8̔{̕܂ŏ
+      cpu_reduce_banding_avx2<pixel_t, sample_mode, blur_first, rand_hash>(
+        dst, src, rand, width, height, pitch, range, thresh, ystart, yend);
+      xstart = width & ~7;
+    }
+    cpu_reduce_banding_rows<pixel_t, sample_mode, blur_first, rand_hash>(
+      dst, src, rand, width, height, pitch, range, thresh, xstart, ystart, yend);
+  });
+}
+
+template <typename pixel_t, int sample_mode, bool blur_first, bool rand_hash>
 __global__ void kl_reduce_banding(
   pixel_t* __restrict__ dst, const pixel_t* __restrict__ src, const uint8_t* __restrict__ rand,
   int width, int height, int pitch, int range, int thresh)
@@ -334,8 +399,10 @@ __global__ void kl_reduce_banding(
   if (x < width && y < height) {
 
     int range_limited = min(min(range, y), min(height - y - 1, min(x, width - x - 1)));
-    int refA = random_range(rand[offset + rand_step * 0], range_limited);
-    int refB = random_range(rand[offset + rand_step * 1], range_limited);
+    int randA, randB;
+    deband_random<rand_hash>(rand, rand_step, y * width + x, x, y, randA, randB);
+    int refA = random_range(randA, range_limited);
+    int refB = random_range(randB, range_limited);
 
     int src_val = src[offset];
     int avg, diff;
@@ -380,7 +447,7 @@ __global__ void kl_reduce_banding(
   }
 }
 
-template <typename pixel_t, int sample_mode, bool blur_first>
+template <typename pixel_t, int sample_mode, bool blur_first, bool rand_hash>
 void launch_reduce_banding(
   pixel_t* dst, const pixel_t* src, const uint8_t* rand,
   int width, int height, int pitch, int range, int thresh, PNeoEnv env)
@@ -388,7 +455,7 @@ void launch_reduce_banding(
 	cudaStream_t stream = static_cast<cudaStream_t>(env->GetDeviceStream());
   dim3 threads(32, 16);
   dim3 blocks(nblocks(width, threads.x), nblocks(height, threads.y));
-  kl_reduce_banding<pixel_t, sample_mode, blur_first> << <blocks, threads, 0, stream >> > (
+  kl_reduce_banding<pixel_t, sample_mode, blur_first, rand_hash> << <blocks, threads, 0, stream >> > (
     dst, src, rand, width, height, pitch, range, thresh);
 }
 
@@ -415,13 +482,18 @@ class KDeband : public KDebandBase
   int thresh;
   int sample_mode;
   bool blur_first;
+  bool rand_hash;
 
-  std::unique_ptr<DeviceLocalData<uint8_t>> rand;
+  // TCYKDeband͓e[uL rand_hash=truêƂ͕sv
+  std::shared_ptr<DeviceLocalData<uint8_t>> rand;
 
-  DeviceLocalData<uint8_t>* CreateDebandRandom(int width, int height, int seed, PNeoEnv env)
+  std::shared_ptr<DeviceLocalData<uint8_t>> CreateDebandRandom(int width, int height, int seed, PNeoEnv env)
   {
-    const int max_per_pixel = 2;
-    int length = width * height * max_per_pixel;
+    if (rand_hash) {
+      return nullptr;
+    }
+
+    int length = width * height * DEBAND_RAND_PER_PIXEL;
     auto rand_buf = std::unique_ptr<uint8_t[]>(new uint8_t[length]);
 
     XorShift xor (seed);
@@ -435,7 +507,7 @@ class KDeband : public KDebandBase
       memcpy(&rand_buf[i], &r, length - i);
     }
 
-    return new DeviceLocalData<uint8_t>(rand_buf.get(), length, env);
+    return DeviceLocalData<uint8_t>::GetShared(rand_buf.get(), length, env);
   }
 
   template <typename pixel_t>
@@ -456,31 +528,43 @@ class KDeband : public KDebandBase
     int widthUV = vi.width >> logUVx;
     int heightUV = vi.height >> logUVy;
 
-    const uint8_t* prand = rand->GetData(env);
+    const uint8_t* prand = rand ? rand->GetData(env) : nullptr;
 
-    void(*table[2][6])(
+    void(*table[2][12])(
       pixel_t* dst, const pixel_t* src, const uint8_t* rand,
       int width, int height, int pitch, int range, int thresh, PNeoEnv env) =
     {
       {
-        cpu_reduce_banding<pixel_t, 0, false>,
-        cpu_reduce_banding<pixel_t, 0, true>,
-        cpu_reduce_banding<pixel_t, 1, false>,
-        cpu_reduce_banding<pixel_t, 1, true>,
-        cpu_reduce_banding<pixel_t, 2, false>,
-        cpu_reduce_banding<pixel_t, 2, true>,
+        cpu_reduce_banding<pixel_t, 0, false, false>,
+        cpu_reduce_banding<pixel_t, 0, true, false>,
+        cpu_reduce_banding<pixel_t, 1, false, false>,
+        cpu_reduce_banding<pixel_t, 1, true, false>,
+        cpu_reduce_banding<pixel_t, 2, false, false>,
+        cpu_reduce_banding<pixel_t, 2, true, false>,
+        cpu_reduce_banding<pixel_t, 0, false, true>,
+        cpu_reduce_banding<pixel_t, 0, true, true>,
+        cpu_reduce_banding<pixel_t, 1, false, true>,
+        cpu_reduce_banding<pixel_t, 1, true, true>,
+        cpu_reduce_banding<pixel_t, 2, false, true>,
+        cpu_reduce_banding<pixel_t, 2, true, true>,
       },
       {
-        launch_reduce_banding<pixel_t, 0, false>,
-        launch_reduce_banding<pixel_t, 0, true>,
-        launch_reduce_banding<pixel_t, 1, false>,
-        launch_reduce_banding<pixel_t, 1, true>,
-        launch_reduce_banding<pixel_t, 2, false>,
-        launch_reduce_banding<pixel_t, 2, true>,
+        launch_reduce_banding<pixel_t, 0, false, false>,
+        launch_reduce_banding<pixel_t, 0, true, false>,
+        launch_reduce_banding<pixel_t, 1, false, false>,
+        launch_reduce_banding<pixel_t, 1, true, false>,
+        launch_reduce_banding<pixel_t, 2, false, false>,
+        launch_reduce_banding<pixel_t, 2, true, false>,
+        launch_reduce_banding<pixel_t, 0, false, true>,
+        launch_reduce_banding<pixel_t, 0, true, true>,
+        launch_reduce_banding<pixel_t, 1, false, true>,
+        launch_reduce_banding<pixel_t, 1, true, true>,
+        launch_reduce_banding<pixel_t, 2, false, true>,
+        launch_reduce_banding<pixel_t, 2, true, true>,
       }
     };
 
-    int table_idx = sample_mode * 2 + (blur_first ? 1 : 0);
+    int table_idx = (rand_hash ? 6 : 0) + sample_mode * 2 + (blur_first ? 1 : 0);
 
     if (IS_CUDA) {
       table[1][table_idx](dstY, srcY, prand, vi.width, vi.height, pitchY, range, thresh, env);
@@ -500,12 +584,13 @@ class KDeband : public KDebandBase
   }
 
 public:
-  KDeband(PClip clip, int range, float thresh, int sample_mode, bool blur_first, PNeoEnv env)
+  KDeband(PClip clip, int range, float thresh, int sample_mode, bool blur_first, bool rand_hash, PNeoEnv env)
     : KDebandBase(clip)
     , range(range)
     , thresh(scaleParam(thresh, vi.BitsPerComponent()))
     , sample_mode(sample_mode)
     , blur_first(blur_first)
+    , rand_hash(rand_hash)
     , rand(CreateDebandRandom(vi.width, vi.height, 0, env))
   {
     if (sample_mode != 0 && sample_mode != 1 && sample_mode != 2) {
@@ -545,10 +630,118 @@ public:
       (float)args[2].AsFloat(1), // thresh
       args[3].AsInt(1),          // sample_mode
       args[4].AsBool(false),     // blur_first
+      args[5].AsBool(false),     // rand_hash
       env);
   }
 };
 
+// KDebandCPUJ[l̃}CNx`}[N
+// 1v[S[hɂCłAVX2łŌvAʂvȂ΃G[
+// 8̔{ɂȂŁAAVX2ł̌Cłŏ[̕܂߂
+template <typename pixel_t>
+static std::string DebandBench(int iterations, int bits, PNeoEnv env)
+{
+  enum { WIDTH = 1918, HEIGHT = 1080, RANGE = 15 };
+  const int pitch = WIDTH + 66;
+  const int thresh = scaleParam(4, bits);
+
+  // ̃Of[VɃmCY悹
+  std::vector<pixel_t> src(pitch * HEIGHT);
+  unsigned int rnd = 2463534242u;
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < pitch; ++x) {
+      int base = (x >> 3) & 0xFF;
+      rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;
+      src[x + y * pitch] = (pixel_t)(std::min(base + (int)(rnd & 7), 255) << (bits - 8));
+    }
+  }
+
+  // e[uKDebandƓ傫
+  std::vector<uint8_t> rand(WIDTH * HEIGHT * DEBAND_RAND_PER_PIXEL);
+  XorShift rng(0);
+  for (int i = 0; i < (int)rand.size(); ++i) {
+    rand[i] = (uint8_t)rng.next();
+  }
+
+  typedef void(*ROWS)(pixel_t*, const pixel_t*, const uint8_t*, int, int, int, int, int, int, int, int);
+  typedef void(*ROWS_AVX2)(pixel_t*, const pixel_t*, const uint8_t*, int, int, int, int, int, int, int);
+  struct Impl {
+    const char* name;
+    ROWS c;
+    ROWS_AVX2 avx2;
+  };
+  const Impl impls[] = {
+    { "Mode0F", cpu_reduce_banding_rows<pixel_t, 0, false, false>, cpu_reduce_banding_avx2<pixel_t, 0, false, false> },
+    { "Mode0T", cpu_reduce_banding_rows<pixel_t, 0, true, false>, cpu_reduce_banding_avx2<pixel_t, 0, true, false> },
+    { "Mode1F", cpu_reduce_banding_rows<pixel_t, 1, false, false>, cpu_reduce_banding_avx2<pixel_t, 1, false, false> },
+    { "Mode1T", cpu_reduce_banding_rows<pixel_t, 1, true, false>, cpu_reduce_banding_avx2<pixel_t, 1, true, false> },
+    { "Mode2F", cpu_reduce_banding_rows<pixel_t, 2, false, false>, cpu_reduce_banding_avx2<pixel_t, 2, false, false> },
+    { "Mode2T", cpu_reduce_banding_rows<pixel_t, 2, true, false>, cpu_reduce_banding_avx2<pixel_t, 2, true, false> },
+    { "Mode0F_Hash", cpu_reduce_banding_rows<pixel_t, 0, false, true>, cpu_reduce_banding_avx2<pixel_t, 0, false, true> },
+    { "Mode0T_Hash", cpu_reduce_banding_rows<pixel_t, 0, true, true>, cpu_reduce_banding_avx2<pixel_t, 0, true, true> },
+    { "Mode1F_Hash", cpu_reduce_banding_rows<pixel_t, 1, false, true>, cpu_reduce_banding_avx2<pixel_t, 1, false, true> },
+    { "Mode1T_Hash", cpu_reduce_banding_rows<pixel_t, 1, true, true>, cpu_reduce_banding_avx2<pixel_t, 1, true, true> },
+    { "Mode2F_Hash", cpu_reduce_banding_rows<pixel_t, 2, false, true>, cpu_reduce_banding_avx2<pixel_t, 2, false, true> },
+    { "Mode2T_Hash", cpu_reduce_banding_rows<pixel_t, 2, true, true>, cpu_reduce_banding_avx2<pixel_t, 2, true, true> },
+  };
+
+  const bool avx2 = IsAVX2Available();
+  std::string result;
+  char buf[256];
+
+  for (const Impl& impl : impls) {
+    std::vector<pixel_t> ref(pitch * HEIGHT), dst(pitch * HEIGHT);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+      impl.c(ref.data(), src.data(), rand.data(), WIDTH, HEIGHT, pitch, RANGE, thresh, 0, 0, HEIGHT);
+    }
+    auto mid = std::chrono::high_resolution_clock::now();
+    if (avx2) {
+      // cpu_reduce_bandingƓS
+      for (int it = 0; it < iterations; ++it) {
+        impl.avx2(dst.data(), src.data(), rand.data(), WIDTH, HEIGHT, pitch, RANGE, thresh, 0, HEIGHT);
+        impl.c(dst.data(), src.data(), rand.data(), WIDTH, HEIGHT, pitch, RANGE, thresh, WIDTH & ~7, 0, HEIGHT);
+      }
+      if (memcmp(dst.data(), ref.data(), sizeof(pixel_t) * dst.size())) {
+        env->ThrowError("[KDebandBench] %dbit %s: AVX2̌ʂCƈv܂", bits, impl.name);
+      }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double cMs = std::chrono::duration<double, std::milli>(mid - start).count() / iterations;
+    double avx2Ms = std::chrono::duration<double, std::milli>(end - mid).count() / iterations;
+    if (avx2) {
+      sprintf(buf, "%2dbit %-11s: C %8.3f ms/plane AVX2 %8.3f ms/plane\n", bits, impl.name, cMs, avx2Ms);
+    }
+    else {
+      sprintf(buf, "%2dbit %-11s: C %8.3f ms/plane\n", bits, impl.name, cMs);
+    }
+    printf("%s", buf);
+    result += buf;
+  }
+
+  return result;
+}
+
+static AVSValue __cdecl KDebandBench(AVSValue args, void* user_data, IScriptEnvironment* env_)
+{
+  PNeoEnv env = env_;
+  int bits = args[0].AsInt(8);
+  int iterations = args[1].AsInt(100);
+  std::string result;
+  if (bits == 8) {
+    result = DebandBench<uint8_t>(iterations, bits, env);
+  }
+  else if (bits > 8 && bits <= 16) {
+    result = DebandBench<uint16_t>(iterations, bits, env);
+  }
+  else {
+    env->ThrowError("[KDebandBench] Unsupported bits %d", bits);
+  }
+  return env->SaveString(result.c_str());
+}
+
 template <typename pixel_t>
 void cpu_copy(pixel_t* dst, const pixel_t* __restrict__ src, int width, int height, int pitch)
 {
@@ -1582,7 +1775,8 @@ public:
 void AddFuncDebandKernel(IScriptEnvironment* env)
 {
   env->AddFunction("KTemporalNR", "c[dist]i[thresh]f", KTemporalNR::Create, 0);
-  env->AddFunction("KDeband", "c[range]i[thresh]f[sample]i[blur_first]b", KDeband::Create, 0);
+  env->AddFunction("KDeband", "c[range]i[thresh]f[sample]i[blur_first]b[rand_hash]b", KDeband::Create, 0);
+  env->AddFunction("KDebandBench", "[bits]i[iterations]i", KDebandBench, 0);
   env->AddFunction("KEdgeLevel", "c[str]i[thrs]f[repair]i[struv]i[show]b", KEdgeLevel::Create, 0);
 }
 
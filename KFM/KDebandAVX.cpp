@@ -0,0 +1,169 @@
+#include <stdint.h>
+#include <avisynth.h>
+
+#include <algorithm>
+
+#include <immintrin.h>
+
+// KDebandCPU(AVX2)
+// 8f32bitɍLďAQƉfgatherŏW߂
+// ʂKDeband.cucpu_reduce_banding_rowsƊSɈv
+// 8̔{𒴂镔͌ĂяoCłŏ
+
+// KDeband.cudeband_hashƓ
+static inline __m256i deband_hash_avx2(__m256i x, int y)
+{
+  __m256i h = _mm256_xor_si256(
+    _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x9E3779B1u)),
+    _mm256_set1_epi32((int)((uint32_t)y * 0x85EBCA77u)));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+  h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x7FEB352D));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+  h = _mm256_mullo_epi32(h, _mm256_set1_epi32((int)0x846CA68Bu));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+  return h;
+}
+
+// random_rangeƓ rangecharɕϊĂg
+static inline __m256i random_range_avx2(__m256i random, __m256i range)
+{
+  return _mm256_sub_epi32(_mm256_srai_epi32(_mm256_mullo_epi32(
+    _mm256_add_epi32(_mm256_slli_epi32(range, 1), _mm256_set1_epi32(1)), random), 8), range);
+}
+
+template <typename pixel_t> struct DebandAVX2 { };
+
+template <> struct DebandAVX2<uint8_t> {
+  static __m256i load(const uint8_t* p) { return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p)); }
+  static void store(uint8_t* p, __m256i v) {
+    v = _mm256_packus_epi16(_mm256_packus_epi32(v, v), v);
+    _mm_storel_epi64((__m128i*)p, _mm_unpacklo_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+  }
+};
+
+template <> struct DebandAVX2<uint16_t> {
+  static __m256i load(const uint16_t* p) { return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p)); }
+  static void store(uint16_t* p, __m256i v) {
+    v = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+    _mm_storeu_si128((__m128i*)p, _mm256_castsi256_si128(v));
+  }
+};
+
+// src[idx]W߂
+// gather4oCgǂނ̂ŁAv[Ō̉f̌͂ݏoȂ悤
+// Ō͎̕OǂŃVtg
+template <typename pixel_t>
+static inline __m256i gather_pixels(const pixel_t* src, __m256i idx, __m256i lastBase)
+{
+  __m256i base = _mm256_min_epi32(idx, lastBase);
+  __m256i shift = _mm256_slli_epi32(_mm256_sub_epi32(idx, base), (sizeof(pixel_t) == 1) ? 3 : 4);
+  __m256i v = _mm256_i32gather_epi32((const int*)src, base, sizeof(pixel_t));
+  v = _mm256_srlv_epi32(v, shift);
+  return _mm256_and_si256(v, _mm256_set1_epi32((sizeof(pixel_t) == 1) ? 0xFF : 0xFFFF));
+}
+
+template <typename pixel_t, int sample_mode, bool blur_first, bool rand_hash>
+void cpu_reduce_banding_avx2(
+  pixel_t* dst, const pixel_t* src, const uint8_t* rand,
+  int width, int height, int pitch, int range, int thresh, int ystart, int yend)
+{
+  typedef DebandAVX2<pixel_t> K;
+
+  const int rand_step = width * height;
+  const int width8 = width & ~7;
+  const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i vpitch = _mm256_set1_epi32(pitch);
+  const __m256i vthresh = _mm256_set1_epi32(thresh);
+  const __m256i vright = _mm256_set1_epi32(width - 1);
+  const __m256i lastBase = _mm256_set1_epi32(
+    (height - 1) * pitch + width - 1 - (4 / (int)sizeof(pixel_t) - 1));
+
+  for (int y = ystart; y < yend; ++y) {
+    const __m256i rowLimit = _mm256_set1_epi32(std::min(range, std::min(y, height - y - 1)));
+    for (int x = 0; x < width8; x += 8) {
+      const int offset = y * pitch + x;
+      const int rand_offset = y * width + x; // e[upitchɂ炸widthŕׂĂ
+      __m256i vx = _mm256_add_epi32(_mm256_set1_epi32(x), lane);
+      __m256i voffset = _mm256_add_epi32(_mm256_set1_epi32(offset), lane);
+
+      __m256i range_limited = _mm256_min_epi32(rowLimit, _mm256_min_epi32(vx, _mm256_sub_epi32(vright, vx)));
+      range_limited = _mm256_srai_epi32(_mm256_slli_epi32(range_limited, 24), 24);
+
+      __m256i randA, randB;
+      if (rand_hash) {
+        __m256i h = deband_hash_avx2(vx, y);
+        randA = _mm256_and_si256(h, _mm256_set1_epi32(0xFF));
+        randB = _mm256_and_si256(_mm256_srli_epi32(h, 8), _mm256_set1_epi32(0xFF));
+      }
+      else {
+        randA = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&rand[rand_offset + rand_step * 0]));
+        randB = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&rand[rand_offset + rand_step * 1]));
+      }
+      __m256i refA = random_range_avx2(randA, range_limited);
+      __m256i refB = random_range_avx2(randB, range_limited);
+
+      __m256i src_val = K::load(&src[offset]);
+      __m256i avg, diff;
+
+      if (sample_mode == 0) {
+        __m256i ref = _mm256_add_epi32(_mm256_mullo_epi32(refA, vpitch), refB);
+
+        avg = gather_pixels(src, _mm256_add_epi32(voffset, ref), lastBase);
+        diff = _mm256_abs_epi32(_mm256_sub_epi32(src_val, avg));
+      }
+      else if (sample_mode == 1) {
+        __m256i ref = _mm256_add_epi32(_mm256_mullo_epi32(refA, vpitch), refB);
+
+        __m256i ref_p = gather_pixels(src, _mm256_add_epi32(voffset, ref), lastBase);
+        __m256i ref_m = gather_pixels(src, _mm256_sub_epi32(voffset, ref), lastBase);
+
+        avg = _mm256_srai_epi32(_mm256_add_epi32(ref_p, ref_m), 1);
+        diff = blur_first
+          ? _mm256_abs_epi32(_mm256_sub_epi32(src_val, avg))
+          : _mm256_max_epi32(
+            _mm256_abs_epi32(_mm256_sub_epi32(src_val, ref_p)),
+            _mm256_abs_epi32(_mm256_sub_epi32(src_val, ref_m)));
+      }
+      else {
+        __m256i ref_0 = _mm256_add_epi32(_mm256_mullo_epi32(refA, vpitch), refB);
+        __m256i ref_1 = _mm256_sub_epi32(refA, _mm256_mullo_epi32(refB, vpitch));
+
+        __m256i ref_0p = gather_pixels(src, _mm256_add_epi32(voffset, ref_0), lastBase);
+        __m256i ref_0m = gather_pixels(src, _mm256_sub_epi32(voffset, ref_0), lastBase);
+        __m256i ref_1p = gather_pixels(src, _mm256_add_epi32(voffset, ref_1), lastBase);
+        __m256i ref_1m = gather_pixels(src, _mm256_sub_epi32(voffset, ref_1), lastBase);
+
+        avg = _mm256_srai_epi32(_mm256_add_epi32(
+          _mm256_add_epi32(ref_0p, ref_0m), _mm256_add_epi32(ref_1p, ref_1m)), 2);
+        diff = blur_first
+          ? _mm256_abs_epi32(_mm256_sub_epi32(src_val, avg))
+          : _mm256_max_epi32(
+            _mm256_max_epi32(
+              _mm256_abs_epi32(_mm256_sub_epi32(src_val, ref_0p)),
+              _mm256_abs_epi32(_mm256_sub_epi32(src_val, ref_0m))),
+            _mm256_max_epi32(
+              _mm256_abs_epi32(_mm256_sub_epi32(src_val, ref_1p)),
+              _mm256_abs_epi32(_mm256_sub_epi32(src_val, ref_1m))));
+      }
+
+      // diff > thresh Ȃsrc_val
+      __m256i result = _mm256_blendv_epi8(avg, src_val, _mm256_cmpgt_epi32(diff, vthresh));
+      K::store(&dst[offset], result);
+    }
+  }
+}
+
+#define DEBAND_AVX2_INSTANTIATE(pixel_t, rand_hash) \
+  template void cpu_reduce_banding_avx2<pixel_t, 0, false, rand_hash>(pixel_t*, const pixel_t*, const uint8_t*, int, int, int, int, int, int, int); \
+  template void cpu_reduce_banding_avx2<pixel_t, 0, true, rand_hash>(pixel_t*, const pixel_t*, const uint8_t*, int, int, int, int, int, int, int); \
+  template void cpu_reduce_banding_avx2<pixel_t, 1, false, rand_hash>(pixel_t*, const pixel_t*, const uint8_t*, int, int, int, int, int, int, int); \
+  template void cpu_reduce_banding_avx2<pixel_t, 1, true, rand_hash>(pixel_t*, const pixel_t*, const uint8_t*, int, int, int, int, int, int, int); \
+  template void cpu_reduce_banding_avx2<pixel_t, 2, false, rand_hash>(pixel_t*, const pixel_t*, const uint8_t*, int, int, int, int, int, int, int); \
+  template void cpu_reduce_banding_avx2<pixel_t, 2, true, rand_hash>(pixel_t*, const pixel_t*, const uint8_t*, int, int, int, int, int, int, int);
+
+DEBAND_AVX2_INSTANTIATE(uint8_t, false)
+DEBAND_AVX2_INSTANTIATE(uint8_t, true)
+DEBAND_AVX2_INSTANTIATE(uint16_t, false)
+DEBAND_AVX2_INSTANTIATE(uint16_t, true)
+
+#undef DEBAND_AVX2_INSTANTIATE
@@ -14,6 +14,7 @@
 #include "KMV.h"
 #include "KFM.h"
 #include "Copy.h"
+#include "ResultFile.h"
 
 void OnCudaError(cudaError_t err) {
 #if 1 // fobOpi{Ԃ͎菜j
@@ -40,56 +41,6 @@ bool IsAligned(Frame& frame, const VideoInfo& vi, PNeoEnv env) {
 	return true;
 }
 
-class File
-{
-public:
-  File(const std::string& path, const char* mode, IScriptEnvironment* env) {
-    fp_ = _fsopen(path.c_str(), mode, _SH_DENYNO);
-    if (fp_ == NULL) {
-      env->ThrowError("failed to open file %s", path.c_str());
-    }
-  }
-  ~File() {
-    fclose(fp_);
-  }
-  void write(uint8_t* ptr, size_t sz, IScriptEnvironment* env) const {
-    if (sz == 0) return;
-    if (fwrite(ptr, sz, 1, fp_) != 1) {
-      env->ThrowError("failed to write to file");
-    }
-  }
-  template <typename T>
-  void writeValue(T v, IScriptEnvironment* env) const {
-    write((uint8_t*)&v, sizeof(T), env);
-  }
-  size_t read(uint8_t* ptr, size_t sz, IScriptEnvironment* env) const {
-    if (sz == 0) return 0;
-    size_t ret = fread(ptr, 1, sz, fp_);
-    if (ret <= 0) {
-      env->ThrowError("failed to read from file");
-    }
-    return ret;
-  }
-  template <typename T>
-  T readValue(IScriptEnvironment* env) const {
-    T v;
-    if (read((uint8_t*)&v, sizeof(T), env) != sizeof(T)) {
-      env->ThrowError("failed to read value from file");
-    }
-    return v;
-  }
-  static bool exists(const std::string& path) {
-    FILE* fp_ = _fsopen(path.c_str(), "rb", _SH_DENYNO);
-    if (fp_) {
-      fclose(fp_);
-      return true;
-    }
-    return false;
-  }
-private:
-  FILE * fp_;
-};
-
 int GetDeviceTypes(const PClip& clip)
 {
   int devtypes = (clip->GetVersion() >= 5) ? clip->SetCacheHints(CACHE_GET_DEV_TYPE, 0) : 0;
@@ -478,6 +429,43 @@ class KFMCycleAnalyze : public GenericVideoFilter
   std::vector<KFMResult> results;
   std::unique_ptr<TextFile> debugFile;
 
+  // ʃt@Ci1pXڂ͏݁A2pXڂ͓ǂݍ݁j
+  // 1pXڂcheckpointCyclesƂɃ`FbN|CgAŊJ炻ĊJ
+  // ĊJƂmatch蒼悤ɁA`FbN|CgnumCyclescurrentłȂ
+  // 2pXڂ͍ŏGetFramefingerprintmF
+  std::unique_ptr<KFMResultFile> resultFile;
+  int checkpointCycles;
+  int checkpointCycle; // ŌɃ`FbN|CgƂcurrent
+  bool fingerprintChecked;
+
+  // `FbN|CgɕۑĊJp̏
+  // ʂ̍ŐVResumeWindow()̓p^[؂ւŌォ珑邱Ƃ̂ŁA̕ɓ
+  // ̌ KFMResult recent[ResumeWindow()], tail[ResumeWindow()] 
+  struct ResumeState {
+    int current;
+    int pattern;
+    int numRecent;
+    int numTail;
+  };
+
+  // 1pXڂ̐ǂ
+  // KPreCycleAnalyze܂ł̓t[ƂɓƗȂ̂ŁÃTCNFMData[J[XbhŕɍĂ
+  // p^[؂ւ̔͑ÕTCŇʂɈˑ̂ŁA܂Œʂcurrent̏ɏ
+  // prefetchTCN̃ob`ɂāA1gĂԂɎ̃ob`擾
+  struct PrefetchJob {
+    KFMCycleAnalyze* self;
+    int cycle;
+    FMData data;
+    std::string error;
+  };
+  struct PrefetchBatch {
+    int start;
+    std::vector<PrefetchJob> jobs;
+    IJobCompletion* completion;
+  };
+  int prefetch;
+  std::deque<std::unique_ptr<PrefetchBatch>> prefetchBatches;
+
   // e|
   std::deque<KFMResult> recentBest;
   int pattern;
@@ -518,6 +506,155 @@ class KFMCycleAnalyze : public GenericVideoFilter
     return data;
   }
 
+  static AVSValue PrefetchWorker(IScriptEnvironment2* env, void* data)
+  {
+    PrefetchJob* job = static_cast<PrefetchJob*>(data);
+    try {
+      job->data = job->self->GetFMData(job->cycle, env);
+    }
+    catch (const AvisynthError& err) {
+      job->error = err.msg;
+    }
+    catch (...) {
+      job->error = "[KFMCycleAnalyze] prefetch failed";
+    }
+    return AVSValue();
+  }
+
+  void StartPrefetch(int start, PNeoEnv env)
+  {
+    int end = std::min(start + prefetch, numCycles);
+    if (start >= end) {
+      return;
+    }
+    // jobs̃AhX[J[ɓn̂ŁAOɑSĂ
+    std::unique_ptr<PrefetchBatch> batch(new PrefetchBatch());
+    batch->start = start;
+    batch->jobs.resize(end - start);
+    batch->completion = env->NewCompletion(end - start);
+    for (int i = 0; i < end - start; ++i) {
+      batch->jobs[i].self = this;
+      batch->jobs[i].cycle = start + i;
+      env->ParallelJob(PrefetchWorker, &batch->jobs[i], batch->completion);
+    }
+    prefetchBatches.push_back(std::move(batch));
+  }
+
+  void PopPrefetch()
+  {
+    PrefetchBatch* batch = prefetchBatches.front().get();
+    batch->completion->Wait();
+    batch->completion->Destroy();
+    prefetchBatches.pop_front();
+  }
+
+  void ClearPrefetch()
+  {
+    while (prefetchBatches.size()) {
+      PopPrefetch();
+    }
+  }
+
+  FMData GetFMDataPrefetched(int cycle, PNeoEnv env)
+  {
+    if (prefetch <= 0) {
+      return GetFMData(cycle, env);
+    }
+    // ǂ݂Ovꂽ蒼i1pXڂ͏ɗ̂Œʏ͋NȂj
+    if (prefetchBatches.size() && cycle < prefetchBatches.front()->start) {
+      ClearPrefetch();
+    }
+    while (prefetchBatches.size() &&
+      cycle >= prefetchBatches.front()->start + (int)prefetchBatches.front()->jobs.size())
+    {
+      PopPrefetch();
+    }
+    if (prefetchBatches.empty()) {
+      StartPrefetch(cycle, env);
+    }
+    PrefetchBatch* batch = prefetchBatches.front().get();
+    if (prefetchBatches.size() == 1) {
+      // ̃ob`𓊂Ă
+      StartPrefetch(batch->start + (int)batch->jobs.size(), env);
+    }
+    batch->completion->Wait();
+    const PrefetchJob& job = batch->jobs[cycle - batch->start];
+    if (job.error.size()) {
+      env->ThrowError("%s", job.error.c_str());
+    }
+    return job.data;
+  }
+
+  int ResumeWindow() const { return pastCycles + 1; }
+  int ResumeStateBytes() const { return sizeof(ResumeState) + sizeof(KFMResult) * ResumeWindow() * 2; }
+
+  // p[^ƃ\[X̓ei擪ƒԂ̃TCNj
+  uint64_t MakeFingerprint(IScriptEnvironment* env)
+  {
+    float fparams[] = { lscale, costth, adj2224, adj30, NGThresh, th60, th24, rel24 };
+    int iparams[] = { srcvi.width, srcvi.height, numCycles, cycleRange, pastCycles };
+    uint64_t h = 14695981039346656037ULL;
+    h = KFMResultFile::Hash(h, fparams, sizeof(fparams));
+    h = KFMResultFile::Hash(h, iparams, sizeof(iparams));
+    int cycles[] = { 0, numCycles / 2 };
+    for (int cycle : cycles) {
+      FMData data = GetFMData(cycle, env);
+      h = KFMResultFile::Hash(h, &data, sizeof(data));
+    }
+    return h;
+  }
+
+  void OpenResultFile(IScriptEnvironment* env)
+  {
+    resultFile = std::unique_ptr<KFMResultFile>(new KFMResultFile(filepath + ".result.dat",
+      KFMResultFile::KIND_CYCLE_RESULT, MakeFingerprint(env),
+      sizeof(KFMResult), numCycles + cycleRange, ResumeStateBytes(), env));
+
+    const KFMResult* stored = static_cast<const KFMResult*>(resultFile->GetData());
+    if (resultFile->IsComplete()) {
+      // 1pXڂIĂ
+      results.assign(stored, stored + resultFile->GetCount());
+      return;
+    }
+
+    std::vector<uint8_t> buf(ResumeStateBytes());
+    int count = resultFile->ReadCheckpoint(buf.data());
+    if (count > 0) {
+      const ResumeState* state = reinterpret_cast<const ResumeState*>(buf.data());
+      const KFMResult* recent = reinterpret_cast<const KFMResult*>(state + 1);
+      const KFMResult* tail = recent + ResumeWindow();
+      results.assign(stored, stored + count);
+      std::copy(tail, tail + state->numTail, results.end() - state->numTail);
+      recentBest.assign(recent, recent + state->numRecent);
+      pattern = state->pattern;
+      current = state->current;
+      checkpointCycle = current;
+    }
+  }
+
+  // [0,count)̃TCNς
+  void WriteCheckpoint(int count)
+  {
+    // Õ`FbN|Cgς\Ƃ낾
+    KFMResult* stored = static_cast<KFMResult*>(resultFile->GetWritePtr());
+    int start = std::max(0, checkpointCycle - ResumeWindow());
+    std::copy(results.begin() + start, results.begin() + count, stored + start);
+
+    std::vector<uint8_t> buf(ResumeStateBytes());
+    ResumeState* state = reinterpret_cast<ResumeState*>(buf.data());
+    KFMResult* recent = reinterpret_cast<KFMResult*>(state + 1);
+    KFMResult* tail = recent + ResumeWindow();
+    state->current = count;
+    state->pattern = pattern;
+    state->numRecent = (int)recentBest.size();
+    state->numTail = std::min(count, ResumeWindow());
+    std::copy(recentBest.begin(), recentBest.end(), recent);
+    std::copy(results.begin() + count - state->numTail, results.begin() + count, tail);
+    resultFile->WriteCheckpoint(count, buf.data());
+
+    checkpointCycle = count;
+  }
+
   int BestPattern(FMMatch& match)
   {
     auto it = std::max_element(match.shima, match.shima + NUM_PATTERNS);
@@ -571,8 +708,20 @@ class KFMCycleAnalyze : public GenericVideoFilter
     }
   }
 
+  void CheckFingerprint(IScriptEnvironment* env)
+  {
+    if (resultFile->GetFingerprint() != MakeFingerprint(env)) {
+      env->ThrowError("[KFMCycleAnalyze] %s.result.dat was generated from a different source or parameters. please generate again.",
+        filepath.c_str());
+    }
+    fingerprintChecked = true;
+  }
+
   PVideoFrame ExecuteOnePath(int cycle, IScriptEnvironment* env)
   {
+    if (!resultFile) {
+      OpenResultFile(env);
+    }
     if (cycle < results.size()) {
       return MakeFrame(results[cycle], env);
     }
@@ -581,7 +730,7 @@ class KFMCycleAnalyze : public GenericVideoFilter
     int last = (cycle == numCycles - 1) ? (numCycles + cycleRange) : (cycle + 1);
     for (; current < last; ++current) {
       if (current < numCycles) {
-        match = patterns.Matching(GetFMData(current, env),
+        match = patterns.Matching(GetFMDataPrefetched(current, env),
           srcvi.width, srcvi.height, costth, adj2224, adj30);
       }
 
@@ -626,16 +775,20 @@ class KFMCycleAnalyze : public GenericVideoFilter
       if (recentBest.size() > pastCycles) {
         recentBest.pop_back();
       }
+
+      // numCyclesȍ~matchÕTCNp̂łŎ~߂Ȃ
+      if (current + 1 < numCycles && current + 1 - checkpointCycle >= checkpointCycles) {
+        WriteCheckpoint(current + 1);
+      }
     }
 
     if (last == numCycles + cycleRange) {
       // 60p
       Make60p();
-      // Ō̓t@Cɏ
-      File file(filepath + ".result.dat", "wb", env);
-      for (int i = 0; i < numCycles; ++i) {
-        file.writeValue(results[i], env);
-      }
+      // Ō͑SĊɂ
+      KFMResult* stored = static_cast<KFMResult*>(resultFile->GetWritePtr());
+      std::copy(results.begin(), results.begin() + numCycles, stored);
+      resultFile->Complete(numCycles);
       if (debug) {
         debugFile = nullptr;
         auto file = std::unique_ptr<TextFile>(new TextFile(filepath + ".pattern.txt", "w", env));
@@ -658,7 +811,7 @@ public:
     float lscale, float costth, float adj2224, float adj30,
     int cycleRange, float NGThresh, int pastCycles,
     float th60, float th24, float rel24,
-    const std::string& filepath, int debug, IScriptEnvironment* env)
+    const std::string& filepath, int debug, int prefetch, int checkpoint, IScriptEnvironment* env)
     : GenericVideoFilter(fmframe)
     , source(source)
     , srcvi(source->GetVideoInfo())
@@ -677,6 +830,10 @@ public:
     , rel24(rel24)
     , filepath(GetFullPath(filepath)) // GetFrameƃJgfBNgႤ̂ŃtpXɂĂ
     , debug(debug)
+    , checkpointCycles(checkpoint)
+    , checkpointCycle(0)
+    , fingerprintChecked(false)
+    , prefetch(prefetch)
     , pattern(0)
     , current(0)
   {
@@ -689,6 +846,9 @@ public:
     if (mode < 0 || mode > 2) {
       env->ThrowError("[KFMCycleAnalyze] mode(%d) must be in range 0-2", mode);
     }
+    if (checkpoint <= 0) {
+      env->ThrowError("[KFMCycleAnalyze] checkpoint(%d) must be positive", checkpoint);
+    }
 
     if (mode == GEN_PATTERN) {
       if (debug) {
@@ -696,11 +856,9 @@ public:
       }
     }
     else if (mode == READ_PATTERN) {
-      File file(filepath + ".result.dat", "rb", env);
-      for (int i = 0; i < numCycles; ++i) {
-        results.push_back(file.readValue<KFMResult>(env));
-      }
-      if (results.size() != numCycles) {
+      resultFile = std::unique_ptr<KFMResultFile>(new KFMResultFile(filepath + ".result.dat",
+        KFMResultFile::KIND_CYCLE_RESULT, sizeof(KFMResult), env));
+      if (resultFile->GetCount() != numCycles) {
         env->ThrowError("[KFMCycleAnalyze] # of cycles does not match. please generate again.");
       }
     }
@@ -708,6 +866,12 @@ public:
     CycleAnalyzeInfo::SetParam(vi, &info);
   }
 
+  ~KFMCycleAnalyze()
+  {
+    // [J[thisQƂĂ̂ŏI܂ő҂
+    ClearPrefetch();
+  }
+
   PVideoFrame __stdcall GetFrame(int cycle, IScriptEnvironment* env)
   {
     if (mode == REALTIME) {
@@ -717,7 +881,10 @@ public:
       return ExecuteOnePath(cycle, env);
     }
     else if (mode == READ_PATTERN) {
-      return MakeFrame(results[cycle], env);
+      if (!fingerprintChecked) {
+        CheckFingerprint(env);
+      }
+      return MakeFrame(static_cast<const KFMResult*>(resultFile->GetData())[cycle], env);
     }
     return PVideoFrame();
   }
@@ -749,6 +916,8 @@ public:
       (float)args[12].AsFloat(0.2f),           // rell24
       args[13].AsString("kfm"),                // filepath
       args[14].AsInt(0),           // debug
+      args[15].AsInt(8),           // prefetch
+      args[16].AsInt(1000),        // checkpoint
       env
     );
   }
@@ -874,7 +1043,7 @@ void AddFuncFM(IScriptEnvironment* env)
 {
   env->AddFunction("KShowStatic", "cc", KShowStatic::Create, 0);
 
-  env->AddFunction("KFMCycleAnalyze", "cc[mode]i[lscale]f[costth]f[adj2224]f[adj30]f[range]i[thresh]f[past]i[th60]f[th24]f[rel24]f[filepath]s[debug]i", KFMCycleAnalyze::Create, 0);
+  env->AddFunction("KFMCycleAnalyze", "cc[mode]i[lscale]f[costth]f[adj2224]f[adj30]f[range]i[thresh]f[past]i[th60]f[th24]f[rel24]f[filepath]s[debug]i[prefetch]i[checkpoint]i", KFMCycleAnalyze::Create, 0);
   env->AddFunction("Print", "cs[x]i[y]i", Print::Create, 0);
 
   env->AddFunction("KFMDumpFM", "c[filepath]s", KFMDumpFM::Create, 0);
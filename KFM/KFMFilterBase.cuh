@@ -1,6 +1,8 @@
 
 #include <stdint.h>
 #include <avisynth.h>
+#include <mutex>
+#include <vector>
 #include "Frame.h"
 
 struct FrameOldAnalyzeParam {
@@ -63,6 +65,57 @@ public:
   int __stdcall SetCacheHints(int cachehints, int frame_range);
 };
 
+// Asize̓̓t[ێ郊Oobt@
+// ԂɃANZXƂ͑ȎƏdȂ镪g񂵂āAV1GetFrame
+// dȂȂƂi_ANZXj͑S蒼
+// ێĂԂ̓LbVǂoĂČvZȂ
+// MT_NICE_FILTERɌĂ΂̂ŁAGetFrame̓bN̊Oōs
+class FrameWindow
+{
+  std::mutex mutex;
+  int size;
+  int devid;
+  int first; // ێĂt[̐擪ԍ devid < 0Ȃ
+  std::vector<PVideoFrame> frames; // t[ԍkframes[Slot(k)]
+
+  int Slot(int k) const { return ((k % size) + size) % size; }
+
+public:
+  FrameWindow(int size) : size(size), devid(-1), first(0), frames(size) { }
+
+  // [n, n + size)̃t[dstɓ
+  // getFrame(k)̓t[ԍk̃t[Ԃi͈͊ÕNvgetFrameōsj
+  template <typename F>
+  void Get(int n, PVideoFrame* dst, F getFrame, PNeoEnv env)
+  {
+    int dev = env->GetDeviceId();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (devid == dev) {
+        for (int i = 0; i < size; ++i) {
+          int k = n + i;
+          if (k >= first && k < first + size) {
+            dst[i] = frames[Slot(k)];
+          }
+        }
+      }
+    }
+    for (int i = 0; i < size; ++i) {
+      if (!dst[i]) {
+        dst[i] = getFrame(n + i);
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      devid = dev;
+      first = n;
+      for (int i = 0; i < size; ++i) {
+        frames[Slot(n + i)] = dst[i];
+      }
+    }
+  }
+};
+
 static __device__ __host__ int4 CalcCombe(int4 a, int4 b, int4 c, int4 d, int4 e) {
   return abs(a + c * 4 + e - (b + d) * 3);
 }
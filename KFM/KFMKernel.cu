@@ -10,6 +10,7 @@
 #include "CommonFunctions.h"
 #include "KFM.h"
 #include "TextOut.h"
+#include "ResultFile.h"
 
 #include "VectorFunctions.cuh"
 #include "ReduceKernel.cuh"
@@ -438,13 +439,19 @@ class KFMSwitch : public KFMFilterBase
 
 	void WriteToFile(PNeoEnv env)
 	{
-		auto file = std::unique_ptr<TextFile>(new TextFile(filepath + ".duration.txt", "w", env));
-		for (int i = 0; i < (int)durations.size(); ++i) {
-			fprintf(file->fp, "%d\n", durations[i]);
+		{
+			// KFMDecimatep[Xɓǂ߂悤ɃoCiŏ
+			int count = (int)durations.size();
+			int iparams[] = { vi.num_frames, vi.fps_numerator, vi.fps_denominator, count };
+			uint64_t fingerprint = KFMResultFile::Hash(14695981039346656037ULL, iparams, sizeof(iparams));
+			fingerprint = KFMResultFile::Hash(fingerprint, durations.data(), sizeof(int) * count);
+			KFMResultFile file(filepath + ".duration.dat", KFMResultFile::KIND_DURATION,
+				fingerprint, sizeof(int), count, 0, env);
+			std::copy(durations.begin(), durations.end(), static_cast<int*>(file.GetWritePtr()));
+			file.Complete(count);
 		}
-		file = nullptr;
 
-		file = std::unique_ptr<TextFile>(new TextFile(filepath + ".timecode.txt", "w", env));
+		auto file = std::unique_ptr<TextFile>(new TextFile(filepath + ".timecode.txt", "w", env));
 		double elapsed = 0;
 		double tick = (double)vi.fps_denominator / vi.fps_numerator;
 		fprintf(file->fp, "# timecode format v2\n");
@@ -772,26 +779,23 @@ public:
 
 class KFMDecimate : public GenericVideoFilter
 {
-  std::vector<int> durations;
   std::vector<int> framesMap;
 public:
   KFMDecimate(PClip source, const std::string& filepath, IScriptEnvironment* env)
     : GenericVideoFilter(source)
   {
-    auto file = std::unique_ptr<TextFile>(new TextFile(filepath + ".duration.txt", "r", env));
-    char buf[100];
-    while (fgets(buf, sizeof(buf), file->fp) && *buf) {
-      durations.push_back(std::atoi(buf));
-    }
-    int numSourceFrames = std::accumulate(durations.begin(), durations.end(), 0);
+    KFMResultFile file(filepath + ".duration.dat", KFMResultFile::KIND_DURATION, sizeof(int), env);
+    const int* durations = static_cast<const int*>(file.GetData());
+    int numDurations = file.GetCount();
+    int numSourceFrames = std::accumulate(durations, durations + numDurations, 0);
     if (vi.num_frames != numSourceFrames) {
       env->ThrowError("[KFMDecimate] # of frames does not match. %d(%s) vs %d(source clip)",
         (int)numSourceFrames, filepath.c_str(), vi.num_frames);
     }
-    vi.num_frames = (int)durations.size();
-    framesMap.resize(durations.size());
+    vi.num_frames = numDurations;
+    framesMap.resize(numDurations);
     framesMap[0] = 0;
-    for (int i = 0; i < (int)durations.size() - 1; ++i) {
+    for (int i = 0; i < numDurations - 1; ++i) {
       framesMap[i + 1] = framesMap[i] + durations[i];
     }
   }
@@ -70,7 +70,9 @@ class KTemporalDiff : public KFMFilterBase
     N_REFS = DIST * 2 + 1,
   };
 
-  Frame GetRefFrame(int ref, PNeoEnv env)
+  FrameWindow refWindow;
+
+  PVideoFrame GetRefFrame(int ref, PNeoEnv env)
   {
     ref = clamp(ref, 0, vi.num_frames);
     return child->GetFrame(ref, env);
@@ -126,9 +128,11 @@ class KTemporalDiff : public KFMFilterBase
   template <typename pixel_t>
   PVideoFrame GetFrameT(int n, PNeoEnv env)
   {
+    PVideoFrame refs[N_REFS];
+    refWindow.Get(n - DIST, refs, [&](int ref) { return GetRefFrame(ref, env); }, env);
     Frame frames[N_REFS];
     for (int i = 0; i < N_REFS; ++i) {
-      frames[i] = GetRefFrame(i + n - DIST, env);
+      frames[i] = refs[i];
     }
     Frame diff = env->NewVideoFrame(vi);
 
@@ -140,6 +144,7 @@ class KTemporalDiff : public KFMFilterBase
 public:
   KTemporalDiff(PClip clip30, PNeoEnv env)
     : KFMFilterBase(clip30)
+    , refWindow(N_REFS)
   { }
 
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env_)
@@ -248,7 +253,9 @@ class KAnalyzeStatic : public KFMFilterBase
   float thcombe;
   float thdiff;
 
-  Frame GetDiffFrame(int ref, PNeoEnv env)
+  FrameWindow diffWindow;
+
+  PVideoFrame GetDiffFrame(int ref, PNeoEnv env)
   {
     ref = clamp(ref, 0, vi.num_frames);
     return diffclip->GetFrame(ref, env);
@@ -332,9 +339,11 @@ class KAnalyzeStatic : public KFMFilterBase
   template <typename pixel_t>
   PVideoFrame GetFrameT(int n, PNeoEnv env)
   {
+    PVideoFrame diffs[N_DIFFS];
+    diffWindow.Get(n - DIST, diffs, [&](int ref) { return GetDiffFrame(ref, env); }, env);
     Frame diffframes[N_DIFFS];
     for (int i = 0; i < N_DIFFS; ++i) {
-      diffframes[i] = GetDiffFrame(i + n - DIST, env);
+      diffframes[i] = diffs[i];
     }
 
     Frame padded;
@@ -374,6 +383,7 @@ public:
     , thdiff(thdiff)
     , padvi(vi)
     , superclip(pad)
+    , diffWindow(N_DIFFS)
   {
     if (logUVx != 1 || logUVy != 1) env->ThrowError("[KAnalyzeStatic] Unsupported format (only supports YV12)");
 
@@ -0,0 +1,284 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "avisynth.h"
+
+#define NOMINMAX
+#include <windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "ResultFile.h"
+
+struct KFMResultFile::Header
+{
+  enum {
+    MAGIC = 0x524D464B, // "KFMR"
+    VERSION = 1,
+  };
+  uint32_t magic;
+  uint32_t version;
+  int32_t kind;
+  int32_t elemBytes;
+  int32_t capacity;
+  int32_t stateBytes;
+  uint64_t fingerprint;
+  int32_t complete;
+  int32_t count;
+};
+
+struct KFMResultFile::Checkpoint
+{
+  uint64_t seq; // 0͖
+  uint64_t hash; // count,statẽnbV ݓrŗ̂
+  int32_t count;
+  int32_t reserved;
+  // ̌stateBytesoCg̍ĊJpf[^
+};
+
+static size_t align_up(size_t v, size_t a) {
+  return (v + a - 1) / a * a;
+}
+
+KFMResultFile::KFMResultFile(const std::string& path, int kind, uint64_t fingerprint,
+  int elemBytes, int capacity, int stateBytes, PNeoEnv env)
+  : filename(path)
+  , writable(true)
+  , hFile(INVALID_HANDLE_VALUE)
+  , hMapping(NULL)
+  , base(nullptr)
+  , data(nullptr)
+  , slotBytes(align_up(sizeof(Checkpoint) + stateBytes, 64))
+  , stateBytes(stateBytes)
+{
+  const size_t slotsOffset = align_up(sizeof(Header), 64);
+  const size_t dataOffset = align_up(slotsOffset + slotBytes * 2, 4096);
+  fileSize = dataOffset + (size_t)elemBytes * capacity;
+
+  Open(env);
+  data = base + dataOffset;
+
+  Header* header = GetHeader();
+  bool valid =
+    header->magic == Header::MAGIC &&
+    header->version == Header::VERSION &&
+    header->kind == kind &&
+    header->elemBytes == elemBytes &&
+    header->capacity == capacity &&
+    header->stateBytes == stateBytes &&
+    header->fingerprint == fingerprint;
+
+  if (!valid) {
+    //  magic͍Ōɏ
+    header->magic = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    memset(base + slotsOffset, 0, slotBytes * 2);
+    header->version = Header::VERSION;
+    header->kind = kind;
+    header->elemBytes = elemBytes;
+    header->capacity = capacity;
+    header->stateBytes = stateBytes;
+    header->fingerprint = fingerprint;
+    header->complete = 0;
+    header->count = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = Header::MAGIC;
+  }
+}
+
+KFMResultFile::KFMResultFile(const std::string& path, int kind, int elemBytes, PNeoEnv env)
+  : filename(path)
+  , writable(false)
+  , hFile(INVALID_HANDLE_VALUE)
+  , hMapping(NULL)
+  , base(nullptr)
+  , data(nullptr)
+  , fileSize(0)
+  , slotBytes(0)
+  , stateBytes(0)
+{
+  Open(env);
+
+  Header* header = GetHeader();
+  bool valid = fileSize >= sizeof(Header) &&
+    header->magic == Header::MAGIC &&
+    header->version == Header::VERSION &&
+    header->kind == kind &&
+    header->elemBytes == elemBytes &&
+    header->complete &&
+    header->count <= header->capacity;
+  if (valid) {
+    stateBytes = header->stateBytes;
+    slotBytes = align_up(sizeof(Checkpoint) + stateBytes, 64);
+    const size_t slotsOffset = align_up(sizeof(Header), 64);
+    const size_t dataOffset = align_up(slotsOffset + slotBytes * 2, 4096);
+    valid = (fileSize == dataOffset + (size_t)elemBytes * header->capacity);
+    data = base + dataOffset;
+  }
+  if (!valid) {
+    Close();
+    env->ThrowError("%s is not a complete result file. please generate again.", filename.c_str());
+  }
+}
+
+void KFMResultFile::Open(PNeoEnv env)
+{
+  // 1pXڂs2pXڂ̃XNvgJ悤ɂ
+  hFile = CreateFileA(filename.c_str(),
+    writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+    FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+    writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hFile == INVALID_HANDLE_VALUE) {
+    env->ThrowError("failed to open file %s", filename.c_str());
+  }
+
+  LARGE_INTEGER curSize;
+  GetFileSizeEx(hFile, &curSize);
+  if (writable) {
+    // TCYႤt@C͍蒼iTCY0̐VKt@C܂ށj
+    if ((size_t)curSize.QuadPart != fileSize) {
+      LARGE_INTEGER newSize;
+      newSize.QuadPart = (LONGLONG)fileSize;
+      if (!SetFilePointerEx(hFile, newSize, NULL, FILE_BEGIN) || !SetEndOfFile(hFile)) {
+        Close();
+        env->ThrowError("failed to resize file %s", filename.c_str());
+      }
+    }
+  }
+  else {
+    fileSize = (size_t)curSize.QuadPart;
+    if (fileSize == 0) {
+      Close();
+      env->ThrowError("%s is empty. please generate again.", filename.c_str());
+    }
+  }
+
+  hMapping = CreateFileMappingA(hFile, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+    (DWORD)((uint64_t)fileSize >> 32), (DWORD)(fileSize & 0xFFFFFFFF), NULL);
+  if (hMapping == NULL) {
+    Close();
+    env->ThrowError("failed to map file %s", filename.c_str());
+  }
+  base = (uint8_t*)MapViewOfFile(hMapping, writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, fileSize);
+  if (base == nullptr) {
+    Close();
+    env->ThrowError("failed to map file %s", filename.c_str());
+  }
+}
+
+KFMResultFile::~KFMResultFile()
+{
+  Close();
+}
+
+// RXgN^ŗO𓊂ƃfXgN^Ă΂Ȃ̂ŁAOɂĂ
+void KFMResultFile::Close()
+{
+  if (base) {
+    UnmapViewOfFile(base);
+    base = nullptr;
+  }
+  if (hMapping) {
+    CloseHandle(hMapping);
+    hMapping = NULL;
+  }
+  if (hFile != INVALID_HANDLE_VALUE) {
+    CloseHandle(hFile);
+    hFile = INVALID_HANDLE_VALUE;
+  }
+}
+
+bool KFMResultFile::IsComplete() const
+{
+  return GetHeader()->complete != 0;
+}
+
+int KFMResultFile::GetCount() const
+{
+  return IsComplete() ? GetHeader()->count : 0;
+}
+
+uint64_t KFMResultFile::GetFingerprint() const
+{
+  return GetHeader()->fingerprint;
+}
+
+KFMResultFile::Checkpoint* KFMResultFile::GetSlot(int i) const
+{
+  return (Checkpoint*)(base + align_up(sizeof(Header), 64) + slotBytes * i);
+}
+
+static uint64_t HashSlot(int count, const void* state, int stateBytes)
+{
+  uint64_t h = KFMResultFile::Hash(14695981039346656037ULL, &count, sizeof(count));
+  return KFMResultFile::Hash(h, state, stateBytes);
+}
+
+bool KFMResultFile::IsValidSlot(const Checkpoint* slot) const
+{
+  return slot->seq != 0 &&
+    slot->count >= 0 && slot->count <= GetHeader()->capacity &&
+    slot->hash == HashSlot(slot->count, slot + 1, stateBytes);
+}
+
+int KFMResultFile::ReadCheckpoint(void* state) const
+{
+  const Checkpoint* best = nullptr;
+  for (int i = 0; i < 2; ++i) {
+    const Checkpoint* slot = GetSlot(i);
+    if (IsValidSlot(slot) && (best == nullptr || slot->seq > best->seq)) {
+      best = slot;
+    }
+  }
+  if (best == nullptr) {
+    return 0;
+  }
+  memcpy(state, best + 1, stateBytes);
+  return best->count;
+}
+
+void KFMResultFile::WriteCheckpoint(int count, const void* state)
+{
+  // Âi܂͉Ăjɏ
+  Checkpoint* slots[] = { GetSlot(0), GetSlot(1) };
+  uint64_t seq[2];
+  for (int i = 0; i < 2; ++i) {
+    seq[i] = IsValidSlot(slots[i]) ? slots[i]->seq : 0;
+  }
+  Checkpoint* slot = (seq[0] <= seq[1]) ? slots[0] : slots[1];
+
+  // ĂԂ͖ɂĂ
+  volatile uint64_t* pseq = &slot->seq;
+  *pseq = 0;
+  std::atomic_thread_fence(std::memory_order_release);
+  slot->count = count;
+  memcpy(slot + 1, state, stateBytes);
+  slot->hash = HashSlot(count, state, stateBytes);
+  std::atomic_thread_fence(std::memory_order_release);
+  *pseq = std::max(seq[0], seq[1]) + 1;
+
+  // vZXĂOS߂AOSƗꍇɔĂŏoĂ
+  // FlushViewOfFile͏on߂邾Ȃ̂ŁAFlushFileBuffersŃfBXNɓ͂܂ő҂
+  FlushViewOfFile(base, 0);
+  FlushFileBuffers((HANDLE)hFile);
+}
+
+void KFMResultFile::Complete(int count)
+{
+  Header* header = GetHeader();
+  header->count = count;
+  std::atomic_thread_fence(std::memory_order_release);
+  header->complete = 1;
+  FlushViewOfFile(base, 0);
+  FlushFileBuffers((HANDLE)hFile);
+}
+
+uint64_t KFMResultFile::Hash(uint64_t h, const void* data, size_t bytes)
+{
+  // FNV-1a
+  const uint8_t* p = (const uint8_t*)data;
+  for (size_t i = 0; i < bytes; ++i) {
+    h = (h ^ p[i]) * 1099511628211ULL;
+  }
+  return h;
+}
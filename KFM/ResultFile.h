@@ -0,0 +1,70 @@
+#pragma once
+
+#include "avisynth.h"
+#include <stdint.h>
+#include <string>
+
+// 2pX̌ʂۑ郁}bvgt@C
+// KFMCycleAnalyze.result.datAKFMSwitch.duration.datŎg
+// t@C\: Header | `FbN|Cg x2 | vfz
+// 2pXڂ̓p[XɃ}bv̂܂܎QƂ
+// 1pXڂ͒IɃ`FbN|CĝŁArŗĂŌ̃`FbN|CgĊJł
+// `FbN|Cg2݂ɏAĂȂseq傫g
+class KFMResultFile
+{
+public:
+  enum Kind {
+    KIND_CYCLE_RESULT = 1, // KFMResult
+    KIND_DURATION = 2,     // int
+  };
+
+  // ݗpɊJ
+  // kind,fingerprint,elemBytes,capacity,stateByteŝǂꂩႤt@C͍蒼
+  // fingerprint̓p[^ƃ\[X̓e
+  // stateBytes̓`FbN|CgɈꏏɕۑĊJpf[^̃TCY
+  KFMResultFile(const std::string& path, int kind, uint64_t fingerprint,
+    int elemBytes, int capacity, int stateBytes, PNeoEnv env);
+
+  // ǂݍݗpɊJ ĂȂt@C̓G[
+  KFMResultFile(const std::string& path, int kind, int elemBytes, PNeoEnv env);
+
+  ~KFMResultFile();
+
+  bool IsComplete() const;
+  // t@C̗vf
+  int GetCount() const;
+  // ݎɎw肵fingerprint
+  uint64_t GetFingerprint() const;
+
+  const void* GetData() const { return data; }
+  void* GetWritePtr() { return data; }
+
+  // Lȃ`FbN|CgΗvfԂstateɃRs[ Ȃ0
+  int ReadCheckpoint(void* state) const;
+  // [0,count)̗vfƍĊJpstatem肷
+  void WriteCheckpoint(int count, const void* state);
+  // countvfŊ
+  void Complete(int count);
+
+  static uint64_t Hash(uint64_t h, const void* data, size_t bytes);
+
+private:
+  struct Header;
+  struct Checkpoint;
+
+  std::string filename;
+  bool writable;
+  void* hFile;
+  void* hMapping;
+  uint8_t* base;
+  uint8_t* data;
+  size_t fileSize;
+  size_t slotBytes;
+  int stateBytes;
+
+  void Open(PNeoEnv env);
+  void Close();
+  Header* GetHeader() const { return (Header*)base; }
+  Checkpoint* GetSlot(int i) const;
+  bool IsValidSlot(const Checkpoint* slot) const;
+};
@@ -0,0 +1,267 @@
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "DegrainFunctions.h"
+
+// ̋ubN͕s1WX^ɋl߂ď
+// ROW_BYTESoCg x (16/ROW_BYTES)s
+template <int ROW_BYTES>
+static __forceinline __m128i load_rows128(const void* p, int pitch_bytes) {
+  const uint8_t* p8 = reinterpret_cast<const uint8_t*>(p);
+  if (ROW_BYTES == 4) {
+    __m128i v = _mm_cvtsi32_si128(*reinterpret_cast<const int*>(p8));
+    v = _mm_insert_epi32(v, *reinterpret_cast<const int*>(p8 + pitch_bytes), 1);
+    v = _mm_insert_epi32(v, *reinterpret_cast<const int*>(p8 + pitch_bytes * 2), 2);
+    return _mm_insert_epi32(v, *reinterpret_cast<const int*>(p8 + pitch_bytes * 3), 3);
+  }
+  if (ROW_BYTES == 8) {
+    return _mm_unpacklo_epi64(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p8)),
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p8 + pitch_bytes)));
+  }
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p8));
+}
+
+template <int ROW_BYTES>
+static __forceinline void store_rows128(void* p, int pitch_bytes, __m128i v) {
+  uint8_t* p8 = reinterpret_cast<uint8_t*>(p);
+  if (ROW_BYTES == 4) {
+    *reinterpret_cast<int*>(p8) = _mm_cvtsi128_si32(v);
+    *reinterpret_cast<int*>(p8 + pitch_bytes) = _mm_extract_epi32(v, 1);
+    *reinterpret_cast<int*>(p8 + pitch_bytes * 2) = _mm_extract_epi32(v, 2);
+    *reinterpret_cast<int*>(p8 + pitch_bytes * 3) = _mm_extract_epi32(v, 3);
+  }
+  else if (ROW_BYTES == 8) {
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p8), v);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p8 + pitch_bytes), _mm_unpackhi_epi64(v, v));
+  }
+  else {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p8), v);
+  }
+}
+
+// ROW_BYTESoCg x (32/ROW_BYTES)s
+template <int ROW_BYTES>
+static __forceinline __m256i load_rows256(const void* p, int pitch_bytes) {
+  const uint8_t* p8 = reinterpret_cast<const uint8_t*>(p);
+  if (ROW_BYTES == 32) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p8));
+  }
+  const int half = (32 / ROW_BYTES / 2) * pitch_bytes;
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(
+    load_rows128<(ROW_BYTES < 16) ? ROW_BYTES : 16>(p8, pitch_bytes)),
+    load_rows128<(ROW_BYTES < 16) ? ROW_BYTES : 16>(p8 + half, pitch_bytes), 1);
+}
+
+template <int ROW_BYTES>
+static __forceinline void store_rows256(void* p, int pitch_bytes, __m256i v) {
+  uint8_t* p8 = reinterpret_cast<uint8_t*>(p);
+  if (ROW_BYTES == 32) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p8), v);
+    return;
+  }
+  const int half = (32 / ROW_BYTES / 2) * pitch_bytes;
+  store_rows128<(ROW_BYTES < 16) ? ROW_BYTES : 16>(p8, pitch_bytes, _mm256_castsi256_si128(v));
+  store_rows128<(ROW_BYTES < 16) ? ROW_BYTES : 16>(p8 + half, pitch_bytes, _mm256_extracti128_si256(v, 1));
+}
+
+// ̕: src, refB[0], refF[0], refB[1], refF[1], ...
+template <typename pixel_t, int delta>
+static __forceinline void degrain_terms(
+  const pixel_t** ptr, int* pitch, int* weight,
+  const pixel_t *pSrc, int nSrcPitch, const pixel_t **pRefB, const pixel_t **pRefF, int nRefPitch,
+  int WSrc, const int *WRefB, const int *WRefF)
+{
+  ptr[0] = pSrc;
+  pitch[0] = nSrcPitch;
+  weight[0] = WSrc;
+  for (int j = 0; j < delta; ++j) {
+    ptr[1 + j * 2] = pRefB[j];
+    pitch[1 + j * 2] = nRefPitch;
+    weight[1 + j * 2] = WRefB[j];
+    ptr[2 + j * 2] = pRefF[j];
+    pitch[2 + j * 2] = nRefPitch;
+    weight[2 + j * 2] = WRefF[j];
+  }
+}
+
+// 8bit: 2pmaddwd32bitɐϘa
+// d݂͔񕉂ōv256Ȃ̂ŁAʂ>>8ŕK0-255Ɏ܂
+template <int delta, int nBlkWidth, int nBlkHeight>
+static void Degrain_AVX2_8(uint8_t *pDst, int nDstPitch, const uint8_t *pSrc, int nSrcPitch,
+  const uint8_t **pRefB, const uint8_t **pRefF, int nRefPitch,
+  int WSrc, int *WRefB, int *WRefF)
+{
+  enum {
+    NTERMS = 1 + 2 * delta,
+    NPAIRS = (NTERMS + 1) / 2,
+    CW = (nBlkWidth < 16) ? nBlkWidth : 16,
+    ROWS = 16 / CW,
+  };
+
+  const uint8_t* ptr[NPAIRS * 2];
+  int pitch[NPAIRS * 2];
+  int weight[NPAIRS * 2];
+  degrain_terms<uint8_t, delta>(ptr, pitch, weight, pSrc, nSrcPitch, pRefB, pRefF, nRefPitch, WSrc, WRefB, WRefF);
+  // ͊Ȃ̂ōŌ͏d0̃_~[
+  ptr[NTERMS] = pSrc;
+  pitch[NTERMS] = nSrcPitch;
+  weight[NTERMS] = 0;
+
+  __m256i w[NPAIRS];
+  for (int k = 0; k < NPAIRS; ++k) {
+    w[k] = _mm256_set1_epi32((weight[k * 2] & 0xFFFF) | (weight[k * 2 + 1] << 16));
+  }
+  const __m256i rnd = _mm256_set1_epi32(128);
+
+  for (int y = 0; y < nBlkHeight; y += ROWS) {
+    for (int x = 0; x < nBlkWidth; x += CW) {
+      __m256i lo = rnd;
+      __m256i hi = rnd;
+      for (int k = 0; k < NPAIRS; ++k) {
+        __m256i a = _mm256_cvtepu8_epi16(load_rows128<CW>(ptr[k * 2] + y * pitch[k * 2] + x, pitch[k * 2]));
+        __m256i b = _mm256_cvtepu8_epi16(load_rows128<CW>(ptr[k * 2 + 1] + y * pitch[k * 2 + 1] + x, pitch[k * 2 + 1]));
+        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w[k]));
+        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w[k]));
+      }
+      __m256i r = _mm256_packus_epi32(_mm256_srai_epi32(lo, 8), _mm256_srai_epi32(hi, 8));
+      r = _mm256_packus_epi16(r, r);
+      r = _mm256_permute4x64_epi64(r, _MM_SHUFFLE(3, 1, 2, 0));
+      store_rows128<CW>(pDst + y * nDstPitch + x, nDstPitch, _mm256_castsi256_si128(r));
+    }
+  }
+}
+
+// 16bit: ft16bitɎ܂Ȃ̂32bitŏZiۂ߂ȂCłƓj
+template <int delta, int nBlkWidth, int nBlkHeight>
+static void Degrain_AVX2_16(uint16_t *pDst, int nDstPitch, const uint16_t *pSrc, int nSrcPitch,
+  const uint16_t **pRefB, const uint16_t **pRefF, int nRefPitch,
+  int WSrc, int *WRefB, int *WRefF)
+{
+  enum {
+    NTERMS = 1 + 2 * delta,
+    CW = (nBlkWidth < 8) ? nBlkWidth : 8,
+    ROWS = 8 / CW,
+  };
+
+  const uint16_t* ptr[NTERMS];
+  int pitch[NTERMS];
+  int weight[NTERMS];
+  degrain_terms<uint16_t, delta>(ptr, pitch, weight, pSrc, nSrcPitch, pRefB, pRefF, nRefPitch, WSrc, WRefB, WRefF);
+
+  __m256i w[NTERMS];
+  for (int k = 0; k < NTERMS; ++k) {
+    w[k] = _mm256_set1_epi32(weight[k]);
+  }
+
+  for (int y = 0; y < nBlkHeight; y += ROWS) {
+    for (int x = 0; x < nBlkWidth; x += CW) {
+      __m256i acc = _mm256_setzero_si256();
+      for (int k = 0; k < NTERMS; ++k) {
+        __m256i a = _mm256_cvtepu16_epi32(
+          load_rows128<CW * 2>(ptr[k] + y * pitch[k] + x, pitch[k] * sizeof(uint16_t)));
+        acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(a, w[k]));
+      }
+      acc = _mm256_srai_epi32(acc, 8);
+      __m256i r = _mm256_packus_epi32(acc, acc);
+      r = _mm256_permute4x64_epi64(r, _MM_SHUFFLE(3, 1, 2, 0));
+      store_rows128<CW * 2>(pDst + y * nDstPitch + x, nDstPitch * sizeof(uint16_t), _mm256_castsi256_si128(r));
+    }
+  }
+}
+
+// 8bit: pDst += (pSrc * pWin + 256) >> 6
+// (src,1)(win,256)pmaddwdŊۂ߂܂1߂ōς܂
+template <int nBlkWidth, int nBlkHeight>
+static void Overlaps_AVX2_8(short *pDst, int nDstPitch, const uint8_t *pSrc, int nSrcPitch, const short *pWin, int nWinPitch)
+{
+  enum {
+    CW = (nBlkWidth < 16) ? nBlkWidth : 16,
+    ROWS = 16 / CW,
+  };
+
+  const __m256i one = _mm256_set1_epi16(1);
+  const __m256i rnd = _mm256_set1_epi16(256);
+
+  for (int y = 0; y < nBlkHeight; y += ROWS) {
+    for (int x = 0; x < nBlkWidth; x += CW) {
+      __m256i s = _mm256_cvtepu8_epi16(load_rows128<CW>(pSrc + y * nSrcPitch + x, nSrcPitch));
+      __m256i win = load_rows256<CW * 2>(pWin + y * nWinPitch + x, nWinPitch * sizeof(short));
+      __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(s, one), _mm256_unpacklo_epi16(win, rnd));
+      __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(s, one), _mm256_unpackhi_epi16(win, rnd));
+      __m256i v = _mm256_packs_epi32(_mm256_srai_epi32(lo, 6), _mm256_srai_epi32(hi, 6));
+      short* dst = pDst + y * nDstPitch + x;
+      __m256i d = load_rows256<CW * 2>(dst, nDstPitch * sizeof(short));
+      store_rows256<CW * 2>(dst, nDstPitch * sizeof(short), _mm256_add_epi16(d, v));
+    }
+  }
+}
+
+// 16bit: pDst += pSrc * pWin (32bit)
+template <int nBlkWidth, int nBlkHeight>
+static void Overlaps_AVX2_16(int *pDst, int nDstPitch, const uint16_t *pSrc, int nSrcPitch, const short *pWin, int nWinPitch)
+{
+  enum {
+    CW = (nBlkWidth < 8) ? nBlkWidth : 8,
+    ROWS = 8 / CW,
+  };
+
+  for (int y = 0; y < nBlkHeight; y += ROWS) {
+    for (int x = 0; x < nBlkWidth; x += CW) {
+      __m256i s = _mm256_cvtepu16_epi32(
+        load_rows128<CW * 2>(pSrc + y * nSrcPitch + x, nSrcPitch * sizeof(uint16_t)));
+      __m256i win = _mm256_cvtepi16_epi32(
+        load_rows128<CW * 2>(pWin + y * nWinPitch + x, nWinPitch * sizeof(short)));
+      int* dst = pDst + y * nDstPitch + x;
+      __m256i d = load_rows256<CW * 4>(dst, nDstPitch * sizeof(int));
+      store_rows256<CW * 4>(dst, nDstPitch * sizeof(int), _mm256_add_epi32(d, _mm256_mullo_epi32(s, win)));
+    }
+  }
+}
+
+template <typename pixel_t> struct DegrainAVX2 { };
+template <> struct DegrainAVX2<uint8_t> {
+  template <int delta, int W, int H> static DegrainBlockFunction<uint8_t> degrain() { return Degrain_AVX2_8<delta, W, H>; }
+  template <int W, int H> static OverlapBlockFunction<uint8_t> overlaps() { return Overlaps_AVX2_8<W, H>; }
+};
+template <> struct DegrainAVX2<uint16_t> {
+  template <int delta, int W, int H> static DegrainBlockFunction<uint16_t> degrain() { return Degrain_AVX2_16<delta, W, H>; }
+  template <int W, int H> static OverlapBlockFunction<uint16_t> overlaps() { return Overlaps_AVX2_16<W, H>; }
+};
+
+template <typename pixel_t, int delta>
+static DegrainBlockFunction<pixel_t> get_degrain_avx2_func_delta(int nBlkWidth, int nBlkHeight)
+{
+  typedef DegrainAVX2<pixel_t> K;
+  if (nBlkWidth == 4 && nBlkHeight == 4) return K::template degrain<delta, 4, 4>();
+  if (nBlkWidth == 8 && nBlkHeight == 8) return K::template degrain<delta, 8, 8>();
+  if (nBlkWidth == 16 && nBlkHeight == 16) return K::template degrain<delta, 16, 16>();
+  if (nBlkWidth == 32 && nBlkHeight == 32) return K::template degrain<delta, 32, 32>();
+  return nullptr;
+}
+
+template <typename pixel_t>
+DegrainBlockFunction<pixel_t> get_degrain_avx2_func(int delta, int nBlkWidth, int nBlkHeight)
+{
+  switch (delta) {
+  case 1: return get_degrain_avx2_func_delta<pixel_t, 1>(nBlkWidth, nBlkHeight);
+  case 2: return get_degrain_avx2_func_delta<pixel_t, 2>(nBlkWidth, nBlkHeight);
+  }
+  return nullptr;
+}
+
+template <typename pixel_t>
+OverlapBlockFunction<pixel_t> get_overlaps_avx2_func(int nBlkWidth, int nBlkHeight)
+{
+  typedef DegrainAVX2<pixel_t> K;
+  if (nBlkWidth == 4 && nBlkHeight == 4) return K::template overlaps<4, 4>();
+  if (nBlkWidth == 8 && nBlkHeight == 8) return K::template overlaps<8, 8>();
+  if (nBlkWidth == 16 && nBlkHeight == 16) return K::template overlaps<16, 16>();
+  if (nBlkWidth == 32 && nBlkHeight == 32) return K::template overlaps<32, 32>();
+  return nullptr;
+}
+
+template DegrainBlockFunction<uint8_t> get_degrain_avx2_func<uint8_t>(int delta, int nBlkWidth, int nBlkHeight);
+template DegrainBlockFunction<uint16_t> get_degrain_avx2_func<uint16_t>(int delta, int nBlkWidth, int nBlkHeight);
+template OverlapBlockFunction<uint8_t> get_overlaps_avx2_func<uint8_t>(int nBlkWidth, int nBlkHeight);
+template OverlapBlockFunction<uint16_t> get_overlaps_avx2_func<uint16_t>(int nBlkWidth, int nBlkHeight);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include <type_traits>
+
+// CPUKMDegrainŎgubN֐
+// pitch͗vfioCgł͂Ȃj
+
+// overlap̑ݐ 8bitshort, 16bitint
+template <typename pixel_t>
+using overlap_tmp_t = typename std::conditional <sizeof(pixel_t) == 1, short, int>::type;
+
+// pRefB,pRefF,WRefB,WRefFMAX_DEGRAINvf
+template <typename pixel_t>
+using DegrainBlockFunction = void(*)(pixel_t *pDst, int nDstPitch, const pixel_t *pSrc, int nSrcPitch,
+  const pixel_t **pRefB, const pixel_t **pRefF, int nRefPitch,
+  int WSrc, int *WRefB, int *WRefF);
+
+template <typename pixel_t>
+using OverlapBlockFunction = void(*)(overlap_tmp_t<pixel_t> *pDst, int nDstPitch,
+  const pixel_t *pSrc, int nSrcPitch, const short *pWin, int nWinPitch);
+
+// ʂCŁiDegrain1to6_C, Overlaps_CjƊSɈv
+// ΉĂȂubNTCYAdeltanullptrԂ̂ŁAĂяoCłɃtH[obN邱
+template <typename pixel_t>
+DegrainBlockFunction<pixel_t> get_degrain_avx2_func(int delta, int nBlkWidth, int nBlkHeight);
+
+template <typename pixel_t>
+OverlapBlockFunction<pixel_t> get_overlaps_avx2_func(int nBlkWidth, int nBlkHeight);
@@ -0,0 +1,167 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include "Expr.h"
+
+namespace {
+
+struct OpInfo {
+  const char* name;
+  int code;
+  int nargs;
+};
+
+const OpInfo OP_TABLE[] = {
+  { "+", EXPR_ADD, 2 },
+  { "-", EXPR_SUB, 2 },
+  { "*", EXPR_MUL, 2 },
+  { "/", EXPR_DIV, 2 },
+  { "min", EXPR_MIN, 2 },
+  { "max", EXPR_MAX, 2 },
+  { "<", EXPR_LT, 2 },
+  { ">", EXPR_GT, 2 },
+  { "<=", EXPR_LE, 2 },
+  { ">=", EXPR_GE, 2 },
+  { "==", EXPR_EQ, 2 },
+  { "=", EXPR_EQ, 2 },
+  { "!=", EXPR_NE, 2 },
+  { "&", EXPR_AND, 2 },
+  { "&&", EXPR_AND, 2 },
+  { "|", EXPR_OR, 2 },
+  { "||", EXPR_OR, 2 },
+  { "abs", EXPR_ABS, 1 },
+  { "neg", EXPR_NEG, 1 },
+  { "sqrt", EXPR_SQRT, 1 },
+  { "floor", EXPR_FLOOR, 1 },
+  { "?", EXPR_COND, 3 },
+  { "clip", EXPR_CLIP, 3 },
+};
+
+ExprOp MakeOp(int code, int dst, int a = 0, int b = 0, int c = 0, float imm = 0) {
+  ExprOp op = { code, dst, a, b, c, imm };
+  return op;
+}
+
+} // namespace
+
+bool CompileExpr(const std::string& expr, int numInputs, int bitsPerComponent,
+  ExprProgram& prog, std::string& err)
+{
+  const char* inputNames = "xyza";
+  const float rangeHalf = (float)(1 << (bitsPerComponent - 1));
+  const float rangeMax = (float)((1 << bitsPerComponent) - 1);
+  const float rangeSize = (float)(1 << bitsPerComponent);
+  // masktoolsƓ scaleb̓rbgVtgAscalef̓tW̐Li16bitŁ~257j
+  const float scaleb = (float)(1 << (bitsPerComponent - 8));
+  const float scalef = rangeMax / 255.0f;
+
+  prog.ops.clear();
+  prog.numRegs = 0;
+
+  int sp = 0; // X^bN̗vf
+  int scaledOp = -1; // Ōscalef,scaleb萔̖߈ʒu
+  std::istringstream is(expr);
+  std::string tok;
+  while (is >> tok) {
+    // 
+    const char* in = (tok.size() == 1) ? strchr(inputNames, tok[0]) : nullptr;
+    if (in != nullptr) {
+      int index = (int)(in - inputNames);
+      if (index >= numInputs) {
+        err = "input " + tok + " is not given";
+        return false;
+      }
+      prog.ops.push_back(MakeOp(EXPR_LOAD, sp++, index));
+    }
+    // 萔
+    else if (tok == "range_half") {
+      prog.ops.push_back(MakeOp(EXPR_CONST, sp++, 0, 0, 0, rangeHalf));
+    }
+    else if (tok == "range_max") {
+      prog.ops.push_back(MakeOp(EXPR_CONST, sp++, 0, 0, 0, rangeMax));
+    }
+    else if (tok == "range_size") {
+      prog.ops.push_back(MakeOp(EXPR_CONST, sp++, 0, 0, 0, rangeSize));
+    }
+    // 8bit̒lrbg[xɍ킹 萔ɂgȂ
+    else if (tok == "scalef" || tok == "scaleb") {
+      if (sp < 1 || prog.ops.back().op != EXPR_CONST) {
+        err = tok + " must follow a constant";
+        return false;
+      }
+      if (scaledOp == (int)prog.ops.size() - 1) {
+        err = "constant is already scaled at " + tok;
+        return false;
+      }
+      prog.ops.back().imm *= (tok == "scalef") ? scalef : scaleb;
+      scaledOp = (int)prog.ops.size() - 1;
+    }
+    else if (tok == "dup") {
+      if (sp < 1) {
+        err = "stack underflow at dup";
+        return false;
+      }
+      prog.ops.push_back(MakeOp(EXPR_DUP, sp, sp - 1));
+      ++sp;
+    }
+    else if (tok == "swap") {
+      if (sp < 2) {
+        err = "stack underflow at swap";
+        return false;
+      }
+      prog.ops.push_back(MakeOp(EXPR_SWAP, sp - 2, sp - 2, sp - 1));
+    }
+    else {
+      const OpInfo* info = nullptr;
+      for (const OpInfo& o : OP_TABLE) {
+        if (tok == o.name) {
+          info = &o;
+          break;
+        }
+      }
+      if (info != nullptr) {
+        if (sp < info->nargs) {
+          err = "stack underflow at " + tok;
+          return false;
+        }
+        // ʂ͈ԉ̈̈ʒuɓ
+        // gȂWX^͈͓̔w悤ɂĂ
+        int base = sp - info->nargs;
+        int b = (info->nargs >= 2) ? base + 1 : base;
+        int c = (info->nargs >= 3) ? base + 2 : base;
+        prog.ops.push_back(MakeOp(info->code, base, base, b, c));
+        sp = base + 1;
+      }
+      else {
+        char* end;
+        float v = strtof(tok.c_str(), &end);
+        if (*end != 0) {
+          err = "unknown token " + tok;
+          return false;
+        }
+        prog.ops.push_back(MakeOp(EXPR_CONST, sp++, 0, 0, 0, v));
+      }
+    }
+
+    // Zq̓X^bN𑝂₳Ȃ̂ŁAtłʂ
+    if (sp > EXPR_MAX_STACK) {
+      err = "stack overflow";
+      return false;
+    }
+    prog.numRegs = std::max(prog.numRegs, sp);
+  }
+
+  if (sp != 1) {
+    err = (sp == 0) ? "empty expression" : "expression leaves more than one value";
+    return false;
+  }
+  if ((int)prog.ops.size() > EXPR_MAX_OPS) {
+    err = "expression is too long";
+    return false;
+  }
+  return true;
+}
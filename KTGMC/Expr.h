@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// KExpr̋t|[hRpCߗ
+// WX^̓X^bN̒iɑΉ̂ŁAe߂̓X^bNŊ
+// CPUŁiKernelCPU.cpp,KernelAVX2.cppjCUDAŁiKernel.cukl_exprjœߗs
+
+enum {
+  EXPR_MAX_STACK = 16,
+  EXPR_MAX_OPS = 256,
+  EXPR_MAX_INPUTS = 4,
+};
+
+enum ExprOpCode {
+  EXPR_LOAD,  // dst = a
+  EXPR_CONST, // dst = imm
+  EXPR_DUP,   // dst = a
+  EXPR_SWAP,  // a <-> b
+
+  // dst = a op b
+  EXPR_ADD,
+  EXPR_SUB,
+  EXPR_MUL,
+  EXPR_DIV,
+  EXPR_MIN,
+  EXPR_MAX,
+  EXPR_LT,
+  EXPR_GT,
+  EXPR_LE,
+  EXPR_GE,
+  EXPR_EQ,
+  EXPR_NE,
+  EXPR_AND,
+  EXPR_OR,
+
+  // dst = op a
+  EXPR_ABS,
+  EXPR_NEG,
+  EXPR_SQRT,
+  EXPR_FLOOR,
+
+  EXPR_COND,  // dst = a ? b : c
+  EXPR_CLIP,  // dst = clamp(a, b, c)
+};
+
+struct ExprOp {
+  int op;
+  int dst;
+  int a, b, c;
+  float imm;
+};
+
+struct ExprProgram {
+  std::vector<ExprOp> ops;
+  int numRegs; // őX^bN[
+};
+
+// serrɃbZ[Wfalse
+// g͂x,y,z,ânumInputs
+bool CompileExpr(const std::string& expr, int numInputs, int bitsPerComponent,
+  ExprProgram& prog, std::string& err);
@@ -5,19 +5,26 @@
 #include <windows.h>
 
 #include <algorithm>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
 
 #include <cuda_runtime_api.h>
 #include <cuda_device_runtime_api.h>
 
 #include "CommonFunctions.h"
 #include "DeviceLocalData.h"
+#include "ScratchArena.h"
 #include "DebugWriter.h"
 #include "CudaDebug.h"
 #include "ReduceKernel.cuh"
 #include "VectorFunctions.cuh"
 #include "GenericImageFunctions.cuh"
 #include "Misc.h"
+#include "KernelCPU.h"
+#include "Expr.h"
 
 #define LOG_PRINT 0
 
@@ -44,21 +51,21 @@ struct ResamplingProgram {
   int filter_size;
 
   // Array of Integer indicate starting point of sampling
-  std::unique_ptr<DeviceLocalData<int>> pixel_offset;
+  std::shared_ptr<DeviceLocalData<int>> pixel_offset;
 
   // Array of array of coefficient for each pixel
   // {{pixel[0]_coeff}, {pixel[1]_coeff}, ...}
-  std::unique_ptr<DeviceLocalData<float>> pixel_coefficient_float;
+  std::shared_ptr<DeviceLocalData<float>> pixel_coefficient_float;
 
   ResamplingProgram(int filter_size, int source_size, int target_size, double crop_start, double crop_size,
     int* ppixel_offset, float* ppixel_coefficient_float, PNeoEnv env)
     : filter_size(filter_size), source_size(source_size), target_size(target_size), crop_start(crop_start), crop_size(crop_size),
     env(env)
   {
-    pixel_offset = std::unique_ptr<DeviceLocalData<int>>(
-      new DeviceLocalData<int>(ppixel_offset, target_size, env));
-    pixel_coefficient_float = std::unique_ptr<DeviceLocalData<float>>(
-      new DeviceLocalData<float>(ppixel_coefficient_float, target_size * filter_size, env));
+    // p[^̃TCY͂̂Ńe[u͋L
+    pixel_offset = DeviceLocalData<int>::GetShared(ppixel_offset, target_size, env);
+    pixel_coefficient_float = DeviceLocalData<float>::GetShared(
+      ppixel_coefficient_float, target_size * filter_size, env);
   };
 };
 
@@ -381,10 +388,49 @@ class KTGMC_Bob : public CUDAFilterBase {
   int cacheN;
   PVideoFrame cache[2];
 
+  template <typename pixel_t>
+  void MakeFrameCPU(bool top, PVideoFrame& src, PVideoFrame& dst,
+    ResamplingProgram* program_y, ResamplingProgram* program_uv, PNeoEnv env)
+  {
+    const int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+
+    for (int p = 0; p < 3; ++p) {
+      const pixel_t* srcptr = reinterpret_cast<const pixel_t*>(src->GetReadPtr(planes[p]));
+      int src_pitch = src->GetPitch(planes[p]) / sizeof(pixel_t);
+
+      // separate field
+      srcptr += top ? 0 : src_pitch;
+      src_pitch *= 2;
+
+      pixel_t* dstptr = reinterpret_cast<pixel_t*>(dst->GetWritePtr(planes[p]));
+      int dst_pitch = dst->GetPitch(planes[p]) / sizeof(pixel_t);
+
+      ResamplingProgram* prog = (p == 0) ? program_y : program_uv;
+
+      int width = vi.width;
+      int height = vi.height;
+
+      if (p > 0) {
+        width >>= logUVx;
+        height >>= logUVy;
+      }
+
+      cpu_resample_v<pixel_t>(
+        dstptr, srcptr, dst_pitch, src_pitch, width, height,
+        prog->pixel_offset->GetData(env), prog->pixel_coefficient_float->GetData(env),
+        prog->filter_size, env->GetCPUFlags());
+    }
+  }
+
   template <typename pixel_t>
   void MakeFrameT(bool top, PVideoFrame& src, PVideoFrame& dst,
     ResamplingProgram* program_y, ResamplingProgram* program_uv, PNeoEnv env)
   {
+    if (!IS_CUDA) {
+      MakeFrameCPU<pixel_t>(top, src, dst, program_y, program_uv, env);
+      return;
+    }
+
     typedef typename VectorType<pixel_t>::type vpixel_t;
     cudaStream_t stream = static_cast<cudaStream_t>(env->GetDeviceStream());
 
@@ -464,9 +510,6 @@ public:
   {
     PNeoEnv env = env_;
 
-    if (!IS_CUDA) {
-      env->ThrowError("[KTGMC_Bob] CUDAt[͂Ă");
-    }
 #if LOG_PRINT
     if (IS_CUDA) {
       printf("KTGMC_Bob[CUDA]: N=%d\n", n);
@@ -507,7 +550,10 @@ public:
   }
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) {
-    if (cachehints == CACHE_GET_MTMODE) {
+    if (cachehints == CACHE_GET_DEV_TYPE) {
+      return GetDeviceTypes(child) & (DEV_TYPE_CPU | DEV_TYPE_CUDA);
+    }
+    else if (cachehints == CACHE_GET_MTMODE) {
       return MT_NICE_FILTER;
     }
     return CUDAFilterBase::SetCacheHints(cachehints, frame_range);
@@ -612,15 +658,132 @@ class KBinomialTemporalSoften : public CUDAFilterBase {
   int logUVx;
   int logUVy;
 
+  // CPUł̃t[SADLbV
+  // ԂɏƑÕt[ŌvZyAėpł
+  enum { SAD_CACHE_SIZE = 8 };
+  struct SADCacheEntry {
+    int a, b; // a < b
+    uint64_t sad[3];
+  };
+  std::mutex sadMutex;
+  SADCacheEntry sadCache[SAD_CACHE_SIZE];
+  int sadCacheNext;
+
   PVideoFrame GetRefFrame(int ref, PNeoEnv env)
   {
     ref = clamp(ref, 0, vi.num_frames);
     return child->GetFrame(ref, env);
   }
 
+  template <typename pixel_t>
+  void GetFrameSAD(int a, int b, const PVideoFrame& fa, const PVideoFrame& fb, uint64_t* sad, PNeoEnv env)
+  {
+    if (a == b) {
+      sad[0] = sad[1] = sad[2] = 0;
+      return;
+    }
+    int key0 = std::min(a, b);
+    int key1 = std::max(a, b);
+    {
+      std::lock_guard<std::mutex> lock(sadMutex);
+      for (int i = 0; i < SAD_CACHE_SIZE; ++i) {
+        if (sadCache[i].a == key0 && sadCache[i].b == key1) {
+          std::copy(sadCache[i].sad, sadCache[i].sad + 3, sad);
+          return;
+        }
+      }
+    }
+
+    int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+    for (int p = 0; p < 3; ++p) {
+      sad[p] = 0;
+      if (chroma == false && p > 0) {
+        continue;
+      }
+      int width = vi.width;
+      int height = vi.height;
+      if (p > 0) {
+        width >>= logUVx;
+        height >>= logUVy;
+      }
+      sad[p] = cpu_sad<pixel_t>(
+        reinterpret_cast<const pixel_t*>(fa->GetReadPtr(planes[p])),
+        reinterpret_cast<const pixel_t*>(fb->GetReadPtr(planes[p])),
+        fa->GetPitch(planes[p]) / sizeof(pixel_t), fb->GetPitch(planes[p]) / sizeof(pixel_t),
+        width, height, env->GetCPUFlags());
+    }
+
+    std::lock_guard<std::mutex> lock(sadMutex);
+    SADCacheEntry& entry = sadCache[sadCacheNext];
+    entry.a = key0;
+    entry.b = key1;
+    std::copy(sad, sad + 3, entry.sad);
+    sadCacheNext = (sadCacheNext + 1) % SAD_CACHE_SIZE;
+  }
+
+  template <typename pixel_t>
+  PVideoFrame ProcCPU(int n, PNeoEnv env)
+  {
+    // src,prv1,fwd1,prv2,fwd2
+    const int offsets[] = { 0, -1, 1, -2, 2 };
+    const int nframes = 1 + radius * 2;
+
+    int refn[5];
+    PVideoFrame frames[5];
+    for (int i = 0; i < nframes; ++i) {
+      refn[i] = clamp(n + offsets[i], 0, vi.num_frames - 1);
+      frames[i] = child->GetFrame(refn[i], env);
+    }
+
+    uint64_t sad[4][3];
+    for (int i = 1; i < nframes; ++i) {
+      GetFrameSAD<pixel_t>(refn[0], refn[i], frames[0], frames[i], sad[i - 1], env);
+    }
+
+    PVideoFrame dst = env->NewVideoFrame(vi);
+
+    int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+    for (int p = 0; p < 3; ++p) {
+      pixel_t* pDst = reinterpret_cast<pixel_t*>(dst->GetWritePtr(planes[p]));
+      int dstPitch = dst->GetPitch(planes[p]) / sizeof(pixel_t);
+      int width = vi.width;
+      int height = vi.height;
+
+      if (p > 0) {
+        width >>= logUVx;
+        height >>= logUVy;
+      }
+
+      if (chroma == false && p > 0) {
+        env->BitBlt((BYTE*)pDst, dst->GetPitch(planes[p]),
+          frames[0]->GetReadPtr(planes[p]), frames[0]->GetPitch(planes[p]),
+          width * sizeof(pixel_t), height);
+        continue;
+      }
+
+      const pixel_t* srcs[5];
+      int pitches[5];
+      double fsc = (double)scenechange * width * height;
+      for (int i = 0; i < nframes; ++i) {
+        // V[`FW̃t[srcŒu
+        int f = (i > 0 && sad[i - 1][p] >= fsc) ? 0 : i;
+        srcs[i] = reinterpret_cast<const pixel_t*>(frames[f]->GetReadPtr(planes[p]));
+        pitches[i] = frames[f]->GetPitch(planes[p]) / sizeof(pixel_t);
+      }
+
+      cpu_binomial_soften<pixel_t>(pDst, dstPitch, srcs, pitches, radius, width, height, env->GetCPUFlags());
+    }
+
+    return dst;
+  }
+
   template <typename pixel_t>
   PVideoFrame Proc(int n, PNeoEnv env)
   {
+    if (!IS_CUDA) {
+      return ProcCPU<pixel_t>(n, env);
+    }
+
     typedef typename VectorType<pixel_t>::type vpixel_t;
     cudaStream_t stream = static_cast<cudaStream_t>(env->GetDeviceStream());
 
@@ -636,14 +799,8 @@ class KBinomialTemporalSoften : public CUDAFilterBase {
       fwd2 = GetRefFrame(n + 2, env);
     }
 
-    PVideoFrame work;
-    int work_bytes = sizeof(float) * radius * 2 * 3;
-    VideoInfo workvi = VideoInfo();
-    workvi.pixel_type = VideoInfo::CS_BGR32;
-    workvi.width = 2048;
-    workvi.height = nblocks(work_bytes, workvi.width * 4);
-    work = env->NewVideoFrame(workvi);
-    float* sad = reinterpret_cast<float*>(work->GetWritePtr());
+    ScratchBuffer work(sizeof(float) * radius * 2 * 3, env);
+    float* sad = work.Get<float>();
 
     PVideoFrame dst = env->NewVideoFrame(vi);
 
@@ -729,22 +886,23 @@ public:
     , chroma(chroma)
     , logUVx(vi.GetPlaneWidthSubsampling(PLANAR_U))
     , logUVy(vi.GetPlaneHeightSubsampling(PLANAR_U))
+    , sadCacheNext(0)
   {
     PNeoEnv env = env_;
 
     if (radius != 1 && radius != 2) {
       env->ThrowError("[KBinomialTemporalSoften] radius12ł");
     }
+
+    for (int i = 0; i < SAD_CACHE_SIZE; ++i) {
+      sadCache[i].a = sadCache[i].b = -1;
+    }
   }
 
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env_)
   {
     PNeoEnv env = env_;
 
-    if (!IS_CUDA) {
-      env->ThrowError("[KBinomialTemporalSoften] CUDAt[͂Ă");
-    }
-
     int pixelSize = vi.ComponentSize();
     switch (pixelSize) {
     case 1:
@@ -757,6 +915,13 @@ public:
     return PVideoFrame();
   }
 
+  int __stdcall SetCacheHints(int cachehints, int frame_range) {
+    if (cachehints == CACHE_GET_DEV_TYPE) {
+      return GetDeviceTypes(child) & (DEV_TYPE_CPU | DEV_TYPE_CUDA);
+    }
+    return CUDAFilterBase::SetCacheHints(cachehints, frame_range);
+  }
+
   static AVSValue __cdecl Create(AVSValue args, void* user_data, IScriptEnvironment* env) {
     return new KBinomialTemporalSoften(
       args[0].AsClip(),
@@ -1020,9 +1185,45 @@ class KRemoveGrain : public CUDAFilterBase {
   int logUVx;
   int logUVy;
 
+  template <typename pixel_t>
+  PVideoFrame ProcCPU(int n, PNeoEnv env)
+  {
+    PVideoFrame src = child->GetFrame(n, env);
+    PVideoFrame dst = env->NewVideoFrame(vi);
+
+    int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+    int modes[] = { mode, modeU, modeV };
+
+    for (int p = 0; p < 3; ++p) {
+      int mode = modes[p];
+      if (mode == -1) continue;
+
+      const pixel_t* pSrc = reinterpret_cast<const pixel_t*>(src->GetReadPtr(planes[p]));
+      pixel_t* pDst = reinterpret_cast<pixel_t*>(dst->GetWritePtr(planes[p]));
+
+      int srcPitch = src->GetPitch(planes[p]) / sizeof(pixel_t);
+      int dstPitch = dst->GetPitch(planes[p]) / sizeof(pixel_t);
+      int width = vi.width;
+      int height = vi.height;
+
+      if (p > 0) {
+        width >>= logUVx;
+        height >>= logUVy;
+      }
+
+      cpu_removegrain<pixel_t>(pDst, pSrc, dstPitch, srcPitch, width, height, mode, env->GetCPUFlags());
+    }
+
+    return dst;
+  }
+
   template <typename pixel_t>
   PVideoFrame Proc(int n, PNeoEnv env)
   {
+    if (!IS_CUDA) {
+      return ProcCPU<pixel_t>(n, env);
+    }
+
     typedef typename VectorType<pixel_t>::type vpixel_t;
     cudaStream_t stream = static_cast<cudaStream_t>(env->GetDeviceStream());
 
@@ -1151,10 +1352,6 @@ public:
   {
     PNeoEnv env = env_;
 
-    if (!IS_CUDA) {
-      env->ThrowError("[KRemoveGrain] CUDAt[͂Ă");
-    }
-
     int pixelSize = vi.ComponentSize();
     switch (pixelSize) {
     case 1:
@@ -1167,6 +1364,13 @@ public:
     return PVideoFrame();
   }
 
+  int __stdcall SetCacheHints(int cachehints, int frame_range) {
+    if (cachehints == CACHE_GET_DEV_TYPE) {
+      return GetDeviceTypes(child) & (DEV_TYPE_CPU | DEV_TYPE_CUDA);
+    }
+    return CUDAFilterBase::SetCacheHints(cachehints, frame_range);
+  }
+
   static AVSValue __cdecl Create(AVSValue args, void* user_data, IScriptEnvironment* env) {
     int mode = args[1].AsInt(2);
     int modeU = args[2].AsInt(mode);
@@ -1191,9 +1395,48 @@ class KRepair : public CUDAFilterBase {
   int logUVx;
   int logUVy;
 
+  template <typename pixel_t>
+  PVideoFrame ProcCPU(int n, PNeoEnv env)
+  {
+    PVideoFrame src = child->GetFrame(n, env);
+    PVideoFrame ref = refclip->GetFrame(n, env);
+    PVideoFrame dst = env->NewVideoFrame(vi);
+
+    int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+    int modes[] = { mode, modeU, modeV };
+
+    for (int p = 0; p < 3; ++p) {
+      int mode = modes[p];
+      if (mode == -1) continue;
+
+      const pixel_t* pSrc = reinterpret_cast<const pixel_t*>(src->GetReadPtr(planes[p]));
+      const pixel_t* pRef = reinterpret_cast<const pixel_t*>(ref->GetReadPtr(planes[p]));
+      pixel_t* pDst = reinterpret_cast<pixel_t*>(dst->GetWritePtr(planes[p]));
+
+      int srcPitch = src->GetPitch(planes[p]) / sizeof(pixel_t);
+      int refPitch = ref->GetPitch(planes[p]) / sizeof(pixel_t);
+      int dstPitch = dst->GetPitch(planes[p]) / sizeof(pixel_t);
+      int width = vi.width;
+      int height = vi.height;
+
+      if (p > 0) {
+        width >>= logUVx;
+        height >>= logUVy;
+      }
+
+      cpu_repair<pixel_t>(pDst, pSrc, pRef, dstPitch, srcPitch, refPitch, width, height, mode, env->GetCPUFlags());
+    }
+
+    return dst;
+  }
+
   template <typename pixel_t>
   PVideoFrame Proc(int n, PNeoEnv env)
   {
+    if (!IS_CUDA) {
+      return ProcCPU<pixel_t>(n, env);
+    }
+
     typedef typename VectorType<pixel_t>::type vpixel_t;
     cudaStream_t stream = static_cast<cudaStream_t>(env->GetDeviceStream());
 
@@ -1308,10 +1551,6 @@ public:
   {
     PNeoEnv env = env_;
 
-    if (!IS_CUDA) {
-      env->ThrowError("[KRepair] CUDAt[͂Ă");
-    }
-
     int pixelSize = vi.ComponentSize();
     switch (pixelSize) {
     case 1:
@@ -1324,6 +1563,13 @@ public:
     return PVideoFrame();
   }
 
+  int __stdcall SetCacheHints(int cachehints, int frame_range) {
+    if (cachehints == CACHE_GET_DEV_TYPE) {
+      return GetDeviceTypes(child) & GetDeviceTypes(refclip) & (DEV_TYPE_CPU | DEV_TYPE_CUDA);
+    }
+    return CUDAFilterBase::SetCacheHints(cachehints, frame_range);
+  }
+
   static AVSValue __cdecl Create(AVSValue args, void* user_data, IScriptEnvironment* env) {
     int mode = args[2].AsInt(2);
     int modeU = args[3].AsInt(mode);
@@ -1364,9 +1610,45 @@ class KVerticalCleaner : public CUDAFilterBase {
   int logUVx;
   int logUVy;
 
+  template <typename pixel_t>
+  PVideoFrame ProcCPU(int n, PNeoEnv env)
+  {
+    PVideoFrame src = child->GetFrame(n, env);
+    PVideoFrame dst = env->NewVideoFrame(vi);
+
+    int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+    int modes[] = { mode, modeU, modeV };
+
+    for (int p = 0; p < 3; ++p) {
+      int mode = modes[p];
+      if (mode == -1) continue;
+
+      const pixel_t* pSrc = reinterpret_cast<const pixel_t*>(src->GetReadPtr(planes[p]));
+      pixel_t* pDst = reinterpret_cast<pixel_t*>(dst->GetWritePtr(planes[p]));
+
+      int srcPitch = src->GetPitch(planes[p]) / sizeof(pixel_t);
+      int dstPitch = dst->GetPitch(planes[p]) / sizeof(pixel_t);
+      int width = vi.width;
+      int height = vi.height;
+
+      if (p > 0) {
+        width >>= logUVx;
+        height >>= logUVy;
+      }
+
+      cpu_vertical_cleaner<pixel_t>(pDst, pSrc, dstPitch, srcPitch, width, height, mode, env->GetCPUFlags());
+    }
+
+    return dst;
+  }
+
   template <typename pixel_t>
   PVideoFrame Proc(int n, PNeoEnv env)
   {
+    if (!IS_CUDA) {
+      return ProcCPU<pixel_t>(n, env);
+    }
+
     typedef typename VectorType<pixel_t>::type vpixel_t;
     cudaStream_t stream = static_cast<cudaStream_t>(env->GetDeviceStream());
 
@@ -1457,10 +1739,6 @@ public:
   {
     PNeoEnv env = env_;
 
-    if (!IS_CUDA) {
-      env->ThrowError("[KVerticalCleaner] CUDAt[͂Ă");
-    }
-
     int pixelSize = vi.ComponentSize();
     switch (pixelSize) {
     case 1:
@@ -1473,6 +1751,13 @@ public:
     return PVideoFrame();
   }
 
+  int __stdcall SetCacheHints(int cachehints, int frame_range) {
+    if (cachehints == CACHE_GET_DEV_TYPE) {
+      return GetDeviceTypes(child) & (DEV_TYPE_CPU | DEV_TYPE_CUDA);
+    }
+    return CUDAFilterBase::SetCacheHints(cachehints, frame_range);
+  }
+
   static AVSValue __cdecl Create(AVSValue args, void* user_data, IScriptEnvironment* env) {
     int mode = args[1].AsInt(2);
     int modeU = args[2].AsInt(mode);
@@ -1487,18 +1772,107 @@ public:
 };
 
 class KGaussResize : public CUDAFilterBase {
-  std::unique_ptr<ResamplingProgram> progVert;
-  std::unique_ptr<ResamplingProgram> progVertUV;
-  std::unique_ptr<ResamplingProgram> progHori;
-  std::unique_ptr<ResamplingProgram> progHoriUV;
+  // QTGMC͓TCY,pKGaussResize̂ŁAResamplingProgram̓CX^XԂŋL
+  struct Programs {
+    std::unique_ptr<ResamplingProgram> vert;
+    std::unique_ptr<ResamplingProgram> vertUV;
+    std::unique_ptr<ResamplingProgram> hori;
+    std::unique_ptr<ResamplingProgram> horiUV;
+  };
+  typedef std::tuple<int, int, int, int, double> ProgramsKey; // width,height,logUVx,logUVy,p
+
+  static std::mutex programsMutex;
+  static std::map<ProgramsKey, std::weak_ptr<Programs>> programsCache;
+
+  std::shared_ptr<Programs> programs;
+  ResamplingProgram* progVert;
+  ResamplingProgram* progVertUV;
+  ResamplingProgram* progHori;
+  ResamplingProgram* progHoriUV;
 
   bool chroma;
   int logUVx;
   int logUVy;
 
+  static std::shared_ptr<Programs> GetPrograms(
+    int width, int height, int logUVx, int logUVy, double p, PNeoEnv env)
+  {
+    std::lock_guard<std::mutex> lock(programsMutex);
+
+    ProgramsKey key(width, height, logUVx, logUVy, p);
+    std::shared_ptr<Programs> progs = programsCache[key].lock();
+    if (progs) {
+      return progs;
+    }
+
+    // QTGMCɍ킹
+    double crop_width = width + 0.0001;
+    double crop_height = height + 0.0001;
+
+    int divUVx = (1 << logUVx);
+    int divUVy = (1 << logUVy);
+
+    progs = std::make_shared<Programs>();
+    progs->vert = GaussianFilter(p).GetResamplingProgram(height, 0, crop_height, height, env);
+    progs->vertUV = GaussianFilter(p).GetResamplingProgram(height / divUVy, 0, crop_height / divUVy, height / divUVy, env);
+    progs->hori = GaussianFilter(p).GetResamplingProgram(width, 0, crop_width, width, env);
+    progs->horiUV = GaussianFilter(p).GetResamplingProgram(width / divUVx, 0, crop_width / divUVx, width / divUVx, env);
+
+    // gȂȂ̂
+    for (auto it = programsCache.begin(); it != programsCache.end();) {
+      if (it->second.expired()) {
+        it = programsCache.erase(it);
+      }
+      else {
+        ++it;
+      }
+    }
+    programsCache[key] = progs;
+    return progs;
+  }
+
+  template <typename pixel_t>
+  PVideoFrame ProcCPU(int n, PNeoEnv env)
+  {
+    PVideoFrame src = child->GetFrame(n, env);
+    PVideoFrame dst = env->NewVideoFrame(vi);
+
+    const int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+
+    for (int p = 0; p < (chroma ? 3 : 1); ++p) {
+      const pixel_t* srcptr = reinterpret_cast<const pixel_t*>(src->GetReadPtr(planes[p]));
+      pixel_t* dstptr = reinterpret_cast<pixel_t*>(dst->GetWritePtr(planes[p]));
+
+      int src_pitch = src->GetPitch(planes[p]) / sizeof(pixel_t);
+      int dst_pitch = dst->GetPitch(planes[p]) / sizeof(pixel_t);
+
+      ResamplingProgram* progV = (p == 0) ? progVert : progVertUV;
+      ResamplingProgram* progH = (p == 0) ? progHori : progHoriUV;
+
+      int width = vi.width;
+      int height = vi.height;
+
+      if (p > 0) {
+        width >>= logUVx;
+        height >>= logUVy;
+      }
+
+      cpu_gauss_resize<pixel_t>(dstptr, srcptr, dst_pitch, src_pitch, width, height,
+        progV->pixel_offset->GetData(env), progV->pixel_coefficient_float->GetData(env), progV->filter_size,
+        progH->pixel_offset->GetData(env), progH->pixel_coefficient_float->GetData(env), progH->filter_size,
+        env->GetCPUFlags());
+    }
+
+    return dst;
+  }
+
   template <typename pixel_t>
   PVideoFrame Proc(int n, PNeoEnv env)
   {
+    if (!IS_CUDA) {
+      return ProcCPU<pixel_t>(n, env);
+    }
+
     typedef typename VectorType<pixel_t>::type vpixel_t;
     cudaStream_t stream = static_cast<cudaStream_t>(env->GetDeviceStream());
 
@@ -1528,8 +1902,8 @@ class KGaussResize : public CUDAFilterBase {
       int pitch = src->GetPitch(planes[p]) / sizeof(pixel_t);
       int pitch4 = pitch / 4;
 
-      ResamplingProgram* progV = (p == 0) ? progVert.get() : progVertUV.get();
-      ResamplingProgram* progH = (p == 0) ? progHori.get() : progHoriUV.get();
+      ResamplingProgram* progV = (p == 0) ? progVert : progVertUV;
+      ResamplingProgram* progH = (p == 0) ? progHori : progHoriUV;
 
       int width = vi.width;
       int height = vi.height;
@@ -1590,30 +1964,17 @@ public:
   {
     PNeoEnv env = env_;
 
-    int width = vi.width;
-    int height = vi.height;
-
-    // QTGMCɍ킹
-    double crop_width = width + 0.0001;
-    double crop_height = height + 0.0001;
-
-    int divUVx = (1 << logUVx);
-    int divUVy = (1 << logUVy);
-
-    progVert = GaussianFilter(p).GetResamplingProgram(height, 0, crop_height, height, env);
-    progVertUV = GaussianFilter(p).GetResamplingProgram(height / divUVy, 0, crop_height / divUVy, height / divUVy, env);
-    progHori = GaussianFilter(p).GetResamplingProgram(width, 0, crop_width, width, env);
-    progHoriUV = GaussianFilter(p).GetResamplingProgram(width / divUVx, 0, crop_width / divUVx, width / divUVx, env);
+    programs = GetPrograms(vi.width, vi.height, logUVx, logUVy, p, env);
+    progVert = programs->vert.get();
+    progVertUV = programs->vertUV.get();
+    progHori = programs->hori.get();
+    progHoriUV = programs->horiUV.get();
   }
 
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env_)
   {
     PNeoEnv env = env_;
 
-    if (!IS_CUDA) {
-      env->ThrowError("[KGaussResize] CUDAt[͂Ă");
-    }
-
     int pixelSize = vi.ComponentSize();
     switch (pixelSize) {
     case 1:
@@ -1633,8 +1994,18 @@ public:
       args[2].AsBool(true),
       env);
   }
+
+  int __stdcall SetCacheHints(int cachehints, int frame_range) {
+    if (cachehints == CACHE_GET_DEV_TYPE) {
+      return GetDeviceTypes(child) & (DEV_TYPE_CPU | DEV_TYPE_CUDA);
+    }
+    return CUDAFilterBase::SetCacheHints(cachehints, frame_range);
+  }
 };
 
+std::mutex KGaussResize::programsMutex;
+std::map<KGaussResize::ProgramsKey, std::weak_ptr<KGaussResize::Programs>> KGaussResize::programsCache;
+
 class KMasktoolFilterBase : public CUDAFilterBase {
 protected:
   int numChilds;
@@ -1644,6 +2015,9 @@ protected:
   int logUVx;
   int logUVy;
 
+  // hNXProcPlaneCPUĂtrueɂ
+  bool cpuSupported;
+
   virtual void ProcPlane(int p, uint8_t* pDst,
     const uint8_t* pSrc0, const uint8_t* pSrc1, const uint8_t* pSrc2, const uint8_t* pSrc3,
     int width, int height, int pitch, PNeoEnv env) { }
@@ -1652,9 +2026,67 @@ protected:
     const uint16_t* pSrc0, const uint16_t* pSrc1, const uint16_t* pSrc2, const uint16_t* pSrc3,
     int width, int height, int pitch, PNeoEnv env) { }
 
+  // CPU t[ƂpitchႤƂ̂ŕʁXɓn
+  virtual void ProcPlaneCPU(int p, uint8_t* pDst, int dstPitch,
+    const uint8_t* const* pSrcs, const int* srcPitches, int width, int height, PNeoEnv env) { }
+
+  virtual void ProcPlaneCPU(int p, uint16_t* pDst, int dstPitch,
+    const uint16_t* const* pSrcs, const int* srcPitches, int width, int height, PNeoEnv env) { }
+
+  template <typename pixel_t>
+  PVideoFrame ProcCPU(int n, PNeoEnv env)
+  {
+    PVideoFrame srcs[4];
+    for (int i = 0; i < numChilds; ++i) {
+      srcs[i] = childs[i]->GetFrame(n, env);
+    }
+    PVideoFrame dst = env->NewVideoFrame(vi);
+
+    int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+    int modes[] = { Y, U, V };
+
+    for (int p = 0; p < 3; ++p) {
+      int mode = modes[p];
+      if (mode == 1) continue;
+
+      const pixel_t* pSrcs[4] = { nullptr };
+      int srcPitches[4] = { 0 };
+      for (int i = 0; i < numChilds; ++i) {
+        pSrcs[i] = reinterpret_cast<const pixel_t*>(srcs[i]->GetReadPtr(planes[p]));
+        srcPitches[i] = srcs[i]->GetPitch(planes[p]) / sizeof(pixel_t);
+      }
+      pixel_t* pDst = reinterpret_cast<pixel_t*>(dst->GetWritePtr(planes[p]));
+      int dstPitch = dst->GetPitch(planes[p]) / sizeof(pixel_t);
+
+      int width = vi.width;
+      int height = vi.height;
+
+      if (p > 0) {
+        width >>= logUVx;
+        height >>= logUVy;
+      }
+
+      if (mode == 3) {
+        ProcPlaneCPU(p, pDst, dstPitch, pSrcs, srcPitches, width, height, env);
+        continue;
+      }
+
+      int copyFrom = (mode == 4) ? 1 : (mode == 5) ? 2 : 0;
+      env->BitBlt((BYTE*)pDst, dstPitch * sizeof(pixel_t),
+        (const BYTE*)pSrcs[copyFrom], srcPitches[copyFrom] * sizeof(pixel_t),
+        width * sizeof(pixel_t), height);
+    }
+
+    return dst;
+  }
+
   template <typename pixel_t>
   PVideoFrame Proc(int n, PNeoEnv env)
   {
+    if (!IS_CUDA) {
+      return ProcCPU<pixel_t>(n, env);
+    }
+
     typedef typename VectorType<pixel_t>::type vpixel_t;
 		cudaStream_t stream = static_cast<cudaStream_t>(env->GetDeviceStream());
 
@@ -1728,6 +2160,7 @@ public:
     , Y(Y), U(U), V(V)
     , logUVx(vi.GetPlaneWidthSubsampling(PLANAR_U))
     , logUVy(vi.GetPlaneHeightSubsampling(PLANAR_U))
+    , cpuSupported(false)
   {
     childs[0] = child;
   }
@@ -1738,6 +2171,7 @@ public:
     , Y(Y), U(U), V(V)
     , logUVx(vi.GetPlaneWidthSubsampling(PLANAR_U))
     , logUVy(vi.GetPlaneHeightSubsampling(PLANAR_U))
+    , cpuSupported(false)
   {
     childs[0] = child0;
     childs[1] = child1;
@@ -1749,6 +2183,7 @@ public:
     , Y(Y), U(U), V(V)
     , logUVx(vi.GetPlaneWidthSubsampling(PLANAR_U))
     , logUVy(vi.GetPlaneHeightSubsampling(PLANAR_U))
+    , cpuSupported(false)
   {
     childs[0] = child0;
     childs[1] = child1;
@@ -1761,6 +2196,7 @@ public:
     , Y(Y), U(U), V(V)
     , logUVx(vi.GetPlaneWidthSubsampling(PLANAR_U))
     , logUVy(vi.GetPlaneHeightSubsampling(PLANAR_U))
+    , cpuSupported(false)
   {
     childs[0] = child0;
     childs[1] = child1;
@@ -1772,7 +2208,7 @@ public:
   {
     PNeoEnv env = env_;
 
-    if (!IS_CUDA) {
+    if (!IS_CUDA && !cpuSupported) {
       env->ThrowError("[KMasktoolFilterBase] CUDAt[͂Ă");
     }
 
@@ -1787,6 +2223,20 @@ public:
     }
     return PVideoFrame();
   }
+
+  int __stdcall SetCacheHints(int cachehints, int frame_range) {
+    if (cachehints == CACHE_GET_DEV_TYPE) {
+      if (!cpuSupported) {
+        return DEV_TYPE_CUDA;
+      }
+      int devtypes = DEV_TYPE_CPU | DEV_TYPE_CUDA;
+      for (int i = 0; i < numChilds; ++i) {
+        devtypes &= GetDeviceTypes(childs[i]);
+      }
+      return devtypes;
+    }
+    return CUDAFilterBase::SetCacheHints(cachehints, frame_range);
+  }
 };
 
 template <typename vpixel_t, typename Op>
@@ -1962,6 +2412,20 @@ protected:
     ProcPlane_(pDst, pSrc0, pSrc1, pSrc2, width, height, pitch, env);
   }
 
+  virtual void ProcPlaneCPU(int p, uint8_t* pDst, int dstPitch,
+    const uint8_t* const* pSrcs, const int* srcPitches, int width, int height, PNeoEnv env)
+  {
+    cpu_xpand_vertical_x2<uint8_t>(pDst, pSrcs[0], dstPitch, srcPitches[0],
+      width, height, std::is_same<F, Max5>::value, env->GetCPUFlags());
+  }
+
+  virtual void ProcPlaneCPU(int p, uint16_t* pDst, int dstPitch,
+    const uint16_t* const* pSrcs, const int* srcPitches, int width, int height, PNeoEnv env)
+  {
+    cpu_xpand_vertical_x2<uint16_t>(pDst, pSrcs[0], dstPitch, srcPitches[0],
+      width, height, std::is_same<F, Max5>::value, env->GetCPUFlags());
+  }
+
   template <typename pixel_t>
   void ProcPlane_(pixel_t* pDst,
     const pixel_t* pSrc0, const pixel_t* pSrc1, const pixel_t* pSrc2,
@@ -1992,7 +2456,9 @@ protected:
 public:
   KXpandVerticalX2(PClip src0, int y, int u, int v, IScriptEnvironment* env_)
     : KMasktoolFilterBase(src0, y, u, v, env_)
-  { }
+  {
+    cpuSupported = true;
+  }
 
   static AVSValue __cdecl Create(AVSValue args, void* user_data, IScriptEnvironment* env) {
     return new KXpandVerticalX2<F>(
@@ -2226,6 +2692,183 @@ static AVSValue __cdecl KLogicCreate(AVSValue args, void* user_data, IScriptEnvi
   return AVSValue();
 }
 
+struct ExprSrcs {
+  const void* p[EXPR_MAX_INPUTS];
+};
+
+// 1f1XbhKExpr̖ߗs
+// ߗ͋LɒuAr̒l̓WX^i[Jzjɒu
+template <typename pixel_t>
+__global__ void kl_expr(
+  pixel_t* pDst, ExprSrcs srcs,
+  const ExprOp* __restrict__ ops, int numOps,
+  int width, int height, int pitch, float maxval
+)
+{
+  __shared__ ExprOp sops[EXPR_MAX_OPS];
+
+  int tid = threadIdx.x + threadIdx.y * blockDim.x;
+  for (int i = tid; i < numOps; i += blockDim.x * blockDim.y) {
+    sops[i] = ops[i];
+  }
+  __syncthreads();
+
+  int x = threadIdx.x + blockIdx.x * blockDim.x;
+  int y = threadIdx.y + blockIdx.y * blockDim.y;
+
+  if (x < width && y < height) {
+    float r[EXPR_MAX_STACK];
+    for (int i = 0; i < numOps; ++i) {
+      const ExprOp& op = sops[i];
+      float a = r[op.a];
+      float b = r[op.b];
+      float c = r[op.c];
+      float d;
+      switch (op.op) {
+      case EXPR_LOAD: d = ((const pixel_t*)srcs.p[op.a])[x + y * pitch]; break;
+      case EXPR_CONST: d = op.imm; break;
+      case EXPR_DUP: d = a; break;
+      case EXPR_SWAP: r[op.b] = a; d = b; break;
+      case EXPR_ADD: d = a + b; break;
+      case EXPR_SUB: d = a - b; break;
+      case EXPR_MUL: d = a * b; break;
+      case EXPR_DIV: d = a / b; break;
+      case EXPR_MIN: d = (a < b) ? a : b; break;
+      case EXPR_MAX: d = (a > b) ? a : b; break;
+      case EXPR_LT: d = (a < b) ? 1.0f : 0.0f; break;
+      case EXPR_GT: d = (a > b) ? 1.0f : 0.0f; break;
+      case EXPR_LE: d = (a <= b) ? 1.0f : 0.0f; break;
+      case EXPR_GE: d = (a >= b) ? 1.0f : 0.0f; break;
+      case EXPR_EQ: d = (a == b) ? 1.0f : 0.0f; break;
+      case EXPR_NE: d = (a != b) ? 1.0f : 0.0f; break;
+      case EXPR_AND: d = (a > 0 && b > 0) ? 1.0f : 0.0f; break;
+      case EXPR_OR: d = (a > 0 || b > 0) ? 1.0f : 0.0f; break;
+      case EXPR_ABS: d = fabsf(a); break;
+      case EXPR_NEG: d = -a; break;
+      case EXPR_SQRT: d = sqrtf(a); break;
+      case EXPR_FLOOR: d = floorf(a); break;
+      case EXPR_COND: d = (a != 0) ? b : c; break;
+      case EXPR_CLIP: d = (a > b) ? a : b; d = (d < c) ? d : c; break;
+      }
+      r[op.dst] = d;
+    }
+    float v = r[0];
+    v = (v > 0.0f) ? v : 0.0f;
+    v = (v < maxval) ? v : maxval;
+    pDst[x + y * pitch] = pixel_t(v + 0.5f);
+  }
+}
+
+// t|[hŏfƂ̏1pXŎsimt_lutxŷ悤Ȃ́j
+// KMakeDiff,KLogicȂǂiȂ1̎ɂ܂Ƃ߂΁Ar̃t[ɏɍς
+// ͂ x,y,z,a ̍ő4Nbv
+class KExpr : public KMasktoolFilterBase
+{
+  ExprProgram programs[3];
+  std::unique_ptr<DeviceLocalData<ExprOp>> devOps[3];
+
+  // o͂̃Nvl rbg[xŌ߂
+  float MaxValue() const { return (float)((1 << vi.BitsPerComponent()) - 1); }
+
+protected:
+
+  virtual void ProcPlane(int p, uint8_t* pDst,
+    const uint8_t* pSrc0, const uint8_t* pSrc1, const uint8_t* pSrc2, const uint8_t* pSrc3,
+    int width, int height, int pitch, PNeoEnv env)
+  {
+    ProcPlane_(p, pDst, pSrc0, pSrc1, pSrc2, pSrc3, width, height, pitch, env);
+  }
+
+  virtual void ProcPlane(int p, uint16_t* pDst,
+    const uint16_t* pSrc0, const uint16_t* pSrc1, const uint16_t* pSrc2, const uint16_t* pSrc3,
+    int width, int height, int pitch, PNeoEnv env)
+  {
+    ProcPlane_(p, pDst, pSrc0, pSrc1, pSrc2, pSrc3, width, height, pitch, env);
+  }
+
+  virtual void ProcPlaneCPU(int p, uint8_t* pDst, int dstPitch,
+    const uint8_t* const* pSrcs, const int* srcPitches, int width, int height, PNeoEnv env)
+  {
+    cpu_expr<uint8_t>(pDst, dstPitch, pSrcs, srcPitches, width, height,
+      devOps[p]->GetData(env), (int)programs[p].ops.size(), MaxValue(), env->GetCPUFlags());
+  }
+
+  virtual void ProcPlaneCPU(int p, uint16_t* pDst, int dstPitch,
+    const uint16_t* const* pSrcs, const int* srcPitches, int width, int height, PNeoEnv env)
+  {
+    cpu_expr<uint16_t>(pDst, dstPitch, pSrcs, srcPitches, width, height,
+      devOps[p]->GetData(env), (int)programs[p].ops.size(), MaxValue(), env->GetCPUFlags());
+  }
+
+  template <typename pixel_t>
+  void ProcPlane_(int p, pixel_t* pDst,
+    const pixel_t* pSrc0, const pixel_t* pSrc1, const pixel_t* pSrc2, const pixel_t* pSrc3,
+    int width, int height, int pitch, PNeoEnv env)
+  {
+    cudaStream_t stream = static_cast<cudaStream_t>(env->GetDeviceStream());
+
+    ExprSrcs srcs = { { pSrc0, pSrc1, pSrc2, pSrc3 } };
+
+    dim3 threads(32, 16);
+    dim3 blocks(nblocks(width, threads.x), nblocks(height, threads.y));
+    kl_expr<pixel_t> << <blocks, threads, 0, stream >> > (
+      pDst, srcs, devOps[p]->GetData(env), (int)programs[p].ops.size(), width, height, pitch, MaxValue());
+    DEBUG_SYNC;
+  }
+
+public:
+  KExpr(PClip src0, PClip src1, PClip src2, PClip src3,
+    const char* expr, const char* yexpr, const char* uexpr, const char* vexpr,
+    int y, int u, int v, IScriptEnvironment* env_)
+    : KMasktoolFilterBase(src0, y, u, v, env_)
+  {
+    PNeoEnv env = env_;
+
+    cpuSupported = true;
+
+    PClip others[] = { src1, src2, src3 };
+    for (int i = 0; i < 3 && others[i]; ++i) {
+      const VideoInfo& vi2 = others[i]->GetVideoInfo();
+      if (vi2.width != vi.width || vi2.height != vi.height || vi2.pixel_type != vi.pixel_type) {
+        env->ThrowError("[KExpr] All clips must have the same format");
+      }
+      childs[numChilds++] = others[i];
+    }
+
+    const char* planeExprs[] = { yexpr, uexpr, vexpr };
+    int modes[] = { Y, U, V };
+    for (int p = 0; p < 3; ++p) {
+      if (modes[p] != 3) continue;
+      const char* e = planeExprs[p] ? planeExprs[p] : expr;
+      if (e == nullptr) {
+        env->ThrowError("[KExpr] No expression for plane %d", p);
+      }
+      std::string err;
+      if (!CompileExpr(e, numChilds, vi.BitsPerComponent(), programs[p], err)) {
+        env->ThrowError("[KExpr] %s: \"%s\"", err.c_str(), e);
+      }
+      devOps[p] = std::unique_ptr<DeviceLocalData<ExprOp>>(new DeviceLocalData<ExprOp>(
+        programs[p].ops.data(), (int)programs[p].ops.size(), env));
+    }
+  }
+
+  static AVSValue __cdecl Create(AVSValue args, void* user_data, IScriptEnvironment* env) {
+    return new KExpr(
+      args[0].AsClip(),
+      args[1].Defined() ? args[1].AsClip() : nullptr,
+      args[2].Defined() ? args[2].AsClip() : nullptr,
+      args[3].Defined() ? args[3].AsClip() : nullptr,
+      args[4].AsString(nullptr),
+      args[5].AsString(nullptr),
+      args[6].AsString(nullptr),
+      args[7].AsString(nullptr),
+      args[8].AsInt(3),
+      args[9].AsInt(1),
+      args[10].AsInt(1),
+      env);
+  }
+};
+
 __device__ int dev_bobshimmerfixes_merge(
   int src, int diff, int c1, int c2, int scale, int maxval
 )
@@ -3139,6 +3782,47 @@ class KDoubleWeave : public CUDAFilterBase
     }
   }
 
+  // CPU s݂ɕׂ邾Ȃ̂BitBltisƂmemcpyjŏ
+  void ProcCPU(PVideoFrame& dst, PVideoFrame& top, PVideoFrame& bottom, PNeoEnv env)
+  {
+    const int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+
+    for (int p = 0; p < 3; ++p) {
+      BYTE* pDst = dst->GetWritePtr(planes[p]);
+      int dstPitch = dst->GetPitch(planes[p]);
+      int rowSize = top->GetRowSize(planes[p]);
+      int height2 = top->GetHeight(planes[p]);
+
+      env->BitBlt(pDst, dstPitch * 2,
+        top->GetReadPtr(planes[p]), top->GetPitch(planes[p]), rowSize, height2);
+      env->BitBlt(pDst + dstPitch, dstPitch * 2,
+        bottom->GetReadPtr(planes[p]), bottom->GetPitch(planes[p]), rowSize, height2);
+    }
+  }
+
+  // SeparateFields̏o͂͌t[pitch2{ŌĂ邾Ȃ̂ŁA
+  // 2̃tB[ht[̏㉺Ȃ猳t[̃r[Ԃ΃Rs[͗vȂ
+  PVideoFrame GetWeaveView(const PVideoFrame& top, const PVideoFrame& bottom, PNeoEnv env)
+  {
+    if (top->GetFrameBuffer() != bottom->GetFrameBuffer()) {
+      return PVideoFrame();
+    }
+
+    const int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+
+    for (int p = 0; p < 3; ++p) {
+      int pitch = top->GetPitch(planes[p]);
+      if ((pitch & 1) || bottom->GetPitch(planes[p]) != pitch ||
+        bottom->GetReadPtr(planes[p]) != top->GetReadPtr(planes[p]) + pitch / 2)
+      {
+        return PVideoFrame();
+      }
+    }
+
+    return env->SubframePlanar(top, 0, top->GetPitch(PLANAR_Y) / 2,
+      top->GetRowSize(PLANAR_Y), top->GetHeight(PLANAR_Y) * 2, 0, 0, top->GetPitch(PLANAR_U) / 2);
+  }
+
 public:
   KDoubleWeave(PClip child, IScriptEnvironment* env_)
     : CUDAFilterBase(child)
@@ -3153,9 +3837,6 @@ public:
   {
     PNeoEnv env = env_;
 
-    if (!IS_CUDA) {
-      env->ThrowError("[KDoubleWeave] CUDAt[͂Ă");
-    }
 #if LOG_PRINT
     if (IS_CUDA) {
       printf("KDoubleWeave[CUDA]: N=%d\n", n);
@@ -3163,13 +3844,24 @@ public:
 #endif
     PVideoFrame a = child->GetFrame(n, env);
     PVideoFrame b = child->GetFrame(n + 1, env);
-    PVideoFrame dst = env->NewVideoFrame(vi);
     const bool parity = child->GetParity(n);
 
     if (!parity) {
       std::swap(a, b);
     }
 
+    PVideoFrame view = GetWeaveView(a, b, env);
+    if (view) {
+      return view;
+    }
+
+    PVideoFrame dst = env->NewVideoFrame(vi);
+
+    if (!IS_CUDA) {
+      ProcCPU(dst, a, b, env);
+      return dst;
+    }
+
     int pixelSize = vi.ComponentSize();
     switch (pixelSize) {
     case 1:
@@ -3199,6 +3891,13 @@ public:
     AVSValue selectargs[3] = { KDoubleWeave::Create(args, 0, env), 2, 0 };
     return env->Invoke("SelectEvery", AVSValue(selectargs, 3));
   }
+
+  int __stdcall SetCacheHints(int cachehints, int frame_range) {
+    if (cachehints == CACHE_GET_DEV_TYPE) {
+      return GetDeviceTypes(child) & (DEV_TYPE_CPU | DEV_TYPE_CUDA);
+    }
+    return CUDAFilterBase::SetCacheHints(cachehints, frame_range);
+  }
 };
 
 class KCopy : public GenericVideoFilter
@@ -3305,6 +4004,7 @@ void AddFuncKernel(IScriptEnvironment* env)
   env->AddFunction("KMakeDiff", "cc[y]i[u]i[v]i", KMakeDiff<MakeDiffOp>::Create, 0);
   env->AddFunction("KAddDiff", "cc[y]i[u]i[v]i", KMakeDiff<AddDiffOp>::Create, 0);
   env->AddFunction("KLogic", "cc[mode]s[y]i[u]i[v]i", KLogicCreate, 0);
+  env->AddFunction("KExpr", "c[c2]c[c3]c[c4]c[expr]s[yexpr]s[uexpr]s[vexpr]s[y]i[u]i[v]i", KExpr::Create, 0);
 
   env->AddFunction("KTGMC_BobShimmerFixesMerge", "cccc[y]i[u]i[v]i", KTGMC_BobShimmerFixesMerge::Create, 0);
   env->AddFunction("KTGMC_VResharpen", "c[y]i[u]i[v]i", KTGMC_VResharpen::Create, 0);
@@ -0,0 +1,685 @@
+#include "avisynth.h"
+
+#define NOMINMAX
+#include <windows.h>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+
+#include <immintrin.h>
+
+#include "KernelCPU.h"
+#include "Expr.h"
+
+// Kernel.cũtB^AVX2
+// CŁiKernelCPU.cppjƓvZŁAʂ͊SɈv
+
+static __forceinline __m256 load8_ps(const uint8_t* p) {
+  return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p)));
+}
+static __forceinline __m256 load8_ps(const uint16_t* p) {
+  return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p)));
+}
+
+// ؂̂ĂŐ8f
+static __forceinline void store8_ps(uint8_t* p, __m256 v) {
+  __m256i i = _mm256_cvttps_epi32(v);
+  __m128i w = _mm_packus_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1));
+  _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(w, w));
+}
+static __forceinline void store8_ps(uint16_t* p, __m256 v) {
+  __m256i i = _mm256_cvttps_epi32(v);
+  _mm_storeu_si128((__m128i*)p, _mm_packus_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1)));
+}
+
+template <typename pixel_t>
+void resample_v_avx2(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, const int* offset, const float* coef, int filter_size, int ystart, int yend)
+{
+  const float maxv = (sizeof(pixel_t) == 1) ? 255.0f : 65535.0f;
+  const __m256 vmax = _mm256_set1_ps(maxv);
+  const __m256 vhalf = _mm256_set1_ps(0.5f);
+
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* s = src + offset[y] * src_pitch;
+    const float* c = coef + y * filter_size;
+    pixel_t* d = dst + y * dst_pitch;
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+      // CłƓ0珇ɑiFMA͎gȂj
+      __m256 result = _mm256_setzero_ps();
+      for (int i = 0; i < filter_size; ++i) {
+        result = _mm256_add_ps(result, _mm256_mul_ps(load8_ps(s + x + i * src_pitch), _mm256_set1_ps(c[i])));
+      }
+      result = _mm256_min_ps(_mm256_max_ps(result, _mm256_setzero_ps()), vmax);
+      store8_ps(d + x, _mm256_add_ps(result, vhalf));
+    }
+    for (; x < width; ++x) {
+      float result = 0;
+      for (int i = 0; i < filter_size; ++i) {
+        result += s[x + i * src_pitch] * c[i];
+      }
+      result = std::min(std::max(result, 0.0f), maxv);
+      d[x] = pixel_t(result + 0.5f);
+    }
+  }
+}
+
+template void resample_v_avx2<uint8_t>(uint8_t* dst, const uint8_t* src, int dst_pitch, int src_pitch,
+  int width, const int* offset, const float* coef, int filter_size, int ystart, int yend);
+template void resample_v_avx2<uint16_t>(uint16_t* dst, const uint16_t* src, int dst_pitch, int src_pitch,
+  int width, const int* offset, const float* coef, int filter_size, int ystart, int yend);
+
+static __forceinline void transpose8_ps(__m256* r)
+{
+  __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+  __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+  __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+  __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+  __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+  __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+  __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+  __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+  __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+  r[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+  r[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+  r[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+  r[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+  r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+  r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+  r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+  r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+}
+
+template <typename pixel_t>
+void gauss_resize_avx2(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch, int width,
+  const int* offsetV, const float* coefV, int filterSizeV,
+  const int* offsetH, const float* coefH, int filterSizeH, float* tile, int ystart, int yend)
+{
+  enum { R = GAUSS_TILE_ROWS };
+  static_assert(R == 8, "transpose8_ps");
+
+  const float maxv = (sizeof(pixel_t) == 1) ? 255.0f : 65535.0f;
+  const __m256 vmax = _mm256_set1_ps(maxv);
+  const __m256 vhalf = _mm256_set1_ps(0.5f);
+
+  for (int y0 = ystart; y0 < yend; y0 += R) {
+    int nrows = std::min<int>(R, yend - y0);
+
+    // c tile[x*R+r]ɍsy0+řʂu
+    // Ō̃^C[ȂƂ͍ŏIsdČvZ
+    const pixel_t* s[R];
+    const float* c[R];
+    for (int r = 0; r < R; ++r) {
+      int y = y0 + std::min(r, nrows - 1);
+      s[r] = src + offsetV[y] * src_pitch;
+      c[r] = coefV + y * filterSizeV;
+    }
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+      __m256 v[R];
+      for (int r = 0; r < R; ++r) {
+        // CłƓ0珇ɑiFMA͎gȂj
+        __m256 result = _mm256_setzero_ps();
+        for (int i = 0; i < filterSizeV; ++i) {
+          result = _mm256_add_ps(result, _mm256_mul_ps(load8_ps(s[r] + x + i * src_pitch), _mm256_set1_ps(c[r][i])));
+        }
+        result = _mm256_min_ps(_mm256_max_ps(result, _mm256_setzero_ps()), vmax);
+        v[r] = _mm256_round_ps(_mm256_add_ps(result, vhalf), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+      }
+      transpose8_ps(v);
+      for (int k = 0; k < 8; ++k) {
+        _mm256_storeu_ps(tile + (x + k) * R, v[k]);
+      }
+    }
+    for (; x < width; ++x) {
+      for (int r = 0; r < R; ++r) {
+        float result = 0;
+        for (int i = 0; i < filterSizeV; ++i) {
+          result += s[r][x + i * src_pitch] * c[r][i];
+        }
+        result = std::min(std::max(result, 0.0f), maxv);
+        tile[x * R + r] = (float)pixel_t(result + 0.5f);
+      }
+    }
+
+    //  o8fs̃xNgŌvZē]uĖ߂
+    x = 0;
+    for (; x + 8 <= width; x += 8) {
+      __m256 h[8];
+      for (int k = 0; k < 8; ++k) {
+        const float* t = tile + offsetH[x + k] * R;
+        const float* ch = coefH + (x + k) * filterSizeH;
+        __m256 result = _mm256_setzero_ps();
+        for (int i = 0; i < filterSizeH; ++i) {
+          result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_loadu_ps(t + i * R), _mm256_set1_ps(ch[i])));
+        }
+        h[k] = result;
+      }
+      transpose8_ps(h);
+      for (int r = 0; r < nrows; ++r) {
+        __m256 result = _mm256_min_ps(_mm256_max_ps(h[r], _mm256_setzero_ps()), vmax);
+        store8_ps(dst + (y0 + r) * dst_pitch + x, _mm256_add_ps(result, vhalf));
+      }
+    }
+    for (; x < width; ++x) {
+      const float* t = tile + offsetH[x] * R;
+      const float* ch = coefH + x * filterSizeH;
+      for (int r = 0; r < nrows; ++r) {
+        float result = 0;
+        for (int i = 0; i < filterSizeH; ++i) {
+          result += t[i * R + r] * ch[i];
+        }
+        result = std::min(std::max(result, 0.0f), maxv);
+        dst[x + (y0 + r) * dst_pitch] = pixel_t(result + 0.5f);
+      }
+    }
+  }
+}
+
+template void gauss_resize_avx2<uint8_t>(uint8_t* dst, const uint8_t* src, int dst_pitch, int src_pitch, int width,
+  const int* offsetV, const float* coefV, int filterSizeV,
+  const int* offsetH, const float* coefH, int filterSizeH, float* tile, int ystart, int yend);
+template void gauss_resize_avx2<uint16_t>(uint16_t* dst, const uint16_t* src, int dst_pitch, int src_pitch, int width,
+  const int* offsetV, const float* coefV, int filterSizeV,
+  const int* offsetH, const float* coefH, int filterSizeH, float* tile, int ystart, int yend);
+
+// RemoveGrain/Repair̔rn͉f̃rbĝ܂܁i8bitȂ32fj
+struct RGVecU8 {
+  enum { N = 32 };
+  typedef uint8_t pixel_t;
+  static __forceinline __m256i load(const uint8_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+  static __forceinline void store(uint8_t* p, __m256i v) { _mm256_storeu_si256((__m256i*)p, v); }
+  static __forceinline __m256i min(__m256i a, __m256i b) { return _mm256_min_epu8(a, b); }
+  static __forceinline __m256i max(__m256i a, __m256i b) { return _mm256_max_epu8(a, b); }
+};
+struct RGVecU16 {
+  enum { N = 16 };
+  typedef uint16_t pixel_t;
+  static __forceinline __m256i load(const uint16_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+  static __forceinline void store(uint16_t* p, __m256i v) { _mm256_storeu_si256((__m256i*)p, v); }
+  static __forceinline __m256i min(__m256i a, __m256i b) { return _mm256_min_epu16(a, b); }
+  static __forceinline __m256i max(__m256i a, __m256i b) { return _mm256_max_epu16(a, b); }
+};
+
+template <typename V>
+struct VecCompareAndSwap {
+  __forceinline void operator()(__m256i& a, __m256i& b) {
+    __m256i a_ = V::min(a, b);
+    __m256i b_ = V::max(a, b);
+    a = a_; b = b_;
+  }
+};
+
+template <typename V>
+static __forceinline __m256i clamp_vec(__m256i s, __m256i lo, __m256i hi) {
+  return V::max(lo, V::min(s, hi));
+}
+
+// V̕ƂɏA[͍Ō1ɂ炵ďd˂ď
+// io͂src猈܂̂ŏd˂ďĂʂ͓j
+template <typename V, int N>
+static void rg_clip_avx2(typename V::pixel_t* dst, const typename V::pixel_t* src,
+  int dst_pitch, int src_pitch, int width, int ystart, int yend)
+{
+  typedef typename V::pixel_t pixel_t;
+  const int xend = width - 1;
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* s0 = src + (y - 1) * src_pitch;
+    const pixel_t* s1 = src + y * src_pitch;
+    const pixel_t* s2 = src + (y + 1) * src_pitch;
+    pixel_t* d = dst + y * dst_pitch;
+    for (int xx = 1; xx < xend; xx += V::N) {
+      const int x = std::min(xx, xend - V::N);
+      __m256i a0 = V::load(s0 + x - 1), a1 = V::load(s0 + x), a2 = V::load(s0 + x + 1);
+      __m256i a3 = V::load(s1 + x - 1), s = V::load(s1 + x), a4 = V::load(s1 + x + 1);
+      __m256i a5 = V::load(s2 + x - 1), a6 = V::load(s2 + x), a7 = V::load(s2 + x + 1);
+
+      cpu_sort_8elem<__m256i, VecCompareAndSwap<V>>(a0, a1, a2, a3, a4, a5, a6, a7);
+
+      __m256i tmp;
+      switch (N) {
+      case 1: tmp = clamp_vec<V>(s, a0, a7); break;
+      case 2: tmp = clamp_vec<V>(s, a1, a6); break;
+      case 3: tmp = clamp_vec<V>(s, a2, a5); break;
+      case 4: tmp = clamp_vec<V>(s, a3, a4); break;
+      }
+      V::store(d + x, tmp);
+    }
+  }
+}
+
+template <typename V, int N>
+static void repair_clip_avx2(typename V::pixel_t* dst, const typename V::pixel_t* src,
+  const typename V::pixel_t* ref, int dst_pitch, int src_pitch, int ref_pitch,
+  int width, int ystart, int yend)
+{
+  typedef typename V::pixel_t pixel_t;
+  const int xend = width - 1;
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* r0 = ref + (y - 1) * ref_pitch;
+    const pixel_t* r1 = ref + y * ref_pitch;
+    const pixel_t* r2 = ref + (y + 1) * ref_pitch;
+    const pixel_t* s1 = src + y * src_pitch;
+    pixel_t* d = dst + y * dst_pitch;
+    for (int xx = 1; xx < xend; xx += V::N) {
+      const int x = std::min(xx, xend - V::N);
+      __m256i a0 = V::load(r0 + x - 1), a1 = V::load(r0 + x), a2 = V::load(r0 + x + 1);
+      __m256i a3 = V::load(r1 + x - 1), a4 = V::load(r1 + x), a5 = V::load(r1 + x + 1);
+      __m256i a6 = V::load(r2 + x - 1), a7 = V::load(r2 + x), a8 = V::load(r2 + x + 1);
+
+      cpu_sort_9elem<__m256i, VecCompareAndSwap<V>>(a0, a1, a2, a3, a4, a5, a6, a7, a8);
+
+      __m256i s = V::load(s1 + x);
+      __m256i tmp;
+      switch (N) {
+      case 1: tmp = clamp_vec<V>(s, a0, a8); break;
+      case 2: tmp = clamp_vec<V>(s, a1, a7); break;
+      case 3: tmp = clamp_vec<V>(s, a2, a6); break;
+      case 4: tmp = clamp_vec<V>(s, a3, a5); break;
+      }
+      V::store(d + x, tmp);
+    }
+  }
+}
+
+// ڂn͘aȂ悤8bit16bitA16bit32bitɍLď
+struct RGBlurU8 {
+  enum { N = 16 };
+  typedef uint8_t pixel_t;
+  static __forceinline __m256i load(const uint8_t* p) {
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p));
+  }
+  static __forceinline void store(uint8_t* p, __m256i v) {
+    __m128i w = _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    _mm_storeu_si128((__m128i*)p, w);
+  }
+  static __forceinline __m256i add(__m256i a, __m256i b) { return _mm256_add_epi16(a, b); }
+  static __forceinline __m256i set1(int v) { return _mm256_set1_epi16(v); }
+  static __forceinline __m256i shl(__m256i v, int n) { return _mm256_slli_epi16(v, n); }
+  static __forceinline __m256i shift(__m256i v, int n) { return _mm256_srli_epi16(v, n); }
+  static __forceinline __m256i rg11(__m256i v) {
+    return _mm256_srli_epi16(_mm256_add_epi16(v, _mm256_set1_epi16(8)), 4);
+  }
+  // (sum+4)/9 sum+4<=2299Ȃ̂ x*7282>>16 Őmɋ܂
+  static __forceinline __m256i rg20(__m256i v) {
+    return _mm256_mulhi_epu16(_mm256_add_epi16(v, _mm256_set1_epi16(4)), _mm256_set1_epi16(7282));
+  }
+};
+struct RGBlurU16 {
+  enum { N = 8 };
+  typedef uint16_t pixel_t;
+  static __forceinline __m256i load(const uint16_t* p) {
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p));
+  }
+  static __forceinline void store(uint16_t* p, __m256i v) {
+    _mm_storeu_si128((__m128i*)p, _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+  }
+  static __forceinline __m256i add(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+  static __forceinline __m256i set1(int v) { return _mm256_set1_epi32(v); }
+  static __forceinline __m256i shl(__m256i v, int n) { return _mm256_slli_epi32(v, n); }
+  static __forceinline __m256i shift(__m256i v, int n) { return _mm256_srli_epi32(v, n); }
+  static __forceinline __m256i rg11(__m256i v) {
+    return _mm256_srli_epi32(_mm256_add_epi32(v, _mm256_set1_epi32(8)), 4);
+  }
+  // sum+4 < 2^20Ȃ̂float̏Z؂̂ĂΐZƈv
+  static __forceinline __m256i rg20(__m256i v) {
+    __m256 f = _mm256_cvtepi32_ps(_mm256_add_epi32(v, _mm256_set1_epi32(4)));
+    return _mm256_cvttps_epi32(_mm256_div_ps(f, _mm256_set1_ps(9.0f)));
+  }
+};
+
+template <typename V, bool RG20>
+static void rg_blur_avx2(typename V::pixel_t* dst, const typename V::pixel_t* src,
+  int dst_pitch, int src_pitch, int width, int ystart, int yend)
+{
+  typedef typename V::pixel_t pixel_t;
+  const int xend = width - 1;
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* s0 = src + (y - 1) * src_pitch;
+    const pixel_t* s1 = src + y * src_pitch;
+    const pixel_t* s2 = src + (y + 1) * src_pitch;
+    pixel_t* d = dst + y * dst_pitch;
+    for (int xx = 1; xx < xend; xx += V::N) {
+      const int x = std::min(xx, xend - V::N);
+      __m256i h0, h1, h2;
+      if (RG20) {
+        h0 = V::add(V::add(V::load(s0 + x - 1), V::load(s0 + x)), V::load(s0 + x + 1));
+        h1 = V::add(V::add(V::load(s1 + x - 1), V::load(s1 + x)), V::load(s1 + x + 1));
+        h2 = V::add(V::add(V::load(s2 + x - 1), V::load(s2 + x)), V::load(s2 + x + 1));
+        V::store(d + x, V::rg20(V::add(V::add(h0, h1), h2)));
+      }
+      else {
+        __m256i c0 = V::load(s0 + x), c1 = V::load(s1 + x), c2 = V::load(s2 + x);
+        h0 = V::add(V::add(V::load(s0 + x - 1), V::add(c0, c0)), V::load(s0 + x + 1));
+        h1 = V::add(V::add(V::load(s1 + x - 1), V::add(c1, c1)), V::load(s1 + x + 1));
+        h2 = V::add(V::add(V::load(s2 + x - 1), V::add(c2, c2)), V::load(s2 + x + 1));
+        V::store(d + x, V::rg11(V::add(V::add(h0, V::add(h1, h1)), h2)));
+      }
+    }
+  }
+}
+
+template <typename pixel_t> struct RGVec { };
+template <> struct RGVec<uint8_t> { typedef RGVecU8 Cmp; typedef RGBlurU8 Blur; };
+template <> struct RGVec<uint16_t> { typedef RGVecU16 Cmp; typedef RGBlurU16 Blur; };
+
+template <typename pixel_t>
+void removegrain_avx2(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, int mode, int ystart, int yend)
+{
+  typedef typename RGVec<pixel_t>::Cmp C;
+  typedef typename RGVec<pixel_t>::Blur B;
+  switch (mode) {
+  case 1: rg_clip_avx2<C, 1>(dst, src, dst_pitch, src_pitch, width, ystart, yend); break;
+  case 2: rg_clip_avx2<C, 2>(dst, src, dst_pitch, src_pitch, width, ystart, yend); break;
+  case 3: rg_clip_avx2<C, 3>(dst, src, dst_pitch, src_pitch, width, ystart, yend); break;
+  case 4: rg_clip_avx2<C, 4>(dst, src, dst_pitch, src_pitch, width, ystart, yend); break;
+  case 11:
+  case 12: rg_blur_avx2<B, false>(dst, src, dst_pitch, src_pitch, width, ystart, yend); break;
+  case 20: rg_blur_avx2<B, true>(dst, src, dst_pitch, src_pitch, width, ystart, yend); break;
+  }
+}
+
+template <typename pixel_t>
+void repair_avx2(pixel_t* dst, const pixel_t* src, const pixel_t* ref,
+  int dst_pitch, int src_pitch, int ref_pitch, int width, int mode, int ystart, int yend)
+{
+  typedef typename RGVec<pixel_t>::Cmp C;
+  switch (mode) {
+  case 1: repair_clip_avx2<C, 1>(dst, src, ref, dst_pitch, src_pitch, ref_pitch, width, ystart, yend); break;
+  case 2: repair_clip_avx2<C, 2>(dst, src, ref, dst_pitch, src_pitch, ref_pitch, width, ystart, yend); break;
+  case 3: repair_clip_avx2<C, 3>(dst, src, ref, dst_pitch, src_pitch, ref_pitch, width, ystart, yend); break;
+  case 4: repair_clip_avx2<C, 4>(dst, src, ref, dst_pitch, src_pitch, ref_pitch, width, ystart, yend); break;
+  }
+}
+
+template void removegrain_avx2<uint8_t>(uint8_t* dst, const uint8_t* src, int dst_pitch, int src_pitch,
+  int width, int mode, int ystart, int yend);
+template void removegrain_avx2<uint16_t>(uint16_t* dst, const uint16_t* src, int dst_pitch, int src_pitch,
+  int width, int mode, int ystart, int yend);
+template void repair_avx2<uint8_t>(uint8_t* dst, const uint8_t* src, const uint8_t* ref,
+  int dst_pitch, int src_pitch, int ref_pitch, int width, int mode, int ystart, int yend);
+template void repair_avx2<uint16_t>(uint16_t* dst, const uint16_t* src, const uint16_t* ref,
+  int dst_pitch, int src_pitch, int ref_pitch, int width, int mode, int ystart, int yend);
+
+static __forceinline uint64_t hsum_epi64(__m256i v) {
+  __m128i s = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+  return (uint64_t)_mm_cvtsi128_si64(s) + (uint64_t)_mm_extract_epi64(s, 1);
+}
+
+template <>
+uint64_t sad_avx2<uint8_t>(const uint8_t* a, const uint8_t* b, int a_pitch, int b_pitch,
+  int width, int ystart, int yend)
+{
+  __m256i sum = _mm256_setzero_si256();
+  uint64_t tail = 0;
+  for (int y = ystart; y < yend; ++y) {
+    const uint8_t* pa = a + y * a_pitch;
+    const uint8_t* pb = b + y * b_pitch;
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+      __m256i va = _mm256_loadu_si256((const __m256i*)(pa + x));
+      __m256i vb = _mm256_loadu_si256((const __m256i*)(pb + x));
+      sum = _mm256_add_epi64(sum, _mm256_sad_epu8(va, vb));
+    }
+    for (; x < width; ++x) {
+      tail += std::abs(pa[x] - pb[x]);
+    }
+  }
+  return hsum_epi64(sum) + tail;
+}
+
+template <>
+uint64_t sad_avx2<uint16_t>(const uint16_t* a, const uint16_t* b, int a_pitch, int b_pitch,
+  int width, int ystart, int yend)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i sum = _mm256_setzero_si256();
+  uint64_t tail = 0;
+  for (int y = ystart; y < yend; ++y) {
+    const uint16_t* pa = a + y * a_pitch;
+    const uint16_t* pb = b + y * b_pitch;
+    // 1s32bitňȂ̂ōsƂ64bit֑
+    __m256i rowsum = _mm256_setzero_si256();
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+      __m256i va = _mm256_loadu_si256((const __m256i*)(pa + x));
+      __m256i vb = _mm256_loadu_si256((const __m256i*)(pb + x));
+      __m256i d = _mm256_or_si256(_mm256_subs_epu16(va, vb), _mm256_subs_epu16(vb, va));
+      rowsum = _mm256_add_epi32(rowsum, _mm256_add_epi32(
+        _mm256_unpacklo_epi16(d, zero), _mm256_unpackhi_epi16(d, zero)));
+    }
+    sum = _mm256_add_epi64(sum, _mm256_add_epi64(
+      _mm256_unpacklo_epi32(rowsum, zero), _mm256_unpackhi_epi32(rowsum, zero)));
+    for (; x < width; ++x) {
+      tail += std::abs(pa[x] - pb[x]);
+    }
+  }
+  return hsum_epi64(sum) + tail;
+}
+
+// 8bit16bitA16bit32bitɍLČvZiRGBlurU8,RGBlurU16load,storegj
+template <typename V>
+static void binomial_soften_avx2_t(typename V::pixel_t* dst, int dst_pitch,
+  const typename V::pixel_t* const* srcs, const int* pitches, int radius, int width, int ystart, int yend)
+{
+  typedef typename V::pixel_t pixel_t;
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* src = srcs[0] + y * pitches[0];
+    const pixel_t* ref0 = srcs[1] + y * pitches[1];
+    const pixel_t* ref1 = srcs[2] + y * pitches[2];
+    pixel_t* d = dst + y * dst_pitch;
+    if (radius == 1) {
+      for (int xx = 0; xx < width; xx += V::N) {
+        const int x = std::min(xx, width - V::N);
+        __m256i s = V::load(src + x);
+        __m256i t = V::add(V::add(V::load(ref0 + x), V::load(ref1 + x)), V::add(s, s));
+        V::store(d + x, V::shift(V::add(t, V::set1(2)), 2));
+      }
+    }
+    else {
+      const pixel_t* ref2 = srcs[3] + y * pitches[3];
+      const pixel_t* ref3 = srcs[4] + y * pitches[4];
+      for (int xx = 0; xx < width; xx += V::N) {
+        const int x = std::min(xx, width - V::N);
+        // ref2 + ref0*4 + src*6 + ref1*4 + ref3 = (ref2 + ref3) + ((ref0 + ref1 + src) * 4) + src*2
+        __m256i s = V::load(src + x);
+        __m256i t = V::add(V::add(V::load(ref0 + x), V::load(ref1 + x)), s);
+        t = V::add(V::add(V::shl(t, 2), V::add(s, s)), V::add(V::load(ref2 + x), V::load(ref3 + x)));
+        V::store(d + x, V::shift(V::add(t, V::set1(4)), 4));
+      }
+    }
+  }
+}
+
+template <typename pixel_t>
+void binomial_soften_avx2(pixel_t* dst, int dst_pitch, const pixel_t* const* srcs, const int* pitches,
+  int radius, int width, int ystart, int yend)
+{
+  binomial_soften_avx2_t<typename RGVec<pixel_t>::Blur>(dst, dst_pitch, srcs, pitches, radius, width, ystart, yend);
+}
+
+template void binomial_soften_avx2<uint8_t>(uint8_t* dst, int dst_pitch, const uint8_t* const* srcs, const int* pitches,
+  int radius, int width, int ystart, int yend);
+template void binomial_soften_avx2<uint16_t>(uint16_t* dst, int dst_pitch, const uint16_t* const* srcs, const int* pitches,
+  int radius, int width, int ystart, int yend);
+
+// e߂̓ubNŚi8̔{ɐ؂グjɂ܂Ƃ߂ēKp
+// WX^zEXPR_BLOCK̒̂Œ[̗]ȃ[͓ǂݏĂȂ
+template <typename pixel_t>
+void expr_avx2(pixel_t* dst, int dst_pitch, const pixel_t* const* srcs, const int* pitches,
+  int width, const ExprOp* ops, int numOps, float maxval, int ystart, int yend)
+{
+  const __m256 vzero = _mm256_setzero_ps();
+  const __m256 vone = _mm256_set1_ps(1.0f);
+  const __m256 vmax = _mm256_set1_ps(maxval);
+  const __m256 vhalf = _mm256_set1_ps(0.5f);
+  const __m256 vsign = _mm256_set1_ps(-0.0f);
+
+  alignas(32) float regs[EXPR_MAX_STACK][EXPR_BLOCK];
+
+#define EXPR_LOOP(expr) for (int k = 0; k < len8; k += 8) { _mm256_store_ps(d + k, expr); }
+#define VA _mm256_load_ps(a + k)
+#define VB _mm256_load_ps(b + k)
+#define VC _mm256_load_ps(c + k)
+
+  for (int y = ystart; y < yend; ++y) {
+    for (int x0 = 0; x0 < width; x0 += EXPR_BLOCK) {
+      const int len = std::min<int>(EXPR_BLOCK, width - x0);
+      const int len8 = (len + 7) & ~7;
+      for (int i = 0; i < numOps; ++i) {
+        const ExprOp& op = ops[i];
+        float* d = regs[op.dst];
+        float* a = regs[op.a];
+        float* b = regs[op.b];
+        float* c = regs[op.c];
+        switch (op.op) {
+        case EXPR_LOAD: {
+          const pixel_t* s = srcs[op.a] + y * pitches[op.a] + x0;
+          int k = 0;
+          for (; k + 8 <= len; k += 8) _mm256_store_ps(d + k, load8_ps(s + k));
+          for (; k < len; ++k) d[k] = s[k];
+          break;
+        }
+        case EXPR_CONST: EXPR_LOOP(_mm256_set1_ps(op.imm)); break;
+        case EXPR_DUP: EXPR_LOOP(VA); break;
+        case EXPR_SWAP:
+          for (int k = 0; k < len8; k += 8) {
+            __m256 t = VA;
+            _mm256_store_ps(a + k, VB);
+            _mm256_store_ps(b + k, t);
+          }
+          break;
+        case EXPR_ADD: EXPR_LOOP(_mm256_add_ps(VA, VB)); break;
+        case EXPR_SUB: EXPR_LOOP(_mm256_sub_ps(VA, VB)); break;
+        case EXPR_MUL: EXPR_LOOP(_mm256_mul_ps(VA, VB)); break;
+        case EXPR_DIV: EXPR_LOOP(_mm256_div_ps(VA, VB)); break;
+        case EXPR_MIN: EXPR_LOOP(_mm256_min_ps(VA, VB)); break;
+        case EXPR_MAX: EXPR_LOOP(_mm256_max_ps(VA, VB)); break;
+        case EXPR_LT: EXPR_LOOP(_mm256_and_ps(_mm256_cmp_ps(VA, VB, _CMP_LT_OQ), vone)); break;
+        case EXPR_GT: EXPR_LOOP(_mm256_and_ps(_mm256_cmp_ps(VA, VB, _CMP_GT_OQ), vone)); break;
+        case EXPR_LE: EXPR_LOOP(_mm256_and_ps(_mm256_cmp_ps(VA, VB, _CMP_LE_OQ), vone)); break;
+        case EXPR_GE: EXPR_LOOP(_mm256_and_ps(_mm256_cmp_ps(VA, VB, _CMP_GE_OQ), vone)); break;
+        case EXPR_EQ: EXPR_LOOP(_mm256_and_ps(_mm256_cmp_ps(VA, VB, _CMP_EQ_OQ), vone)); break;
+        case EXPR_NE: EXPR_LOOP(_mm256_and_ps(_mm256_cmp_ps(VA, VB, _CMP_NEQ_UQ), vone)); break;
+        case EXPR_AND:
+          EXPR_LOOP(_mm256_and_ps(_mm256_and_ps(
+            _mm256_cmp_ps(VA, vzero, _CMP_GT_OQ), _mm256_cmp_ps(VB, vzero, _CMP_GT_OQ)), vone));
+          break;
+        case EXPR_OR:
+          EXPR_LOOP(_mm256_and_ps(_mm256_or_ps(
+            _mm256_cmp_ps(VA, vzero, _CMP_GT_OQ), _mm256_cmp_ps(VB, vzero, _CMP_GT_OQ)), vone));
+          break;
+        case EXPR_ABS: EXPR_LOOP(_mm256_andnot_ps(vsign, VA)); break;
+        case EXPR_NEG: EXPR_LOOP(_mm256_xor_ps(vsign, VA)); break;
+        case EXPR_SQRT: EXPR_LOOP(_mm256_sqrt_ps(VA)); break;
+        case EXPR_FLOOR: EXPR_LOOP(_mm256_floor_ps(VA)); break;
+        case EXPR_COND: EXPR_LOOP(_mm256_blendv_ps(VC, VB, _mm256_cmp_ps(VA, vzero, _CMP_NEQ_UQ))); break;
+        case EXPR_CLIP: EXPR_LOOP(_mm256_min_ps(_mm256_max_ps(VA, VB), VC)); break;
+        }
+      }
+
+      const float* r = regs[0];
+      pixel_t* pd = dst + y * dst_pitch + x0;
+      int k = 0;
+      for (; k + 8 <= len; k += 8) {
+        __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_load_ps(r + k), vzero), vmax);
+        store8_ps(pd + k, _mm256_add_ps(v, vhalf));
+      }
+      for (; k < len; ++k) {
+        float v = r[k];
+        v = (v > 0.0f) ? v : 0.0f;
+        v = (v < maxval) ? v : maxval;
+        pd[k] = pixel_t(v + 0.5f);
+      }
+    }
+  }
+
+#undef EXPR_LOOP
+#undef VA
+#undef VB
+#undef VC
+}
+
+template void expr_avx2<uint8_t>(uint8_t* dst, int dst_pitch, const uint8_t* const* srcs, const int* pitches,
+  int width, const ExprOp* ops, int numOps, float maxval, int ystart, int yend);
+template void expr_avx2<uint16_t>(uint16_t* dst, int dst_pitch, const uint16_t* const* srcs, const int* pitches,
+  int width, const ExprOp* ops, int numOps, float maxval, int ystart, int yend);
+
+template <typename V>
+static void xpand_vertical_x2_avx2_t(typename V::pixel_t* dst, const typename V::pixel_t* src,
+  int dst_pitch, int src_pitch, int height, bool isMax, int xstart, int xend, int ystart, int yend)
+{
+  typedef typename V::pixel_t pixel_t;
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* s0 = src + std::max(y - 2, 0) * src_pitch;
+    const pixel_t* s1 = src + std::max(y - 1, 0) * src_pitch;
+    const pixel_t* s2 = src + y * src_pitch;
+    const pixel_t* s3 = src + std::min(y + 1, height - 1) * src_pitch;
+    const pixel_t* s4 = src + std::min(y + 2, height - 1) * src_pitch;
+    pixel_t* d = dst + y * dst_pitch;
+    if (isMax) {
+      for (int x = xstart; x < xend; x += V::N) {
+        V::store(d + x, V::max(V::max(V::max(V::load(s0 + x), V::load(s1 + x)),
+          V::max(V::load(s2 + x), V::load(s3 + x))), V::load(s4 + x)));
+      }
+    }
+    else {
+      for (int x = xstart; x < xend; x += V::N) {
+        V::store(d + x, V::min(V::min(V::min(V::load(s0 + x), V::load(s1 + x)),
+          V::min(V::load(s2 + x), V::load(s3 + x))), V::load(s4 + x)));
+      }
+    }
+  }
+}
+
+template <typename V>
+static void vertical_median_avx2_t(typename V::pixel_t* dst, const typename V::pixel_t* src,
+  int dst_pitch, int src_pitch, int xstart, int xend, int ystart, int yend)
+{
+  typedef typename V::pixel_t pixel_t;
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* s0 = src + (y - 1) * src_pitch;
+    const pixel_t* s1 = src + y * src_pitch;
+    const pixel_t* s2 = src + (y + 1) * src_pitch;
+    pixel_t* d = dst + y * dst_pitch;
+    for (int x = xstart; x < xend; x += V::N) {
+      __m256i a = V::load(s0 + x), b = V::load(s1 + x), c = V::load(s2 + x);
+      V::store(d + x, V::min(V::max(V::min(a, b), c), V::max(a, b)));
+    }
+  }
+}
+
+template <typename pixel_t>
+void xpand_vertical_x2_avx2(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int height, bool isMax, int xstart, int xend, int ystart, int yend)
+{
+  xpand_vertical_x2_avx2_t<typename RGVec<pixel_t>::Cmp>(
+    dst, src, dst_pitch, src_pitch, height, isMax, xstart, xend, ystart, yend);
+}
+
+template <typename pixel_t>
+void vertical_median_avx2(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int xstart, int xend, int ystart, int yend)
+{
+  vertical_median_avx2_t<typename RGVec<pixel_t>::Cmp>(
+    dst, src, dst_pitch, src_pitch, xstart, xend, ystart, yend);
+}
+
+template void xpand_vertical_x2_avx2<uint8_t>(uint8_t* dst, const uint8_t* src, int dst_pitch, int src_pitch,
+  int height, bool isMax, int xstart, int xend, int ystart, int yend);
+template void xpand_vertical_x2_avx2<uint16_t>(uint16_t* dst, const uint16_t* src, int dst_pitch, int src_pitch,
+  int height, bool isMax, int xstart, int xend, int ystart, int yend);
+template void vertical_median_avx2<uint8_t>(uint8_t* dst, const uint8_t* src, int dst_pitch, int src_pitch,
+  int xstart, int xend, int ystart, int yend);
+template void vertical_median_avx2<uint16_t>(uint16_t* dst, const uint16_t* src, int dst_pitch, int src_pitch,
+  int xstart, int xend, int ystart, int yend);
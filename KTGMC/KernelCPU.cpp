@@ -0,0 +1,579 @@
+#include "avisynth.h"
+
+#define NOMINMAX
+#include <windows.h>
+#include <cstdint>
+#include <algorithm>
+
+#include <cstring>
+#include <atomic>
+#include <cstdlib>
+#include <cmath>
+#include <functional>
+#include <memory>
+
+#include "KernelCPU.h"
+#include "Expr.h"
+#include "ThreadPool.h"
+
+// Kernel.cũtB^CPUiCłAVX2ł̐U蕪j
+// Cłkl_XXXJ[lƓvZŏ
+
+template <typename pixel_t>
+static void resample_v_c(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, const int* offset, const float* coef, int filter_size, int ystart, int yend)
+{
+  const float maxv = (sizeof(pixel_t) == 1) ? 255.0f : 65535.0f;
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* s = src + offset[y] * src_pitch;
+    const float* c = coef + y * filter_size;
+    pixel_t* d = dst + y * dst_pitch;
+    for (int x = 0; x < width; ++x) {
+      float result = 0;
+      for (int i = 0; i < filter_size; ++i) {
+        result += s[x + i * src_pitch] * c[i];
+      }
+      result = std::min(std::max(result, 0.0f), maxv);
+      d[x] = pixel_t(result + 0.5f);
+    }
+  }
+}
+
+template <typename pixel_t>
+void cpu_resample_v(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, int height, const int* offset, const float* coef, int filter_size, int cpuFlags)
+{
+  const bool avx2 = (cpuFlags & CPUF_AVX2) != 0;
+  ThreadPool::GetInstance().ParallelRows(height, 16, [=](int ystart, int yend) {
+    if (avx2) {
+      resample_v_avx2(dst, src, dst_pitch, src_pitch, width, offset, coef, filter_size, ystart, yend);
+    }
+    else {
+      resample_v_c(dst, src, dst_pitch, src_pitch, width, offset, coef, filter_size, ystart, yend);
+    }
+  });
+}
+
+template void cpu_resample_v<uint8_t>(uint8_t* dst, const uint8_t* src, int dst_pitch, int src_pitch,
+  int width, int height, const int* offset, const float* coef, int filter_size, int cpuFlags);
+template void cpu_resample_v<uint16_t>(uint16_t* dst, const uint16_t* src, int dst_pitch, int src_pitch,
+  int width, int height, const int* offset, const float* coef, int filter_size, int cpuFlags);
+
+// tile1sg
+template <typename pixel_t>
+static void gauss_resize_c(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch, int width,
+  const int* offsetV, const float* coefV, int filterSizeV,
+  const int* offsetH, const float* coefH, int filterSizeH, float* tile, int ystart, int yend)
+{
+  const float maxv = (sizeof(pixel_t) == 1) ? 255.0f : 65535.0f;
+  for (int y = ystart; y < yend; ++y) {
+    // c
+    const pixel_t* s = src + offsetV[y] * src_pitch;
+    const float* c = coefV + y * filterSizeV;
+    for (int x = 0; x < width; ++x) {
+      float result = 0;
+      for (int i = 0; i < filterSizeV; ++i) {
+        result += s[x + i * src_pitch] * c[i];
+      }
+      result = std::min(std::max(result, 0.0f), maxv);
+      tile[x] = (float)pixel_t(result + 0.5f);
+    }
+    // 
+    pixel_t* d = dst + y * dst_pitch;
+    for (int x = 0; x < width; ++x) {
+      const float* t = tile + offsetH[x];
+      const float* ch = coefH + x * filterSizeH;
+      float result = 0;
+      for (int i = 0; i < filterSizeH; ++i) {
+        result += t[i] * ch[i];
+      }
+      result = std::min(std::max(result, 0.0f), maxv);
+      d[x] = pixel_t(result + 0.5f);
+    }
+  }
+}
+
+template <typename pixel_t>
+void cpu_gauss_resize(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch, int width, int height,
+  const int* offsetV, const float* coefV, int filterSizeV,
+  const int* offsetH, const float* coefH, int filterSizeH, int cpuFlags)
+{
+  const bool avx2 = (cpuFlags & CPUF_AVX2) != 0;
+  ThreadPool::GetInstance().ParallelRows(height, 16, [=](int ystart, int yend) {
+    std::unique_ptr<float[]> tile(new float[width * GAUSS_TILE_ROWS]);
+    if (avx2) {
+      gauss_resize_avx2(dst, src, dst_pitch, src_pitch, width,
+        offsetV, coefV, filterSizeV, offsetH, coefH, filterSizeH, tile.get(), ystart, yend);
+    }
+    else {
+      gauss_resize_c(dst, src, dst_pitch, src_pitch, width,
+        offsetV, coefV, filterSizeV, offsetH, coefH, filterSizeH, tile.get(), ystart, yend);
+    }
+  });
+}
+
+template void cpu_gauss_resize<uint8_t>(uint8_t* dst, const uint8_t* src, int dst_pitch, int src_pitch, int width, int height,
+  const int* offsetV, const float* coefV, int filterSizeV,
+  const int* offsetH, const float* coefH, int filterSizeH, int cpuFlags);
+template void cpu_gauss_resize<uint16_t>(uint16_t* dst, const uint16_t* src, int dst_pitch, int src_pitch, int width, int height,
+  const int* offsetV, const float* coefV, int filterSizeV,
+  const int* offsetH, const float* coefH, int filterSizeH, int cpuFlags);
+
+template <typename pixel_t>
+static void copy_plane(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch, int width, int height)
+{
+  for (int y = 0; y < height; ++y) {
+    memcpy(dst + y * dst_pitch, src + y * src_pitch, width * sizeof(pixel_t));
+  }
+}
+
+// kl_copy_boarder1Ɠ
+template <typename pixel_t>
+static void copy_border1(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch, int width, int height)
+{
+  memcpy(dst, src, width * sizeof(pixel_t));
+  memcpy(dst + (height - 1) * dst_pitch, src + (height - 1) * src_pitch, width * sizeof(pixel_t));
+  for (int y = 1; y < height - 1; ++y) {
+    dst[y * dst_pitch] = src[y * src_pitch];
+    dst[(width - 1) + y * dst_pitch] = src[(width - 1) + y * src_pitch];
+  }
+}
+
+static inline int clamp(int n, int minv, int maxv) {
+  return std::max(minv, std::min(n, maxv));
+}
+
+struct IntCompareAndSwap {
+  void operator()(int& a, int& b) {
+    int a_ = std::min(a, b);
+    int b_ = std::max(a, b);
+    a = a_; b = b_;
+  }
+};
+
+template <typename pixel_t, int N>
+static void rg_clip_c(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, int ystart, int yend)
+{
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* s0 = src + (y - 1) * src_pitch;
+    const pixel_t* s1 = src + y * src_pitch;
+    const pixel_t* s2 = src + (y + 1) * src_pitch;
+    pixel_t* d = dst + y * dst_pitch;
+    for (int x = 1; x < width - 1; ++x) {
+      int a0 = s0[x - 1], a1 = s0[x], a2 = s0[x + 1];
+      int a3 = s1[x - 1], s = s1[x], a4 = s1[x + 1];
+      int a5 = s2[x - 1], a6 = s2[x], a7 = s2[x + 1];
+
+      cpu_sort_8elem<int, IntCompareAndSwap>(a0, a1, a2, a3, a4, a5, a6, a7);
+
+      int tmp;
+      switch (N) {
+      case 1: tmp = clamp(s, a0, a7); break;
+      case 2: tmp = clamp(s, a1, a6); break;
+      case 3: tmp = clamp(s, a2, a5); break;
+      case 4: tmp = clamp(s, a3, a4); break;
+      }
+      d[x] = tmp;
+    }
+  }
+}
+
+// mode 11,12: [1 2 1]Amode 20: [1 1 1]
+template <typename pixel_t, bool RG20>
+static void rg_blur_c(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, int ystart, int yend)
+{
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* s0 = src + (y - 1) * src_pitch;
+    const pixel_t* s1 = src + y * src_pitch;
+    const pixel_t* s2 = src + (y + 1) * src_pitch;
+    pixel_t* d = dst + y * dst_pitch;
+    for (int x = 1; x < width - 1; ++x) {
+      int tmp;
+      if (RG20) {
+        int sum = s0[x - 1] + s0[x] + s0[x + 1] + s1[x - 1] + s1[x] + s1[x + 1] + s2[x - 1] + s2[x] + s2[x + 1];
+        tmp = (sum + 4) / 9;
+      }
+      else {
+        int h0 = s0[x - 1] + s0[x] * 2 + s0[x + 1];
+        int h1 = s1[x - 1] + s1[x] * 2 + s1[x + 1];
+        int h2 = s2[x - 1] + s2[x] * 2 + s2[x + 1];
+        tmp = (h0 + h1 * 2 + h2 + 8) >> 4;
+      }
+      d[x] = tmp;
+    }
+  }
+}
+
+template <typename pixel_t, int N>
+static void repair_clip_c(pixel_t* dst, const pixel_t* src, const pixel_t* ref,
+  int dst_pitch, int src_pitch, int ref_pitch, int width, int ystart, int yend)
+{
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* r0 = ref + (y - 1) * ref_pitch;
+    const pixel_t* r1 = ref + y * ref_pitch;
+    const pixel_t* r2 = ref + (y + 1) * ref_pitch;
+    const pixel_t* s1 = src + y * src_pitch;
+    pixel_t* d = dst + y * dst_pitch;
+    for (int x = 1; x < width - 1; ++x) {
+      int a0 = r0[x - 1], a1 = r0[x], a2 = r0[x + 1];
+      int a3 = r1[x - 1], a4 = r1[x], a5 = r1[x + 1];
+      int a6 = r2[x - 1], a7 = r2[x], a8 = r2[x + 1];
+
+      cpu_sort_9elem<int, IntCompareAndSwap>(a0, a1, a2, a3, a4, a5, a6, a7, a8);
+
+      int s = s1[x];
+      int tmp;
+      switch (N) {
+      case 1: tmp = clamp(s, a0, a8); break;
+      case 2: tmp = clamp(s, a1, a7); break;
+      case 3: tmp = clamp(s, a2, a6); break;
+      case 4: tmp = clamp(s, a3, a5); break;
+      }
+      d[x] = tmp;
+    }
+  }
+}
+
+template <typename pixel_t>
+static void removegrain_c(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, int mode, int ystart, int yend)
+{
+  switch (mode) {
+  case 1: rg_clip_c<pixel_t, 1>(dst, src, dst_pitch, src_pitch, width, ystart, yend); break;
+  case 2: rg_clip_c<pixel_t, 2>(dst, src, dst_pitch, src_pitch, width, ystart, yend); break;
+  case 3: rg_clip_c<pixel_t, 3>(dst, src, dst_pitch, src_pitch, width, ystart, yend); break;
+  case 4: rg_clip_c<pixel_t, 4>(dst, src, dst_pitch, src_pitch, width, ystart, yend); break;
+  case 11:
+  case 12: rg_blur_c<pixel_t, false>(dst, src, dst_pitch, src_pitch, width, ystart, yend); break;
+  case 20: rg_blur_c<pixel_t, true>(dst, src, dst_pitch, src_pitch, width, ystart, yend); break;
+  }
+}
+
+template <typename pixel_t>
+static void repair_c(pixel_t* dst, const pixel_t* src, const pixel_t* ref,
+  int dst_pitch, int src_pitch, int ref_pitch, int width, int mode, int ystart, int yend)
+{
+  switch (mode) {
+  case 1: repair_clip_c<pixel_t, 1>(dst, src, ref, dst_pitch, src_pitch, ref_pitch, width, ystart, yend); break;
+  case 2: repair_clip_c<pixel_t, 2>(dst, src, ref, dst_pitch, src_pitch, ref_pitch, width, ystart, yend); break;
+  case 3: repair_clip_c<pixel_t, 3>(dst, src, ref, dst_pitch, src_pitch, ref_pitch, width, ystart, yend); break;
+  case 4: repair_clip_c<pixel_t, 4>(dst, src, ref, dst_pitch, src_pitch, ref_pitch, width, ystart, yend); break;
+  }
+}
+
+template <typename pixel_t>
+void cpu_removegrain(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, int height, int mode, int cpuFlags)
+{
+  if (mode == 0 || width < 3 || height < 3) {
+    copy_plane(dst, src, dst_pitch, src_pitch, width, height);
+    return;
+  }
+  const bool avx2 = (cpuFlags & CPUF_AVX2) && (width - 2 >= REMOVEGRAIN_AVX2_MIN_WIDTH);
+  // E̍sđтɕ
+  ThreadPool::GetInstance().ParallelRows(height - 2, 16, [=](int ystart, int yend) {
+    if (avx2) {
+      removegrain_avx2(dst, src, dst_pitch, src_pitch, width, mode, ystart + 1, yend + 1);
+    }
+    else {
+      removegrain_c(dst, src, dst_pitch, src_pitch, width, mode, ystart + 1, yend + 1);
+    }
+  });
+  copy_border1(dst, src, dst_pitch, src_pitch, width, height);
+}
+
+template <typename pixel_t>
+void cpu_repair(pixel_t* dst, const pixel_t* src, const pixel_t* ref,
+  int dst_pitch, int src_pitch, int ref_pitch, int width, int height, int mode, int cpuFlags)
+{
+  if (mode == 0 || width < 3 || height < 3) {
+    copy_plane(dst, src, dst_pitch, src_pitch, width, height);
+    return;
+  }
+  const bool avx2 = (cpuFlags & CPUF_AVX2) && (width - 2 >= REMOVEGRAIN_AVX2_MIN_WIDTH);
+  ThreadPool::GetInstance().ParallelRows(height - 2, 16, [=](int ystart, int yend) {
+    if (avx2) {
+      repair_avx2(dst, src, ref, dst_pitch, src_pitch, ref_pitch, width, mode, ystart + 1, yend + 1);
+    }
+    else {
+      repair_c(dst, src, ref, dst_pitch, src_pitch, ref_pitch, width, mode, ystart + 1, yend + 1);
+    }
+  });
+  copy_border1(dst, src, dst_pitch, src_pitch, width, height);
+}
+
+template void cpu_removegrain<uint8_t>(uint8_t* dst, const uint8_t* src, int dst_pitch, int src_pitch,
+  int width, int height, int mode, int cpuFlags);
+template void cpu_removegrain<uint16_t>(uint16_t* dst, const uint16_t* src, int dst_pitch, int src_pitch,
+  int width, int height, int mode, int cpuFlags);
+template void cpu_repair<uint8_t>(uint8_t* dst, const uint8_t* src, const uint8_t* ref,
+  int dst_pitch, int src_pitch, int ref_pitch, int width, int height, int mode, int cpuFlags);
+template void cpu_repair<uint16_t>(uint16_t* dst, const uint16_t* src, const uint16_t* ref,
+  int dst_pitch, int src_pitch, int ref_pitch, int width, int height, int mode, int cpuFlags);
+
+template <typename pixel_t>
+static uint64_t sad_c(const pixel_t* a, const pixel_t* b, int a_pitch, int b_pitch,
+  int width, int ystart, int yend)
+{
+  uint64_t sad = 0;
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* pa = a + y * a_pitch;
+    const pixel_t* pb = b + y * b_pitch;
+    uint32_t rowsad = 0;
+    for (int x = 0; x < width; ++x) {
+      rowsad += std::abs(pa[x] - pb[x]);
+    }
+    sad += rowsad;
+  }
+  return sad;
+}
+
+template <typename pixel_t>
+uint64_t cpu_sad(const pixel_t* a, const pixel_t* b, int a_pitch, int b_pitch,
+  int width, int height, int cpuFlags)
+{
+  const bool avx2 = (cpuFlags & CPUF_AVX2) != 0;
+  std::atomic<uint64_t> sad(0);
+  ThreadPool::GetInstance().ParallelRows(height, 16, [&](int ystart, int yend) {
+    sad += avx2
+      ? sad_avx2(a, b, a_pitch, b_pitch, width, ystart, yend)
+      : sad_c(a, b, a_pitch, b_pitch, width, ystart, yend);
+  });
+  return sad;
+}
+
+template <typename pixel_t>
+static void binomial_soften_c(pixel_t* dst, int dst_pitch, const pixel_t* const* srcs, const int* pitches,
+  int radius, int width, int ystart, int yend)
+{
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* src = srcs[0] + y * pitches[0];
+    const pixel_t* ref0 = srcs[1] + y * pitches[1];
+    const pixel_t* ref1 = srcs[2] + y * pitches[2];
+    pixel_t* d = dst + y * dst_pitch;
+    if (radius == 1) {
+      for (int x = 0; x < width; ++x) {
+        d[x] = (ref0[x] + src[x] * 2 + ref1[x] + 2) >> 2;
+      }
+    }
+    else {
+      const pixel_t* ref2 = srcs[3] + y * pitches[3];
+      const pixel_t* ref3 = srcs[4] + y * pitches[4];
+      for (int x = 0; x < width; ++x) {
+        d[x] = (ref2[x] + ref0[x] * 4 + src[x] * 6 + ref1[x] * 4 + ref3[x] + 4) >> 4;
+      }
+    }
+  }
+}
+
+template <typename pixel_t>
+void cpu_binomial_soften(pixel_t* dst, int dst_pitch, const pixel_t* const* srcs, const int* pitches,
+  int radius, int width, int height, int cpuFlags)
+{
+  const bool avx2 = (cpuFlags & CPUF_AVX2) && (width >= BINOMIAL_SOFTEN_AVX2_MIN_WIDTH);
+  ThreadPool::GetInstance().ParallelRows(height, 16, [=](int ystart, int yend) {
+    if (avx2) {
+      binomial_soften_avx2(dst, dst_pitch, srcs, pitches, radius, width, ystart, yend);
+    }
+    else {
+      binomial_soften_c(dst, dst_pitch, srcs, pitches, radius, width, ystart, yend);
+    }
+  });
+}
+
+template uint64_t cpu_sad<uint8_t>(const uint8_t* a, const uint8_t* b, int a_pitch, int b_pitch,
+  int width, int height, int cpuFlags);
+template uint64_t cpu_sad<uint16_t>(const uint16_t* a, const uint16_t* b, int a_pitch, int b_pitch,
+  int width, int height, int cpuFlags);
+template void cpu_binomial_soften<uint8_t>(uint8_t* dst, int dst_pitch, const uint8_t* const* srcs, const int* pitches,
+  int radius, int width, int height, int cpuFlags);
+template void cpu_binomial_soften<uint16_t>(uint16_t* dst, int dst_pitch, const uint16_t* const* srcs, const int* pitches,
+  int radius, int width, int height, int cpuFlags);
+
+// min,max,rAVX2̖߂NaN𑵂̈Ă
+template <typename pixel_t>
+static void expr_c(pixel_t* dst, int dst_pitch, const pixel_t* const* srcs, const int* pitches,
+  int width, const ExprOp* ops, int numOps, float maxval, int ystart, int yend)
+{
+  float regs[EXPR_MAX_STACK][EXPR_BLOCK];
+
+  for (int y = ystart; y < yend; ++y) {
+    for (int x0 = 0; x0 < width; x0 += EXPR_BLOCK) {
+      const int len = std::min<int>(EXPR_BLOCK, width - x0);
+      for (int i = 0; i < numOps; ++i) {
+        const ExprOp& op = ops[i];
+        float* d = regs[op.dst];
+        float* a = regs[op.a];
+        float* b = regs[op.b];
+        float* c = regs[op.c];
+        switch (op.op) {
+        case EXPR_LOAD: {
+          const pixel_t* s = srcs[op.a] + y * pitches[op.a] + x0;
+          for (int k = 0; k < len; ++k) d[k] = s[k];
+          break;
+        }
+        case EXPR_CONST: for (int k = 0; k < len; ++k) d[k] = op.imm; break;
+        case EXPR_DUP: for (int k = 0; k < len; ++k) d[k] = a[k]; break;
+        case EXPR_SWAP: for (int k = 0; k < len; ++k) std::swap(a[k], b[k]); break;
+        case EXPR_ADD: for (int k = 0; k < len; ++k) d[k] = a[k] + b[k]; break;
+        case EXPR_SUB: for (int k = 0; k < len; ++k) d[k] = a[k] - b[k]; break;
+        case EXPR_MUL: for (int k = 0; k < len; ++k) d[k] = a[k] * b[k]; break;
+        case EXPR_DIV: for (int k = 0; k < len; ++k) d[k] = a[k] / b[k]; break;
+        case EXPR_MIN: for (int k = 0; k < len; ++k) d[k] = (a[k] < b[k]) ? a[k] : b[k]; break;
+        case EXPR_MAX: for (int k = 0; k < len; ++k) d[k] = (a[k] > b[k]) ? a[k] : b[k]; break;
+        case EXPR_LT: for (int k = 0; k < len; ++k) d[k] = (a[k] < b[k]) ? 1.0f : 0.0f; break;
+        case EXPR_GT: for (int k = 0; k < len; ++k) d[k] = (a[k] > b[k]) ? 1.0f : 0.0f; break;
+        case EXPR_LE: for (int k = 0; k < len; ++k) d[k] = (a[k] <= b[k]) ? 1.0f : 0.0f; break;
+        case EXPR_GE: for (int k = 0; k < len; ++k) d[k] = (a[k] >= b[k]) ? 1.0f : 0.0f; break;
+        case EXPR_EQ: for (int k = 0; k < len; ++k) d[k] = (a[k] == b[k]) ? 1.0f : 0.0f; break;
+        case EXPR_NE: for (int k = 0; k < len; ++k) d[k] = (a[k] != b[k]) ? 1.0f : 0.0f; break;
+        case EXPR_AND: for (int k = 0; k < len; ++k) d[k] = (a[k] > 0 && b[k] > 0) ? 1.0f : 0.0f; break;
+        case EXPR_OR: for (int k = 0; k < len; ++k) d[k] = (a[k] > 0 || b[k] > 0) ? 1.0f : 0.0f; break;
+        case EXPR_ABS: for (int k = 0; k < len; ++k) d[k] = std::abs(a[k]); break;
+        case EXPR_NEG: for (int k = 0; k < len; ++k) d[k] = -a[k]; break;
+        case EXPR_SQRT: for (int k = 0; k < len; ++k) d[k] = std::sqrt(a[k]); break;
+        case EXPR_FLOOR: for (int k = 0; k < len; ++k) d[k] = std::floor(a[k]); break;
+        case EXPR_COND: for (int k = 0; k < len; ++k) d[k] = (a[k] != 0) ? b[k] : c[k]; break;
+        case EXPR_CLIP:
+          for (int k = 0; k < len; ++k) {
+            float t = (a[k] > b[k]) ? a[k] : b[k];
+            d[k] = (t < c[k]) ? t : c[k];
+          }
+          break;
+        }
+      }
+      pixel_t* pd = dst + y * dst_pitch + x0;
+      for (int k = 0; k < len; ++k) {
+        float v = regs[0][k];
+        v = (v > 0.0f) ? v : 0.0f;
+        v = (v < maxval) ? v : maxval;
+        pd[k] = pixel_t(v + 0.5f);
+      }
+    }
+  }
+}
+
+template <typename pixel_t>
+void cpu_expr(pixel_t* dst, int dst_pitch, const pixel_t* const* srcs, const int* pitches,
+  int width, int height, const ExprOp* ops, int numOps, float maxval, int cpuFlags)
+{
+  const bool avx2 = (cpuFlags & CPUF_AVX2) != 0;
+  ThreadPool::GetInstance().ParallelRows(height, 16, [=](int ystart, int yend) {
+    if (avx2) {
+      expr_avx2(dst, dst_pitch, srcs, pitches, width, ops, numOps, maxval, ystart, yend);
+    }
+    else {
+      expr_c(dst, dst_pitch, srcs, pitches, width, ops, numOps, maxval, ystart, yend);
+    }
+  });
+}
+
+template void cpu_expr<uint8_t>(uint8_t* dst, int dst_pitch, const uint8_t* const* srcs, const int* pitches,
+  int width, int height, const ExprOp* ops, int numOps, float maxval, int cpuFlags);
+template void cpu_expr<uint16_t>(uint16_t* dst, int dst_pitch, const uint16_t* const* srcs, const int* pitches,
+  int width, int height, const ExprOp* ops, int numOps, float maxval, int cpuFlags);
+
+// ̑тƍs̑тɕĕɏ
+// ̑тƃXbhɑȂƂ̂ŁAȂ͍sł
+static void parallel_strips(int width, int height, int stripWidth,
+  const std::function<void(int, int, int, int)>& func)
+{
+  ThreadPool& pool = ThreadPool::GetInstance();
+  const int nstrips = (width + stripWidth - 1) / stripWidth;
+  const int nbands = clamp(pool.GetNumThreads() * 2 / nstrips, 1, std::max(1, height / 16));
+  pool.ParallelFor(nstrips * nbands, [&](int i) {
+    int s = i % nstrips;
+    int b = i / nstrips;
+    func(s * stripWidth, std::min(width, (s + 1) * stripWidth), height * b / nbands, height * (b + 1) / nbands);
+  });
+}
+
+template <typename pixel_t>
+static void xpand_vertical_x2_c(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int height, bool isMax, int xstart, int xend, int ystart, int yend)
+{
+  for (int y = ystart; y < yend; ++y) {
+    // ͈͊O̍s͒[̍sŒui̍s܂ނ̂min,max̌ʂ͓j
+    const pixel_t* s0 = src + std::max(y - 2, 0) * src_pitch;
+    const pixel_t* s1 = src + std::max(y - 1, 0) * src_pitch;
+    const pixel_t* s2 = src + y * src_pitch;
+    const pixel_t* s3 = src + std::min(y + 1, height - 1) * src_pitch;
+    const pixel_t* s4 = src + std::min(y + 2, height - 1) * src_pitch;
+    pixel_t* d = dst + y * dst_pitch;
+    for (int x = xstart; x < xend; ++x) {
+      d[x] = isMax
+        ? std::max(std::max(std::max(s0[x], s1[x]), std::max(s2[x], s3[x])), s4[x])
+        : std::min(std::min(std::min(s0[x], s1[x]), std::min(s2[x], s3[x])), s4[x]);
+    }
+  }
+}
+
+template <typename pixel_t>
+static void vertical_median_c(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int xstart, int xend, int ystart, int yend)
+{
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* s0 = src + (y - 1) * src_pitch;
+    const pixel_t* s1 = src + y * src_pitch;
+    const pixel_t* s2 = src + (y + 1) * src_pitch;
+    pixel_t* d = dst + y * dst_pitch;
+    for (int x = xstart; x < xend; ++x) {
+      int a = s0[x], b = s1[x], c = s2[x];
+      d[x] = std::min(std::max(std::min(a, b), c), std::max(a, b));
+    }
+  }
+}
+
+template <typename pixel_t>
+void cpu_xpand_vertical_x2(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, int height, bool isMax, int cpuFlags)
+{
+  const bool avx2 = (cpuFlags & CPUF_AVX2) != 0;
+  const int vw = 32 / sizeof(pixel_t);
+  parallel_strips(width, height, VERTICAL_STRIP_BYTES / sizeof(pixel_t),
+    [=](int xstart, int xend, int ystart, int yend) {
+    int xv = avx2 ? xstart + (xend - xstart) / vw * vw : xstart;
+    if (xv > xstart) {
+      xpand_vertical_x2_avx2(dst, src, dst_pitch, src_pitch, height, isMax, xstart, xv, ystart, yend);
+    }
+    if (xv < xend) {
+      xpand_vertical_x2_c(dst, src, dst_pitch, src_pitch, height, isMax, xv, xend, ystart, yend);
+    }
+  });
+}
+
+template <typename pixel_t>
+void cpu_vertical_cleaner(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, int height, int mode, int cpuFlags)
+{
+  if (mode == 0 || height < 3) {
+    copy_plane(dst, src, dst_pitch, src_pitch, width, height);
+    return;
+  }
+  const bool avx2 = (cpuFlags & CPUF_AVX2) != 0;
+  const int vw = 32 / sizeof(pixel_t);
+  // ㉺1sď
+  parallel_strips(width, height - 2, VERTICAL_STRIP_BYTES / sizeof(pixel_t),
+    [=](int xstart, int xend, int ystart, int yend) {
+    int xv = avx2 ? xstart + (xend - xstart) / vw * vw : xstart;
+    if (xv > xstart) {
+      vertical_median_avx2(dst, src, dst_pitch, src_pitch, xstart, xv, ystart + 1, yend + 1);
+    }
+    if (xv < xend) {
+      vertical_median_c(dst, src, dst_pitch, src_pitch, xv, xend, ystart + 1, yend + 1);
+    }
+  });
+  memcpy(dst, src, width * sizeof(pixel_t));
+  memcpy(dst + (height - 1) * dst_pitch, src + (height - 1) * src_pitch, width * sizeof(pixel_t));
+}
+
+template void cpu_xpand_vertical_x2<uint8_t>(uint8_t* dst, const uint8_t* src, int dst_pitch, int src_pitch,
+  int width, int height, bool isMax, int cpuFlags);
+template void cpu_xpand_vertical_x2<uint16_t>(uint16_t* dst, const uint16_t* src, int dst_pitch, int src_pitch,
+  int width, int height, bool isMax, int cpuFlags);
+template void cpu_vertical_cleaner<uint8_t>(uint8_t* dst, const uint8_t* src, int dst_pitch, int src_pitch,
+  int width, int height, int mode, int cpuFlags);
+template void cpu_vertical_cleaner<uint16_t>(uint16_t* dst, const uint16_t* src, int dst_pitch, int src_pitch,
+  int width, int height, int mode, int cpuFlags);
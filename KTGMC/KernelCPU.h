@@ -0,0 +1,191 @@
+#pragma once
+
+#include <stdint.h>
+
+struct ExprOp;
+
+// Kernel.cũtB^CPU
+// pitch͗vfioCgł͂Ȃj
+// cpuFlagsAVX2AVX2łgBs͑тɕThreadPoolŕɏ
+
+// cTvikl_resample_vƓvZj
+// offset,coefResamplingProgram̂́icoefheight*filter_sizevfj
+template <typename pixel_t>
+void cpu_resample_v(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, int height, const int* offset, const float* coef, int filter_size, int cpuFlags);
+
+// GaussResizeic̏ kl_resample_v,kl_resample_hƓvZj
+// čʂ͑Sʂ̈ꎞt[ɏAGAUSS_TILE_ROWSsflɊۂ߂ă^Cɒuĉ
+// AVX2ł̓^C]uĎi[x][s]jAsɃxNg
+enum { GAUSS_TILE_ROWS = 8 };
+
+template <typename pixel_t>
+void cpu_gauss_resize(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch, int width, int height,
+  const int* offsetV, const float* coefV, int filterSizeV,
+  const int* offsetH, const float* coefH, int filterSizeH, int cpuFlags);
+
+// RemoveGrainimode 0,1,2,3,4,11,12,20 kl_rg_clip,kl_box3x3_filterƓvZj
+// ㉺E1f̋Esrĉ܂܃Rs[
+template <typename pixel_t>
+void cpu_removegrain(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, int height, int mode, int cpuFlags);
+
+// Repairimode 0,1,2,3,4 kl_repair_clipƓvZj
+template <typename pixel_t>
+void cpu_repair(pixel_t* dst, const pixel_t* src, const pixel_t* ref,
+  int dst_pitch, int src_pitch, int ref_pitch, int width, int height, int mode, int cpuFlags);
+
+// 2ʂ̍Βlaikl_calculate_sadƓŏWvj
+template <typename pixel_t>
+uint64_t cpu_sad(const pixel_t* a, const pixel_t* b, int a_pitch, int b_pitch,
+  int width, int height, int cpuFlags);
+
+// BinomialTemporalSoftenikl_binomial_temporal_soften_1,2ƓvZj
+// srcs,pitches src,prv1,fwd1,prv2,fwd2 ̏BV[`FWref͌ĂяosrcɒuĂ
+template <typename pixel_t>
+void cpu_binomial_soften(pixel_t* dst, int dst_pitch, const pixel_t* const* srcs, const int* pitches,
+  int radius, int width, int height, int cpuFlags);
+
+// c̏͗̑сiVERTICAL_STRIP_BYTESoCgjƂɏォ珇ɏ
+// т̂̕ŎQƂ㉺̍sL1ɎcĂāA͂̊es̓1񂾂ǂ܂
+enum { VERTICAL_STRIP_BYTES = 256 };
+
+// c5^bvmin/maxikl_box5_v,kl_box5_v_borderƓjisMax=falseȂmin
+template <typename pixel_t>
+void cpu_xpand_vertical_x2(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, int height, bool isMax, int cpuFlags);
+
+// VerticalCleanerimode 0,1 kl_vertical_cleaner_medianƓj ㉺1ssrĉ܂܃Rs[
+template <typename pixel_t>
+void cpu_vertical_cleaner(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, int height, int mode, int cpuFlags);
+
+// KExprikl_exprƓvZj srcs,pitches͓x,y,z,ȁ
+// sEXPR_BLOCKfɋ؂Ė߂Ƃɂ܂Ƃ߂ď̂ŁAr̒lL1Ɏ܂
+enum { EXPR_BLOCK = 256 };
+
+template <typename pixel_t>
+void cpu_expr(pixel_t* dst, int dst_pitch, const pixel_t* const* srcs, const int* pitches,
+  int width, int height, const ExprOp* ops, int numOps, float maxval, int cpuFlags);
+
+// \[eBOlbg[NiKernel.cudev_sort_8elem,dev_sort_9elemƓj
+// CłAVX2łŋpBCompareAndSwapa<=bɂȂ悤ɓւ
+template<typename T, typename CompareAndSwap>
+inline void cpu_sort_8elem(T& a0, T& a1, T& a2, T& a3, T& a4, T& a5, T& a6, T& a7)
+{
+  CompareAndSwap cas;
+
+  // Batcher's odd-even mergesort
+  cas(a0, a1);
+  cas(a2, a3);
+  cas(a4, a5);
+  cas(a6, a7);
+
+  cas(a0, a2);
+  cas(a1, a3);
+  cas(a4, a6);
+  cas(a5, a7);
+
+  cas(a1, a2);
+  cas(a5, a6);
+
+  cas(a0, a4);
+  cas(a1, a5);
+  cas(a2, a6);
+  cas(a3, a7);
+
+  cas(a2, a4);
+  cas(a3, a5);
+
+  cas(a1, a2);
+  cas(a3, a4);
+  cas(a5, a6);
+}
+
+template<typename T, typename CompareAndSwap>
+inline void cpu_sort_9elem(T& a0, T& a1, T& a2, T& a3, T& a4, T& a5, T& a6, T& a7, T& a8)
+{
+  CompareAndSwap cas;
+
+  cas(a0, a1);
+  cas(a3, a4);
+  cas(a6, a7);
+
+  cas(a1, a2);
+  cas(a4, a5);
+  cas(a7, a8);
+
+  cas(a0, a1);
+  cas(a3, a4);
+  cas(a6, a7);
+
+  cas(a0, a3);
+  cas(a1, a4);
+  cas(a2, a5);
+
+  cas(a3, a6);
+  cas(a4, a7);
+  cas(a5, a8);
+
+  cas(a0, a3);
+  cas(a1, a4);
+  cas(a2, a5);
+
+  cas(a1, a3);
+  cas(a5, a7);
+  cas(a2, a6);
+  cas(a4, a6);
+  cas(a2, a4);
+  cas(a2, a3);
+  cas(a5, a6);
+}
+
+// ȉAVX2ŁiKernelAVX2.cppj s[ystart,yend)
+// ʂCłƊSɈv
+
+template <typename pixel_t>
+void resample_v_avx2(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, const int* offset, const float* coef, int filter_size, int ystart, int yend);
+
+// tilewidth*GAUSS_TILE_ROWSvf
+// FMA͎g킸CłƓɑ̂Ōʂ͈v
+template <typename pixel_t>
+void gauss_resize_avx2(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch, int width,
+  const int* offsetV, const float* coefV, int filterSizeV,
+  const int* offsetH, const float* coefH, int filterSizeH, float* tile, int ystart, int yend);
+
+// E[1,width-1)Bwidth-2 >= REMOVEGRAIN_AVX2_MIN_WIDTHł邱
+enum { REMOVEGRAIN_AVX2_MIN_WIDTH = 32 };
+
+template <typename pixel_t>
+void removegrain_avx2(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int width, int mode, int ystart, int yend);
+
+template <typename pixel_t>
+void repair_avx2(pixel_t* dst, const pixel_t* src, const pixel_t* ref,
+  int dst_pitch, int src_pitch, int ref_pitch, int width, int mode, int ystart, int yend);
+
+template <typename pixel_t>
+uint64_t sad_avx2(const pixel_t* a, const pixel_t* b, int a_pitch, int b_pitch,
+  int width, int ystart, int yend);
+
+// width >= BINOMIAL_SOFTEN_AVX2_MIN_WIDTHł邱
+enum { BINOMIAL_SOFTEN_AVX2_MIN_WIDTH = 16 };
+
+template <typename pixel_t>
+void binomial_soften_avx2(pixel_t* dst, int dst_pitch, const pixel_t* const* srcs, const int* pitches,
+  int radius, int width, int ystart, int yend);
+
+template <typename pixel_t>
+void expr_avx2(pixel_t* dst, int dst_pitch, const pixel_t* const* srcs, const int* pitches,
+  int width, const ExprOp* ops, int numOps, float maxval, int ystart, int yend);
+
+// ȉ̏c̏͗[xstart,xend)As[ystart,yend)
+// xend-xstart32oCg̔{ł邱
+template <typename pixel_t>
+void xpand_vertical_x2_avx2(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int height, bool isMax, int xstart, int xend, int ystart, int yend);
+
+template <typename pixel_t>
+void vertical_median_avx2(pixel_t* dst, const pixel_t* src, int dst_pitch, int src_pitch,
+  int xstart, int xend, int ystart, int yend);
@@ -8,12 +8,19 @@
 #include <vector>
 #include <algorithm>
 #include <cassert>
+#include <string>
 
 #include "CommonFunctions.h"
 #include "MVKernel.h"
 #include "DeviceLocalData.h"
+#include "ScratchArena.h"
 #include "Misc.h"
 #include "KMV.h"
+#include "SADFunctions.h"
+#include "DegrainFunctions.h"
+#include "SuperFunctions.h"
+#include "ThreadPool.h"
+#include "MVCache.h"
 
 #if 1
 #include "DebugWriter.h"
@@ -108,64 +115,29 @@ void MemZoneSet(pixel_t* dst, int dst_pitch, pixel_t v, int width, int height)
   }
 }
 
-template<typename pixel_t>
-void PadCorner(pixel_t *p, pixel_t v, int hPad, int vPad, int refPitch)
-{
-  for (int i = 0; i < vPad; i++) {
-    if (sizeof(pixel_t) == 1) {
-      memset(p, v, hPad); // faster than loop
-    }
-    else {
-      std::fill_n(p, hPad, v);
-    }
-    p += refPitch;
-  }
-}
-
 template<typename pixel_t>
 void PadFrame(pixel_t *refFrame, int refPitch, int hPad, int vPad, int width, int height)
 {
   pixel_t *pfoff = refFrame + vPad * refPitch + hPad;
 
-  // Up-Left
-  PadCorner<pixel_t>(refFrame, pfoff[0], hPad, vPad, refPitch);
-  // Up-Right
-  PadCorner<pixel_t>(refFrame + hPad + width, pfoff[width - 1], hPad, vPad, refPitch);
-  // Down-Left
-  PadCorner<pixel_t>(refFrame + (vPad + height) * refPitch,
-    pfoff[(height - 1) * refPitch], hPad, vPad, refPitch);
-  // Down-Right
-  PadCorner<pixel_t>(refFrame + hPad + width + (vPad + height) * refPitch,
-    pfoff[(height - 1) * refPitch + width - 1], hPad, vPad, refPitch);
-
-  // Top and bottom
-  for (int i = 0; i < width; i++)
-  {
-    pixel_t value_t = pfoff[i];
-    pixel_t value_b = pfoff[i + (height - 1) * refPitch];
-    pixel_t *p_t = refFrame + hPad + i;
-    pixel_t *p_b = p_t + (height + vPad) * refPitch;
-    for (int j = 0; j < vPad; j++)
-    {
-      p_t[0] = value_t;
-      p_b[0] = value_b;
-      p_t += refPitch;
-      p_b += refPitch;
-    }
-  }
-
+  // sPʂmemcpy/filli1f肸Ƒj
   // Left and right
   for (int i = 0; i < height; i++)
   {
-    pixel_t value_l = pfoff[i * refPitch];
-    pixel_t value_r = pfoff[i * refPitch + width - 1];
     pixel_t *p_l = refFrame + (vPad + i) * refPitch;
     pixel_t *p_r = p_l + width + hPad;
-    for (int j = 0; j < hPad; j++)
-    {
-      p_l[j] = value_l;
-      p_r[j] = value_r;
-    }
+    std::fill_n(p_l, hPad, pfoff[i * refPitch]);
+    std::fill_n(p_r, hPad, pfoff[i * refPitch + width - 1]);
+  }
+
+  // Top and bottom (with corners)
+  const int rowBytes = (width + hPad * 2) * sizeof(pixel_t);
+  const pixel_t *p_t = refFrame + vPad * refPitch;
+  const pixel_t *p_b = refFrame + (vPad + height - 1) * refPitch;
+  for (int j = 0; j < vPad; j++)
+  {
+    memcpy(refFrame + j * refPitch, p_t, rowBytes);
+    memcpy(refFrame + (vPad + height + j) * refPitch, p_b, rowBytes);
   }
 }
 
@@ -342,14 +314,14 @@ public:
   virtual void SetTarget(uint8_t* pSrc, int _nPitch) = 0;
   virtual void Fill(const uint8_t *_pNewPlane, int nNewPitch) = 0;
   virtual void Pad() = 0;
-  virtual void Refine() = 0;
-  virtual void ReduceTo(KMPlaneBase* dstPlane) = 0;
+  virtual void Refine(bool mt, PNeoEnv env) = 0;
+  virtual void ReduceTo(KMPlaneBase* dstPlane, bool mt, PNeoEnv env) = 0;
 };
 
 template <typename pixel_t>
 class KMPlane : public KMPlaneBase
 {
-  IKDeintKernel<pixel_t>* kernel;
+  IMVCUDA* cuda;
   std::unique_ptr<pixel_t*[]> pPlane;
   int nPel;
   int nWidth;
@@ -366,7 +338,7 @@ class KMPlane : public KMPlaneBase
 public:
 
   KMPlane(int nWidth, int nHeight, int nPel, int nHPad, int nVPad, int nBitsPerPixel, IMVCUDA* cuda)
-    : kernel(cuda->get(pixel_t()))
+    : cuda(cuda)
     , pPlane(new pixel_t*[nPel * nPel])
     , nPel(nPel)
     , nWidth(nWidth)
@@ -459,7 +431,8 @@ public:
   {
     const pixel_t* pNewPlane = (const pixel_t*)_pNewPlane;
 
-    if (kernel->IsEnabled()) {
+    if (cuda->IsEnabled()) {
+      auto kernel = cuda->get(pixel_t());
       kernel->Copy(pPlane[0] + nOffsetPadding, nPitch, pNewPlane, nNewPitch, nWidth, nHeight);
     }
     else {
@@ -469,7 +442,8 @@ public:
 
   void Pad()
   {
-    if (kernel->IsEnabled()) {
+    if (cuda->IsEnabled()) {
+      auto kernel = cuda->get(pixel_t());
       kernel->PadFrame(pPlane[0], nPitch, nHPad, nVPad, nWidth, nHeight);
     }
     else {
@@ -477,9 +451,10 @@ public:
     }
   }
 
-  void Refine()
+  void Refine(bool mt, PNeoEnv env)
   {
-    if (kernel->IsEnabled()) {
+    if (cuda->IsEnabled()) {
+      auto kernel = cuda->get(pixel_t());
       switch (nPel)
       {
       case 2:
@@ -491,6 +466,21 @@ public:
         //  break;
       }
     }
+    else if (nPel == 2 && (env->GetCPUFlags() & CPUF_AVX2)) {
+      // ctB^͕̓͂ԑOpPlane[0]ŁAtB^͓sǂ܂Ȃ̂
+      // s̑тƂ3܂Ƃ߂ďł
+      auto refine = [&](int ystart, int yend) {
+        HorizontalWiener_AVX2(pPlane[1], pPlane[0], nPitch, nPitch, nExtendedWidth, nExtendedHeight, nBitsPerPixel, ystart, yend);
+        VerticalWiener_AVX2(pPlane[2], pPlane[0], nPitch, nPitch, nExtendedWidth, nExtendedHeight, nBitsPerPixel, ystart, yend);
+        HorizontalWiener_AVX2(pPlane[3], pPlane[2], nPitch, nPitch, nExtendedWidth, nExtendedHeight, nBitsPerPixel, ystart, yend);
+      };
+      if (mt) {
+        ThreadPool::GetInstance().ParallelRows(nExtendedHeight, 16, refine);
+      }
+      else {
+        refine(0, nExtendedHeight);
+      }
+    }
     else {
       switch (nPel)
       {
@@ -505,16 +495,32 @@ public:
     }
   }
 
-  void ReduceTo(KMPlaneBase* dstPlane)
+  void ReduceTo(KMPlaneBase* dstPlane, bool mt, PNeoEnv env)
   {
     KMPlane<pixel_t>&		red = *static_cast<KMPlane<pixel_t>*>(dstPlane);
-    if (kernel->IsEnabled()) {
+    if (cuda->IsEnabled()) {
+      auto kernel = cuda->get(pixel_t());
       kernel->RB2BilinearFiltered(
         red.pPlane[0] + red.nOffsetPadding, pPlane[0] + nOffsetPadding,
         red.nPitch, nPitch,
         red.nWidth, red.nHeight
       );
     }
+    else if (env->GetCPUFlags() & CPUF_AVX2) {
+      auto reduce = [&](int ystart, int yend) {
+        RB2BilinearFiltered_AVX2(
+          red.pPlane[0] + red.nOffsetPadding, pPlane[0] + nOffsetPadding,
+          red.nPitch, nPitch,
+          red.nWidth, red.nHeight, ystart, yend
+        );
+      };
+      if (mt) {
+        ThreadPool::GetInstance().ParallelRows(red.nHeight, 16, reduce);
+      }
+      else {
+        reduce(0, red.nHeight);
+      }
+    }
     else {
       RB2BilinearFiltered(
         red.pPlane[0] + red.nOffsetPadding, pPlane[0] + nOffsetPadding,
@@ -537,13 +543,13 @@ class KMFrame
   template <typename pixel_t>
   void CreatePlanes(int nWidth, int nHeight, int nPel, int nHPad, int nVPad)
   {
-    pYPlane = std::unique_ptr<KMPlaneBase>(new KMPlane<uint8_t>(
+    pYPlane = std::unique_ptr<KMPlaneBase>(new KMPlane<pixel_t>(
       nWidth, nHeight, nPel, nHPad, nVPad, param->nBitsPerPixel, cuda));
     if (param->chroma) {
-      pUPlane = std::unique_ptr<KMPlaneBase>(new KMPlane<uint8_t>(
+      pUPlane = std::unique_ptr<KMPlaneBase>(new KMPlane<pixel_t>(
         nWidth / param->xRatioUV, nHeight / param->yRatioUV, nPel,
         nHPad / param->xRatioUV, nVPad / param->yRatioUV, param->nBitsPerPixel, cuda));
-      pVPlane = std::unique_ptr<KMPlaneBase>(new KMPlane<uint8_t>(
+      pVPlane = std::unique_ptr<KMPlaneBase>(new KMPlane<pixel_t>(
         nWidth / param->xRatioUV, nHeight / param->yRatioUV, nPel,
         nHPad / param->xRatioUV, nVPad / param->yRatioUV, param->nBitsPerPixel, cuda));
     }
@@ -565,6 +571,7 @@ public:
   KMPlaneBase* GetYPlane() { return pYPlane.get(); }
   KMPlaneBase* GetUPlane() { return pUPlane.get(); }
   KMPlaneBase* GetVPlane() { return pVPlane.get(); }
+  KMPlaneBase* GetPlane(int i) { return (i == 0) ? GetYPlane() : (i == 1) ? GetUPlane() : GetVPlane(); }
 
   void SetTarget(uint8_t * pSrcY, int pitchY, uint8_t * pSrcU, int pitchU, uint8_t *pSrcV, int pitchV)
   {
@@ -593,12 +600,12 @@ public:
   //  }
   //}
 
-  void	Refine()
+  void	Refine(bool mt, PNeoEnv env)
   {
-    pYPlane->Refine();
+    pYPlane->Refine(mt, env);
     if (param->chroma) {
-      pUPlane->Refine();
-      pVPlane->Refine();
+      pUPlane->Refine(mt, env);
+      pVPlane->Refine(mt, env);
     }
   }
 
@@ -611,12 +618,12 @@ public:
     }
   }
 
-  void	ReduceTo(KMFrame *pFrame)
+  void	ReduceTo(KMFrame *pFrame, bool mt, PNeoEnv env)
   {
-    pYPlane->ReduceTo(pFrame->GetYPlane());
+    pYPlane->ReduceTo(pFrame->GetYPlane(), mt, env);
     if (param->chroma) {
-      pUPlane->ReduceTo(pFrame->GetUPlane());
-      pVPlane->ReduceTo(pFrame->GetVPlane());
+      pUPlane->ReduceTo(pFrame->GetUPlane(), mt, env);
+      pVPlane->ReduceTo(pFrame->GetVPlane(), mt, env);
     }
   }
 };
@@ -658,17 +665,41 @@ public:
     }
   }
 
-  void Construct(const uint8_t * pSrcY, int pitchY, const uint8_t * pSrcU, int pitchU, const uint8_t *pSrcV, int pitchV)
+  void Construct(const uint8_t * pSrcY, int pitchY, const uint8_t * pSrcU, int pitchU, const uint8_t *pSrcV, int pitchV,
+    bool mt, PNeoEnv env)
   {
     pFrames[0]->Fill(pSrcY, pitchY, pSrcU, pitchU, pSrcV, pitchV);
-    pFrames[0]->Pad();
-    pFrames[0]->Refine();
 
-    for (int i = 0; i < param->nLevels - 1; i++)
-    {
-      pFrames[i]->ReduceTo(pFrames[i + 1].get());
-      pFrames[i + 1]->Pad();
+    if (!mt || cuda->IsEnabled()) {
+      pFrames[0]->Pad();
+      pFrames[0]->Refine(mt, env);
+
+      for (int i = 0; i < param->nLevels - 1; i++)
+      {
+        pFrames[i]->ReduceTo(pFrames[i + 1].get(), mt, env);
+        pFrames[i + 1]->Pad();
+      }
+      return;
     }
+
+    // (Y,U,V)ƂɁAx0̃pfBO+TusNZԂƁAk+pfBO̘A݂͌ɓƗ
+    // ik̓x0̃pfBÖǂ܂ȂĵŁAx2̃^XNɏ
+    const int nPlanes = param->chroma ? 3 : 1;
+    ThreadPool::GetInstance().ParallelFor(nPlanes * 2, [&](int task) {
+      const int plane = task >> 1;
+      if ((task & 1) == 0) {
+        KMPlaneBase* p = pFrames[0]->GetPlane(plane);
+        p->Pad();
+        p->Refine(mt, env);
+      }
+      else {
+        for (int i = 0; i < param->nLevels - 1; i++)
+        {
+          pFrames[i]->GetPlane(plane)->ReduceTo(pFrames[i + 1]->GetPlane(plane), mt, env);
+          pFrames[i + 1]->GetPlane(plane)->Pad();
+        }
+      }
+    });
   }
 
   KMFrame *GetFrame(int nLevel)
@@ -691,14 +722,16 @@ class KMSuper : public GenericVideoFilter
   KMVParam params;
 
   std::unique_ptr<IMVCUDA> cuda;
+  bool mt;
 
   std::unique_ptr<KMSuperFrame> pSrcGOF;
 
 public:
-  KMSuper(PClip child, int nHPad, int nVPad, int nPel, int nLevels, bool chroma, int nSharp, int nRfilter, PNeoEnv env)
+  KMSuper(PClip child, int nHPad, int nVPad, int nPel, int nLevels, bool chroma, int nSharp, int nRfilter, bool cpuKernel, bool mt, PNeoEnv env)
     : GenericVideoFilter(child)
     , params(KMVParam::SUPER_FRAME)
-    , cuda(CreateKDeintCUDA())
+    , cuda(CreateKDeintCUDA(cpuKernel))
+    , mt(mt)
   {
     // ̏ΉẴR
     if (nHPad != 8) env->ThrowError("[KMSuper] hpad must be 8.");
@@ -714,6 +747,11 @@ public:
     params.yRatioUV = 1 << vi.GetPlaneHeightSubsampling(PLANAR_U);
     params.xRatioUV = 1 << vi.GetPlaneWidthSubsampling(PLANAR_U);
 
+    // CPUCUDAłƓ4:2:0̂
+    if (cpuKernel && (params.xRatioUV != 2 || params.yRatioUV != 2)) {
+      env->ThrowError("[KMSuper] cpukernel supports only YUV420.");
+    }
+
     params.nPixelSize = vi.ComponentSize();
     params.nBitsPerPixel = vi.BitsPerComponent();
     params.nPixelShift = (params.nPixelSize == 1) ? 0 : 1;
@@ -743,6 +781,7 @@ public:
     params.nLevels = nLevels;
     params.nDropLevels = 0;
     params.pixelType = vi.pixel_type;
+    params.cpuKernel = cpuKernel;
 
     KMVParam::SetParam(vi, &params);
 
@@ -777,7 +816,7 @@ public:
     int nDstPitchUV = dst->GetPitch(PLANAR_U) >> params.nPixelShift;
 
     pSrcGOF->SetTarget(pDstY, nDstPitchY, pDstU, nDstPitchUV, pDstV, nDstPitchUV);
-    pSrcGOF->Construct(pSrcY, nSrcPitchY, pSrcU, nSrcPitchUV, pSrcV, nSrcPitchUV);
+    pSrcGOF->Construct(pSrcY, nSrcPitchY, pSrcU, nSrcPitchUV, pSrcV, nSrcPitchUV, mt, env);
 
     return dst;
   }
@@ -804,6 +843,8 @@ public:
       args[5].AsBool(true), // chroma
       args[6].AsInt(2), // sharp
       args[7].AsInt(2), // rfilter
+      args[8].AsBool(false), // cpukernel
+      args[9].AsBool(true), // mt
       env);
   }
 };
@@ -863,7 +904,7 @@ static unsigned int Sad_C(const pixel_t *pSrc, int nSrcPitch, const pixel_t *pRe
 }
 
 template<typename pixel_t>
-unsigned int(*get_sad_function(int nBlkWidth, int nBlkHeight, PNeoEnv env))(const pixel_t *pSrc, int nSrcPitch, const pixel_t *pRef, int nRefPitch)
+static SADFunction<pixel_t> get_sad_c_function(int nBlkWidth, int nBlkHeight)
 {
   if (nBlkWidth == 4 && nBlkHeight == 4) {
     return Sad_C<4, 4, pixel_t>;
@@ -877,12 +918,149 @@ unsigned int(*get_sad_function(int nBlkWidth, int nBlkHeight, PNeoEnv env))(cons
   else if (nBlkWidth == 32 && nBlkHeight == 32) {
     return Sad_C<32, 32, pixel_t>;
   }
-  else {
-    env->ThrowError("Not supported blocksize (%d,%d)", nBlkWidth, nBlkHeight);
+  // YV16̐F
+  else if (nBlkWidth == 4 && nBlkHeight == 8) {
+    return Sad_C<4, 8, pixel_t>;
+  }
+  else if (nBlkWidth == 8 && nBlkHeight == 16) {
+    return Sad_C<8, 16, pixel_t>;
+  }
+  else if (nBlkWidth == 16 && nBlkHeight == 32) {
+    return Sad_C<16, 32, pixel_t>;
+  }
+  return nullptr;
+}
+
+enum SAD_ISA {
+  SAD_ISA_C,
+  SAD_ISA_SSE41,
+  SAD_ISA_AVX2,
+  SAD_ISA_AVX512,
+  SAD_ISA_COUNT
+};
+
+static const char* SAD_ISA_NAMES[SAD_ISA_COUNT] = { "C", "SSE4.1", "AVX2", "AVX-512BW" };
+
+// w肵߃Zbg̎ԂiȂnullptrj
+template<typename pixel_t>
+static SADFunction<pixel_t> get_sad_function_isa(int nBlkWidth, int nBlkHeight, SAD_ISA isa)
+{
+  switch (isa) {
+  case SAD_ISA_C: return get_sad_c_function<pixel_t>(nBlkWidth, nBlkHeight);
+  case SAD_ISA_SSE41: return get_sad_sse41_func<pixel_t>(nBlkWidth, nBlkHeight);
+  case SAD_ISA_AVX2: return get_sad_avx2_func<pixel_t>(nBlkWidth, nBlkHeight);
+  case SAD_ISA_AVX512: return get_sad_avx512_func<pixel_t>(nBlkWidth, nBlkHeight);
+  }
+  return nullptr;
+}
+
+static bool IsSADISAAvailable(SAD_ISA isa, int cpuFlags)
+{
+  switch (isa) {
+  case SAD_ISA_C: return true;
+  case SAD_ISA_SSE41: return (cpuFlags & CPUF_SSE4_1) != 0;
+  case SAD_ISA_AVX2: return (cpuFlags & CPUF_AVX2) != 0;
+  case SAD_ISA_AVX512: return (cpuFlags & CPUF_AVX512BW) != 0;
+  }
+  return false;
+}
+
+template<typename pixel_t>
+SADFunction<pixel_t> get_sad_function(int nBlkWidth, int nBlkHeight, PNeoEnv env)
+{
+  // g钆ňԐV߃Zbg̎g
+  // ʂ͂ǂSad_CƊSɈv
+  int cpuFlags = env->GetCPUFlags();
+  for (int isa = SAD_ISA_COUNT - 1; isa >= 0; --isa) {
+    if (IsSADISAAvailable((SAD_ISA)isa, cpuFlags)) {
+      auto func = get_sad_function_isa<pixel_t>(nBlkWidth, nBlkHeight, (SAD_ISA)isa);
+      if (func) {
+        return func;
+      }
+    }
   }
+  env->ThrowError("Not supported blocksize (%d,%d)", nBlkWidth, nBlkHeight);
   return nullptr;
 }
 
+// SAD֐̃}CNx`}[N
+// g閽߃Zbgׂ̎ČvĕbSAD񐔂Ԃ
+template<typename pixel_t>
+static std::string SADBench(int iterations, int bits, PNeoEnv env)
+{
+  enum { PITCH = 128, HEIGHT = 96 };
+  std::vector<pixel_t> src(PITCH * HEIGHT), ref(PITCH * HEIGHT);
+  unsigned int rnd = 2463534242u;
+  for (int i = 0; i < PITCH * HEIGHT; ++i) {
+    rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;
+    src[i] = (pixel_t)(rnd & ((1 << bits) - 1));
+    rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;
+    ref[i] = (pixel_t)(rnd & ((1 << bits) - 1));
+  }
+
+  const int sizes[][2] = { { 4, 4 },{ 8, 8 },{ 16, 16 },{ 32, 32 },{ 4, 8 },{ 8, 16 },{ 16, 32 } };
+  int cpuFlags = env->GetCPUFlags();
+  std::string result;
+  char buf[256];
+
+  LARGE_INTEGER liFreq;
+  QueryPerformanceFrequency(&liFreq);
+
+  for (auto& size : sizes) {
+    unsigned int refsum = 0;
+    for (int isa = 0; isa < SAD_ISA_COUNT; ++isa) {
+      if (!IsSADISAAvailable((SAD_ISA)isa, cpuFlags)) continue;
+      auto func = get_sad_function_isa<pixel_t>(size[0], size[1], (SAD_ISA)isa);
+      if (func == nullptr) continue;
+
+      LARGE_INTEGER liBefore, liAfter;
+      QueryPerformanceCounter(&liBefore);
+
+      // TƓ悤ref̈ʒu炵Ȃ
+      unsigned int sum = 0;
+      for (int i = 0; i < iterations; ++i) {
+        int off = (i & 31) + ((i >> 5) & 31) * PITCH;
+        sum += func(src.data() + 32 * PITCH, PITCH, ref.data() + off, PITCH);
+      }
+
+      QueryPerformanceCounter(&liAfter);
+      double sec = (double)(liAfter.QuadPart - liBefore.QuadPart) / liFreq.QuadPart;
+
+      if (isa == SAD_ISA_C) {
+        refsum = sum;
+      }
+      else if (sum != refsum) {
+        env->ThrowError("[KMSADBench] %dx%d %s: ʂCƈv܂", size[0], size[1], SAD_ISA_NAMES[isa]);
+      }
+
+      sprintf(buf, "%2dx%-2d %2dbit %-9s: %8.2f MSAD/s\n",
+        size[0], size[1], bits, SAD_ISA_NAMES[isa], iterations / sec / 1000000.0);
+      printf("%s", buf);
+      result += buf;
+    }
+  }
+
+  return result;
+}
+
+static AVSValue __cdecl KMSADBench(AVSValue args, void* user_data, IScriptEnvironment* env_)
+{
+  PNeoEnv env = env_;
+  int bits = args[0].AsInt(8);
+  int iterations = args[1].AsInt(1000000);
+  std::string result;
+  if (bits == 8) {
+    result = SADBench<uint8_t>(iterations, bits, env);
+  }
+  else if (bits > 8 && bits <= 16) {
+    result = SADBench<uint16_t>(iterations, bits, env);
+  }
+  else {
+    env->ThrowError("[KMSADBench] Unsupported bits %d", bits);
+  }
+  return env->SaveString(result.c_str());
+}
+
 struct MVPlaneParam {
   int nBlkX;            /* width in number of blocks */
   int nBlkY;            /* height in number of blocks */
@@ -922,6 +1100,7 @@ struct MVPlaneParam {
   int badrange;
   bool meander;
   bool tryMany;
+  int adaptiveSAD;      // T͈͂KIɕςSADli0:j
 
   int verybigSAD;
   int nLambdaLevel;
@@ -934,7 +1113,7 @@ struct MVPlaneParam {
     SearchType searchType, int nSearchParam, int PelSearch, int nLambda,
     int lsad, int penaltyNew, int plevel, bool global,
     int penaltyZero, int pglobal, int badSAD,
-    int badrange, bool meander, bool tryMany)
+    int badrange, bool meander, bool tryMany, int adaptiveSAD)
     : nBlkX(_nBlkX)
     , nBlkY(_nBlkY)
     , nBlkSizeX(_nBlkSizeX)
@@ -972,6 +1151,7 @@ struct MVPlaneParam {
     , badrange(badrange)
     , meander(meander)
     , tryMany(tryMany)
+    , adaptiveSAD(adaptiveSAD)
     , verybigSAD(3 * _nBlkSizeX * _nBlkSizeY * (nPixelSize == 4 ? 1 : (1 << nBitsPerPixel))) // * 256, pixelsize==2 -> 65536. Float:1
   {
     nLambdaLevel = nLambda / (nPel * nPel);
@@ -990,10 +1170,52 @@ enum {
   MAX_BATCH = 8,
 };
 
+// CPUŃubNT̓viKMAnalysestats=truêƂWvj
+struct SearchStats {
+  // ŏIIɍ̗pꂽxN^ǂ̌₩痈
+  enum {
+    PRED_ZERO,
+    PRED_GLOBAL,
+    PRED_COARSE, // ̃x̗\
+    PRED_MEDIAN,
+    PRED_LEFT,
+    PRED_UP,
+    PRED_BOTTOMRIGHT,
+    PRED_REFINE, // TŉPꂽ
+    PRED_COUNT
+  };
+
+  int64_t blocks;
+  int64_t candidates; // ]xN^i͈͊O͏j
+  int64_t sadCalls; // SADvZ񐔁iPxƐF1j
+  int64_t earlyExits; // MV RXgőł؂SADvZȂ
+  int64_t winner[PRED_COUNT];
+
+  SearchStats() : blocks(), candidates(), sadCalls(), earlyExits(), winner() { }
+
+  void Add(const SearchStats& o) {
+    blocks += o.blocks;
+    candidates += o.candidates;
+    sadCalls += o.sadCalls;
+    earlyExits += o.earlyExits;
+    for (int i = 0; i < PRED_COUNT; ++i) {
+      winner[i] += o.winner[i];
+    }
+  }
+
+  static const char* GetPredName(int i) {
+    static const char* names[] = { "zero", "global", "coarse", "median", "left", "up", "bottomright", "refine" };
+    return names[i];
+  }
+};
+
 // Kob`܂Ƃ߂ďiŌƂŃt[ȂƂ̓|C^𕡐ēnj
 class PlaneOfBlocksBase {
 public:
   virtual ~PlaneOfBlocksBase() { }
+  // vCPUł̂
+  virtual void EnableStats() { }
+  virtual const SearchStats* GetStats() const { return nullptr; }
   virtual int GetWorkSize() = 0;
   virtual void SetWorkMemory(uint8_t* work) = 0;
   virtual void InitializeGlobalMV(int batch, VECTOR* globalMV) = 0;
@@ -1004,18 +1226,19 @@ public:
   virtual void WriteDefault(VECTOR *out, int nCount) = 0;
 };
 
+// PlaneOfBlocks1ubN̒T
+// ubNƂɕςԂ̂ŁAɒTƂ̓XbhƂɍ
 template <typename pixel_t>
-class PlaneOfBlocks : public PlaneOfBlocksBase
+class BlockSearch
 {
   /* fields set at initialization */
-  const MVPlaneParam p;
+  const MVPlaneParam& p;
 
   unsigned int(*const SAD)(const pixel_t *pSrc, int nSrcPitch, const pixel_t *pRef, int nRefPitch);
   unsigned int(*const SADCHROMA)(const pixel_t *pSrc, int nSrcPitch, const pixel_t *pRef, int nRefPitch);
 
-  std::vector<VECTOR> batchVectors[ANALYZE_MAX_BATCH];
-
   VECTOR* vectors;
+  SearchStats* stats; // nullptrȂWvȂ
   KMPlane<pixel_t> *pSrcYPlane, *pSrcUPlane, *pSrcVPlane;
   KMPlane<pixel_t> *pRefYPlane, *pRefUPlane, *pRefVPlane;
 
@@ -1354,22 +1577,40 @@ class PlaneOfBlocks : public PlaneOfBlocksBase
     ExpandingSearch(1, 1, bmx, bmy);
   }
 
+  // \̎_łSADT͈͂߂
+  // \΋ߖTA\Δ͈͂2{ɍL
+  int GetSearchRange() const
+  {
+    if (p.adaptiveSAD <= 0) {
+      return p.nSearchParam;
+    }
+    if (bestMV.sad < p.adaptiveSAD) {
+      return 1;
+    }
+    if (bestMV.sad > p.adaptiveSAD * 4) {
+      return p.nSearchParam * 2;
+    }
+    return p.nSearchParam;
+  }
+
   void Refine()
   {
+    int nSearchRange = GetSearchRange();
+
     // then, we refine, according to the search type
     switch (p.searchType) {
     case EXHAUSTIVE: {
       //		ExhaustiveSearch(nSearchParam);
       int mvx = bestMV.x;
       int mvy = bestMV.y;
-      for (int i = 1; i <= p.nSearchParam; i++)// region is same as exhaustive, but ordered by radius (from near to far)
+      for (int i = 1; i <= nSearchRange; i++)// region is same as exhaustive, but ordered by radius (from near to far)
       {
         ExpandingSearch(i, 1, mvx, mvy);
       }
     }
                      break;
     case HEX2SEARCH:
-      Hex2Search(p.nSearchParam);
+      Hex2Search(nSearchRange);
       break;
     default:
       // Not implemented
@@ -1388,9 +1629,14 @@ class PlaneOfBlocks : public PlaneOfBlocksBase
   {		//here the chance for default values are high especially for zeroMVfieldShifted (on left/top border)
     if (IsVectorOK(vx, vy))
     {
+      if (stats) ++stats->candidates;
       // from 2.5.11.9-SVP: no additional SAD calculations if partial sum is already above minCost
       int cost = MotionDistorsion(vx, vy);
-      if (cost >= nMinCost) return;
+      if (cost >= nMinCost) {
+        if (stats) ++stats->earlyExits;
+        return;
+      }
+      if (stats) ++stats->sadCalls;
 
       typedef typename std::conditional < sizeof(pixel_t) == 1, int, __int64 >::type safe_sad_t;
 
@@ -1484,9 +1730,14 @@ class PlaneOfBlocks : public PlaneOfBlocksBase
   {
     if (IsVectorOK(vx, vy))
     {
+      if (stats) ++stats->candidates;
       // from 2.5.11.9-SVP: no additional SAD calculations if partial sum is already above minCost
       int cost = MotionDistorsion(vx, vy);
-      if (cost >= nMinCost) return;
+      if (cost >= nMinCost) {
+        if (stats) ++stats->earlyExits;
+        return;
+      }
+      if (stats) ++stats->sadCalls;
 
       typedef typename std::conditional < sizeof(pixel_t) == 1, int, __int64 >::type safe_sad_t;
 
@@ -1537,6 +1788,7 @@ class PlaneOfBlocks : public PlaneOfBlocksBase
     }
     bestMV.sad = sad;
     nMinCost = sad + ((p.penaltyZero*(safe_sad_t)sad) >> 8); // v.1.11.0.2
+    int winner = SearchStats::PRED_ZERO;
 
     if (debug) {
       printf("zero: sad=%d, mincost=%d\n", sad, nMinCost);
@@ -1615,6 +1867,7 @@ class PlaneOfBlocks : public PlaneOfBlocksBase
         bestMV.y = globalMVPredictor.y;
         bestMV.sad = sad;
         nMinCost = cost;
+        winner = SearchStats::PRED_GLOBAL;
       }
       //	}
       //	Then, the predictor :
@@ -1635,6 +1888,7 @@ class PlaneOfBlocks : public PlaneOfBlocksBase
         bestMV.y = predictor.y;
         bestMV.sad = sad;
         nMinCost = cost;
+        winner = SearchStats::PRED_COARSE;
       }
     }
 
@@ -1643,23 +1897,235 @@ class PlaneOfBlocks : public PlaneOfBlocksBase
 
     for (int i = 0; i < npred; i++)
     {
+      int prevCost = nMinCost;
       CheckMV<true>(predictors[i].x, predictors[i].y);
+      // predictors[0..3]median,left,up,bottomright̏
+      if (nMinCost < prevCost) winner = SearchStats::PRED_MEDIAN + i;
     }	// for i
 
+    if (stats) {
+      // zero,global,coarse3͕KSADvZĂ
+      stats->candidates += 3;
+      stats->sadCalls += 3;
+    }
+
+    int refineCost = nMinCost;
+
       // then, we refine, according to the search type
     Refine();
 
+    if (stats) {
+      if (nMinCost < refineCost) winner = SearchStats::PRED_REFINE;
+      ++stats->blocks;
+      ++stats->winner[winner];
+    }
+
     // we store the result
     vectors[blkIdx] = bestMV;
   }
 
+public:
+  BlockSearch(const MVPlaneParam& p,
+    unsigned int(*SAD)(const pixel_t *pSrc, int nSrcPitch, const pixel_t *pRef, int nRefPitch),
+    unsigned int(*SADCHROMA)(const pixel_t *pSrc, int nSrcPitch, const pixel_t *pRef, int nRefPitch),
+    VECTOR* vectors, KMFrame *pSrcFrame, KMFrame *pRefFrame, SearchStats* stats)
+    : p(p)
+    , SAD(SAD)
+    , SADCHROMA(SADCHROMA)
+    , vectors(vectors)
+    , stats(stats)
+  {
+    pSrcYPlane = static_cast<KMPlane<pixel_t>*>(pSrcFrame->GetYPlane());
+    pSrcUPlane = static_cast<KMPlane<pixel_t>*>(pSrcFrame->GetUPlane());
+    pSrcVPlane = static_cast<KMPlane<pixel_t>*>(pSrcFrame->GetVPlane());
+    pRefYPlane = static_cast<KMPlane<pixel_t>*>(pRefFrame->GetYPlane());
+    pRefUPlane = static_cast<KMPlane<pixel_t>*>(pRefFrame->GetUPlane());
+    pRefVPlane = static_cast<KMPlane<pixel_t>*>(pRefFrame->GetVPlane());
+
+    nSrcPitch[0] = pSrcYPlane->GetPitch();
+    if (p.chroma)
+    {
+      nSrcPitch[1] = pSrcUPlane->GetPitch();
+      nSrcPitch[2] = pSrcVPlane->GetPitch();
+    }
+    nRefPitch[0] = pRefYPlane->GetPitch();
+    if (p.chroma)
+    {
+      nRefPitch[1] = pRefUPlane->GetPitch();
+      nRefPitch[2] = pRefVPlane->GetPitch();
+    }
+  }
+
+  /* search the vector of the block (_blkx, _blky) */
+  VECTOR Search(int _blkx, int _blky, int _blkScanDir, const VECTOR& globalMV)
+  {
+    blkx = _blkx;
+    blky = _blky;
+    blkScanDir = _blkScanDir;
+    blkIdx = blky*p.nBlkX + blkx;
+    iter = 0;
+
+    // Functions using float must not be used here
+
+    x[0] = pSrcYPlane->GetHPadding() + (p.nBlkSizeX - p.nOverlapX) * blkx;
+    y[0] = pSrcYPlane->GetVPadding() + (p.nBlkSizeY - p.nOverlapY) * blky;
+    if (p.chroma)
+    {
+      x[1] = pSrcUPlane->GetHPadding() + ((p.nBlkSizeX - p.nOverlapX) >> p.nLogxRatioUV) * blkx;
+      x[2] = pSrcVPlane->GetHPadding() + ((p.nBlkSizeX - p.nOverlapX) >> p.nLogxRatioUV) * blkx;
+      y[1] = pSrcUPlane->GetVPadding() + ((p.nBlkSizeY - p.nOverlapY) >> p.nLogyRatioUV) * blky;
+      y[2] = pSrcVPlane->GetVPadding() + ((p.nBlkSizeY - p.nOverlapY) >> p.nLogyRatioUV) * blky;
+    }
+
+    // Resets the global predictor (it may have been clipped during the
+    // previous block scan)
+    globalMVPredictor = globalMV;
+
+    pSrc[0] = pSrcYPlane->GetAbsolutePelPointer(x[0], y[0]);
+    if (p.chroma)
+    {
+      pSrc[1] = pSrcUPlane->GetAbsolutePelPointer(x[1], y[1]);
+      pSrc[2] = pSrcVPlane->GetAbsolutePelPointer(x[2], y[2]);
+    }
+
+    if (blky == 0)
+    {
+      nCurrentLambda = 0;
+    }
+    else
+    {
+      nCurrentLambda = p.nLambdaLevel;
+    }
+
+    // decreased padding of coarse levels
+    int nHPaddingScaled = pSrcYPlane->GetHPadding() >> p.nLogScale;
+    int nVPaddingScaled = pSrcYPlane->GetVPadding() >> p.nLogScale;
+    /* computes search boundaries */
+    nDxMax = p.nPel * (pSrcYPlane->GetExtendedWidth() - x[0] - p.nBlkSizeX - pSrcYPlane->GetHPadding() + nHPaddingScaled);
+    nDyMax = p.nPel * (pSrcYPlane->GetExtendedHeight() - y[0] - p.nBlkSizeY - pSrcYPlane->GetVPadding() + nVPaddingScaled);
+    nDxMin = -p.nPel * (x[0] - pSrcYPlane->GetHPadding() + nHPaddingScaled);
+    nDyMin = -p.nPel * (y[0] - pSrcYPlane->GetVPadding() + nVPaddingScaled);
+
+    /* search the mv */
+    predictor = ClipMV(vectors[blkIdx]);
+
+    // TODO: no need
+    VECTOR zeroMV = { 0,0,0 };
+    predictors[4] = ClipMV(zeroMV);
+
+    // debug
+    //debug = (p.nBlkY == 32 && blkIdx == 0);
+    debug = false;
+
+    PseudoEPZSearch();
+
+    return bestMV;
+  }
+};
+
+template <typename pixel_t>
+class PlaneOfBlocks : public PlaneOfBlocksBase
+{
+  /* fields set at initialization */
+  const MVPlaneParam p;
+
+  unsigned int(*const SAD)(const pixel_t *pSrc, int nSrcPitch, const pixel_t *pRef, int nRefPitch);
+  unsigned int(*const SADCHROMA)(const pixel_t *pSrc, int nSrcPitch, const pixel_t *pRef, int nRefPitch);
+
+  std::vector<VECTOR> batchVectors[ANALYZE_MAX_BATCH];
+
+  // Tv XbhƂɏWvĂstatsMutexő
+  bool statsEnabled;
+  SearchStats stats;
+  std::mutex statsMutex;
+
+  void AddStats(const SearchStats& s)
+  {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.Add(s);
+  }
+
+  /* search the vectors for the whole plane in the serial order */
+  void SearchMVsSerial(BlockSearch<pixel_t>& search, const VECTOR& globalMV, VECTOR *out)
+  {
+    VECTOR *pBlkData = out;
+
+    for (int blky = 0; blky < p.nBlkY; blky++)
+    {
+      int blkScanDir = (blky % 2 == 0 || !p.meander) ? 1 : -1;
+      // meander (alternate) scan blocks (even row left to right, odd row right to left)
+      int blkxStart = (blky % 2 == 0 || !p.meander) ? 0 : p.nBlkX - 1;
+
+      for (int iblkx = 0; iblkx < p.nBlkX; iblkx++)
+      {
+        int blkx = blkxStart + iblkx*blkScanDir;
+
+        /* write the results */
+        pBlkData[blkx] = search.Search(blkx, blky, blkScanDir, globalMV);
+      }	// for iblkx
+
+      pBlkData += p.nBlkX;
+    }	// for blky
+  }
+
+  // EF[utgŒTimeanderȂ̒TƓʂɂȂj
+  // ubN(x,y)͍(x-1,y)Ə(x,y-1)̒TʂƁAE(x+1,y+1)̒TO̒lĩx̗\jgB
+  // 1s1Xbhō珈āA̍s(x,y-1)܂ŏÎ҂Ă΍Ə͑ĂB
+  // ̂Ƃ(x-1,y-1)IĂ̂ŁA(x-1,y-1)EƂēǂ(x,y)ɏ㏑邱ƂȂB
+  void SearchMVsWavefront(KMFrame *pSrcFrame, KMFrame *pRefFrame, VECTOR* vectors, const VECTOR& globalMV, VECTOR *out)
+  {
+    std::unique_ptr<std::atomic<int>[]> progress(new std::atomic<int>[p.nBlkY]);
+    for (int blky = 0; blky < p.nBlkY; blky++) {
+      progress[blky].store(0, std::memory_order_relaxed);
+    }
+
+    // ǂ̍sOŒfA̍sprogress͂i܂Ȃ̂ő҂Ăs
+    std::atomic<bool> aborted(false);
+
+    ThreadPool::GetInstance().ParallelFor(p.nBlkY, [&](int blky) {
+      try {
+        SearchStats rowStats;
+        BlockSearch<pixel_t> search(p, SAD, SADCHROMA, vectors, pSrcFrame, pRefFrame,
+          statsEnabled ? &rowStats : nullptr);
+        VECTOR *pBlkData = out + blky * p.nBlkX;
+
+        for (int blkx = 0; blkx < p.nBlkX; blkx++) {
+          if (blky > 0) {
+            // s͏ォ珇Ɏôŏ̍s͕KNĂ
+            while (progress[blky - 1].load(std::memory_order_acquire) <= blkx) {
+              if (aborted.load(std::memory_order_acquire)) {
+                return;
+              }
+              std::this_thread::yield();
+            }
+          }
+          pBlkData[blkx] = search.Search(blkx, blky, 1, globalMV);
+          progress[blky].store(blkx + 1, std::memory_order_release);
+        }
+
+        if (statsEnabled) {
+          AddStats(rowStats);
+        }
+      }
+      catch (...) {
+        // OParallelForĂяoXbhœ
+        aborted.store(true, std::memory_order_release);
+        throw;
+      }
+    });
+  }
+
 public:
   PlaneOfBlocks(MVPlaneParam p, PNeoEnv env)
     : p(p)
     , SAD(get_sad_function<pixel_t>(p.nBlkSizeX, p.nBlkSizeY, env))
     , SADCHROMA(get_sad_function<pixel_t>(p.nBlkSizeX / p.xRatioUV, p.nBlkSizeY / p.yRatioUV, env))
+    , statsEnabled(false)
   { }
 
+  void EnableStats() { statsEnabled = true; }
+  const SearchStats* GetStats() const { return statsEnabled ? &stats : nullptr; }
+
   int GetWorkSize()
   {
     return 0;
@@ -1692,15 +2158,28 @@ public:
 
   void SearchMVs(int batch, KMFrame **pSrcFrame, KMFrame **pRefFrame, const VECTOR *_globalMV, VECTOR **out, int nCount)
   {
+    // svectorĊmۂȂ悤ɊmۂĂ
     for (int b = 0; b < batch; ++b) {
       batchVectors[b].resize(p.nBlkCount);
-      vectors = batchVectors[b].data();
-      SearchMVs(pSrcFrame[b], pRefFrame[b], &_globalMV[b], out[b], nCount);
+    }
+
+    // ob`̊et[yA͓ƗȂ̂1Xbh1t[yAŏ
+    // eXbh͎batchVectors[b]ĜŋLԂ͂Ȃ
+    if (p._mt_flag && batch > 1 && ThreadPool::GetInstance().GetNumThreads() > 1) {
+      ThreadPool::GetInstance().ParallelFor(batch, [&](int b) {
+        SearchMVs(pSrcFrame[b], pRefFrame[b], batchVectors[b].data(), &_globalMV[b], out[b], nCount, false);
+      });
+    }
+    else {
+      for (int b = 0; b < batch; ++b) {
+        SearchMVs(pSrcFrame[b], pRefFrame[b], batchVectors[b].data(), &_globalMV[b], out[b], nCount, p._mt_flag);
+      }
     }
   }
 
   /* search the vectors for the whole plane */
-  void SearchMVs(KMFrame *pSrcFrame, KMFrame *pRefFrame, const VECTOR *_globalMV, VECTOR *out, int nCount)
+  void SearchMVs(KMFrame *pSrcFrame, KMFrame *pRefFrame, VECTOR* vectors,
+    const VECTOR *_globalMV, VECTOR *out, int nCount, bool wavefront)
   {
     assert(nCount == p.nBlkCount);
     // -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -
@@ -1710,134 +2189,19 @@ public:
     globalMV.x *= p.nPel;
     globalMV.y *= p.nPel;
 
-    pSrcYPlane = static_cast<KMPlane<pixel_t>*>(pSrcFrame->GetYPlane());
-    pSrcUPlane = static_cast<KMPlane<pixel_t>*>(pSrcFrame->GetUPlane());
-    pSrcVPlane = static_cast<KMPlane<pixel_t>*>(pSrcFrame->GetVPlane());
-    pRefYPlane = static_cast<KMPlane<pixel_t>*>(pRefFrame->GetYPlane());
-    pRefUPlane = static_cast<KMPlane<pixel_t>*>(pRefFrame->GetUPlane());
-    pRefVPlane = static_cast<KMPlane<pixel_t>*>(pRefFrame->GetVPlane());
-
-    nSrcPitch[0] = pSrcYPlane->GetPitch();
-    if (p.chroma)
-    {
-      nSrcPitch[1] = pSrcUPlane->GetPitch();
-      nSrcPitch[2] = pSrcVPlane->GetPitch();
-    }
-    nRefPitch[0] = pRefYPlane->GetPitch();
-    if (p.chroma)
-    {
-      nRefPitch[1] = pRefUPlane->GetPitch();
-      nRefPitch[2] = pRefVPlane->GetPitch();
-    }
-
-    // -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -
-
-    VECTOR *pBlkData = out;
-
-    y[0] = pSrcYPlane->GetVPadding();
-
-    if (p.chroma)
-    {
-      y[1] = pSrcUPlane->GetVPadding();
-      y[2] = pSrcVPlane->GetVPadding();
+    // meander͍sƂɑςĈˑ֌WOɂȂ̂ŕ񉻂Ȃ
+    if (wavefront && !p.meander && p.nBlkY > 1 && ThreadPool::GetInstance().GetNumThreads() > 1) {
+      SearchMVsWavefront(pSrcFrame, pRefFrame, vectors, globalMV, out);
     }
-
-    // Functions using float must not be used here
-
-    int nBlkSizeX_Ovr[3] = { (p.nBlkSizeX - p.nOverlapX), (p.nBlkSizeX - p.nOverlapX) >> p.nLogxRatioUV, (p.nBlkSizeX - p.nOverlapX) >> p.nLogxRatioUV };
-    int nBlkSizeY_Ovr[3] = { (p.nBlkSizeY - p.nOverlapY), (p.nBlkSizeY - p.nOverlapY) >> p.nLogyRatioUV, (p.nBlkSizeY - p.nOverlapY) >> p.nLogyRatioUV };
-
-    for (blky = 0; blky < p.nBlkY; blky++)
-    {
-      blkScanDir = (blky % 2 == 0 || !p.meander) ? 1 : -1;
-      // meander (alternate) scan blocks (even row left to right, odd row right to left)
-      int blkxStart = (blky % 2 == 0 || !p.meander) ? 0 : p.nBlkX - 1;
-      if (blkScanDir == 1) // start with leftmost block
-      {
-        x[0] = pSrcYPlane->GetHPadding();
-        if (p.chroma)
-        {
-          x[1] = pSrcUPlane->GetHPadding();
-          x[2] = pSrcVPlane->GetHPadding();
-        }
-      }
-      else // start with rightmost block, but it is already set at prev row
-      {
-        x[0] = pSrcYPlane->GetHPadding() + nBlkSizeX_Ovr[0] * (p.nBlkX - 1);
-        if (p.chroma)
-        {
-          x[1] = pSrcUPlane->GetHPadding() + nBlkSizeX_Ovr[1] * (p.nBlkX - 1);
-          x[2] = pSrcVPlane->GetHPadding() + nBlkSizeX_Ovr[2] * (p.nBlkX - 1);
-        }
+    else {
+      SearchStats localStats;
+      BlockSearch<pixel_t> search(p, SAD, SADCHROMA, vectors, pSrcFrame, pRefFrame,
+        statsEnabled ? &localStats : nullptr);
+      SearchMVsSerial(search, globalMV, out);
+      if (statsEnabled) {
+        AddStats(localStats);
       }
-
-      for (int iblkx = 0; iblkx < p.nBlkX; iblkx++)
-      {
-        blkx = blkxStart + iblkx*blkScanDir;
-        blkIdx = blky*p.nBlkX + blkx;
-        iter = 0;
-        //			DebugPrintf("BlkIdx = %d \n", blkIdx);
-
-        // Resets the global predictor (it may have been clipped during the
-        // previous block scan)
-        globalMVPredictor = globalMV;
-
-        pSrc[0] = pSrcYPlane->GetAbsolutePelPointer(x[0], y[0]);
-        if (p.chroma)
-        {
-          pSrc[1] = pSrcUPlane->GetAbsolutePelPointer(x[1], y[1]);
-          pSrc[2] = pSrcVPlane->GetAbsolutePelPointer(x[2], y[2]);
-        }
-
-        if (blky == 0)
-        {
-          nCurrentLambda = 0;
-        }
-        else
-        {
-          nCurrentLambda = p.nLambdaLevel;
-        }
-
-        // decreased padding of coarse levels
-        int nHPaddingScaled = pSrcYPlane->GetHPadding() >> p.nLogScale;
-        int nVPaddingScaled = pSrcYPlane->GetVPadding() >> p.nLogScale;
-        /* computes search boundaries */
-        nDxMax = p.nPel * (pSrcYPlane->GetExtendedWidth() - x[0] - p.nBlkSizeX - pSrcYPlane->GetHPadding() + nHPaddingScaled);
-        nDyMax = p.nPel * (pSrcYPlane->GetExtendedHeight() - y[0] - p.nBlkSizeY - pSrcYPlane->GetVPadding() + nVPaddingScaled);
-        nDxMin = -p.nPel * (x[0] - pSrcYPlane->GetHPadding() + nHPaddingScaled);
-        nDyMin = -p.nPel * (y[0] - pSrcYPlane->GetVPadding() + nVPaddingScaled);
-
-        /* search the mv */
-        predictor = ClipMV(vectors[blkIdx]);
-
-        // TODO: no need
-        VECTOR zeroMV = { 0,0,0 };
-        predictors[4] = ClipMV(zeroMV);
-
-        // debug
-        //debug = (p.nBlkY == 32 && blkIdx == 0);
-        debug = false;
-
-        PseudoEPZSearch();
-
-        /* write the results */
-        pBlkData[blkx] = bestMV;
-
-        /* increment indexes & pointers */
-        if (iblkx < p.nBlkX - 1)
-        {
-          x[0] += nBlkSizeX_Ovr[0] * blkScanDir;
-          x[1] += nBlkSizeX_Ovr[1] * blkScanDir;
-          x[2] += nBlkSizeX_Ovr[2] * blkScanDir;
-        }
-      }	// for iblkx
-
-      pBlkData += p.nBlkX;
-
-      y[0] += nBlkSizeY_Ovr[0];
-      y[1] += nBlkSizeY_Ovr[1];
-      y[2] += nBlkSizeY_Ovr[2];
-    }	// for blky
+    }
 
     // -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -  -
   }
@@ -2094,12 +2458,11 @@ public:
   }
 };
 
+template <typename pixel_t>
 class PlaneOfBlocksCUDA : public PlaneOfBlocksBase
 {
-  typedef uint8_t pixel_t;
-
   const MVPlaneParam p;
-  IKDeintKernel<pixel_t>* kernel;
+  IMVCUDA* cuda;
 
   short2* vectors;
   int* sads;
@@ -2118,10 +2481,15 @@ class PlaneOfBlocksCUDA : public PlaneOfBlocksBase
     return N_CONST_VEC + p.nBlkCount;
   }
 
+  // CUDACPÛǂgenvŌ܂̂Ŗ擾
+  IKDeintKernel<pixel_t>* kernel() const {
+    return cuda->get(pixel_t());
+  }
+
 public:
   PlaneOfBlocksCUDA(MVPlaneParam p, IMVCUDA* cuda, PNeoEnv env)
     : p(p)
-    , kernel(cuda->get(pixel_t()))
+    , cuda(cuda)
   { }
 
   ~PlaneOfBlocksCUDA() { }
@@ -2130,8 +2498,8 @@ public:
   {
     return GetVectorsPitch() * p.batch * sizeof(short2) +
       (GetSadsPitch() + 1 + p.nBlkX) * p.batch * sizeof(int) +
-      p.nBlkCount * p.batch * kernel->GetSearchBlockSize() +
-      p.batch * kernel->GetSearchBatchSize();
+      p.nBlkCount * p.batch * kernel()->GetSearchBlockSize() +
+      p.batch * kernel()->GetSearchBatchSize();
   }
 
   void SetWorkMemory(uint8_t* work)
@@ -2141,7 +2509,7 @@ public:
     prog = &sads[GetSadsPitch() * p.batch];
     next = &prog[p.nBlkX * p.batch];
     blocks = (void*)&next[1 * p.batch];
-    batchdata = (void*)&((uint8_t*)blocks)[p.nBlkCount * kernel->GetSearchBlockSize() * p.batch];
+    batchdata = (void*)&((uint8_t*)blocks)[p.nBlkCount * kernel()->GetSearchBlockSize() * p.batch];
 
     // ItZbgĂ
     vectors += N_CONST_VEC;
@@ -2150,14 +2518,15 @@ public:
 
   void InitializeGlobalMV(int batch, VECTOR* globalMV)
   {
-    // do nothing
+    // global𐄒肵ȂƂ[xN^ĝŏĂ
+    kernel()->WriteDefaultMV(globalMV, batch, 0);
   }
 
   void EstimateGlobalMVDoubled(int batch, VECTOR* globalMV)
   {
     assert(batch <= ANALYZE_MAX_BATCH);
 
-    kernel->EstimateGlobalMV(batch, vectors, GetVectorsPitch(), p.nBlkCount, (short2*)globalMV);
+    kernel()->EstimateGlobalMV(batch, vectors, GetVectorsPitch(), p.nBlkCount, (short2*)globalMV);
   }
 
   void InterpolatePrediction(int batch, const PlaneOfBlocksBase* _pob)
@@ -2184,7 +2553,7 @@ public:
     int atotalx = (p.nBlkSizeX - p.nOverlapX) * 4;
     //int atotaly = (p.nBlkSizeY - p.nOverlapY) * 4;
 
-    kernel->InterpolatePrediction(
+    kernel()->InterpolatePrediction(
       batch,
       pob.vectors, pob.GetVectorsPitch(), pob.sads, pob.GetSadsPitch(),
       vectors, GetVectorsPitch(), sads, GetSadsPitch(),
@@ -2201,8 +2570,8 @@ public:
     int sadPitch = GetSadsPitch();
 
     for (int i = 0; i < batch; ++i) {
-      kernel->MemCpy(out[i], src[i], nCount * sizeof(VECTOR));
-      kernel->LoadMV(src[i], vectors + vecPitch * i, sads + sadPitch * i, nCount);
+      kernel()->MemCpy(out[i], src[i], nCount * sizeof(VECTOR));
+      kernel()->LoadMV(src[i], vectors + vecPitch * i, sads + sadPitch * i, nCount);
     }
   }
 
@@ -2248,7 +2617,7 @@ public:
     int nImgPitchY = nSrcPitchY * pSrcYPlane->GetExtendedHeight();
     int nImgPitchUV = (p.chroma ? (nSrcPitchUV * pSrcUPlane->GetExtendedHeight()) : 0);
 
-    kernel->Search(batch, batchdata, p.searchType, p.nBlkX, p.nBlkY, p.nBlkSizeX,
+    kernel()->Search(batch, batchdata, p.searchType, p.nBlkX, p.nBlkY, p.nBlkSizeX,
       p.nLogScale, p.nLambdaLevel, p.lsad, p.penaltyZero,
       p.pglobal, p.penaltyNew, p.nPel, p.chroma,
       pSrcYPlane->GetHPadding(), nBlkSizeX, nExtendedWidth, nExtendedHeight,
@@ -2257,7 +2626,7 @@ public:
       (const short2*)globalMV, vectors, GetVectorsPitch(), sads, GetSadsPitch(), blocks, prog, next);
 
     for (int i = 0; i < batch; ++i) {
-      kernel->StoreMV(out[i], vectors + vecPitch * i, sads + sadPitch * i, nCount);
+      kernel()->StoreMV(out[i], vectors + vecPitch * i, sads + sadPitch * i, nCount);
     }
   }
 
@@ -2265,7 +2634,7 @@ public:
   {
     assert(nCount == p.nBlkCount);
 
-    kernel->WriteDefaultMV(out, nCount, p.verybigSAD);
+    kernel()->WriteDefaultMV(out, nCount, p.verybigSAD);
   }
 };
 
@@ -2293,7 +2662,7 @@ public:
     SearchType searchType, int nSearchParam, int nPelSearch, int nLambda,
     int lsad, int pnew, int plevel, bool global,
     int penaltyZero, int pglobal, int badSAD,
-    int badrange, bool meander, bool tryMany,
+    int badrange, bool meander, bool tryMany, int adaptiveSAD,
 
     IMVCUDA* cuda,
     PNeoEnv env)
@@ -2329,23 +2698,33 @@ public:
 
         searchTypeLevel, nSearchParam, nSearchParamLevel, nLambda, lsad, pnew,
         plevel, global, penaltyZero, pglobal, badSAD, badrange, meander,
-        tryMany);
+        tryMany, adaptiveSAD);
 
       if (nPixelSize == 1) {
         cpuplanes[i] = std::unique_ptr<PlaneOfBlocksBase>(
           new PlaneOfBlocks<uint8_t>(p, env));
         cudaplanes[i] = std::unique_ptr<PlaneOfBlocksBase>(
-          new PlaneOfBlocksCUDA(p, cuda, env));
+          new PlaneOfBlocksCUDA<uint8_t>(p, cuda, env));
       }
       else {
         cpuplanes[i] = std::unique_ptr<PlaneOfBlocksBase>(
           new PlaneOfBlocks<uint16_t>(p, env));
         cudaplanes[i] = std::unique_ptr<PlaneOfBlocksBase>(
-          new PlaneOfBlocksCUDA(p, cuda, env));
+          new PlaneOfBlocksCUDA<uint16_t>(p, cuda, env));
       }
     }
   }
 
+  void EnableStats() {
+    for (int i = 0; i < nLevelCount; i++) {
+      cpuplanes[i]->EnableStats();
+    }
+  }
+
+  const SearchStats* GetStats(int level) const {
+    return cpuplanes[level]->GetStats();
+  }
+
   int GetWorkSize() const {
     int size = sizeof(VECTOR) * maxBatch; // globalMV
     int nLevelFrom = nLevelCount - 1;
@@ -2463,6 +2842,28 @@ const char* GetAnalyzeValidPropName() {
   return "KMVIsValid";
 }
 
+// LbVǂݏoxN^t[ɕtieXgŃqbgmF邽߁j
+static const char* GetAnalyzeCacheHitPropName() {
+  return "KMVCacheHit";
+}
+
+// xN^t[̃f[^VECTORzƂĎ擾
+// RpNg`̏ꍇbufɓWJiCPÛ݁j
+static const VECTOR* GetFrameVectors(const KMVParam* params,
+  const PVideoFrame& frame, std::vector<VECTOR>& buf, PNeoEnv env)
+{
+  if (!params->IsCompactMV()) {
+    return reinterpret_cast<const VECTOR*>(frame->GetReadPtr());
+  }
+  if (IS_CUDA) {
+    env->ThrowError("Compact motion vector format is not supported on CUDA");
+  }
+  int nCount = params->GetTotalBlocks();
+  buf.resize(nCount);
+  KMVCompact::Unpack(frame->GetReadPtr(), buf.data(), nCount);
+  return buf.data();
+}
+
 class KMAnalyse : public GenericVideoFilter
 {
 private:
@@ -2479,6 +2880,78 @@ private:
   PClip partial;
   const KMVParam* partialParams;
 
+  // Tʂ̃LbVt@Cicachew莞̂݁j
+  std::unique_ptr<KMVCacheFile> cacheFile;
+  uint64_t paramHash;
+
+  // RpNg`̏ꍇ̒TʁiVECTORjpartial̓WJ
+  std::vector<VECTOR> vectorBuf;
+  std::vector<VECTOR> preBuf[ANALYZE_MAX_BATCH];
+
+  bool adaptive;
+
+  // Tvistatsw莞̓fXgN^ŏój
+  // v̂CPU̒TiPlaneOfBlocksj
+  bool statsEnabled;
+  bool usedKernel; // CUDAcpukernelŒT
+  int64_t statsFrames; // vɓĂt[
+
+  void PrintStats()
+  {
+    printf("KMAnalyse stats: %s delta=%d blksize=%d\n",
+      params.isBackward ? "backward" : "forward", params.nDeltaFrame, params.nBlkSizeX);
+    if (usedKernel) {
+      printf("  not available on CUDA or cpukernel\n");
+    }
+    for (int i = params.nAnalyzeLevels - 1; i >= 0; i--) {
+      const SearchStats* st = pAnalyzer->GetStats(i);
+      if (st == nullptr || st->blocks == 0) {
+        continue;
+      }
+      double blocks = (double)st->blocks;
+      printf("  level %d: blocks=%lld candidates/blk=%.2f sad/blk=%.2f earlyexit=%.1f%%\n",
+        i, (long long)st->blocks, st->candidates / blocks, st->sadCalls / blocks,
+        st->candidates ? 100.0 * st->earlyExits / st->candidates : 0.0);
+      printf("    winner:");
+      for (int w = 0; w < SearchStats::PRED_COUNT; ++w) {
+        printf(" %s=%.1f%%", SearchStats::GetPredName(w), 100.0 * st->winner[w] / blocks);
+      }
+      printf("\n");
+    }
+  }
+
+  // ܂ł̓v̗݌vo̓t[ɕtieXgŊmF邽߁j
+  void SetStatsProperties(PVideoFrame* frames, int numBatch)
+  {
+    statsFrames += numBatch;
+    int64_t blocks = 0;
+    int64_t candidates = 0;
+    for (int i = 0; i < params.nAnalyzeLevels; i++) {
+      const SearchStats* st = pAnalyzer->GetStats(i);
+      if (st != nullptr) {
+        blocks += st->blocks;
+        candidates += st->candidates;
+      }
+    }
+    for (int b = 0; b < numBatch; ++b) {
+      frames[b]->SetProperty("KMVStatFrames", AVSMapValue((__int64)statsFrames));
+      frames[b]->SetProperty("KMVStatBlkCount", AVSMapValue((__int64)params.GetTotalBlocks()));
+      frames[b]->SetProperty("KMVStatBlocks", AVSMapValue((__int64)blocks));
+      frames[b]->SetProperty("KMVStatCandidates", AVSMapValue((__int64)candidates));
+    }
+  }
+
+  // \[Xt[̓enbVvZ
+  static uint64_t HashSourceFrame(uint64_t h, PVideoFrame &src, bool chroma)
+  {
+    const int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+    for (int p = 0; p < (chroma ? 3 : 1); ++p) {
+      h = KMVCacheFile::HashPlane(h, src->GetReadPtr(planes[p]),
+        src->GetPitch(planes[p]), src->GetRowSize(planes[p]), src->GetHeight(planes[p]));
+    }
+    return h;
+  }
+
   void LoadSourceFrame(KMSuperFrame *sf, PVideoFrame &src)
   {
     const unsigned char *	pSrcY;
@@ -2508,15 +2981,20 @@ public:
     int overlapx, int overlapy, const char* _outfilename, int dctmode,
     int divide, int sadx264, int badSAD, int badrange, bool isse,
     bool meander, bool temporal_flag, bool tryMany, bool multi_flag,
-    bool mt_flag, int _chromaSADScale, int batch, PNeoEnv env)
+    bool mt_flag, int _chromaSADScale, int batch, const char* cachePath, bool compact, bool stats, int adaptiveSAD, PNeoEnv env)
     : GenericVideoFilter(child)
     , params(KMVParam::MV_FRAME)
-    , cuda(CreateKDeintCUDA())
+    , cuda(CreateKDeintCUDA(KMVParam::GetParam(vi, env)->cpuKernel))
     , pAnalyzer()
     , maxBatch(batch)
     , curBatch(-1)
     , partial(partial)
     , partialParams(partial ? KMVParam::GetParam(partial->GetVideoInfo(), env) : nullptr)
+    , paramHash(0)
+    , adaptive(adaptiveSAD > 0)
+    , statsEnabled(stats)
+    , usedKernel(false)
+    , statsFrames(0)
   {
     int nPixelSize = vi.ComponentSize();
     int nBitsPerPixel = vi.BitsPerComponent();
@@ -2552,6 +3030,12 @@ public:
     params.nOverlapY = overlapy;
     params.nDeltaFrame = df;
     params.chroma = chroma;
+    params.nVersion = KMVParam::VERSION;
+    params.mvFormat = compact ? KMVParam::MV_FORMAT_COMPACT : KMVParam::MV_FORMAT_VECTOR;
+
+    if (compact && params.nBitsPerPixel > 12) {
+      env->ThrowError("KMAnalyse: compact format supports up to 12 bits");
+    }
 
     const std::vector< std::pair< int, int > > allowed_blksizes = { { 32,32 },{ 16,16 },{ 8,8 } };
     bool found = false;
@@ -2634,6 +3118,11 @@ public:
 
     lsad = lsad * (blksizex * blksizey) / 64 * (1 << (params.nBitsPerPixel - 8)); // normalized to 8x8 blocksize todo: float
     badSAD = badSAD * (blksizex * blksizey) / 64 * (1 << (params.nBitsPerPixel - 8));
+    // adaptive8x8ubN8bit Fgꍇ͂̕𑫂iKMVClipthSCD1Ɠj
+    adaptiveSAD = adaptiveSAD * (blksizex * blksizey) / 64 * (1 << (params.nBitsPerPixel - 8));
+    if (params.chroma) {
+      adaptiveSAD += ScaleSadChroma(adaptiveSAD * 2, params.chromaSADScale) / 4;
+    }
 
     // not below value of 0 at finest level
     pelSearch = (pelSearch <= 0) ? params.nPel : pelSearch;
@@ -2698,7 +3187,7 @@ public:
       0,
       params.nPixelSize, // PF
       params.nBitsPerPixel,
-      false,
+      mt_flag,
       params.chromaSADScale,
       batch,
 
@@ -2715,16 +3204,51 @@ public:
       badrange,
       meander,
       tryMany,
+      adaptiveSAD,
 
       cuda.get(),
       env
     ));
 
     // Defines the format of the output vector clip
-    const int		out_frame_bytes = pAnalyzer->GetArraySize();
+    const int		out_frame_bytes = params.IsCompactMV() ?
+      KMVCompact::GetBytes(params.GetTotalBlocks()) : pAnalyzer->GetArraySize();
+    if (params.IsCompactMV()) {
+      vectorBuf.resize(params.GetTotalBlocks() * batch);
+    }
+    if (statsEnabled) {
+      pAnalyzer->EnableStats();
+    }
     vi.pixel_type = VideoInfo::CS_BGR32;
     vi.width = 2048;
     vi.height = nblocks(out_frame_bytes, vi.width * 4);
+
+    if (cachePath && *cachePath) {
+      // ʂɉep[^SănbVɊ܂߂
+      // KMVParam̓pfBÔŃoƂɓ
+      const int hashParams[] = {
+        KMVParam::VERSION,
+        params.nWidth, params.nHeight, params.nActualWidth, params.nActualHeight,
+        params.nHPad, params.nVPad, params.nPel, params.chroma, params.nLevels,
+        params.nPixelSize, params.nBitsPerPixel, params.pixelType,
+        params.nDeltaFrame, params.isBackward, params.nBlkSizeX, params.nBlkSizeY,
+        params.nOverlapX, params.nOverlapY, params.nAnalyzeLevels, params.chromaSADScale,
+        partialParams ? partialParams->nAnalyzeLevels : 0,
+        (int)searchType, nSearchParam, pelSearch, lambda, lsad, pnew, plevel, global,
+        penaltyZero, pglobal, badSAD, badrange, meander, tryMany,
+        adaptiveSAD, params.mvFormat, params.cpuKernel, out_frame_bytes
+      };
+      paramHash = KMVCacheFile::Hash(0, hashParams, sizeof(hashParams));
+      cacheFile = std::unique_ptr<KMVCacheFile>(new KMVCacheFile(
+        cachePath, params, paramHash, vi.num_frames, out_frame_bytes, env));
+    }
+  }
+
+  ~KMAnalyse()
+  {
+    if (statsEnabled) {
+      PrintStats();
+    }
   }
 
   PVideoFrame __stdcall	GetFrame(int n, IScriptEnvironment* env_)
@@ -2740,11 +3264,16 @@ public:
       PVideoFrame dst = env->NewVideoFrame(vi);
       cuda->SetEnv(env);
 
-      VECTOR* pDst = reinterpret_cast<VECTOR*>(dst->GetWritePtr());
+      VECTOR* pDst = params.IsCompactMV() ?
+        vectorBuf.data() : reinterpret_cast<VECTOR*>(dst->GetWritePtr());
 
       // fill all vectors with invalid data
       pAnalyzer->WriteDefault(pDst);
 
+      if (params.IsCompactMV()) {
+        KMVCompact::Pack(pDst, dst->GetWritePtr(), params.GetTotalBlocks());
+      }
+
       dst->SetProperty(GetAnalyzeValidPropName(), false);
 
       return dst;
@@ -2765,8 +3294,25 @@ public:
     KMSuperFrame *ppSrcSF[ANALYZE_MAX_BATCH];
     KMSuperFrame *ppRefSF[ANALYZE_MAX_BATCH];
     VECTOR *ppOut[ANALYZE_MAX_BATCH];
+    uint8_t *ppOutFrame[ANALYZE_MAX_BATCH];
     const VECTOR *ppPre[ANALYZE_MAX_BATCH];
     PVideoFrame preFrames[ANALYZE_MAX_BATCH];
+    uint64_t cacheKeys[ANALYZE_MAX_BATCH];
+    const int nVectors = params.GetTotalBlocks();
+
+    // cpukernel̂ƂCPUłcudaplanesŒT̂ŁAT̎IS_CUDAł͂ȂIsEnabledŔf
+    cuda->SetEnv(env);
+
+    if (cacheFile && IS_CUDA) {
+      env->ThrowError("KMAnalyse: cache is not supported on CUDA");
+    }
+    if (params.IsCompactMV() && IS_CUDA) {
+      env->ThrowError("KMAnalyse: compact format is not supported on CUDA");
+    }
+    if (adaptive && cuda->IsEnabled()) {
+      env->ThrowError("KMAnalyse: adaptive is not supported on CUDA or cpukernel");
+    }
+    usedKernel |= cuda->IsEnabled();
 
 #if LOG_PRINT
     if (IS_CUDA) {
@@ -2780,7 +3326,10 @@ public:
       // t[m
       batchFrames[b] = env->NewVideoFrame(vi);
       batchFrames[b]->SetProperty(GetAnalyzeValidPropName(), true);
-      ppOut[b] = reinterpret_cast<VECTOR*>(batchFrames[b]->GetWritePtr());
+      ppOutFrame[b] = batchFrames[b]->GetWritePtr();
+      // RpNg`͈UVECTORŒTĂl߂
+      ppOut[b] = params.IsCompactMV() ?
+        vectorBuf.data() + nVectors * b : reinterpret_cast<VECTOR*>(ppOutFrame[b]);
 
       const int nsrc = requestedBatch * maxBatch + minframe + b;
       const int nref = nsrc + offset;
@@ -2798,7 +3347,18 @@ public:
 
       if (partialParams) {
         preFrames[b] = partial->GetFrame(nsrc, env);
-        ppPre[b] = reinterpret_cast<const VECTOR*>(preFrames[b]->GetReadPtr());
+        ppPre[b] = GetFrameVectors(partialParams, preFrames[b], preBuf[b], env);
+      }
+
+      if (cacheFile) {
+        // L[̓p[^AsrcArefApartial̓e
+        uint64_t h = HashSourceFrame(paramHash, srcFrames[b], params.chroma);
+        h = HashSourceFrame(h, refFrames[b], params.chroma);
+        if (partialParams) {
+          h = KMVCacheFile::HashPlane(h, preFrames[b]->GetReadPtr(),
+            preFrames[b]->GetPitch(), preFrames[b]->GetRowSize(), preFrames[b]->GetHeight());
+        }
+        cacheKeys[b] = KMVCacheFile::MakeKey(h);
       }
 
 #if 0
@@ -2807,15 +3367,23 @@ public:
 #endif
     }
 
-    cuda->SetEnv(env);
+    if (cacheFile) {
+      bool hit = true;
+      for (int b = 0; b < numBatch && hit; ++b) {
+        const int nsrc = requestedBatch * maxBatch + minframe + b;
+        hit = cacheFile->Read(nsrc, cacheKeys[b], ppOutFrame[b]);
+      }
+      if (hit) {
+        // ob`ŜLbVɂ̂ŒTsv
+        for (int b = 0; b < numBatch; ++b) {
+          batchFrames[b]->SetProperty(GetAnalyzeCacheHitPropName(), true);
+        }
+        curBatch = requestedBatch;
+        return batchFrames[requested % maxBatch];
+      }
+    }
 
-    PVideoFrame work;
-    int work_bytes = pAnalyzer->GetWorkSize();
-    VideoInfo workvi = VideoInfo();
-    workvi.pixel_type = VideoInfo::CS_BGR32;
-    workvi.width = 2048;
-    workvi.height = nblocks(work_bytes, workvi.width * 4);
-    work = env->NewVideoFrame(workvi);
+    ScratchBuffer work(pAnalyzer->GetWorkSize(), env);
 
 #if LOG_PRINT
     if (IS_CUDA) {
@@ -2825,7 +3393,24 @@ public:
     }
 #endif
 
-    pAnalyzer->SearchMVs(numBatch, ppSrcSF, ppRefSF, partialParams ? ppPre : nullptr, ppOut, work->GetWritePtr());
+    pAnalyzer->SearchMVs(numBatch, ppSrcSF, ppRefSF, partialParams ? ppPre : nullptr, ppOut, work.GetWritePtr());
+
+    if (statsEnabled && !cuda->IsEnabled()) {
+      SetStatsProperties(batchFrames, numBatch);
+    }
+
+    if (params.IsCompactMV()) {
+      for (int b = 0; b < numBatch; ++b) {
+        KMVCompact::Pack(ppOut[b], ppOutFrame[b], nVectors);
+      }
+    }
+
+    if (cacheFile) {
+      for (int b = 0; b < numBatch; ++b) {
+        const int nsrc = requestedBatch * maxBatch + minframe + b;
+        cacheFile->Write(nsrc, cacheKeys[b], ppOutFrame[b]);
+      }
+    }
 
     curBatch = requestedBatch;
     return batchFrames[requested % maxBatch];
@@ -2893,9 +3478,13 @@ public:
       false,  // temporal predictor
       false,  // try many
       false,  // multi
-      false,  // mt
+      args[15].AsBool(true),  // mt
       0,   // scaleCSAD
       args[14].AsInt(1), // batch
+      args[16].AsString(nullptr), // cache
+      args[17].AsBool(false), // compact
+      args[18].AsBool(false), // stats
+      args[19].AsInt(0), // adaptive
       env
     );
   }
@@ -2962,7 +3551,7 @@ public:
     : GenericVideoFilter(child)
     , superParams(KMVParam::GetParam(vi, env))
     , params(*superParams)
-    , cuda(CreateKDeintCUDA())
+    , cuda(CreateKDeintCUDA(KMVParam::GetParam(vi, env)->cpuKernel))
   {
     params.nWidth = PlaneWidthLuma(superParams->nWidth, nDropLevels, superParams->xRatioUV, superParams->nHPad);
     params.nHeight = PlaneHeightLuma(superParams->nHeight, nDropLevels, superParams->yRatioUV, superParams->nVPad);
@@ -3139,6 +3728,7 @@ class KMVReplaceWithMV : public GenericVideoFilter
   PClip mvv;
 
   const KMVParam* params;
+  std::vector<VECTOR> vectorBuf;
 
   void GetMVData(int n, const int*& pMv, int& data_size, PNeoEnv env)
   {
@@ -3189,7 +3779,11 @@ public:
 
     const LevelInfo *linfo = params->levelInfo;
     PVideoFrame ret = env->NewVideoFrame(vi);
-    VECTOR* kdata = reinterpret_cast<VECTOR*>(ret->GetWritePtr());
+    if (params->IsCompactMV()) {
+      vectorBuf.resize(params->GetTotalBlocks());
+    }
+    VECTOR* kdata = params->IsCompactMV() ?
+      vectorBuf.data() : reinterpret_cast<VECTOR*>(ret->GetWritePtr());
 
     // validity
     ret->SetProperty(GetAnalyzeValidPropName(), pMv[1]);
@@ -3209,6 +3803,10 @@ public:
       kdata += linfo[i].nBlkX * linfo[i].nBlkY;
     }
 
+    if (params->IsCompactMV()) {
+      KMVCompact::Pack(vectorBuf.data(), ret->GetWritePtr(), params->GetTotalBlocks());
+    }
+
     return ret;
   }
 
@@ -3225,6 +3823,7 @@ class MVReplaceWithKMV : public GenericVideoFilter
   PClip kmv;
 
   const KMVParam* params;
+  std::vector<VECTOR> vectorBuf;
 
   // wb_Ȃǂ̃f[^̍Č͑ςȂ̂ŁA
   // 1mvtoolst[擾
@@ -3276,7 +3875,7 @@ public:
     }
 
     PVideoFrame kmvframe = kmv->GetFrame(n, env);
-    const VECTOR* kdata = reinterpret_cast<const VECTOR*>(kmvframe->GetReadPtr());
+    const VECTOR* kdata = GetFrameVectors(params, kmvframe, vectorBuf, env);
 
     PVideoFrame ret = env->NewVideoFrame(vi);
     const LevelInfo *linfo = params->levelInfo;
@@ -3324,6 +3923,7 @@ class KMAnalyzeCheck : public GenericVideoFilter
   PClip mvv;
 
   const KMVParam* params;
+  std::vector<VECTOR> vectorBuf;
 
   void GetMVData(int n, const int*& pMv, int& data_size, PNeoEnv env)
   {
@@ -3372,7 +3972,7 @@ public:
     PVideoFrame kmvframe = kmv->GetFrame(n, env);
 
     const LevelInfo* linfo = params->levelInfo;
-    const VECTOR* kdata = reinterpret_cast<const VECTOR*>(kmvframe->GetReadPtr());
+    const VECTOR* kdata = GetFrameVectors(params, kmvframe, vectorBuf, env);
 
     const int* pMv;
     int data_size;
@@ -3417,6 +4017,9 @@ class KMAnalyzeCheck2 : public GenericVideoFilter
   PClip kmv2;
 
   const KMVParam* params;
+  const KMVParam* params2;
+  std::vector<VECTOR> vectorBuf1;
+  std::vector<VECTOR> vectorBuf2;
 
 public:
   KMAnalyzeCheck2(PClip kmv1, PClip kmv2, PClip view, PNeoEnv env)
@@ -3424,6 +4027,7 @@ public:
     , kmv1(kmv1)
     , kmv2(kmv2)
     , params(KMVParam::GetParam(kmv1->GetVideoInfo(), env))
+    , params2(KMVParam::GetParam(kmv2->GetVideoInfo(), env))
   {
   }
 
@@ -3435,8 +4039,8 @@ public:
     PVideoFrame kmvframe2 = kmv2->GetFrame(n, env);
 
     const LevelInfo* linfo = params->levelInfo;
-    const VECTOR* kdata1 = reinterpret_cast<const VECTOR*>(kmvframe1->GetReadPtr());
-    const VECTOR* kdata2 = reinterpret_cast<const VECTOR*>(kmvframe2->GetReadPtr());
+    const VECTOR* kdata1 = GetFrameVectors(params, kmvframe1, vectorBuf1, env);
+    const VECTOR* kdata2 = GetFrameVectors(params2, kmvframe2, vectorBuf2, env);
 
     // validity
     bool data1valid = kmvframe1->GetProperty(GetAnalyzeValidPropName())->GetInt() != 0;
@@ -3902,6 +4506,9 @@ class KMVClip
 
   bool isValid;
 
+  // RpNg`̓WJ
+  std::vector<VECTOR> vectorBuf;
+
 public:
   KMVClip(const KMVParam* params, int _nSCD1, int _nSCD2)
     : params(params)
@@ -3943,6 +4550,13 @@ public:
     }
   }
 
+  // xN^t[Zbg
+  void SetFrame(const PVideoFrame& frame, PNeoEnv env)
+  {
+    bool isValid_ = frame->GetProperty(GetAnalyzeValidPropName())->GetInt() != 0;
+    SetData(GetFrameVectors(params, frame, vectorBuf, env), isValid_);
+  }
+
   int GetThSCD1() const { return nSCD1; }
   int GetThSCD2() const { return nSCD2; }
 
@@ -4054,13 +4668,13 @@ class KMDegrainCore : public KMDegrainCoreBase
   const bool isUV;
   const int thSAD;
   const int nLimit;
+  const bool mt;
 
   const KMVClip* mvClipB[MAX_DEGRAIN];
   const KMVClip* mvClipF[MAX_DEGRAIN];
 
   const OverlapWindows* OverWins;
 
-  std::unique_ptr<pixel_t[]> tmpBlock;
   std::unique_ptr<tmp_t[]> tmpDst;
 
   NormWeightsFunction NORMWEIGHTS;
@@ -4097,7 +4711,11 @@ class KMDegrainCore : public KMDegrainCoreBase
     return nullptr;
   }
 
-  static DegrainFunction GetDegrainFunction(int delta, int blockWidth, int blockHeight) {
+  static DegrainFunction GetDegrainFunction(int delta, int blockWidth, int blockHeight, int cpuFlags) {
+    if (cpuFlags & CPUF_AVX2) {
+      DegrainFunction func = get_degrain_avx2_func<pixel_t>(delta, blockWidth, blockHeight);
+      if (func) return func;
+    }
     switch (delta) {
     case 1: return GetDegrainFunction<1>(blockWidth, blockHeight);
     case 2: return GetDegrainFunction<2>(blockWidth, blockHeight);
@@ -4153,7 +4771,7 @@ class KMDegrainCore : public KMDegrainCoreBase
 public:
   KMDegrainCore(const KMVParam* params,
     int delta,
-    bool isUV, int thSAD, int nLimit,
+    bool isUV, int thSAD, int nLimit, bool mt,
     KMVClip* mvClipB_[MAX_DEGRAIN],
     KMVClip* mvClipF_[MAX_DEGRAIN],
     const OverlapWindows* OverWins, PNeoEnv env)
@@ -4162,10 +4780,10 @@ public:
     , isUV(isUV)
     , thSAD(thSAD)
     , nLimit(nLimit)
+    , mt(mt)
     , mvClipB()
     , mvClipF()
     , OverWins(OverWins)
-    , tmpBlock()
     , tmpDst()
   {
     const int nBlkSizeX = params->nBlkSizeX;
@@ -4181,9 +4799,14 @@ public:
       mvClipF[i] = mvClipF_[i];
     }
 
+    const int cpuFlags = env->GetCPUFlags();
+
     NORMWEIGHTS = GetNormWeightsFunction(delta);
-    OVERLAP = GetOverlapFunction<pixel_t>(blockWidth, blockHeight);
-    DEGRAIN = GetDegrainFunction(delta, blockWidth, blockHeight);
+    OVERLAP = (cpuFlags & CPUF_AVX2) ? get_overlaps_avx2_func<pixel_t>(blockWidth, blockHeight) : nullptr;
+    if (!OVERLAP) {
+      OVERLAP = GetOverlapFunction<pixel_t>(blockWidth, blockHeight);
+    }
+    DEGRAIN = GetDegrainFunction(delta, blockWidth, blockHeight, cpuFlags);
 
     if (!NORMWEIGHTS)
       env->ThrowError("KMDegrain%d : no valid NORMWEIGHTS function for %dx%d, delta=%d", delta, blockWidth, blockHeight, delta);
@@ -4231,135 +4854,136 @@ public:
       return;
     }
 
-    if (nOverlapX == 0 && nOverlapY == 0)
-    {
-      const pixel_t* pSrcCur = src;
-      pixel_t* pDstCur = dst;
+    const bool isOverlap = (nOverlapX != 0 || nOverlapY != 0);
+    const bool isLimit = (nLimit < (1 << nBitsPerPixel) - 1);
+    const int stepX = (nBlkSizeX - nOverlapX) >> nLogxRatio;
+    const int stepY = (nBlkSizeY - nOverlapY) >> nLogyRatio;
 
-      for (int by = 0; by < nBlkY; by++)
+    // ubNsbyŏIIȏo͂Sfs͈̔
+    // overlapĂdȂ炸[0,nHeight_B)傤Ǖ
+    auto bandRows = [&](int by, int& ystart, int& yend) {
+      ystart = by * stepY;
+      yend = (by == nBlkY - 1) ? (nHeight_B >> nLogyRatio) : (by + 1) * stepY;
+    };
+
+    // ubNsPʂŕ񉻂
+    ThreadPool& pool = ThreadPool::GetInstance();
+    const bool parallel = mt && nBlkY > 1 && pool.GetNumThreads() > 1;
+    auto forEachRow = [&](int n, const std::function<void(int)>& f) {
+      if (parallel) {
+        pool.ParallelFor(n, f);
+      }
+      else {
+        for (int i = 0; i < n; ++i) f(i);
+      }
+    };
+
+    // 1ubNs̏d݂ƎQƃubN߂DEGRAIN
+    // pBlkDstnullptr̂ƂpTmpBlockɏotmpDstɑ|đ
+    auto procBlockRow = [&](int by, pixel_t* pBlkDst, pixel_t* pTmpBlock, const short *winOverBase) {
+      const pixel_t* pSrcCur = src + by * stepY * nSrcPitch;
+      const int tmpBlockPitch = nBlkSizeX;
+      const int tmpDstPitch = nWidth;
+      tmp_t *pTmpDst = pBlkDst ? nullptr : tmpDst.get() + by * stepY * tmpDstPitch;
+      int wby = ((by + nBlkY - 3) / (nBlkY - 2)) * 3;
+
+      int xx = 0;
+      for (int bx = 0; bx < nBlkX; bx++)
       {
-        int xx = 0;
-        for (int bx = 0; bx < nBlkX; bx++)
-        {
-          const pixel_t * pB[MAX_DEGRAIN], *pF[MAX_DEGRAIN];
-          int WSrc;
-          int WRefB[MAX_DEGRAIN], WRefF[MAX_DEGRAIN];
+        const pixel_t * pB[MAX_DEGRAIN], *pF[MAX_DEGRAIN];
+        int WSrc;
+        int WRefB[MAX_DEGRAIN], WRefF[MAX_DEGRAIN];
 
-          for (int j = 0; j < delta; j++) {
-            use_block(pB[j], WRefB[j], isUsableB[j], *mvClipB[j], bx, by, pPlanesB[j], pDummyPlane, thSAD, nLogxRatio, nLogyRatio, nPel);
-            use_block(pF[j], WRefF[j], isUsableF[j], *mvClipF[j], bx, by, pPlanesF[j], pDummyPlane, thSAD, nLogxRatio, nLogyRatio, nPel);
-          }
+        for (int j = 0; j < delta; j++) {
+          use_block(pB[j], WRefB[j], isUsableB[j], *mvClipB[j], bx, by, pPlanesB[j], pDummyPlane, thSAD, nLogxRatio, nLogyRatio, nPel);
+          use_block(pF[j], WRefF[j], isUsableF[j], *mvClipF[j], bx, by, pPlanesF[j], pDummyPlane, thSAD, nLogxRatio, nLogyRatio, nPel);
+        }
 
-          NORMWEIGHTS(WSrc, WRefB, WRefF);
+        NORMWEIGHTS(WSrc, WRefB, WRefF);
 
-          DEGRAIN(pDstCur + xx, nDstPitch, pSrcCur + xx, nSrcPitch,
+        if (pBlkDst) {
+          DEGRAIN(pBlkDst + xx, nDstPitch, pSrcCur + xx, nSrcPitch,
             pB, pF, nSuperPitch, WSrc, WRefB, WRefF);
+        }
+        else {
+          // select window
+          int wbx = (bx + nBlkX - 3) / (nBlkX - 2);
+          const short *winOver = winOverBase + (wby + wbx) * OverWins->GetSize();
 
-          xx += (nBlkSizeX >> nLogxRatio);
+          DEGRAIN(pTmpBlock, tmpBlockPitch, pSrcCur + xx, nSrcPitch,
+            pB, pF, nSuperPitch, WSrc, WRefB, WRefF);
 
-          if (bx == nBlkX - 1 && nWidth_B < nWidth) // right non-covered region
-          {
-            Copy(pDstCur + (nWidth_B >> nLogxRatio), nDstPitch,
-              pSrcCur + (nWidth_B >> nLogxRatio), nSrcPitch,
-              (nWidth - nWidth_B) >> nLogxRatio,
-              nBlkSizeY >> nLogyRatio);
-          }
-        }	// for bx
+          OVERLAP(pTmpDst + xx, tmpDstPitch, pTmpBlock, tmpBlockPitch, winOver, nBlkSizeX >> nLogxRatio);
+        }
 
-        pDstCur += (nBlkSizeY >> nLogyRatio) * nDstPitch;
-        pSrcCur += (nBlkSizeY >> nLogyRatio) * nSrcPitch;
+        xx += stepX;
+      }	// for bx
+    };
 
-        if (by == nBlkY - 1 && nHeight_B < nHeight) // bottom uncovered region
-        {
-          Copy(pDstCur, nDstPitch, pSrcCur, nSrcPitch,
-            nWidth >> nLogxRatio, (nHeight - nHeight_B) >> nLogyRatio);
-        }
-      }	// for by
+    // S͈͂̉E̔Jo[̈nLimit̏
+    auto finishBand = [&](int ystart, int yend) {
+      if (nWidth_B < nWidth) // right non-covered region
+      {
+        Copy(dst + ystart * nDstPitch + (nWidth_B >> nLogxRatio), nDstPitch,
+          src + ystart * nSrcPitch + (nWidth_B >> nLogxRatio), nSrcPitch,
+          (nWidth - nWidth_B) >> nLogxRatio, yend - ystart);
+      }
+      if (isLimit)
+      {
+        LimitChanges(dst + ystart * nDstPitch, nDstPitch, src + ystart * nSrcPitch, nSrcPitch,
+          nWidth >> nLogxRatio, yend - ystart, nLimit);
+      }
+    };
+
+    if (!isOverlap)
+    {
+      forEachRow(nBlkY, [&](int by) {
+        int ystart, yend;
+        bandRows(by, ystart, yend);
+        procBlockRow(by, dst + ystart * nDstPitch, nullptr, nullptr);
+        finishBand(ystart, yend);
+      });
     }	// nOverlapX==0 && nOverlapY==0
 
     else // overlap
     {
-      const pixel_t* pSrcCur = src;
-
-      if (tmpBlock == nullptr) {
-        tmpBlock = std::unique_ptr<pixel_t[]>(
-          new pixel_t[MAX_BLOCK_SIZE * MAX_BLOCK_SIZE]);
-      }
-      pixel_t *pTmpBlock = tmpBlock.get();
-      const int tmpBlockPitch = nBlkSizeX;
-
       if (tmpDst == nullptr) {
         tmpDst = std::unique_ptr<tmp_t[]>(
           new tmp_t[params->nWidth * params->nHeight]);
       }
-      tmp_t *pTmpDst = tmpDst.get();
       const int tmpDstPitch = nWidth;
 
-      MemZoneSet<tmp_t>(pTmpDst, tmpDstPitch, 0, nWidth_B >> nLogxRatio, nHeight_B >> nLogyRatio);
-
       const short *winOverBase = OverWins->GetWindow(env);
 
-      for (int by = 0; by < nBlkY; by++)
-      {
-        int xx = 0;
-        int wby = ((by + nBlkY - 3) / (nBlkY - 2)) * 3;
-        for (int bx = 0; bx < nBlkX; bx++)
-        {
-          // select window
-          int wbx = (bx + nBlkX - 3) / (nBlkX - 2);
-          const short *winOver = winOverBase + (wby + wbx) * OverWins->GetSize();
-
-          const pixel_t * pB[MAX_DEGRAIN], *pF[MAX_DEGRAIN];
-          int WSrc;
-          int WRefB[MAX_DEGRAIN], WRefF[MAX_DEGRAIN];
-
-#if 0
-          if (nLogxRatio && (bx == 13 || bx == 14) && by == 0) {
-            printf("CPU:%d\n", pTmpBlock[5]);
-          }
-#endif
-          for (int j = 0; j < delta; j++) {
-            use_block(pB[j], WRefB[j], isUsableB[j], *mvClipB[j], bx, by, pPlanesB[j], pDummyPlane, thSAD, nLogxRatio, nLogyRatio, nPel);
-            use_block(pF[j], WRefF[j], isUsableF[j], *mvClipF[j], bx, by, pPlanesF[j], pDummyPlane, thSAD, nLogxRatio, nLogyRatio, nPel);
-          }
-
-          NORMWEIGHTS(WSrc, WRefB, WRefF);
-
-          DEGRAIN(pTmpBlock, tmpBlockPitch, pSrcCur + xx, nSrcPitch,
-            pB, pF, nSuperPitch, WSrc, WRefB, WRefF);
-
-          OVERLAP(pTmpDst + xx, tmpDstPitch, pTmpBlock, tmpBlockPitch, winOver, nBlkSizeX >> nLogxRatio);
-#if 0
-          if (nLogxRatio && (bx == 13 || bx == 14) && by == 0) {
-            printf("CPU:%d,%d\n", tmpDst.get()[57], src[57]);
-          }
-#endif
-          xx += ((nBlkSizeX - nOverlapX) >> nLogxRatio);
-        }	// for bx
-
-        pSrcCur += ((nBlkSizeY - nOverlapY) >> nLogyRatio) * nSrcPitch;
-        pTmpDst += ((nBlkSizeY - nOverlapY) >> nLogyRatio) * tmpDstPitch;
-      }	// for by
-
-      Short2Bytes(dst, nDstPitch, tmpDst.get(), tmpDstPitch, nWidth_B >> nLogxRatio, nHeight_B >> nLogyRatio, nBitsPerPixel);
-
-      if (nWidth_B < nWidth)
-      {
-        Copy(dst + (nWidth_B >> nLogxRatio),
-          nDstPitch, src + (nWidth_B >> nLogxRatio), nSrcPitch,
-          (nWidth - nWidth_B) >> nLogxRatio, nHeight_B >> nLogyRatio);
-      }
-      if (nHeight_B < nHeight) // bottom noncovered region
-      {
-        Copy(dst + (nHeight_B*nDstPitch >> nLogyRatio), nDstPitch,
-          src + (nHeight_B*nSrcPitch >> nLogyRatio), nSrcPitch,
-          (nWidth >> nLogxRatio), (nHeight - nHeight_B) >> nLogyRatio);
+      // ubNsbyby+1nOverlapYstmpDstdȂ̂ŁAsƊsɕď
+      // (nOverlapY <= nBlkSizeY/2 Ȃ̂byby+2͏dȂȂ)
+      // ޒl̓ubNƂɊۂߍς݂̐Ȃ̂ŁAԂςĂʂ͒ƈv
+      forEachRow(nBlkY, [&](int by) {
+        int ystart, yend;
+        bandRows(by, ystart, yend);
+        MemZoneSet<tmp_t>(tmpDst.get() + ystart * tmpDstPitch, tmpDstPitch, 0, nWidth_B >> nLogxRatio, yend - ystart);
+      });
+      for (int phase = 0; phase < 2; ++phase) {
+        forEachRow((nBlkY - phase + 1) / 2, [&](int i) {
+          pixel_t tmpBlock[MAX_BLOCK_SIZE * MAX_BLOCK_SIZE];
+          procBlockRow(i * 2 + phase, nullptr, tmpBlock, winOverBase);
+        });
       }
+      forEachRow(nBlkY, [&](int by) {
+        int ystart, yend;
+        bandRows(by, ystart, yend);
+        Short2Bytes(dst + ystart * nDstPitch, nDstPitch, tmpDst.get() + ystart * tmpDstPitch, tmpDstPitch,
+          nWidth_B >> nLogxRatio, yend - ystart, nBitsPerPixel);
+        finishBand(ystart, yend);
+      });
     }	// overlap - end
 
-    if (nLimit < (1 << nBitsPerPixel) - 1)
+    if (nHeight_B < nHeight) // bottom noncovered region
     {
-      LimitChanges(dst, nDstPitch, src, nSrcPitch, nWidth >> nLogxRatio, nHeight >> nLogyRatio, nLimit);
+      Copy(dst + (nHeight_B*nDstPitch >> nLogyRatio), nDstPitch,
+        src + (nHeight_B*nSrcPitch >> nLogyRatio), nSrcPitch,
+        (nWidth >> nLogxRatio), (nHeight - nHeight_B) >> nLogyRatio);
+      // Rs[Ȃ̂nLimit͕̏sv
     }
   }
 };
@@ -4401,7 +5025,7 @@ class KMDegrainX : public GenericVideoFilter
   std::unique_ptr<KMSuperFrame> superF[MAX_DEGRAIN];
 
   KMDegrainCoreBase* CreateCore(
-    bool isUV, int nLimit,
+    bool isUV, int nLimit, bool mt,
     KMVClip* mvClipB[MAX_DEGRAIN],
     KMVClip* mvClipF[MAX_DEGRAIN],
     PNeoEnv env)
@@ -4410,10 +5034,10 @@ class KMDegrainX : public GenericVideoFilter
     const OverlapWindows* wins = (isUV ? OverWinsUV : OverWins).get();
 
     if (params->nPixelSize == 1) {
-      return new KMDegrainCore<uint8_t>(params, delta, isUV, th, nLimit, mvClipB, mvClipF, wins, env);
+      return new KMDegrainCore<uint8_t>(params, delta, isUV, th, nLimit, mt, mvClipB, mvClipF, wins, env);
     }
     else {
-      return new KMDegrainCore<uint16_t>(params, delta, isUV, th, nLimit, mvClipB, mvClipF, wins, env);
+      return new KMDegrainCore<uint16_t>(params, delta, isUV, th, nLimit, mt, mvClipB, mvClipF, wins, env);
     }
   }
 
@@ -4519,14 +5143,10 @@ class KMDegrainX : public GenericVideoFilter
     int nBlkY = params->levelInfo[0].nBlkY;
 
     // tmpm
-    VideoInfo tmpvi = { 0 };
-    // 420OAtmp2{̃TCY
-    // nSrcPitchY < nSrcPitchUV * 2 ̉\̂Œ
-    //i傫Ԃɂ͌vZȂ̂ŃRŎgj
-    tmpvi.width = (nSrcPitchUV * 2) * 2;
-    tmpvi.height = vi.height;
-    tmpvi.pixel_type = vi.pixel_type;
-    PVideoFrame tmp = env->NewVideoFrame(tmpvi);
+    // 420OAtmpsrcƓpitchtmp_ti2{̃TCYj
+    int tmpBytesY = sizeof(tmp_t) * nSrcPitchY * vi.height;
+    int tmpBytesUV = sizeof(tmp_t) * nSrcPitchUV * (vi.height >> 1);
+    ScratchBuffer tmp(tmpBytesY + tmpBytesUV * 2, env);
 
     // [Nm
     int degrainBlock;
@@ -4535,14 +5155,9 @@ class KMDegrainX : public GenericVideoFilter
     int blockBytes = degrainBlock * nBlkX * nBlkY;
     int argBytes = degrainArg * 3;
     int scBytes = delta * 2 * sizeof(int);
-    int work_bytes = blockBytes + argBytes + scBytes;
-    VideoInfo workvi = VideoInfo();
-    workvi.pixel_type = VideoInfo::CS_BGR32;
-    workvi.width = 2048;
-    workvi.height = nblocks(work_bytes, workvi.width * 4);
-    PVideoFrame work = env->NewVideoFrame(workvi);
-
-    uint8_t* degrainblock = work->GetWritePtr();
+    ScratchBuffer work(blockBytes + argBytes + scBytes, env);
+
+    uint8_t* degrainblock = work.GetWritePtr();
     uint8_t* degrainarg = degrainblock + blockBytes;
     int* sceneChange = (int*)(degrainarg + argBytes);
 
@@ -4583,9 +5198,9 @@ class KMDegrainX : public GenericVideoFilter
     pdst[1] = reinterpret_cast<pixel_t*>(dst->GetWritePtr(PLANAR_U));
     pdst[2] = reinterpret_cast<pixel_t*>(dst->GetWritePtr(PLANAR_V));
 
-    ptmp[0] = reinterpret_cast<tmp_t*>(tmp->GetWritePtr(PLANAR_Y));
-    ptmp[1] = reinterpret_cast<tmp_t*>(tmp->GetWritePtr(PLANAR_U));
-    ptmp[2] = reinterpret_cast<tmp_t*>(tmp->GetWritePtr(PLANAR_V));
+    ptmp[0] = reinterpret_cast<tmp_t*>(tmp.GetWritePtr());
+    ptmp[1] = reinterpret_cast<tmp_t*>(tmp.GetWritePtr() + tmpBytesY);
+    ptmp[2] = reinterpret_cast<tmp_t*>(tmp.GetWritePtr() + tmpBytesY + tmpBytesUV);
 
     const KMPlane<pixel_t>* pSrcYPlane = 0;
     const KMPlane<pixel_t>* pSrcUPlane = 0;
@@ -4638,7 +5253,7 @@ public:
     bool _mt_flag, int _delta, bool binomial, int useFlag, PNeoEnv env)
     : GenericVideoFilter(child)
     , params(KMVParam::GetParam(mvbw->GetVideoInfo(), env))
-    , cuda(CreateKDeintCUDA())
+    , cuda(CreateKDeintCUDA(KMVParam::GetParam(super->GetVideoInfo(), env)->cpuKernel))
     , delta(_delta)
     , binomial(binomial)
     , useFlag(useFlag)
@@ -4688,9 +5303,9 @@ public:
     }
 
     core = std::unique_ptr<KMDegrainCoreBase>(
-      CreateCore(false, _nLimit, pmvClipB, pmvClipF, env));
+      CreateCore(false, _nLimit, _mt_flag, pmvClipB, pmvClipF, env));
     coreUV = std::unique_ptr<KMDegrainCoreBase>(
-      CreateCore(true, _nLimitC, pmvClipB, pmvClipF, env));
+      CreateCore(true, _nLimitC, _mt_flag, pmvClipB, pmvClipF, env));
   }
 
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env_)
@@ -4704,8 +5319,7 @@ public:
     if (useFlag != USE_ONLY_AFTER) {
       for (int j = delta - 1; j >= 0; j--) {
         mvF[j] = rawClipF[j]->GetFrame(n, env);
-        bool isValid = mvF[j]->GetProperty(GetAnalyzeValidPropName())->GetInt() != 0;
-        mvClipF[j]->SetData(reinterpret_cast<const VECTOR*>(mvF[j]->GetReadPtr()), isValid);
+        mvClipF[j]->SetFrame(mvF[j], env);
         refF[j] = mvClipF[j]->GetRefFrame(isUsableF[j], super, n, env);
         SetSuperFrameTarget(superF[j].get(), refF[j], params->nPixelShift);
       }
@@ -4718,8 +5332,7 @@ public:
     if (useFlag != USE_ONLY_BEFORE) {
       for (int j = 0; j < delta; j++) {
         mvB[j] = rawClipB[j]->GetFrame(n, env);
-        bool isValid = mvB[j]->GetProperty(GetAnalyzeValidPropName())->GetInt() != 0;
-        mvClipB[j]->SetData(reinterpret_cast<const VECTOR*>(mvB[j]->GetReadPtr()), isValid);
+        mvClipB[j]->SetFrame(mvB[j], env);
         refB[j] = mvClipB[j]->GetRefFrame(isUsableB[j], super, n, env);
         SetSuperFrameTarget(superB[j].get(), refB[j], params->nPixelShift);
       }
@@ -4732,7 +5345,7 @@ public:
     }
 #endif
 
-    if (IS_CUDA) {
+    if (cuda->IsEnabled()) {
       if (params->nPixelSize == 1) {
         return ProcCUDA<uint8_t>(n, env, isUsableB, isUsableF);
       }
@@ -4829,7 +5442,7 @@ public:
       true,  // isse
       false, // planar
       false, // lsb
-      true,  // mt
+      args[13 + param_index_shift].AsBool(true),  // mt
       delta,
       args[11 + param_index_shift].AsBool(false),    // binomial
       args[12 + param_index_shift].AsInt(0),    // useFlag
@@ -5149,26 +5762,17 @@ class KMCompensate : public GenericVideoFilter
     int nBlkY = params->levelInfo[0].nBlkY;
 
     // tmpm
-    VideoInfo tmpvi = { 0 };
-    // 420OAtmp2{̃TCY
-    // nSrcPitchY < nSrcPitchUV * 2 ̉\̂Œ
-    //i傫Ԃɂ͌vZȂ̂ŃRŎgj
-    tmpvi.width = (nSrcPitchUV * 2) * 2;
-    tmpvi.height = vi.height;
-    tmpvi.pixel_type = vi.pixel_type;
-    PVideoFrame tmp = env->NewVideoFrame(tmpvi);
+    // 420OAtmpsrcƓpitchtmp_ti2{̃TCYj
+    int tmpBytesY = sizeof(tmp_t) * nSrcPitchY * vi.height;
+    int tmpBytesUV = sizeof(tmp_t) * nSrcPitchUV * (vi.height >> 1);
+    ScratchBuffer tmp(tmpBytesY + tmpBytesUV * 2, env);
 
     // [Nm
     int blockBytes = cuda->get(pixel_t())->GetCompensateStructSize() * nBlkX * nBlkY;
     int scBytes = sizeof(int);
-    int work_bytes = blockBytes + scBytes;
-    VideoInfo workvi = VideoInfo();
-    workvi.pixel_type = VideoInfo::CS_BGR32;
-    workvi.width = 2048;
-    workvi.height = nblocks(work_bytes, workvi.width * 4);
-    PVideoFrame work = env->NewVideoFrame(workvi);
-
-    uint8_t* compensateblock = work->GetWritePtr();
+    ScratchBuffer work(blockBytes + scBytes, env);
+
+    uint8_t* compensateblock = work.GetWritePtr();
     int* sceneChange = (int*)(compensateblock + blockBytes);
 
     const pixel_t *pref[3 * 2] = { 0 };
@@ -5202,9 +5806,9 @@ class KMCompensate : public GenericVideoFilter
     pdst[1] = reinterpret_cast<pixel_t*>(dst->GetWritePtr(PLANAR_U));
     pdst[2] = reinterpret_cast<pixel_t*>(dst->GetWritePtr(PLANAR_V));
 
-    ptmp[0] = reinterpret_cast<tmp_t*>(tmp->GetWritePtr(PLANAR_Y));
-    ptmp[1] = reinterpret_cast<tmp_t*>(tmp->GetWritePtr(PLANAR_U));
-    ptmp[2] = reinterpret_cast<tmp_t*>(tmp->GetWritePtr(PLANAR_V));
+    ptmp[0] = reinterpret_cast<tmp_t*>(tmp.GetWritePtr());
+    ptmp[1] = reinterpret_cast<tmp_t*>(tmp.GetWritePtr() + tmpBytesY);
+    ptmp[2] = reinterpret_cast<tmp_t*>(tmp.GetWritePtr() + tmpBytesY + tmpBytesUV);
 
     const VECTOR *mv = mvClip->GetVectors(0);
 
@@ -5247,7 +5851,7 @@ public:
   )
     : GenericVideoFilter(_child)
     , params(KMVParam::GetParam(vectors->GetVideoInfo(), env))
-    , cuda(CreateKDeintCUDA())
+    , cuda(CreateKDeintCUDA(KMVParam::GetParam(_super->GetVideoInfo(), env)->cpuKernel))
     , super(_super)
     , vectors(vectors)
   {
@@ -5307,8 +5911,7 @@ public:
     SetSuperFrameTarget(superFrame[0].get(), ref0, params->nPixelShift);
 
     PVideoFrame mv = vectors->GetFrame(n, env);
-    bool isValid = mv->GetProperty(GetAnalyzeValidPropName())->GetInt() != 0;
-    mvClip->SetData(reinterpret_cast<const VECTOR*>(mv->GetReadPtr()), isValid);
+    mvClip->SetFrame(mv, env);
     PVideoFrame	ref = mvClip->GetRefFrame(usable_flag, super, n, env);
     SetSuperFrameTarget(superFrame[1].get(), ref, params->nPixelShift);
 
@@ -5323,7 +5926,7 @@ public:
     }
 #endif
 
-    if (IS_CUDA) {
+    if (cuda->IsEnabled()) {
       if (params->nPixelSize == 1) {
         return ProcCUDA<uint8_t>(n, env);
       }
@@ -5369,20 +5972,20 @@ public:
 
 void AddFuncMV(IScriptEnvironment* env)
 {
-  env->AddFunction("KMSuper", "c[hpad]i[vpad]i[pel]i[levels]i[chroma]b[sharp]i[filter]i", KMSuper::Create, 0);
+  env->AddFunction("KMSuper", "c[hpad]i[vpad]i[pel]i[levels]i[chroma]b[sharp]i[filter]i[cpukernel]b[mt]b", KMSuper::Create, 0);
 
   env->AddFunction("KMPartialSuper", "c[drop]i", KMPartialSuper::Create, 0);
 
   env->AddFunction("KMAnalyse",
-    "c[blksize]i[overlap]i[search]i[isb]b[chroma]b[delta]i[lambda]i[lsad]i[global]b[plevel]i[pnew]i[meander]b[partial]c[batch]i",
+    "c[blksize]i[overlap]i[search]i[isb]b[chroma]b[delta]i[lambda]i[lsad]i[global]b[plevel]i[pnew]i[meander]b[partial]c[batch]i[mt]b[cache]s[compact]b[stats]b[adaptive]i",
     KMAnalyse::Create, 0);
 
   env->AddFunction("KMDegrain1",
-    "cccc[thSAD]i[thSADC]i[plane]i[limit]i[limitC]i[thSCD1]i[thSCD2]i[binomial]b[useFlag]i",
+    "cccc[thSAD]i[thSADC]i[plane]i[limit]i[limitC]i[thSCD1]i[thSCD2]i[binomial]b[useFlag]i[mt]b",
     KMDegrainX::Create, (void *)1);
 
   env->AddFunction("KMDegrain2",
-    "cccccc[thSAD]i[thSADC]i[plane]i[limit]i[limitC]i[thSCD1]i[thSCD2]i[binomial]b[useFlag]i",
+    "cccccc[thSAD]i[thSADC]i[plane]i[limit]i[limitC]i[thSCD1]i[thSCD2]i[binomial]b[useFlag]i[mt]b",
     KMDegrainX::Create, (void *)2);
 
   env->AddFunction("KMCompensate",
@@ -5393,6 +5996,8 @@ void AddFuncMV(IScriptEnvironment* env)
   env->AddFunction("KMAnalyzeCheck", "[kmanalyze]c[mvanalyze]c[view]c", KMAnalyzeCheck::Create, 0);
   env->AddFunction("KMAnalyzeCheck2", "[kmanalyze1]c[kmanalyze2]c[view]c", KMAnalyzeCheck2::Create, 0);
 
+  env->AddFunction("KMSADBench", "[bits]i[iterations]i", KMSADBench, 0);
+
   env->AddFunction("KMVReplaceWithMV", "[kmv]c[mvv]c", KMVReplaceWithMV::Create, 0);
   env->AddFunction("MVReplaceWithKMV", "[mvv]c[kmv]c", MVReplaceWithKMV::Create, 0);
 }
@@ -0,0 +1,187 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "avisynth.h"
+
+#define NOMINMAX
+#include <windows.h>
+
+#include <atomic>
+#include <cstring>
+
+#include "MVCache.h"
+
+struct KMVCacheFile::Header
+{
+  enum {
+    MAGIC = 0x43564D4B, // "KMVC"
+    VERSION = 1,
+  };
+  uint32_t magic;
+  uint32_t version;
+  uint64_t paramHash;
+  int32_t numFrames;
+  int32_t frameBytes;
+  KMVParam param;
+};
+
+static size_t align_up(size_t v, size_t a) {
+  return (v + a - 1) / a * a;
+}
+
+KMVCacheFile::KMVCacheFile(const std::string& path, const KMVParam& param, uint64_t paramHash,
+  int numFrames, int frameBytes, PNeoEnv env)
+  : hFile(INVALID_HANDLE_VALUE)
+  , hMapping(NULL)
+  , base(nullptr)
+  , keys(nullptr)
+  , data(nullptr)
+  , numFrames(numFrames)
+  , frameBytes(frameBytes)
+  , slotBytes(align_up(frameBytes, 64))
+{
+  char hashstr[32];
+  sprintf(hashstr, "_%016llx.kmvcache", (unsigned long long)paramHash);
+  std::string filename = path + hashstr;
+
+  const size_t keysOffset = align_up(sizeof(Header), 64);
+  const size_t dataOffset = align_up(keysOffset + sizeof(uint64_t) * numFrames, 4096);
+  const size_t fileSize = dataOffset + slotBytes * numFrames;
+
+  // CX^XivZXj瓯ɊJ悤ɂ
+  hFile = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE,
+    FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hFile == INVALID_HANDLE_VALUE) {
+    env->ThrowError("KMAnalyse: failed to open cache file %s", filename.c_str());
+  }
+
+  LARGE_INTEGER curSize;
+  GetFileSizeEx(hFile, &curSize);
+  bool sizeMatch = ((size_t)curSize.QuadPart == fileSize);
+
+  // TCYႤt@C͍蒼iTCY0̐VKt@C܂ށj
+  if (!sizeMatch) {
+    LARGE_INTEGER newSize;
+    newSize.QuadPart = (LONGLONG)fileSize;
+    if (!SetFilePointerEx(hFile, newSize, NULL, FILE_BEGIN) || !SetEndOfFile(hFile)) {
+      CloseHandle(hFile);
+      env->ThrowError("KMAnalyse: failed to resize cache file %s", filename.c_str());
+    }
+  }
+
+  hMapping = CreateFileMappingA(hFile, NULL, PAGE_READWRITE,
+    (DWORD)((uint64_t)fileSize >> 32), (DWORD)(fileSize & 0xFFFFFFFF), NULL);
+  if (hMapping == NULL) {
+    CloseHandle(hFile);
+    env->ThrowError("KMAnalyse: failed to map cache file %s", filename.c_str());
+  }
+  base = (uint8_t*)MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, fileSize);
+  if (base == nullptr) {
+    CloseHandle(hMapping);
+    CloseHandle(hFile);
+    env->ThrowError("KMAnalyse: failed to map cache file %s", filename.c_str());
+  }
+
+  keys = (uint64_t*)(base + keysOffset);
+  data = base + dataOffset;
+
+  Header* header = (Header*)base;
+  bool valid = sizeMatch &&
+    header->magic == Header::MAGIC &&
+    header->version == Header::VERSION &&
+    header->paramHash == paramHash &&
+    header->numFrames == numFrames &&
+    header->frameBytes == frameBytes &&
+    header->param.nVersion == KMVParam::VERSION;
+
+  if (!valid) {
+    //  magic͍Ōɏ
+    header->magic = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    memset(keys, 0, sizeof(uint64_t) * numFrames);
+    header->version = Header::VERSION;
+    header->paramHash = paramHash;
+    header->numFrames = numFrames;
+    header->frameBytes = frameBytes;
+    header->param = param;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = Header::MAGIC;
+  }
+}
+
+KMVCacheFile::~KMVCacheFile()
+{
+  if (base) {
+    UnmapViewOfFile(base);
+  }
+  if (hMapping) {
+    CloseHandle(hMapping);
+  }
+  if (hFile != INVALID_HANDLE_VALUE) {
+    CloseHandle(hFile);
+  }
+}
+
+bool KMVCacheFile::Read(int n, uint64_t key, void* dst) const
+{
+  if (n < 0 || n >= numFrames || key == 0) {
+    return false;
+  }
+  volatile uint64_t* pkey = &keys[n];
+  if (*pkey != key) {
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  memcpy(dst, data + slotBytes * n, frameBytes);
+  // Rs[ɑ̃CX^XĂ~X
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return *pkey == key;
+}
+
+void KMVCacheFile::Write(int n, uint64_t key, const void* src)
+{
+  if (n < 0 || n >= numFrames || key == 0) {
+    return;
+  }
+  volatile uint64_t* pkey = &keys[n];
+  // f[^ĂԂ͖ɂĂ
+  *pkey = 0;
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(data + slotBytes * n, src, frameBytes);
+  std::atomic_thread_fence(std::memory_order_release);
+  *pkey = key;
+}
+
+// 64bitPʂōȈՃnbViÍwIx͕svj
+static inline uint64_t hash_mix(uint64_t h, uint64_t v)
+{
+  v *= 0x87C37B91114253D5ULL;
+  v = (v << 31) | (v >> 33);
+  v *= 0x4CF5AD432745937FULL;
+  h ^= v;
+  h = (h << 27) | (h >> 37);
+  return h * 5 + 0x52DCE729;
+}
+
+uint64_t KMVCacheFile::Hash(uint64_t h, const void* ptr, size_t bytes)
+{
+  const uint8_t* p = (const uint8_t*)ptr;
+  size_t i = 0;
+  for (; i + 8 <= bytes; i += 8) {
+    uint64_t v;
+    memcpy(&v, p + i, 8);
+    h = hash_mix(h, v);
+  }
+  if (i < bytes) {
+    uint64_t v = 0;
+    memcpy(&v, p + i, bytes - i);
+    h = hash_mix(h, v);
+  }
+  return hash_mix(h, bytes);
+}
+
+uint64_t KMVCacheFile::HashPlane(uint64_t h, const uint8_t* ptr, int pitch, int rowSize, int height)
+{
+  for (int y = 0; y < height; ++y) {
+    h = Hash(h, ptr + (size_t)pitch * y, rowSize);
+  }
+  return h;
+}
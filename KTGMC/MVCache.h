@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include "KMV.h"
+
+// KMAnalysěʂt[Pʂŕۑ郁}bvgt@C
+// \[XAp[^ōēxKMAnalysesƂɒTȗ邽߂Ɏg
+// t@C\: Header(KMVParam܂) | t[Ƃ̃L[ | t[ƂVECTORz
+// L[0͖݂\
+class KMVCacheFile
+{
+public:
+  // path͊gqȂ̃x[XpXBp[^̃nbVt@Cɕt
+  KMVCacheFile(const std::string& path, const KMVParam& param, uint64_t paramHash,
+    int numFrames, int frameBytes, PNeoEnv env);
+  ~KMVCacheFile();
+
+  // L[vdstɃRs[true
+  bool Read(int n, uint64_t key, void* dst) const;
+  void Write(int n, uint64_t key, const void* src);
+
+  // L[vZpnbV
+  static uint64_t Hash(uint64_t h, const void* data, size_t bytes);
+  static uint64_t HashPlane(uint64_t h, const uint8_t* ptr, int pitch, int rowSize, int height);
+  // L[0ɂȂȂ悤ɂ
+  static uint64_t MakeKey(uint64_t h) { return h | 1; }
+
+private:
+  struct Header;
+
+  void* hFile;
+  void* hMapping;
+  uint8_t* base;
+  uint64_t* keys;
+  uint8_t* data;
+  int numFrames;
+  int frameBytes;
+  size_t slotBytes;
+};
@@ -1527,7 +1527,7 @@ __global__ void kl_write_default_mv(VECTOR* dst, int nBlkCount, int verybigSAD)
   if (x < nBlkCount) {
     dst[x].x = 0;
     dst[x].y = 0;
-    dst[x].x = verybigSAD;
+    dst[x].sad = verybigSAD;
   }
 }
 
@@ -1538,7 +1538,7 @@ __global__ void kl_init_const_vec(short2* vectors, int vectorsPitch, const short
     vectors[-2] = short2();
   }
   else {
-    short2 g = *globalMV;
+    short2 g = globalMV[blockIdx.y];
     short2 c = { short(g.x * nPel), short(g.y * nPel) };
     vectors[-1] = c;
   }
@@ -3061,21 +3061,40 @@ class IMVCUDAImpl : public IMVCUDA
   KDeintKernel<uint8_t> k8;
   KDeintKernel<uint16_t> k16;
 
+  // CUDAłȂƂɎgCPUicpukernel=truêƂj
+  std::unique_ptr<IKDeintKernelCPU<uint8_t>> c8;
+  std::unique_ptr<IKDeintKernelCPU<uint16_t>> c16;
+
 public:
+  IMVCUDAImpl(bool cpukernel) {
+    if (cpukernel) {
+      c8 = std::unique_ptr<IKDeintKernelCPU<uint8_t>>(CreateKDeintKernelCPU<uint8_t>());
+      c16 = std::unique_ptr<IKDeintKernelCPU<uint16_t>>(CreateKDeintKernelCPU<uint16_t>());
+    }
+  }
+
   virtual void SetEnv(PNeoEnv env) {
     k8.SetEnv(env);
     k16.SetEnv(env);
+    if (c8) {
+      c8->SetEnv(env);
+      c16->SetEnv(env);
+    }
   }
 
   virtual bool IsEnabled() const {
-    return k8.IsEnabled();
+    return k8.IsEnabled() || (c8 && c8->IsEnabled());
   }
 
-  virtual IKDeintKernel<uint8_t>* get(uint8_t) { return &k8; }
-  virtual IKDeintKernel<uint16_t>* get(uint16_t) { return &k16; }
+  virtual IKDeintKernel<uint8_t>* get(uint8_t) {
+    return (k8.IsEnabled() || !c8) ? (IKDeintKernel<uint8_t>*)&k8 : c8.get();
+  }
+  virtual IKDeintKernel<uint16_t>* get(uint16_t) {
+    return (k16.IsEnabled() || !c16) ? (IKDeintKernel<uint16_t>*)&k16 : c16.get();
+  }
 };
 
-IMVCUDA* CreateKDeintCUDA()
+IMVCUDA* CreateKDeintCUDA(bool cpukernel)
 {
-  return new IMVCUDAImpl();
+  return new IMVCUDAImpl(cpukernel);
 }
@@ -85,13 +85,27 @@ public:
     void* _compensateblock, int* sceneChange) = 0;
 };
 
+// CUDAgȂƂCPU(AVX2)
+template <typename pixel_t>
+class IKDeintKernelCPU : public IKDeintKernel<pixel_t>
+{
+public:
+  virtual ~IKDeintKernelCPU() { }
+  virtual void SetEnv(PNeoEnv env) = 0;
+};
+
+template <typename pixel_t>
+IKDeintKernelCPU<pixel_t>* CreateKDeintKernelCPU();
+
 class IMVCUDA
 {
 public:
+  virtual ~IMVCUDA() { }
   virtual void SetEnv(PNeoEnv env) = 0;
   virtual bool IsEnabled() const = 0;
   virtual IKDeintKernel<uint8_t>* get(uint8_t) = 0;
   virtual IKDeintKernel<uint16_t>* get(uint16_t) = 0;
 };
 
-IMVCUDA* CreateKDeintCUDA();
+// cpukernel: CUDAłȂƂIKDeintKernelCPUg
+IMVCUDA* CreateKDeintCUDA(bool cpukernel = false);
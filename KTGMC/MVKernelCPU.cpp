@@ -0,0 +1,1081 @@
+#include "avisynth.h"
+
+#define NOMINMAX
+#include <windows.h>
+#include <cstdint>
+#include <climits>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include <immintrin.h>
+
+#include "CommonFunctions.h"
+#include "MVKernel.h"
+#include "SADFunctions.h"
+#include "ThreadPool.h"
+
+// IKDeintKernelCPU(AVX2)
+// ASYCUDA(MVKernel.cu)ƓŁAʂCUDAłƈv
+
+/////////////////////////////////////////////////////////////////////////////
+// 
+/////////////////////////////////////////////////////////////////////////////
+
+template <typename pixel_t>
+static void CopyPlane(pixel_t* dst, int dst_pitch, const pixel_t* src, int src_pitch, int width, int height)
+{
+  ThreadPool::GetInstance().ParallelRows(height, 32, [=](int ystart, int yend) {
+    for (int y = ystart; y < yend; ++y) {
+      memcpy(dst + y * dst_pitch, src + y * src_pitch, width * sizeof(pixel_t));
+    }
+  });
+}
+
+// pRef  ubNItZbg\߈ړĂ|C^
+// vx,vy  TusNZ܂߂xNg
+template <typename pixel_t>
+static const pixel_t* get_ref_block(const pixel_t* pRef, int nPitch, int nImgPitch, int nPel, int vx, int vy)
+{
+  if (nPel == 1) {
+    return &pRef[vx + vy * nPitch];
+  }
+  else if (nPel == 2) {
+    int si = (vx & 1) + (vy & 1) * 2;
+    return &pRef[(vx >> 1) + (vy >> 1) * nPitch + si * nImgPitch];
+  }
+  else { // nPel == 4
+    int si = (vx & 3) + (vy & 3) * 4;
+    return &pRef[(vx >> 2) + (vy >> 2) * nPitch + si * nImgPitch];
+  }
+}
+
+static __forceinline __m256i load8_epi32(const uint8_t* p) {
+  return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p));
+}
+static __forceinline __m256i load8_epi32(const uint16_t* p) {
+  return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p));
+}
+static __forceinline __m256i load8_epi32(const short* p) {
+  return _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)p));
+}
+
+// tmpւ̉Z 8bit: (val * win + 256) >> 6 16bitő
+static __forceinline void add_tmp8(unsigned short* tmp, __m256i val, __m256i win) {
+  __m256i t = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(val, win), _mm256_set1_epi32(256)), 6);
+  __m128i t16 = _mm_packus_epi32(_mm256_castsi256_si128(t), _mm256_extracti128_si256(t, 1));
+  _mm_storeu_si128((__m128i*)tmp, _mm_add_epi16(_mm_loadu_si128((const __m128i*)tmp), t16));
+}
+// 16bit: val * win 32bitő
+static __forceinline void add_tmp8(int* tmp, __m256i val, __m256i win) {
+  __m256i t = _mm256_mullo_epi32(val, win);
+  _mm256_storeu_si256((__m256i*)tmp, _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)tmp), t));
+}
+
+// I[o[bv|tmpɑ
+// val = (src * WSrc +  ref * WRef + round) >> 8
+// QƂnRef܂łŁAd0̎QƂ͌ĂяoŏĂ
+template <typename pixel_t, typename tmp_t>
+static void AccumulateBlock(
+  tmp_t* pTmp, int nPitch, const pixel_t* pSrc, int nSrcPitch, int WSrc,
+  const pixel_t* const* pRef, const int* WRef, int nRef, int nPitchSuper,
+  const short* winOver, int nBlkSize)
+{
+  const int round = (sizeof(pixel_t) == 1) ? 128 : 0;
+  const int nBlkSize8 = nBlkSize & ~7;
+  const __m256i vround = _mm256_set1_epi32(round);
+
+  for (int y = 0; y < nBlkSize; ++y) {
+    const pixel_t* src = pSrc + y * nSrcPitch;
+    const short* win = winOver + y * nBlkSize;
+    tmp_t* tmp = pTmp + y * nPitch;
+    int offS = y * nPitchSuper;
+
+    for (int x = 0; x < nBlkSize8; x += 8) {
+      __m256i val = _mm256_mullo_epi32(load8_epi32(src + x), _mm256_set1_epi32(WSrc));
+      for (int i = 0; i < nRef; ++i) {
+        val = _mm256_add_epi32(val, _mm256_mullo_epi32(load8_epi32(pRef[i] + offS + x), _mm256_set1_epi32(WRef[i])));
+      }
+      val = _mm256_srai_epi32(_mm256_add_epi32(val, vround), 8);
+      add_tmp8(tmp + x, val, load8_epi32(win + x));
+    }
+    // 4x4ubNi8x8̐Fj͂
+    for (int x = nBlkSize8; x < nBlkSize; ++x) {
+      int val = src[x] * WSrc;
+      for (int i = 0; i < nRef; ++i) {
+        val += pRef[i][offS + x] * WRef[i];
+      }
+      val = (val + round) >> 8;
+      if (sizeof(pixel_t) == 1)
+        tmp[x] += (val * win[x] + 256) >> 6; // shift 5 in Short2Bytes<uint8_t> in overlap.cpp
+      else
+        tmp[x] += val * win[x]; // shift (5+6); in Short2Bytes16
+    }
+  }
+}
+
+// I[o[bv̂ubNɑ
+// ubN̏c̏dȂ1ׂ̍s܂łȂ̂ŁAsƊsɕ΍sƂɕɏł
+template <typename F>
+static void ParallelBlockRows(int nBlkY, const F& f)
+{
+  ThreadPool& pool = ThreadPool::GetInstance();
+  for (int phase = 0; phase < 2; ++phase) {
+    int nrows = (nBlkY - phase + 1) / 2;
+    pool.ParallelFor(nrows, [&](int i) { f(i * 2 + phase); });
+  }
+}
+
+template <typename pixel_t, typename tmp_t>
+static void TmpToPixel(pixel_t* dst, const tmp_t* tmp, int width, int height, int pitch, int max_pixel_value)
+{
+  const int shift = (sizeof(pixel_t) == 1) ? 5 : (5 + 6);
+  ThreadPool::GetInstance().ParallelRows(height, 32, [=](int ystart, int yend) {
+    for (int y = ystart; y < yend; ++y) {
+      for (int x = 0; x < width; ++x) {
+        dst[x + y * pitch] = (pixel_t)std::min((int)tmp[x + y * pitch] >> shift, max_pixel_value);
+      }
+    }
+  });
+}
+
+template <typename tmp_t>
+static void ZeroTmp(tmp_t* tmp, int width, int height, int pitch)
+{
+  ThreadPool::GetInstance().ParallelRows(height, 32, [=](int ystart, int yend) {
+    for (int y = ystart; y < yend; ++y) {
+      memset(tmp + y * pitch, 0, width * sizeof(tmp_t));
+    }
+  });
+}
+
+static int CountSceneChange(const VECTOR* mv, int nBlks, int nTh1)
+{
+  int s = 0;
+  for (int i = 0; i < nBlks; ++i) {
+    s += (mv[i].sad > nTh1) ? 1 : 0;
+  }
+  return s;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// SearchMV
+/////////////////////////////////////////////////////////////////////////////
+
+// CUDAłSearchBlockƓe
+struct SearchBlockCPU {
+  // nDxMax, nDyMax, nDxMin, nDyMin iMaxMax-1ɂĂj
+  int rect[4];
+  // zero, global, predictor, left, up, bottom-right(from coarse level) vectors̃CfbNX
+  int ref[6];
+  // predictor  x, y
+  int predx, predy;
+  // penaltyZero, penaltyGlobal, 0(penaltyPredictor), penaltyNew
+  int penalties[4];
+  int lambda;
+};
+
+struct CostResultCPU {
+  int cost;
+  short2 xy;
+};
+
+static void clip_mv(short2& v, const int* rect)
+{
+  v.x = (v.x > rect[0]) ? rect[0] : (v.x < rect[2]) ? rect[2] : v.x;
+  v.y = (v.y > rect[1]) ? rect[1] : (v.y < rect[3]) ? rect[3] : v.y;
+}
+
+static bool check_mv(int x, int y, const int* rect)
+{
+  return (x <= rect[0]) & (y <= rect[1]) & (x >= rect[2]) & (y >= rect[3]);
+}
+
+static int sq_norm(int ax, int ay, int bx, int by) {
+  return (ax - bx) * (ax - bx) + (ay - by) * (ay - by);
+}
+
+static short median3(short a, short b, short c) {
+  return std::min(std::max(std::min(a, b), c), std::max(a, b));
+}
+
+static const short2 CPU_EXPAND1[] = {
+  { 0, -1 },{ 0, 1 },{ -1, 0 },{ 1, 0 },
+  { -1, -1 },{ -1, 1 },{ 1, -1 },{ 1, 1 }
+};
+static const short2 CPU_EXPAND2[] = {
+  { -1, -2 },{ -1, 2 },{ 0, -2 },{ 0, 2 },{ 1, -2 },{ 1, 2 },
+  { -2, -1 },{ 2, -1 },{ -2, 0 },{ 2, 0 },{ -2, 1 },{ 2, 1 },
+  { -2, -2 },{ -2, 2 },{ 2, -2 },{ 2, 2 }
+};
+static const short2 CPU_HEX2[] = {
+  { -2, 0 },{ -1, 2 },{ 1, 2 },{ 2, 0 },{ 1, -2 },{ -1, -2 }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// DEGRAIN, COMPENSATE
+/////////////////////////////////////////////////////////////////////////////
+
+enum {
+  // CUDAłƓN=2܂
+  DEGRAIN_MAX_N = 2
+};
+
+template <typename pixel_t>
+struct DegrainBlockCPU {
+  const short *winOver;
+  int nRef;
+  int WSrc;
+  // d݂0łȂQƂl߂ē
+  const pixel_t *pRef[DEGRAIN_MAX_N * 2];
+  int WRef[DEGRAIN_MAX_N * 2];
+};
+
+template <typename pixel_t>
+struct CompensateBlockCPU {
+  const short *winOver;
+  const pixel_t *pRef;
+};
+
+static int degrain_weight(int thSAD, int blockSAD)
+{
+  // Returning directly prevents a divide by 0 if thSAD == blockSAD == 0.
+  if (thSAD <= blockSAD)
+  {
+    return 0;
+  }
+  const float sq_thSAD = float(thSAD) * float(thSAD);
+  const float sq_blockSAD = float(blockSAD) * float(blockSAD);
+  return (int)(256.0f*(sq_thSAD - sq_blockSAD) / (sq_thSAD + sq_blockSAD));
+}
+
+// binomialN=2܂
+static void norm_weights(int N, bool binomial, int &WSrc, int *WRefB, int *WRefF)
+{
+  WSrc = 256;
+  if (binomial) {
+    if (N == 1) {
+      WSrc *= 2;
+    }
+    else if (N == 2) {
+      WSrc *= 6;
+      WRefB[0] *= 4; WRefF[0] *= 4;
+    }
+  }
+  int WSum = WSrc + 1;
+  for (int i = 0; i < N; ++i) {
+    WSum += WRefB[i] + WRefF[i];
+  }
+  WSrc = 256;
+  for (int i = 0; i < N; ++i) {
+    WRefB[i] = WRefB[i] * 256 / WSum; // normalize weights to 256
+    WRefF[i] = WRefF[i] * 256 / WSum;
+    WSrc -= WRefB[i] + WRefF[i];
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// KDeintKernelCPU
+/////////////////////////////////////////////////////////////////////////////
+
+template <typename pixel_t>
+class KDeintKernelCPU : public IKDeintKernelCPU<pixel_t>
+{
+  typedef typename IKDeintKernel<pixel_t>::tmp_t tmp_t;
+
+  PNeoEnv env;
+
+  // SAD֐̓ubNTCYƂɃLbV
+  int sadBlkSize;
+  SADFunction<pixel_t> SAD, SADCHROMA;
+
+  static SADFunction<pixel_t> GetSADFunction(int nBlkSize) {
+    SADFunction<pixel_t> f = get_sad_avx2_func<pixel_t>(nBlkSize, nBlkSize);
+    if (f == nullptr) {
+      f = get_sad_sse41_func<pixel_t>(nBlkSize, nBlkSize);
+    }
+    return f;
+  }
+
+  void SetSADFunctions(int nBlkSize) {
+    if (sadBlkSize != nBlkSize) {
+      SAD = GetSADFunction(nBlkSize);
+      SADCHROMA = GetSADFunction(nBlkSize / 2);
+      if (SAD == nullptr || SADCHROMA == nullptr) {
+        env->ThrowError("[KDeintKernelCPU] ΉubNTCY");
+      }
+      sadBlkSize = nBlkSize;
+    }
+  }
+
+  struct SearchContext {
+    int nPel;
+    bool chroma;
+    int nPitchY, nPitchUV, nImgPitchY, nImgPitchUV;
+    const pixel_t *pSrcY, *pSrcU, *pSrcV;
+    const pixel_t *pRefY, *pRefU, *pRefV;
+  };
+
+  // pSrc,pRef́iubNʒu𑫂jubN̍
+  int CalcSAD(const SearchContext& c, int vx, int vy) const
+  {
+    int sad = SAD(c.pSrcY, c.nPitchY,
+      get_ref_block(c.pRefY, c.nPitchY, c.nImgPitchY, c.nPel, vx, vy), c.nPitchY);
+    if (c.chroma) {
+      sad += SADCHROMA(c.pSrcU, c.nPitchUV,
+        get_ref_block(c.pRefU, c.nPitchUV, c.nImgPitchUV, c.nPel, vx >> 1, vy >> 1), c.nPitchUV);
+      sad += SADCHROMA(c.pSrcV, c.nPitchUV,
+        get_ref_block(c.pRefV, c.nPitchUV, c.nImgPitchUV, c.nPel, vx >> 1, vy >> 1), c.nPitchUV);
+    }
+    return sad;
+  }
+
+  // ܂Ƃ߂ĕ]čŏRXgbest菬΍XV
+  void CheckCandidates(const SearchContext& c, const SearchBlockCPU& data,
+    const short2* area, int n, short2 center, CostResultCPU& best) const
+  {
+    CostResultCPU result = { INT_MAX, center };
+    for (int i = 0; i < n; ++i) {
+      int x = center.x + area[i].x;
+      int y = center.y + area[i].y;
+      int cost = (data.lambda * sq_norm(x, y, data.predx, data.predy)) >> 8;
+      if (check_mv(x, y, data.rect) && cost < best.cost) {
+        int sad = CalcSAD(c, x, y);
+        cost += sad + ((sad * data.penalties[3]) >> 8);
+        if (cost < result.cost) {
+          result.cost = cost;
+          result.xy.x = (short)x;
+          result.xy.y = (short)y;
+        }
+      }
+    }
+    if (result.cost < best.cost) {
+      best = result;
+    }
+  }
+
+  void SearchBlock(const SearchContext& c, const SearchBlockCPU& data,
+    int searchType, short2* vectors, int blkIdx) const
+  {
+    short2 vec[6];
+    for (int i = 0; i < 6; ++i) {
+      vec[i] = vectors[data.ref[i]];
+      clip_mv(vec[i], data.rect);
+    }
+
+    // zero, global, predictor, median, left, up, bottom-right
+    short2 pred[7] = { vec[0], vec[1], vec[2], {}, vec[3], vec[4], vec[5] };
+    pred[3].x = median3(vec[3].x, vec[4].x, vec[5].x);
+    pred[3].y = median3(vec[3].y, vec[4].y, vec[5].y);
+
+    CostResultCPU best = { INT_MAX, short2() };
+    for (int i = 0; i < 7; ++i) {
+      int cost = (data.lambda * sq_norm(pred[i].x, pred[i].y, data.predx, data.predy)) >> 8;
+      int sad = CalcSAD(c, pred[i].x, pred[i].y);
+      if (i < 3) {
+        cost = sad + ((sad * data.penalties[i]) >> 8);
+      }
+      else {
+        cost += sad;
+      }
+      if (cost < best.cost) {
+        best.cost = cost;
+        best.xy = pred[i];
+      }
+    }
+
+    if (searchType == 8) {
+      // exhaustive: expand1expand2\狁߂ʒu𒆐Sɂ
+      short2 center = best.xy;
+      CheckCandidates(c, data, CPU_EXPAND1, 8, center, best);
+      CheckCandidates(c, data, CPU_EXPAND2, 16, center, best);
+    }
+    else {
+      // hex2 -> expand1
+      CheckCandidates(c, data, CPU_HEX2, 6, best.xy, best);
+      CheckCandidates(c, data, CPU_EXPAND1, 8, best.xy, best);
+    }
+
+    vectors[blkIdx] = best.xy;
+  }
+
+public:
+  KDeintKernelCPU()
+    : sadBlkSize(0)
+    , SAD(nullptr)
+    , SADCHROMA(nullptr)
+  { }
+
+  void SetEnv(PNeoEnv env) {
+    this->env = env;
+  }
+
+  bool IsEnabled() const {
+    return env->GetDeviceType() == DEV_TYPE_CPU && (env->GetCPUFlags() & CPUF_AVX2) != 0;
+  }
+
+  void MemCpy(void* dst, const void* src, int nbytes)
+  {
+    memcpy(dst, src, nbytes);
+  }
+
+  void Copy(pixel_t* dst, int dst_pitch, const pixel_t* src, int src_pitch, int width, int height)
+  {
+    CopyPlane(dst, dst_pitch, src, src_pitch, width, height);
+  }
+
+  void PadFrame(pixel_t *ptr, int pitch, int hPad, int vPad, int width, int height)
+  {
+    // E
+    ThreadPool::GetInstance().ParallelRows(height, 32, [=](int ystart, int yend) {
+      for (int y = ystart; y < yend; ++y) {
+        pixel_t* row = ptr + (vPad + y) * pitch;
+        std::fill(row, row + hPad, row[hPad]);
+        std::fill(row + hPad + width, row + hPad * 2 + width, row[hPad + width - 1]);
+      }
+    });
+    // ㉺iẼpfBO݁j
+    int rowbytes = (width + hPad * 2) * sizeof(pixel_t);
+    const pixel_t* top = ptr + vPad * pitch;
+    const pixel_t* bottom = ptr + (vPad + height - 1) * pitch;
+    for (int y = 0; y < vPad; ++y) {
+      memcpy(ptr + y * pitch, top, rowbytes);
+      memcpy(ptr + (vPad + height + y) * pitch, bottom, rowbytes);
+    }
+  }
+
+  void VerticalWiener(
+    pixel_t *pDst, const pixel_t *pSrc, int nDstPitch,
+    int nSrcPitch, int nWidth, int nHeight, int bits_per_pixel)
+  {
+    const int max_pixel_value = (1 << bits_per_pixel) - 1;
+    ThreadPool::GetInstance().ParallelRows(nHeight, 16, [=](int ystart, int yend) {
+      for (int y = ystart; y < yend; ++y) {
+        const pixel_t* s = pSrc + y * nSrcPitch;
+        pixel_t* d = pDst + y * nDstPitch;
+        if (y < 2 || (y >= nHeight - 4 && y < nHeight - 1)) {
+          for (int x = 0; x < nWidth; ++x) {
+            d[x] = (s[x] + s[x + nSrcPitch] + 1) >> 1;
+          }
+        }
+        else if (y < nHeight - 4) {
+          for (int x = 0; x < nWidth; ++x) {
+            int v = (s[x - nSrcPitch * 2]
+              + (-(s[x - nSrcPitch]) + (s[x] << 2) + (s[x + nSrcPitch] << 2) - (s[x + nSrcPitch * 2])) * 5
+              + (s[x + nSrcPitch * 3]) + 16) >> 5;
+            d[x] = (pixel_t)std::min(std::max(v, 0), max_pixel_value);
+          }
+        }
+        else {
+          memcpy(d, s, nWidth * sizeof(pixel_t));
+        }
+      }
+    });
+  }
+
+  void HorizontalWiener(
+    pixel_t *pDst, const pixel_t *pSrc, int nDstPitch,
+    int nSrcPitch, int nWidth, int nHeight, int bits_per_pixel)
+  {
+    const int max_pixel_value = (1 << bits_per_pixel) - 1;
+    const int xb = std::min(2, nWidth);
+    const int xe = std::max(xb, nWidth - 4);
+    ThreadPool::GetInstance().ParallelRows(nHeight, 16, [=](int ystart, int yend) {
+      for (int y = ystart; y < yend; ++y) {
+        const pixel_t* s = pSrc + y * nSrcPitch;
+        pixel_t* d = pDst + y * nDstPitch;
+        for (int x = 0; x < xb; ++x) {
+          d[x] = (s[x] + s[x + 1] + 1) >> 1;
+        }
+        for (int x = xb; x < xe; ++x) {
+          int v = (s[x - 2] + (-(s[x - 1]) + (s[x] << 2) + (s[x + 1] << 2) - (s[x + 2])) * 5 + (s[x + 3]) + 16) >> 5;
+          d[x] = (pixel_t)std::min(std::max(v, 0), max_pixel_value);
+        }
+        for (int x = xe; x < nWidth - 1; ++x) {
+          d[x] = (s[x] + s[x + 1] + 1) >> 1;
+        }
+        if (nWidth - 1 >= xe) {
+          d[nWidth - 1] = s[nWidth - 1];
+        }
+      }
+    });
+  }
+
+  void RB2BilinearFiltered(
+    pixel_t *pDst, const pixel_t *pSrc, int nDstPitch, int nSrcPitch, int nWidth, int nHeight)
+  {
+    ThreadPool::GetInstance().ParallelRows(nHeight, 16, [=](int ystart, int yend) {
+      // ctB^1s
+      std::unique_ptr<pixel_t[]> tmp(new pixel_t[nWidth * 2]);
+      pixel_t* t = tmp.get();
+      for (int y = ystart; y < yend; ++y) {
+        const pixel_t* s = pSrc + y * 2 * nSrcPitch;
+        if (y < 1 || y >= nHeight - 1) {
+          for (int x = 0; x < nWidth * 2; ++x) {
+            t[x] = (s[x] + s[x + nSrcPitch] + 1) >> 1;
+          }
+        }
+        else {
+          for (int x = 0; x < nWidth * 2; ++x) {
+            t[x] = (s[x - nSrcPitch] + s[x] * 3 + s[x + nSrcPitch] * 3 + s[x + nSrcPitch * 2] + 4) / 8;
+          }
+        }
+        pixel_t* d = pDst + y * nDstPitch;
+        for (int x = 0; x < nWidth; ++x) {
+          if (x < 1 || x >= nWidth - 1) {
+            d[x] = (t[x * 2] + t[x * 2 + 1] + 1) >> 1;
+          }
+          else {
+            d[x] = (t[x * 2 - 1] + t[x * 2] * 3 + t[x * 2 + 1] * 3 + t[x * 2 + 2] + 4) / 8;
+          }
+        }
+      }
+    });
+  }
+
+  // Analyze //
+  int GetSearchBlockSize()
+  {
+    return sizeof(SearchBlockCPU);
+  }
+
+  int GetSearchBatchSize()
+  {
+    return 0;
+  }
+
+  void EstimateGlobalMV(int batch, const short2* vectors, int vectorsPitch, int nBlkCount, short2* globalMV)
+  {
+    enum {
+      FREQ_SIZE = 1024 * 8,
+      HALF_SIZE = FREQ_SIZE / 2
+    };
+    ThreadPool::GetInstance().ParallelFor(batch, [=](int b) {
+      const short2* v = vectors + b * vectorsPitch;
+      std::unique_ptr<int[]> freq(new int[FREQ_SIZE * 2]());
+      int* freqx = freq.get();
+      int* freqy = freq.get() + FREQ_SIZE;
+      for (int i = 0; i < nBlkCount; ++i) {
+        int x = v[i].x + HALF_SIZE;
+        int y = v[i].y + HALF_SIZE;
+        if (x >= 0 && x < FREQ_SIZE) freqx[x]++;
+        if (y >= 0 && y < FREQ_SIZE) freqy[y]++;
+      }
+      // ŕpliȂ珬قj
+      int medianx = (int)(std::max_element(freqx, freqx + FREQ_SIZE) - freqx) - HALF_SIZE;
+      int mediany = (int)(std::max_element(freqy, freqy + FREQ_SIZE) - freqy) - HALF_SIZE;
+
+      int meanvx = 0;
+      int meanvy = 0;
+      int num = 0;
+      for (int i = 0; i < nBlkCount; ++i) {
+        if (std::abs(v[i].x - medianx) < 6 && std::abs(v[i].y - mediany) < 6) {
+          meanvx += v[i].x;
+          meanvy += v[i].y;
+          num += 1;
+        }
+      }
+      if (num > 0) {
+        globalMV[b].x = 2 * meanvx / num;
+        globalMV[b].y = 2 * meanvy / num;
+      }
+      else {
+        globalMV[b].x = 2 * medianx;
+        globalMV[b].y = 2 * mediany;
+      }
+    });
+  }
+
+  void InterpolatePrediction(
+    int batch,
+    const short2* src_vector, int srcVectorPitch, const int* src_sad, int srcSadPitch,
+    short2* dst_vector, int dstVectorPitch, int* dst_sad, int dstSadPitch,
+    int nSrcBlkX, int nSrcBlkY, int nDstBlkX, int nDstBlkY,
+    int normFactor, int normov, int atotal, int aodd, int aeven)
+  {
+    ThreadPool::GetInstance().ParallelFor(batch, [=](int b) {
+      const short2* sv = src_vector + b * srcVectorPitch;
+      const int* ss = src_sad + b * srcSadPitch;
+      short2* dv = dst_vector + b * dstVectorPitch;
+      int* ds = dst_sad + b * dstSadPitch;
+
+      for (int y = 0; y < nDstBlkY; ++y) {
+        for (int x = 0; x < nDstBlkX; ++x) {
+          int i = std::min(x, 2 * nSrcBlkX - 1);
+          int j = std::min(y, 2 * nSrcBlkY - 1);
+          int offy = -1 + 2 * (j % 2);
+          int offx = -1 + 2 * (i % 2);
+          int i0 = (i >> 1) + (j >> 1) * nSrcBlkX;
+          // [ׂ͗Ȃ̂œubNg
+          bool edgex = (i == 0) || (i >= 2 * nSrcBlkX - 1);
+          bool edgey = (j == 0) || (j >= 2 * nSrcBlkY - 1);
+          int i1, i2, i3;
+          if (edgex) {
+            i1 = i0;
+            i2 = i3 = edgey ? i0 : i0 + offy * nSrcBlkX;
+          }
+          else if (edgey) {
+            i1 = i0;
+            i2 = i3 = i0 + offx;
+          }
+          else {
+            i1 = i0 + offx;
+            i2 = i0 + offy * nSrcBlkX;
+            i3 = i0 + offx + offy * nSrcBlkX;
+          }
+          short2 v1 = sv[i0], v2 = sv[i1], v3 = sv[i2], v4 = sv[i3];
+
+          int ax1 = (offx > 0) ? aodd : aeven;
+          int ax2 = atotal - ax1;
+          int ay1 = (offy > 0) ? aodd : aeven;
+          int ay2 = atotal - ay1;
+          int a11 = ax1*ay1, a12 = ax1*ay2, a21 = ax2*ay1, a22 = ax2*ay2;
+          int vx = (a11*v1.x + a21*v2.x + a12*v3.x + a22*v4.x) / normov;
+          int vy = (a11*v1.y + a21*v2.y + a12*v3.y + a22*v4.y) / normov;
+
+          int tmp_sad = (a11*ss[i0] + a21*ss[i1] + a12*ss[i2] + a22*ss[i3]) / normov;
+
+          if (normFactor > 0) {
+            vx >>= normFactor;
+            vy >>= normFactor;
+          }
+          else {
+            vx <<= -normFactor;
+            vy <<= -normFactor;
+          }
+
+          int index = x + y * nDstBlkX;
+          dv[index].x = (short)vx;
+          dv[index].y = (short)vy;
+          ds[index] = tmp_sad >> 4;
+        }
+      }
+    });
+  }
+
+  void LoadMV(const VECTOR* in, short2* vectors, int* sads, int nBlkCount)
+  {
+    for (int i = 0; i < nBlkCount; ++i) {
+      vectors[i].x = in[i].x;
+      vectors[i].y = in[i].y;
+      sads[i] = in[i].sad;
+    }
+  }
+
+  void StoreMV(VECTOR* out, const short2* vectors, const int* sads, int nBlkCount)
+  {
+    for (int i = 0; i < nBlkCount; ++i) {
+      out[i].x = vectors[i].x;
+      out[i].y = vectors[i].y;
+      out[i].sad = sads[i];
+    }
+  }
+
+  void WriteDefaultMV(VECTOR* dst, int nBlkCount, int verybigSAD)
+  {
+    for (int i = 0; i < nBlkCount; ++i) {
+      dst[i].x = 0;
+      dst[i].y = 0;
+      dst[i].sad = verybigSAD;
+    }
+  }
+
+  // 36 args
+  // prog,nextCUDAł̓pȂ̂ŎgȂ
+  void Search(
+    int batch, void* _searchbatch,
+    int searchType, int nBlkX, int nBlkY, int nBlkSize, int nLogScale,
+    int nLambdaLevel, int lsad, int penaltyZero, int penaltyGlobal, int penaltyNew,
+    int nPel, bool chroma, int nPad, int nBlkSizeOvr, int nExtendedWidth, int nExptendedHeight,
+    const pixel_t** pSrcY, const pixel_t** pSrcU, const pixel_t** pSrcV,
+    const pixel_t** pRefY, const pixel_t** pRefU, const pixel_t** pRefV,
+    int nPitchY, int nPitchUV, int nImgPitchY, int nImgPitchUV,
+    const short2* globalMV, short2* vectors, int vectorsPitch, int* sads, int sadPitch, void* _searchblocks, int* prog, int* next)
+  {
+    SetSADFunctions(nBlkSize);
+
+    const int nBlkCount = nBlkX * nBlkY;
+    SearchBlockCPU* searchblocks = (SearchBlockCPU*)_searchblocks;
+    ThreadPool& pool = ThreadPool::GetInstance();
+
+    // T̏ivectors[-2]: zero, vectors[-1]: globalj
+    pool.ParallelFor(batch, [&](int b) {
+      short2* v = vectors + b * vectorsPitch;
+      const int* s = sads + b * sadPitch;
+      SearchBlockCPU* blocks = searchblocks + b * nBlkCount;
+
+      v[-2] = short2();
+      v[-1].x = short(globalMV[b].x * nPel);
+      v[-1].y = short(globalMV[b].y * nPel);
+
+      int nPaddingScaled = nPad >> nLogScale;
+      for (int by = 0; by < nBlkY; ++by) {
+        for (int bx = 0; bx < nBlkX; ++bx) {
+          int blkIdx = bx + by * nBlkX;
+          int sad = s[blkIdx];
+          SearchBlockCPU& data = blocks[blkIdx];
+
+          int x = nPad + nBlkSizeOvr * bx;
+          int y = nPad + nBlkSizeOvr * by;
+          data.rect[0] = nPel * (nExtendedWidth - x - nBlkSize - nPad + nPaddingScaled) - 1;
+          data.rect[1] = nPel * (nExptendedHeight - y - nBlkSize - nPad + nPaddingScaled) - 1;
+          data.rect[2] = -nPel * (x - nPad + nPaddingScaled);
+          data.rect[3] = -nPel * (y - nPad + nPaddingScaled);
+
+          // : Tς݂̃xN^, : Tς݂̃xN^i[͍ƓɂmedianōI΂j,
+          // E: ÕxN^iɃRs[́j
+          int left = (bx > 0) ? blkIdx - 1 : -2;
+          int up = (by > 0) ? blkIdx - nBlkX : left;
+          int br = ((by < nBlkY - 1) && (bx < nBlkX - 1)) ? blkIdx + nBlkX + 1 + nBlkCount : -2;
+
+          data.ref[0] = -2;
+          data.ref[1] = -1;
+          data.ref[2] = blkIdx;
+          data.ref[3] = left;
+          data.ref[4] = up;
+          data.ref[5] = br;
+
+          short2 pred = v[blkIdx];
+          v[blkIdx + nBlkCount] = pred;
+          data.predx = pred.x;
+          data.predy = pred.y;
+
+          data.penalties[0] = penaltyZero;
+          data.penalties[1] = penaltyGlobal;
+          data.penalties[2] = 0;
+          data.penalties[3] = penaltyNew;
+
+          int lambda = nLambdaLevel * lsad / (lsad + (sad >> 1)) * lsad / (lsad + (sad >> 1));
+          if (by == 0) lambda = 0;
+          data.lambda = lambda;
+        }
+      }
+    });
+
+    // 񂲂ƂɏォT
+    // ubN(x,y)͍̗(x-1,y)܂ŏIĂΒTł
+    // ͍珇Ɏôō̗͕KNĂ
+    std::unique_ptr<std::atomic<int>[]> progress(new std::atomic<int>[batch * nBlkX]);
+    for (int i = 0; i < batch * nBlkX; ++i) {
+      progress[i].store(0, std::memory_order_relaxed);
+    }
+
+    pool.ParallelFor(batch * nBlkX, [&](int i) {
+      int b = i / nBlkX;
+      int bx = i % nBlkX;
+      short2* v = vectors + b * vectorsPitch;
+      const SearchBlockCPU* blocks = searchblocks + b * nBlkCount;
+
+      SearchContext c = { nPel, chroma, nPitchY, nPitchUV, nImgPitchY, nImgPitchUV };
+      for (int by = 0; by < nBlkY; ++by) {
+        if (bx > 0) {
+          while (progress[i - 1].load(std::memory_order_acquire) <= by) {
+            std::this_thread::yield();
+          }
+        }
+        int offx = nPad + bx * nBlkSizeOvr;
+        int offy = nPad + by * nBlkSizeOvr;
+        c.pSrcY = pSrcY[b] + offx + offy * nPitchY;
+        c.pRefY = pRefY[b] + offx + offy * nPitchY;
+        if (chroma) {
+          int offuv = (offx >> 1) + (offy >> 1) * nPitchUV;
+          c.pSrcU = pSrcU[b] + offuv;
+          c.pSrcV = pSrcV[b] + offuv;
+          c.pRefU = pRefU[b] + offuv;
+          c.pRefV = pRefV[b] + offuv;
+        }
+        int blkIdx = bx + by * nBlkX;
+        SearchBlock(c, blocks[blkIdx], searchType, v, blkIdx);
+        progress[i].store(by + 1, std::memory_order_release);
+      }
+    });
+
+    // ŏIIȃxN^SAD߂
+    pool.ParallelFor(batch * nBlkY, [&](int i) {
+      int b = i / nBlkY;
+      int by = i % nBlkY;
+      const short2* v = vectors + b * vectorsPitch;
+      int* s = sads + b * sadPitch;
+
+      SearchContext c = { nPel, chroma, nPitchY, nPitchUV, nImgPitchY, nImgPitchUV };
+      for (int bx = 0; bx < nBlkX; ++bx) {
+        int offx = nPad + bx * nBlkSizeOvr;
+        int offy = nPad + by * nBlkSizeOvr;
+        c.pSrcY = pSrcY[b] + offx + offy * nPitchY;
+        c.pRefY = pRefY[b] + offx + offy * nPitchY;
+        if (chroma) {
+          int offuv = (offx >> 1) + (offy >> 1) * nPitchUV;
+          c.pSrcU = pSrcU[b] + offuv;
+          c.pSrcV = pSrcV[b] + offuv;
+          c.pRefU = pRefU[b] + offuv;
+          c.pRefV = pRefV[b] + offuv;
+        }
+        int blkIdx = bx + by * nBlkX;
+        s[blkIdx] = CalcSAD(c, v[blkIdx].x, v[blkIdx].y);
+      }
+    });
+  }
+
+  // Degrain //
+  void GetDegrainStructSize(int N, int& degrainBlock, int& degrainArg)
+  {
+    if (N < 1 || N > 2) {
+      env->ThrowError("[Degrain] ΉNł");
+    }
+    degrainBlock = sizeof(DegrainBlockCPU<pixel_t>);
+    degrainArg = 0;
+  }
+
+  //35 args
+  void Degrain(
+    int N, int nWidth, int nHeight, int nBlkX, int nBlkY, int nPad, int nBlkSize, int nPel, int nBitsPerPixel,
+    bool* enableYUV, bool* isUsableB, bool* isUsableF,
+    int nTh1, int nTh2, int thSAD, int thSADC, bool binomial,
+    const short* ovrwins, const short* overwinsUV,
+    const VECTOR** mvB, const VECTOR** mvF,
+    const pixel_t** pSrc, pixel_t** pDst, tmp_t** pTmp, const pixel_t** pRefB, const pixel_t** pRefF,
+    int nPitchY, int nPitchUV,
+    int nPitchSuperY, int nPitchSuperUV, int nImgPitchY, int nImgPitchUV,
+    void* _degrainblock, void* _degrainarg, int* sceneChange)
+  {
+    if (N < 1 || N > 2) {
+      env->ThrowError("[Degrain] ΉNł");
+    }
+
+    const int numBlks = nBlkX * nBlkY;
+    const int nOverlap = nBlkSize / 2;
+    const int nWidth_B = nBlkX*(nBlkSize - nOverlap) + nOverlap;
+    const int nHeight_B = nBlkY*(nBlkSize - nOverlap) + nOverlap;
+    const int max_pixel_value = (1 << nBitsPerPixel) - 1;
+
+    // SceneChangeo
+    int *sceneChangeB = sceneChange;
+    int *sceneChangeF = sceneChange + N;
+    for (int i = 0; i < N; ++i) {
+      sceneChangeB[i] = isUsableB[i] ? CountSceneChange(mvB[i], numBlks, nTh1) : 0;
+      sceneChangeF[i] = isUsableF[i] ? CountSceneChange(mvF[i], numBlks, nTh1) : 0;
+    }
+
+    bool usableB[DEGRAIN_MAX_N], usableF[DEGRAIN_MAX_N];
+    for (int i = 0; i < N; ++i) {
+      usableB[i] = isUsableB[i] && !(sceneChangeB[i] > nTh2);
+      usableF[i] = isUsableF[i] && !(sceneChangeF[i] > nTh2);
+    }
+
+    DegrainBlockCPU<pixel_t>* degrainblocks = (DegrainBlockCPU<pixel_t>*)_degrainblock;
+    ThreadPool& pool = ThreadPool::GetInstance();
+
+    // YUV[v
+    for (int p = 0; p < 3; ++p) {
+      int shift = (p == 0) ? 0 : 1;
+      int blksize = nBlkSize >> shift;
+      int blkstep = blksize / 2;
+      int width = nWidth >> shift;
+      int width_b = nWidth_B >> shift;
+      int height = nHeight >> shift;
+      int height_b = nHeight_B >> shift;
+      int pitch = (p == 0) ? nPitchY : nPitchUV;
+      int pitchsuper = (p == 0) ? nPitchSuperY : nPitchSuperUV;
+      int imgpitch = (p == 0) ? nImgPitchY : nImgPitchUV;
+      int pad = nPad >> shift;
+      int th = (p == 0) ? thSAD : thSADC;
+      const short* wins = (p == 0) ? ovrwins : overwinsUV;
+
+      if (!enableYUV[p]) {
+        // srcRs[
+        CopyPlane(pDst[p], pitch, pSrc[p], pitch, width, height);
+        continue;
+      }
+
+      // DegrainBlock쐬
+      pool.ParallelFor(nBlkY, [&](int by) {
+        for (int bx = 0; bx < nBlkX; ++bx) {
+          int idx = bx + by * nBlkX;
+          DegrainBlockCPU<pixel_t>& b = degrainblocks[idx];
+
+          // winOver
+          int wby = ((by + nBlkY - 3) / (nBlkY - 2)) * 3;
+          int wbx = (bx + nBlkX - 3) / (nBlkX - 2);
+          b.winOver = wins + (wby + wbx) * blksize * blksize;
+
+          int offsetS = (pad + bx * blkstep) + (pad + by * blkstep) * pitchsuper;
+
+          const pixel_t *pB[DEGRAIN_MAX_N], *pF[DEGRAIN_MAX_N];
+          int WRefB[DEGRAIN_MAX_N], WRefF[DEGRAIN_MAX_N];
+          for (int i = 0; i < N; ++i) {
+            if (usableB[i]) {
+              pB[i] = get_ref_block(pRefB[p + i * 3] + offsetS, pitchsuper, imgpitch, nPel,
+                mvB[i][idx].x >> shift, mvB[i][idx].y >> shift);
+              WRefB[i] = degrain_weight(th, mvB[i][idx].sad);
+            }
+            else {
+              pB[i] = nullptr;
+              WRefB[i] = 0;
+            }
+            if (usableF[i]) {
+              pF[i] = get_ref_block(pRefF[p + i * 3] + offsetS, pitchsuper, imgpitch, nPel,
+                mvF[i][idx].x >> shift, mvF[i][idx].y >> shift);
+              WRefF[i] = degrain_weight(th, mvF[i][idx].sad);
+            }
+            else {
+              pF[i] = nullptr;
+              WRefF[i] = 0;
+            }
+          }
+
+          norm_weights(N, binomial, b.WSrc, WRefB, WRefF);
+
+          // d0̎QƂ͌ʂɉeȂ̂ŏ
+          b.nRef = 0;
+          for (int i = 0; i < N; ++i) {
+            if (WRefF[i] != 0) {
+              b.pRef[b.nRef] = pF[i];
+              b.WRef[b.nRef++] = WRefF[i];
+            }
+            if (WRefB[i] != 0) {
+              b.pRef[b.nRef] = pB[i];
+              b.WRef[b.nRef++] = WRefB[i];
+            }
+          }
+        }
+      });
+
+      ZeroTmp(pTmp[p], width_b, height_b, pitch);
+
+      ParallelBlockRows(nBlkY, [&](int by) {
+        for (int bx = 0; bx < nBlkX; ++bx) {
+          const DegrainBlockCPU<pixel_t>& b = degrainblocks[bx + by * nBlkX];
+          int offset = bx * blkstep + by * blkstep * pitch;
+          AccumulateBlock(pTmp[p] + offset, pitch, pSrc[p] + offset, pitch, b.WSrc,
+            b.pRef, b.WRef, b.nRef, pitchsuper, b.winOver, blksize);
+        }
+      });
+
+      // tmp_t -> pixel_t ϊ
+      TmpToPixel(pDst[p], pTmp[p], width_b, height_b, pitch, max_pixel_value);
+
+      // right non-covered regionsrcRs[
+      if (nWidth_B < nWidth) {
+        CopyPlane(pDst[p] + width_b, pitch, pSrc[p] + width_b, pitch, (nWidth - nWidth_B) >> shift, height_b);
+      }
+
+      // bottom uncovered regionsrcRs[
+      if (nHeight_B < nHeight) {
+        CopyPlane(pDst[p] + height_b * pitch, pitch, pSrc[p] + height_b * pitch, pitch, width, (nHeight - nHeight_B) >> shift);
+      }
+    }
+  }
+
+  // Compensate //
+  int GetCompensateStructSize()
+  {
+    return sizeof(CompensateBlockCPU<pixel_t>);
+  }
+
+  //31 args
+  void Compensate(
+    int nWidth, int nHeight, int nBlkX, int nBlkY, int nPad, int nBlkSize, int nPel, int nBitsPerPixel,
+    int nTh1, int nTh2, int time256, int thSAD,
+    const short* ovrwins, const short* overwinsUV, const VECTOR* mv,
+    const pixel_t** pSrc, pixel_t** pDst, tmp_t** pTmp, const pixel_t** pRef,
+    int nPitchY, int nPitchUV,
+    int nPitchSuperY, int nPitchSuperUV, int nImgPitchY, int nImgPitchUV,
+    void* _compensateblock, int* sceneChange)
+  {
+    const int numBlks = nBlkX * nBlkY;
+    const int nOverlap = nBlkSize / 2;
+    const int nWidth_B = nBlkX*(nBlkSize - nOverlap) + nOverlap;
+    const int nHeight_B = nBlkY*(nBlkSize - nOverlap) + nOverlap;
+    const int max_pixel_value = (1 << nBitsPerPixel) - 1;
+
+    // SceneChangeo
+    *sceneChange = CountSceneChange(mv, numBlks, nTh1);
+    const bool isSceneChange = (*sceneChange > nTh2);
+
+    CompensateBlockCPU<pixel_t>* compensateblocks = (CompensateBlockCPU<pixel_t>*)_compensateblock;
+    ThreadPool& pool = ThreadPool::GetInstance();
+
+    // YUV[v
+    for (int p = 0; p < 3; ++p) {
+      int shift = (p == 0) ? 0 : 1;
+      int blksize = nBlkSize >> shift;
+      int blkstep = blksize / 2;
+      int width = nWidth >> shift;
+      int width_b = nWidth_B >> shift;
+      int height = nHeight >> shift;
+      int height_b = nHeight_B >> shift;
+      int pitch = (p == 0) ? nPitchY : nPitchUV;
+      int pitchsuper = (p == 0) ? nPitchSuperY : nPitchSuperUV;
+      int imgpitch = (p == 0) ? nImgPitchY : nImgPitchUV;
+      int pad = nPad >> shift;
+      const short* wins = (p == 0) ? ovrwins : overwinsUV;
+
+      if (isSceneChange) {
+        // V[`FW
+        CopyPlane(pDst[p], pitch, pSrc[p], pitch, width, height);
+        continue;
+      }
+
+      // CompensateBlock쐬
+      pool.ParallelFor(nBlkY, [&](int by) {
+        for (int bx = 0; bx < nBlkX; ++bx) {
+          int idx = bx + by * nBlkX;
+          CompensateBlockCPU<pixel_t>& b = compensateblocks[idx];
+
+          // winOver
+          int wby = ((by + nBlkY - 3) / (nBlkY - 2)) * 3;
+          int wbx = (bx + nBlkX - 3) / (nBlkX - 2);
+          b.winOver = wins + (wby + wbx) * blksize * blksize;
+
+          int offsetS = (pad + bx * blkstep) + (pad + by * blkstep) * pitchsuper;
+
+          VECTOR vec = mv[idx];
+          if (vec.sad < thSAD) {
+            int mx = (vec.x * time256 / 256) >> shift;
+            int my = (vec.y * time256 / 256) >> shift;
+            b.pRef = get_ref_block(pRef[3 + p] + offsetS, pitchsuper, imgpitch, nPel, mx, my);
+          }
+          else {
+            b.pRef = get_ref_block(pRef[0 + p] + offsetS, pitchsuper, imgpitch, nPel, 0, 0);
+          }
+        }
+      });
+
+      ZeroTmp(pTmp[p], width_b, height_b, pitch);
+
+      // QƃubN̂܂ܑiWSrc=256ŎQƂȂj
+      ParallelBlockRows(nBlkY, [&](int by) {
+        for (int bx = 0; bx < nBlkX; ++bx) {
+          const CompensateBlockCPU<pixel_t>& b = compensateblocks[bx + by * nBlkX];
+          int offset = bx * blkstep + by * blkstep * pitch;
+          AccumulateBlock<pixel_t, tmp_t>(pTmp[p] + offset, pitch, b.pRef, pitchsuper, 256,
+            nullptr, nullptr, 0, pitchsuper, b.winOver, blksize);
+        }
+      });
+
+      // tmp_t -> pixel_t ϊ
+      TmpToPixel(pDst[p], pTmp[p], width_b, height_b, pitch, max_pixel_value);
+
+      // right non-covered regionsrcRs[
+      if (nWidth_B < nWidth) {
+        CopyPlane(pDst[p] + width_b, pitch, pSrc[p] + width_b, pitch, (nWidth - nWidth_B) >> shift, height_b);
+      }
+
+      // bottom uncovered regionsrcRs[
+      if (nHeight_B < nHeight) {
+        CopyPlane(pDst[p] + height_b * pitch, pitch, pSrc[p] + height_b * pitch, pitch, width, (nHeight - nHeight_B) >> shift);
+      }
+    }
+  }
+};
+
+template <typename pixel_t>
+IKDeintKernelCPU<pixel_t>* CreateKDeintKernelCPU()
+{
+  return new KDeintKernelCPU<pixel_t>();
+}
+
+template IKDeintKernelCPU<uint8_t>* CreateKDeintKernelCPU<uint8_t>();
+template IKDeintKernelCPU<uint16_t>* CreateKDeintKernelCPU<uint16_t>();
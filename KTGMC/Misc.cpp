@@ -14,6 +14,8 @@
 // commoncpp
 #include "DebugWriter.cpp"
 #include "DeviceLocalData.cpp"
+#include "ScratchArena.cpp"
+#include "ThreadPool.cpp"
 
 void AddFuncKernel(IScriptEnvironment* env);
 void AddFuncMV(IScriptEnvironment* env);
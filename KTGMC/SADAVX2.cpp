@@ -0,0 +1,145 @@
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "SADFunctions.h"
+
+static __forceinline __m128i load_u64(const void* p) {
+  return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+}
+
+static __forceinline __m128i load_u128(const void* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+static __forceinline __m256i load_u256(const void* p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+static __forceinline __m256i combine(__m128i lo, __m128i hi) {
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+// 8oCg x 4s1WX^ɋl߂
+static __forceinline __m256i load_4x64(const void* p, int pitch_bytes) {
+  const uint8_t* p8 = reinterpret_cast<const uint8_t*>(p);
+  __m128i r01 = _mm_unpacklo_epi64(load_u64(p8), load_u64(p8 + pitch_bytes));
+  __m128i r23 = _mm_unpacklo_epi64(load_u64(p8 + pitch_bytes * 2), load_u64(p8 + pitch_bytes * 3));
+  return combine(r01, r23);
+}
+
+// 16oCg x 2s1WX^ɋl߂
+static __forceinline __m256i load_2x128(const void* p, int pitch_bytes) {
+  const uint8_t* p8 = reinterpret_cast<const uint8_t*>(p);
+  return combine(load_u128(p8), load_u128(p8 + pitch_bytes));
+}
+
+// |a-b| (16bit) 32bit[ɑ
+static __forceinline __m256i add_absdiff_u16(__m256i sum, __m256i a, __m256i b) {
+  __m256i d = _mm256_sub_epi16(_mm256_max_epu16(a, b), _mm256_min_epu16(a, b));
+  __m256i lo = _mm256_blend_epi16(d, _mm256_setzero_si256(), 0xAA);
+  __m256i hi = _mm256_srli_epi32(d, 16);
+  return _mm256_add_epi32(sum, _mm256_add_epi32(lo, hi));
+}
+
+static __forceinline unsigned int hsum_epi64(__m256i sum) {
+  __m128i s = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  return (unsigned int)(_mm_cvtsi128_si32(s) + _mm_extract_epi32(s, 2));
+}
+
+static __forceinline unsigned int hsum_epi32(__m256i sum) {
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+  return (unsigned int)_mm_cvtsi128_si32(s);
+}
+
+template <int nBlkWidth, int nBlkHeight>
+static unsigned int Sad_AVX2_8(const uint8_t *pSrc, int nSrcPitch, const uint8_t *pRef, int nRefPitch)
+{
+  __m256i sum = _mm256_setzero_si256();
+  if (nBlkWidth == 8) {
+    for (int y = 0; y < nBlkHeight; y += 4) {
+      sum = _mm256_add_epi64(sum, _mm256_sad_epu8(load_4x64(pSrc, nSrcPitch), load_4x64(pRef, nRefPitch)));
+      pSrc += nSrcPitch * 4;
+      pRef += nRefPitch * 4;
+    }
+  }
+  else if (nBlkWidth == 16) {
+    for (int y = 0; y < nBlkHeight; y += 2) {
+      sum = _mm256_add_epi64(sum, _mm256_sad_epu8(load_2x128(pSrc, nSrcPitch), load_2x128(pRef, nRefPitch)));
+      pSrc += nSrcPitch * 2;
+      pRef += nRefPitch * 2;
+    }
+  }
+  else {
+    for (int y = 0; y < nBlkHeight; ++y) {
+      sum = _mm256_add_epi64(sum, _mm256_sad_epu8(load_u256(pSrc), load_u256(pRef)));
+      pSrc += nSrcPitch;
+      pRef += nRefPitch;
+    }
+  }
+  return hsum_epi64(sum);
+}
+
+template <int nBlkWidth, int nBlkHeight>
+static unsigned int Sad_AVX2_16(const uint16_t *pSrc, int nSrcPitch, const uint16_t *pRef, int nRefPitch)
+{
+  __m256i sum = _mm256_setzero_si256();
+  if (nBlkWidth == 4) {
+    for (int y = 0; y < nBlkHeight; y += 4) {
+      sum = add_absdiff_u16(sum,
+        load_4x64(pSrc, nSrcPitch * sizeof(uint16_t)), load_4x64(pRef, nRefPitch * sizeof(uint16_t)));
+      pSrc += nSrcPitch * 4;
+      pRef += nRefPitch * 4;
+    }
+  }
+  else if (nBlkWidth == 8) {
+    for (int y = 0; y < nBlkHeight; y += 2) {
+      sum = add_absdiff_u16(sum,
+        load_2x128(pSrc, nSrcPitch * sizeof(uint16_t)), load_2x128(pRef, nRefPitch * sizeof(uint16_t)));
+      pSrc += nSrcPitch * 2;
+      pRef += nRefPitch * 2;
+    }
+  }
+  else {
+    for (int y = 0; y < nBlkHeight; ++y) {
+      for (int x = 0; x < nBlkWidth; x += 16) {
+        sum = add_absdiff_u16(sum, load_u256(pSrc + x), load_u256(pRef + x));
+      }
+      pSrc += nSrcPitch;
+      pRef += nRefPitch;
+    }
+  }
+  return hsum_epi32(sum);
+}
+
+template <typename pixel_t> struct SadAVX2 { };
+template <> struct SadAVX2<uint8_t> {
+  template <int W, int H> static SADFunction<uint8_t> get() { return Sad_AVX2_8<W, H>; }
+};
+template <> struct SadAVX2<uint16_t> {
+  template <int W, int H> static SADFunction<uint16_t> get() { return Sad_AVX2_16<W, H>; }
+};
+
+template <typename pixel_t>
+SADFunction<pixel_t> get_sad_avx2_func(int nBlkWidth, int nBlkHeight)
+{
+  typedef SadAVX2<pixel_t> K;
+  if (sizeof(pixel_t) == 1 && nBlkWidth == 4) {
+    // 8bit4xN128bitő̂SSE4.1łg
+    return nullptr;
+  }
+  if (nBlkWidth == 8 && nBlkHeight == 8) return K::template get<8, 8>();
+  if (nBlkWidth == 16 && nBlkHeight == 16) return K::template get<16, 16>();
+  if (nBlkWidth == 32 && nBlkHeight == 32) return K::template get<32, 32>();
+  if (nBlkWidth == 8 && nBlkHeight == 16) return K::template get<8, 16>();
+  if (nBlkWidth == 16 && nBlkHeight == 32) return K::template get<16, 32>();
+  if (sizeof(pixel_t) == 2) {
+    if (nBlkWidth == 4 && nBlkHeight == 4) return K::template get<4, 4>();
+    if (nBlkWidth == 4 && nBlkHeight == 8) return K::template get<4, 8>();
+  }
+  return nullptr;
+}
+
+template SADFunction<uint8_t> get_sad_avx2_func<uint8_t>(int nBlkWidth, int nBlkHeight);
+template SADFunction<uint16_t> get_sad_avx2_func<uint16_t>(int nBlkWidth, int nBlkHeight);
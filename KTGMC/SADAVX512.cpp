@@ -0,0 +1,146 @@
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "SADFunctions.h"
+
+// AVX-512BWintrinsicVS2017(15.3)ȍ~łȂƎgȂ
+#if (defined(_MSC_VER) && _MSC_VER >= 1911) || defined(__AVX512BW__)
+#define ENABLE_SAD_AVX512 1
+#endif
+
+#if ENABLE_SAD_AVX512
+
+static __forceinline __m128i load_u128(const void* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+static __forceinline __m256i load_u256(const void* p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+static __forceinline __m512i load_u512(const void* p) {
+  return _mm512_loadu_si512(p);
+}
+
+// 16oCg x 4s1WX^ɋl߂
+static __forceinline __m512i load_4x128(const void* p, int pitch_bytes) {
+  const uint8_t* p8 = reinterpret_cast<const uint8_t*>(p);
+  __m512i r = _mm512_castsi128_si512(load_u128(p8));
+  r = _mm512_inserti32x4(r, load_u128(p8 + pitch_bytes), 1);
+  r = _mm512_inserti32x4(r, load_u128(p8 + pitch_bytes * 2), 2);
+  return _mm512_inserti32x4(r, load_u128(p8 + pitch_bytes * 3), 3);
+}
+
+// 32oCg x 2s1WX^ɋl߂
+static __forceinline __m512i load_2x256(const void* p, int pitch_bytes) {
+  const uint8_t* p8 = reinterpret_cast<const uint8_t*>(p);
+  return _mm512_inserti64x4(_mm512_castsi256_si512(load_u256(p8)), load_u256(p8 + pitch_bytes), 1);
+}
+
+static __forceinline __m512i add_absdiff_u16(__m512i sum, __m512i a, __m512i b) {
+  __m512i d = _mm512_sub_epi16(_mm512_max_epu16(a, b), _mm512_min_epu16(a, b));
+  __m512i lo = _mm512_and_si512(d, _mm512_set1_epi32(0xFFFF));
+  __m512i hi = _mm512_srli_epi32(d, 16);
+  return _mm512_add_epi32(sum, _mm512_add_epi32(lo, hi));
+}
+
+static __forceinline unsigned int hsum_epi64(__m512i sum) {
+  __m256i s256 = _mm256_add_epi64(_mm512_castsi512_si256(sum), _mm512_extracti64x4_epi64(sum, 1));
+  __m128i s = _mm_add_epi64(_mm256_castsi256_si128(s256), _mm256_extracti128_si256(s256, 1));
+  return (unsigned int)(_mm_cvtsi128_si32(s) + _mm_extract_epi32(s, 2));
+}
+
+static __forceinline unsigned int hsum_epi32(__m512i sum) {
+  __m256i s256 = _mm256_add_epi32(_mm512_castsi512_si256(sum), _mm512_extracti64x4_epi64(sum, 1));
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(s256), _mm256_extracti128_si256(s256, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+  return (unsigned int)_mm_cvtsi128_si32(s);
+}
+
+template <int nBlkWidth, int nBlkHeight>
+static unsigned int Sad_AVX512_8(const uint8_t *pSrc, int nSrcPitch, const uint8_t *pRef, int nRefPitch)
+{
+  __m512i sum = _mm512_setzero_si512();
+  if (nBlkWidth == 16) {
+    for (int y = 0; y < nBlkHeight; y += 4) {
+      sum = _mm512_add_epi64(sum, _mm512_sad_epu8(load_4x128(pSrc, nSrcPitch), load_4x128(pRef, nRefPitch)));
+      pSrc += nSrcPitch * 4;
+      pRef += nRefPitch * 4;
+    }
+  }
+  else {
+    for (int y = 0; y < nBlkHeight; y += 2) {
+      sum = _mm512_add_epi64(sum, _mm512_sad_epu8(load_2x256(pSrc, nSrcPitch), load_2x256(pRef, nRefPitch)));
+      pSrc += nSrcPitch * 2;
+      pRef += nRefPitch * 2;
+    }
+  }
+  return hsum_epi64(sum);
+}
+
+template <int nBlkWidth, int nBlkHeight>
+static unsigned int Sad_AVX512_16(const uint16_t *pSrc, int nSrcPitch, const uint16_t *pRef, int nRefPitch)
+{
+  __m512i sum = _mm512_setzero_si512();
+  if (nBlkWidth == 8) {
+    for (int y = 0; y < nBlkHeight; y += 4) {
+      sum = add_absdiff_u16(sum,
+        load_4x128(pSrc, nSrcPitch * sizeof(uint16_t)), load_4x128(pRef, nRefPitch * sizeof(uint16_t)));
+      pSrc += nSrcPitch * 4;
+      pRef += nRefPitch * 4;
+    }
+  }
+  else if (nBlkWidth == 16) {
+    for (int y = 0; y < nBlkHeight; y += 2) {
+      sum = add_absdiff_u16(sum,
+        load_2x256(pSrc, nSrcPitch * sizeof(uint16_t)), load_2x256(pRef, nRefPitch * sizeof(uint16_t)));
+      pSrc += nSrcPitch * 2;
+      pRef += nRefPitch * 2;
+    }
+  }
+  else {
+    for (int y = 0; y < nBlkHeight; ++y) {
+      sum = add_absdiff_u16(sum, load_u512(pSrc), load_u512(pRef));
+      pSrc += nSrcPitch;
+      pRef += nRefPitch;
+    }
+  }
+  return hsum_epi32(sum);
+}
+
+template <typename pixel_t> struct SadAVX512 { };
+template <> struct SadAVX512<uint8_t> {
+  template <int W, int H> static SADFunction<uint8_t> get() { return Sad_AVX512_8<W, H>; }
+};
+template <> struct SadAVX512<uint16_t> {
+  template <int W, int H> static SADFunction<uint16_t> get() { return Sad_AVX512_16<W, H>; }
+};
+
+template <typename pixel_t>
+SADFunction<pixel_t> get_sad_avx512_func(int nBlkWidth, int nBlkHeight)
+{
+  typedef SadAVX512<pixel_t> K;
+  // 1WX^ɖȂubNAVX2łg
+  if (nBlkWidth == 16 && nBlkHeight == 16) return K::template get<16, 16>();
+  if (nBlkWidth == 32 && nBlkHeight == 32) return K::template get<32, 32>();
+  if (nBlkWidth == 16 && nBlkHeight == 32) return K::template get<16, 32>();
+  if (sizeof(pixel_t) == 2) {
+    if (nBlkWidth == 8 && nBlkHeight == 8) return K::template get<8, 8>();
+    if (nBlkWidth == 8 && nBlkHeight == 16) return K::template get<8, 16>();
+  }
+  return nullptr;
+}
+
+#else // ENABLE_SAD_AVX512
+
+template <typename pixel_t>
+SADFunction<pixel_t> get_sad_avx512_func(int nBlkWidth, int nBlkHeight)
+{
+  return nullptr;
+}
+
+#endif // ENABLE_SAD_AVX512
+
+template SADFunction<uint8_t> get_sad_avx512_func<uint8_t>(int nBlkWidth, int nBlkHeight);
+template SADFunction<uint16_t> get_sad_avx512_func<uint16_t>(int nBlkWidth, int nBlkHeight);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+// CPUPlaneOfBlocksŎgSAD֐
+// pitch͗vfioCgł͂Ȃj
+template <typename pixel_t>
+using SADFunction = unsigned int(*)(const pixel_t *pSrc, int nSrcPitch, const pixel_t *pRef, int nRefPitch);
+
+// ΉĂȂubNTCYnullptrԂ̂ŁAĂяoŉʂ̖߃ZbgɃtH[obN邱
+template <typename pixel_t>
+SADFunction<pixel_t> get_sad_sse41_func(int nBlkWidth, int nBlkHeight);
+
+template <typename pixel_t>
+SADFunction<pixel_t> get_sad_avx2_func(int nBlkWidth, int nBlkHeight);
+
+// RpCAVX-512ɑΉĂȂꍇ͏nullptr
+template <typename pixel_t>
+SADFunction<pixel_t> get_sad_avx512_func(int nBlkWidth, int nBlkHeight);
@@ -0,0 +1,120 @@
+#include <stdint.h>
+#include <smmintrin.h>
+
+#include "SADFunctions.h"
+
+static __forceinline __m128i load_u32(const void* p) {
+  return _mm_cvtsi32_si128(*reinterpret_cast<const int*>(p));
+}
+
+static __forceinline __m128i load_u64(const void* p) {
+  return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+}
+
+static __forceinline __m128i load_u128(const void* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// |a-b| (16bit) 32bit[ɑ
+static __forceinline __m128i add_absdiff_u16(__m128i sum, __m128i a, __m128i b) {
+  __m128i d = _mm_sub_epi16(_mm_max_epu16(a, b), _mm_min_epu16(a, b));
+  __m128i lo = _mm_blend_epi16(d, _mm_setzero_si128(), 0xAA);
+  __m128i hi = _mm_srli_epi32(d, 16);
+  return _mm_add_epi32(sum, _mm_add_epi32(lo, hi));
+}
+
+static __forceinline unsigned int hsum_epi64(__m128i sum) {
+  return (unsigned int)(_mm_cvtsi128_si32(sum) + _mm_extract_epi32(sum, 2));
+}
+
+static __forceinline unsigned int hsum_epi32(__m128i sum) {
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  return (unsigned int)_mm_cvtsi128_si32(sum);
+}
+
+template <int nBlkWidth, int nBlkHeight>
+static unsigned int Sad_SSE41_8(const uint8_t *pSrc, int nSrcPitch, const uint8_t *pRef, int nRefPitch)
+{
+  __m128i sum = _mm_setzero_si128();
+  if (nBlkWidth == 4) {
+    // 2s܂Ƃ߂ď
+    for (int y = 0; y < nBlkHeight; y += 2) {
+      __m128i a = _mm_unpacklo_epi32(load_u32(pSrc), load_u32(pSrc + nSrcPitch));
+      __m128i b = _mm_unpacklo_epi32(load_u32(pRef), load_u32(pRef + nRefPitch));
+      sum = _mm_add_epi64(sum, _mm_sad_epu8(a, b));
+      pSrc += nSrcPitch * 2;
+      pRef += nRefPitch * 2;
+    }
+  }
+  else if (nBlkWidth == 8) {
+    for (int y = 0; y < nBlkHeight; y += 2) {
+      __m128i a = _mm_unpacklo_epi64(load_u64(pSrc), load_u64(pSrc + nSrcPitch));
+      __m128i b = _mm_unpacklo_epi64(load_u64(pRef), load_u64(pRef + nRefPitch));
+      sum = _mm_add_epi64(sum, _mm_sad_epu8(a, b));
+      pSrc += nSrcPitch * 2;
+      pRef += nRefPitch * 2;
+    }
+  }
+  else {
+    for (int y = 0; y < nBlkHeight; ++y) {
+      for (int x = 0; x < nBlkWidth; x += 16) {
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(load_u128(pSrc + x), load_u128(pRef + x)));
+      }
+      pSrc += nSrcPitch;
+      pRef += nRefPitch;
+    }
+  }
+  return hsum_epi64(sum);
+}
+
+template <int nBlkWidth, int nBlkHeight>
+static unsigned int Sad_SSE41_16(const uint16_t *pSrc, int nSrcPitch, const uint16_t *pRef, int nRefPitch)
+{
+  __m128i sum = _mm_setzero_si128();
+  if (nBlkWidth == 4) {
+    for (int y = 0; y < nBlkHeight; y += 2) {
+      __m128i a = _mm_unpacklo_epi64(load_u64(pSrc), load_u64(pSrc + nSrcPitch));
+      __m128i b = _mm_unpacklo_epi64(load_u64(pRef), load_u64(pRef + nRefPitch));
+      sum = add_absdiff_u16(sum, a, b);
+      pSrc += nSrcPitch * 2;
+      pRef += nRefPitch * 2;
+    }
+  }
+  else {
+    for (int y = 0; y < nBlkHeight; ++y) {
+      for (int x = 0; x < nBlkWidth; x += 8) {
+        sum = add_absdiff_u16(sum, load_u128(pSrc + x), load_u128(pRef + x));
+      }
+      pSrc += nSrcPitch;
+      pRef += nRefPitch;
+    }
+  }
+  return hsum_epi32(sum);
+}
+
+template <typename pixel_t> struct SadSSE41 { };
+template <> struct SadSSE41<uint8_t> {
+  template <int W, int H> static SADFunction<uint8_t> get() { return Sad_SSE41_8<W, H>; }
+};
+template <> struct SadSSE41<uint16_t> {
+  template <int W, int H> static SADFunction<uint16_t> get() { return Sad_SSE41_16<W, H>; }
+};
+
+template <typename pixel_t>
+SADFunction<pixel_t> get_sad_sse41_func(int nBlkWidth, int nBlkHeight)
+{
+  typedef SadSSE41<pixel_t> K;
+  if (nBlkWidth == 4 && nBlkHeight == 4) return K::template get<4, 4>();
+  if (nBlkWidth == 8 && nBlkHeight == 8) return K::template get<8, 8>();
+  if (nBlkWidth == 16 && nBlkHeight == 16) return K::template get<16, 16>();
+  if (nBlkWidth == 32 && nBlkHeight == 32) return K::template get<32, 32>();
+  // YV16̐F
+  if (nBlkWidth == 4 && nBlkHeight == 8) return K::template get<4, 8>();
+  if (nBlkWidth == 8 && nBlkHeight == 16) return K::template get<8, 16>();
+  if (nBlkWidth == 16 && nBlkHeight == 32) return K::template get<16, 32>();
+  return nullptr;
+}
+
+template SADFunction<uint8_t> get_sad_sse41_func<uint8_t>(int nBlkWidth, int nBlkHeight);
+template SADFunction<uint16_t> get_sad_sse41_func<uint16_t>(int nBlkWidth, int nBlkHeight);
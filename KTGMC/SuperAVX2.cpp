@@ -0,0 +1,220 @@
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <immintrin.h>
+
+#include "SuperFunctions.h"
+
+// 8bit16bit[ x16A16bit32bit[ x8ŌvZ
+// ǂr̒l[Ɏ܂i8bitWiener-2550`10726j
+template <typename pixel_t> struct Lanes { };
+
+template <> struct Lanes<uint8_t> {
+  enum { N = 16 };
+  static __forceinline __m256i load(const uint8_t* p) {
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+  }
+  // p[0],p[2],p[4],...
+  static __forceinline __m256i load_even(const uint8_t* p) {
+    return _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), _mm256_set1_epi16(0xFF));
+  }
+  // p[1],p[3],p[5],...
+  static __forceinline __m256i load_odd(const uint8_t* p) {
+    return _mm256_srli_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), 8);
+  }
+  static __forceinline void store(uint8_t* p, __m256i v) {
+    v = _mm256_packus_epi16(v, v);
+    v = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(v));
+  }
+  static __forceinline __m256i set1(int v) { return _mm256_set1_epi16((short)v); }
+  static __forceinline __m256i add(__m256i a, __m256i b) { return _mm256_add_epi16(a, b); }
+  static __forceinline __m256i sub(__m256i a, __m256i b) { return _mm256_sub_epi16(a, b); }
+  static __forceinline __m256i min(__m256i a, __m256i b) { return _mm256_min_epi16(a, b); }
+  static __forceinline __m256i max(__m256i a, __m256i b) { return _mm256_max_epi16(a, b); }
+  template <int S> static __forceinline __m256i shl(__m256i a) { return _mm256_slli_epi16(a, S); }
+  template <int S> static __forceinline __m256i sar(__m256i a) { return _mm256_srai_epi16(a, S); }
+};
+
+template <> struct Lanes<uint16_t> {
+  enum { N = 8 };
+  static __forceinline __m256i load(const uint16_t* p) {
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+  }
+  static __forceinline __m256i load_even(const uint16_t* p) {
+    return _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), _mm256_set1_epi32(0xFFFF));
+  }
+  static __forceinline __m256i load_odd(const uint16_t* p) {
+    return _mm256_srli_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), 16);
+  }
+  static __forceinline void store(uint16_t* p, __m256i v) {
+    v = _mm256_packus_epi32(v, v);
+    v = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(v));
+  }
+  static __forceinline __m256i set1(int v) { return _mm256_set1_epi32(v); }
+  static __forceinline __m256i add(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+  static __forceinline __m256i sub(__m256i a, __m256i b) { return _mm256_sub_epi32(a, b); }
+  static __forceinline __m256i min(__m256i a, __m256i b) { return _mm256_min_epi32(a, b); }
+  static __forceinline __m256i max(__m256i a, __m256i b) { return _mm256_max_epi32(a, b); }
+  template <int S> static __forceinline __m256i shl(__m256i a) { return _mm256_slli_epi32(a, S); }
+  template <int S> static __forceinline __m256i sar(__m256i a) { return _mm256_srai_epi32(a, S); }
+};
+
+// (a + b + 1) >> 1
+template <typename pixel_t>
+static void AverageRow(pixel_t* d, const pixel_t* a, const pixel_t* b, int nWidth)
+{
+  typedef Lanes<pixel_t> L;
+  const __m256i one = L::set1(1);
+  int x = 0;
+  for (; x + L::N <= nWidth; x += L::N) {
+    L::store(d + x, L::template sar<1>(L::add(L::add(L::load(a + x), L::load(b + x)), one)));
+  }
+  for (; x < nWidth; ++x) {
+    d[x] = (a[x] + b[x] + 1) >> 1;
+  }
+}
+
+// (1, -5, 20, 20, -5, 1)/32
+template <typename pixel_t>
+static __forceinline __m256i Wiener6(__m256i s0, __m256i s1, __m256i s2, __m256i s3, __m256i s4, __m256i s5, __m256i maxv)
+{
+  typedef Lanes<pixel_t> L;
+  __m256i t = L::sub(L::add(L::template shl<2>(s2), L::template shl<2>(s3)), L::add(s1, s4));
+  t = L::add(L::template shl<2>(t), t); // *5
+  t = L::add(L::add(t, L::add(s0, s5)), L::set1(16));
+  return L::min(L::max(L::template sar<5>(t), _mm256_setzero_si256()), maxv);
+}
+
+template <typename pixel_t>
+void RB2BilinearFiltered_AVX2(
+  pixel_t *pDst, const pixel_t *pSrc, int nDstPitch, int nSrcPitch, int nWidth, int nHeight, int ystart, int yend)
+{
+  typedef Lanes<pixel_t> L;
+  const int srcWidth = nWidth * 2;
+  const __m256i rnd = L::set1(4);
+
+  // ctB^1siCłpDst𒆊ԃobt@ɎgĂ邪ł͕ʂɎj
+  std::unique_ptr<pixel_t[]> tmp(new pixel_t[srcWidth]);
+  pixel_t* t = tmp.get();
+
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* s = pSrc + y * 2 * nSrcPitch;
+    if (y < 1 || y >= nHeight - 1) {
+      AverageRow(t, s, s + nSrcPitch, srcWidth);
+    }
+    else {
+      int x = 0;
+      for (; x + L::N <= srcWidth; x += L::N) {
+        __m256i a = L::load(s + x - nSrcPitch);
+        __m256i b = L::load(s + x);
+        __m256i c = L::load(s + x + nSrcPitch);
+        __m256i d = L::load(s + x + nSrcPitch * 2);
+        __m256i bc = L::add(b, c);
+        __m256i v = L::add(L::add(a, d), L::add(L::template shl<1>(bc), bc));
+        L::store(t + x, L::template sar<3>(L::add(v, rnd)));
+      }
+      for (; x < srcWidth; ++x) {
+        t[x] = (s[x - nSrcPitch] + s[x] * 3 + s[x + nSrcPitch] * 3 + s[x + nSrcPitch * 2] + 4) / 8;
+      }
+    }
+
+    pixel_t* d = pDst + y * nDstPitch;
+    d[0] = (t[0] + t[1] + 1) >> 1;
+    int x = 1;
+    // ԖڂƊԖڂɕēǂ߂Ή1/2Ԉ̂܂܏o
+    for (; x + L::N <= nWidth - 1; x += L::N) {
+      __m256i e0 = L::load_even(t + x * 2);
+      __m256i e1 = L::load_even(t + x * 2 + 2);
+      __m256i om = L::load_odd(t + x * 2 - 2);
+      __m256i o0 = L::load_odd(t + x * 2);
+      __m256i eo = L::add(e0, o0);
+      __m256i v = L::add(L::add(om, e1), L::add(L::template shl<1>(eo), eo));
+      L::store(d + x, L::template sar<3>(L::add(v, rnd)));
+    }
+    for (; x < nWidth - 1; ++x) {
+      d[x] = (t[x * 2 - 1] + t[x * 2] * 3 + t[x * 2 + 1] * 3 + t[x * 2 + 2] + 4) / 8;
+    }
+    for (x = std::max(nWidth - 1, 1); x < nWidth; ++x) {
+      d[x] = (t[x * 2] + t[x * 2 + 1] + 1) >> 1;
+    }
+  }
+}
+
+template <typename pixel_t>
+void VerticalWiener_AVX2(pixel_t *pDst, const pixel_t *pSrc, int nDstPitch,
+  int nSrcPitch, int nWidth, int nHeight, int bits_per_pixel, int ystart, int yend)
+{
+  typedef Lanes<pixel_t> L;
+  const int max_pixel_value = sizeof(pixel_t) == 1 ? 255 : (1 << bits_per_pixel) - 1;
+  const __m256i maxv = L::set1(max_pixel_value);
+
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* s = pSrc + y * nSrcPitch;
+    pixel_t* d = pDst + y * nDstPitch;
+    if (y == nHeight - 1) {
+      std::copy(s, s + nWidth, d);
+    }
+    else if (y < 2 || y >= nHeight - 4) {
+      AverageRow(d, s, s + nSrcPitch, nWidth);
+    }
+    else {
+      int x = 0;
+      for (; x + L::N <= nWidth; x += L::N) {
+        L::store(d + x, Wiener6<pixel_t>(
+          L::load(s + x - nSrcPitch * 2), L::load(s + x - nSrcPitch), L::load(s + x),
+          L::load(s + x + nSrcPitch), L::load(s + x + nSrcPitch * 2), L::load(s + x + nSrcPitch * 3), maxv));
+      }
+      for (; x < nWidth; ++x) {
+        d[x] = std::min(max_pixel_value, std::max(0,
+          ((s[x - nSrcPitch * 2])
+            + (-(s[x - nSrcPitch]) + (s[x] << 2) + (s[x + nSrcPitch] << 2) - (s[x + nSrcPitch * 2])) * 5
+            + (s[x + nSrcPitch * 3]) + 16) >> 5));
+      }
+    }
+  }
+}
+
+template <typename pixel_t>
+void HorizontalWiener_AVX2(pixel_t *pDst, const pixel_t *pSrc, int nDstPitch,
+  int nSrcPitch, int nWidth, int nHeight, int bits_per_pixel, int ystart, int yend)
+{
+  typedef Lanes<pixel_t> L;
+  const int max_pixel_value = sizeof(pixel_t) == 1 ? 255 : (1 << bits_per_pixel) - 1;
+  const __m256i maxv = L::set1(max_pixel_value);
+
+  for (int y = ystart; y < yend; ++y) {
+    const pixel_t* s = pSrc + y * nSrcPitch;
+    pixel_t* d = pDst + y * nDstPitch;
+    d[0] = (s[0] + s[1] + 1) >> 1;
+    d[1] = (s[1] + s[2] + 1) >> 1;
+    int x = 2;
+    for (; x + L::N <= nWidth - 4; x += L::N) {
+      L::store(d + x, Wiener6<pixel_t>(
+        L::load(s + x - 2), L::load(s + x - 1), L::load(s + x),
+        L::load(s + x + 1), L::load(s + x + 2), L::load(s + x + 3), maxv));
+    }
+    for (; x < nWidth - 4; ++x) {
+      d[x] = std::min(max_pixel_value, std::max(0, ((s[x - 2]) + (-(s[x - 1]) + (s[x] << 2)
+        + (s[x + 1] << 2) - (s[x + 2])) * 5 + (s[x + 3]) + 16) >> 5));
+    }
+    for (x = nWidth - 4; x < nWidth - 1; ++x) {
+      d[x] = (s[x] + s[x + 1] + 1) >> 1;
+    }
+    d[nWidth - 1] = s[nWidth - 1];
+  }
+}
+
+template void RB2BilinearFiltered_AVX2<uint8_t>(
+  uint8_t *pDst, const uint8_t *pSrc, int nDstPitch, int nSrcPitch, int nWidth, int nHeight, int ystart, int yend);
+template void RB2BilinearFiltered_AVX2<uint16_t>(
+  uint16_t *pDst, const uint16_t *pSrc, int nDstPitch, int nSrcPitch, int nWidth, int nHeight, int ystart, int yend);
+template void VerticalWiener_AVX2<uint8_t>(uint8_t *pDst, const uint8_t *pSrc, int nDstPitch,
+  int nSrcPitch, int nWidth, int nHeight, int bits_per_pixel, int ystart, int yend);
+template void VerticalWiener_AVX2<uint16_t>(uint16_t *pDst, const uint16_t *pSrc, int nDstPitch,
+  int nSrcPitch, int nWidth, int nHeight, int bits_per_pixel, int ystart, int yend);
+template void HorizontalWiener_AVX2<uint8_t>(uint8_t *pDst, const uint8_t *pSrc, int nDstPitch,
+  int nSrcPitch, int nWidth, int nHeight, int bits_per_pixel, int ystart, int yend);
+template void HorizontalWiener_AVX2<uint16_t>(uint16_t *pDst, const uint16_t *pSrc, int nDstPitch,
+  int nSrcPitch, int nWidth, int nHeight, int bits_per_pixel, int ystart, int yend);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+// CPUKMSuperŎgAVX2֐
+// pitch͗vfioCgł͂Ȃj
+// ʂCŁiRB2BilinearFiltered, VerticalWiener, HorizontalWienerjƊSɈv
+// s͈[ystart,yend)̂ŁAĂяoōs𕪊ĕɌĂׂ
+
+template <typename pixel_t>
+void RB2BilinearFiltered_AVX2(
+  pixel_t *pDst, const pixel_t *pSrc, int nDstPitch, int nSrcPitch, int nWidth, int nHeight, int ystart, int yend);
+
+template <typename pixel_t>
+void VerticalWiener_AVX2(pixel_t *pDst, const pixel_t *pSrc, int nDstPitch,
+  int nSrcPitch, int nWidth, int nHeight, int bits_per_pixel, int ystart, int yend);
+
+template <typename pixel_t>
+void HorizontalWiener_AVX2(pixel_t *pDst, const pixel_t *pSrc, int nDstPitch,
+  int nSrcPitch, int nWidth, int nHeight, int bits_per_pixel, int ystart, int yend);
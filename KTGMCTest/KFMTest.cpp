@@ -7,9 +7,12 @@ protected:
   KFMTest() { }
 
   void TemporalNRTest(TEST_FRAMES tf);
-  void DebandTest(TEST_FRAMES tf, int sample_mode, bool blur_first);
+  void DebandTest(TEST_FRAMES tf, int sample_mode, bool blur_first, bool rand_hash);
+  void DebandBenchTest(int bits);
   void EdgeLevelTest(TEST_FRAMES tf, int repair, bool chroma);
 
+  void CombeBenchTest(int bits);
+
   void CFieldDiffTest(int nt, bool chroma);
   void CFrameDiffDupTest(int blocksize, bool chroma);
 
@@ -57,6 +60,58 @@ TEST_F(KFMTest, AnalyzeStaticTest)
   }
 }
 
+TEST_F(KFMTest, AnalyzeStaticRandomAccessTest)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KFM.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "src.KAnalyzeStatic(30, 15)" << std::endl;
+
+    out.close();
+
+    // ʃCX^XԂɎ擾̂ƔєтɎ擾̂v
+    PClip seq = env->Invoke("Import", scriptpath.c_str()).AsClip();
+    PClip rnd = env->Invoke("Import", scriptpath.c_str()).AsClip();
+
+    enum { N = 16 };
+    const int order[N] = { 8, 9, 10, 3, 2, 1, 15, 14, 0, 7, 6, 11, 12, 5, 4, 13 };
+    int start = seq->GetVideoInfo().num_frames / 2;
+
+    PVideoFrame seqFrames[N];
+    for (int i = 0; i < N; ++i) {
+      seqFrames[i] = seq->GetFrame(start + i, env.get());
+    }
+    const int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+    for (int i = 0; i < N; ++i) {
+      PVideoFrame a = seqFrames[order[i]];
+      PVideoFrame b = rnd->GetFrame(start + order[i], env.get());
+      for (int p : planes) {
+        for (int y = 0; y < a->GetHeight(p); ++y) {
+          ASSERT_EQ(memcmp(
+            a->GetReadPtr(p) + y * a->GetPitch(p),
+            b->GetReadPtr(p) + y * b->GetPitch(p), a->GetRowSize(p)), 0);
+        }
+      }
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
 TEST_F(KFMTest, AnalyzeStaticSuperTest)
 {
   PEnv env;
@@ -249,6 +304,255 @@ TEST_F(KFMTest, PreCycleAnalyzeTest)
   }
 }
 
+void KFMTest::CombeBenchTest(int bits)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string ktgmcPath = modulePath + "\\KFM.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    // AVX2ł̌ʂCłƈvȂꍇ̓G[ɂȂ
+    AVSValue args[] = { bits, 20 };
+    env->Invoke("KFMCombeBench", AVSValue(args, 2));
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KFMTest, CombeBench_8bit)
+{
+  CombeBenchTest(8);
+}
+
+TEST_F(KFMTest, CombeBench_16bit)
+{
+  CombeBenchTest(16);
+}
+
+TEST_F(KFMTest, CycleAnalyzePrefetchTest)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KFM.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    // ǂ݂ĂȂĂ1pXڂ̌ʂ͓ɂȂ
+    out << "src = LWLibavVideoSource(\"test.ts\").OnCPU(0)" << std::endl;
+    out << "pre = src.KFMSuper(src.KFMPad()).KPreCycleAnalyze()" << std::endl;
+
+    out << "ref = pre.KFMCycleAnalyze(src, mode=1, prefetch=0, filepath=\"kfm_noprefetch\").OnCPU(0)" << std::endl;
+    out << "pf = pre.KFMCycleAnalyze(src, mode=1, prefetch=8, filepath=\"kfm_prefetch\").OnCPU(0)" << std::endl;
+
+    out << "ImageCompare(ref, pf, 0)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, TF_MID, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KFMTest, CycleAnalyzeResultFileTest)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KFM.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    // 1pX Ō܂ŉ񂵂Čʃt@C
+    out << "src = LWLibavVideoSource(\"test.ts\").OnCPU(0)" << std::endl;
+    out << "pre = src.KFMSuper(src.KFMPad()).KPreCycleAnalyze()" << std::endl;
+    out << "pre.KFMCycleAnalyze(src, mode=1, filepath=\"kfm_resultfile\").OnCPU(0)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, TF_END, env.get());
+    }
+
+    out.open(scriptpath);
+
+    // 2pX t@Cǂ񂾌ʂ1pXڂ̌ʂɂȂ
+    out << "src = LWLibavVideoSource(\"test.ts\").OnCPU(0)" << std::endl;
+    out << "pre = src.KFMSuper(src.KFMPad()).KPreCycleAnalyze()" << std::endl;
+    out << "ref = pre.KFMCycleAnalyze(src, mode=1, filepath=\"kfm_resultfile_ref\").OnCPU(0)" << std::endl;
+    out << "rd = pre.KFMCycleAnalyze(src, mode=2, filepath=\"kfm_resultfile\").OnCPU(0)" << std::endl;
+
+    out << "ImageCompare(ref, rd, 0)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, TF_END, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KFMTest, CycleAnalyzeResumeTest)
+{
+  // O̎sŎct@CĊJȂ悤ɏĂ
+  DeleteFileA((workDirPath + "\\kfm_resume.result.dat").c_str());
+  DeleteFileA((workDirPath + "\\kfm_resume_ref.result.dat").c_str());
+
+  PEnv env;
+  try {
+    std::string scriptpath = workDirPath + "\\script.avs";
+    std::string header =
+      "src = LWLibavVideoSource(\"test.ts\").OnCPU(0)\n"
+      "pre = src.KFMSuper(src.KFMPad()).KPreCycleAnalyze()\n";
+
+    // 1pXڂŌ܂Œʂĉ񂵂
+    // rŎ~߂́iTCN100..107܂ 10TCNƂɃ`FbN|Cgj
+    // ~߂̂JčŌ܂ŉ񂵂
+    // ̏Ɏs
+    const char* scripts[] = {
+      "pre.KFMCycleAnalyze(src, mode=1, checkpoint=10, filepath=\"kfm_resume_ref\").OnCPU(0)\n",
+      "pre.KFMCycleAnalyze(src, mode=1, checkpoint=10, filepath=\"kfm_resume\").OnCPU(0)\n",
+      "pre.KFMCycleAnalyze(src, mode=1, checkpoint=10, filepath=\"kfm_resume\").OnCPU(0)\n",
+    };
+    TEST_FRAMES frames[] = { TF_END, TF_MID, TF_END };
+
+    for (int i = 0; i < 3; ++i) {
+      env = PEnv(CreateScriptEnvironment2());
+
+      AVSValue result;
+      std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+      env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+      std::string ktgmcPath = modulePath + "\\KFM.dll";
+      env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+      std::ofstream out(scriptpath);
+      out << header << scripts[i];
+      out.close();
+
+      {
+        PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+        GetFrames(clip, frames[i], env.get());
+      }
+
+      if (i == 1) {
+        // rŎ~߂̂͂܂ĂȂ
+        out.open(scriptpath);
+        out << header << "pre.KFMCycleAnalyze(src, mode=2, filepath=\"kfm_resume\").OnCPU(0)\n";
+        out.close();
+        EXPECT_THROW(env->Invoke("Import", scriptpath.c_str()).AsClip(), AvisynthError);
+      }
+
+      env = nullptr;
+    }
+
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KFM.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    // `FbN|Cg߂̌̕ʂĉ񂵂̂ƓɂȂ
+    std::ofstream out(scriptpath);
+    out << header;
+    out << "ref = pre.KFMCycleAnalyze(src, mode=2, filepath=\"kfm_resume_ref\").OnCPU(0)" << std::endl;
+    out << "rd = pre.KFMCycleAnalyze(src, mode=2, filepath=\"kfm_resume\").OnCPU(0)" << std::endl;
+    out << "ImageCompare(ref, rd, 0)" << std::endl;
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, TF_100, env.get());
+      GetFrames(clip, TF_MID, env.get());
+      GetFrames(clip, TF_END, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KFMTest, CycleAnalyzeFingerprintTest)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KFM.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    // 1pX
+    out << "src = LWLibavVideoSource(\"test.ts\").OnCPU(0)" << std::endl;
+    out << "pre = src.KFMSuper(src.KFMPad()).KPreCycleAnalyze()" << std::endl;
+    out << "pre.KFMCycleAnalyze(src, mode=1, filepath=\"kfm_fingerprint\").OnCPU(0)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, TF_END, env.get());
+    }
+
+    out.open(scriptpath);
+
+    // łʂ̃\[Xōʃt@C͓ǂ܂Ȃ
+    out << "src = LWLibavVideoSource(\"test.ts\").FlipVertical().OnCPU(0)" << std::endl;
+    out << "pre = src.KFMSuper(src.KFMPad()).KPreCycleAnalyze()" << std::endl;
+    out << "pre.KFMCycleAnalyze(src, mode=2, filepath=\"kfm_fingerprint\").OnCPU(0)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      EXPECT_THROW(clip->GetFrame(0, env.get()), AvisynthError);
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
 TEST_F(KFMTest, TelecineTest)
 {
   PEnv env;
@@ -579,7 +883,7 @@ TEST_F(KFMTest, TemporalNRTest)
 
 #pragma region Deband
 
-void KFMTest::DebandTest(TEST_FRAMES tf, int sample_mode, bool blur_first)
+void KFMTest::DebandTest(TEST_FRAMES tf, int sample_mode, bool blur_first, bool rand_hash)
 {
   PEnv env;
   try {
@@ -596,12 +900,13 @@ void KFMTest::DebandTest(TEST_FRAMES tf, int sample_mode, bool blur_first)
     std::ofstream out(scriptpath);
 
     const char* blur_str = blur_first ? "true" : "false";
+    const char* hash_str = rand_hash ? "true" : "false";
 
     out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
     out << "srcuda = src.OnCPU(0)" << std::endl;
 
-    out << "ref = src.KDeband(25, 4, " << sample_mode << ", " << blur_str << ")" << std::endl;
-    out << "cuda = srcuda.KDeband(25, 4, " << sample_mode << ", " << blur_str << ")" O_C(0) "" << std::endl;
+    out << "ref = src.KDeband(25, 4, " << sample_mode << ", " << blur_str << ", " << hash_str << ")" << std::endl;
+    out << "cuda = srcuda.KDeband(25, 4, " << sample_mode << ", " << blur_str << ", " << hash_str << ")" O_C(0) "" << std::endl;
 
     out << "ImageCompare(ref, cuda, 1)" << std::endl;
 
@@ -620,32 +925,72 @@ void KFMTest::DebandTest(TEST_FRAMES tf, int sample_mode, bool blur_first)
 
 TEST_F(KFMTest, DebandTest_Mode0F)
 {
-  DebandTest(TF_MID, 0, false);
+  DebandTest(TF_MID, 0, false, false);
 }
 
 TEST_F(KFMTest, DebandTest_Mode1F)
 {
-  DebandTest(TF_MID, 1, false);
+  DebandTest(TF_MID, 1, false, false);
 }
 
 TEST_F(KFMTest, DebandTest_Mode2F)
 {
-  DebandTest(TF_MID, 2, false);
+  DebandTest(TF_MID, 2, false, false);
 }
 
 TEST_F(KFMTest, DebandTest_Mode0T)
 {
-  DebandTest(TF_MID, 0, true);
+  DebandTest(TF_MID, 0, true, false);
 }
 
 TEST_F(KFMTest, DebandTest_Mode1T)
 {
-  DebandTest(TF_MID, 1, true);
+  DebandTest(TF_MID, 1, true, false);
 }
 
 TEST_F(KFMTest, DebandTest_Mode2T)
 {
-  DebandTest(TF_MID, 2, true);
+  DebandTest(TF_MID, 2, true, false);
+}
+
+TEST_F(KFMTest, DebandTest_Mode1F_Hash)
+{
+  DebandTest(TF_MID, 1, false, true);
+}
+
+TEST_F(KFMTest, DebandTest_Mode2T_Hash)
+{
+  DebandTest(TF_MID, 2, true, true);
+}
+
+void KFMTest::DebandBenchTest(int bits)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string ktgmcPath = modulePath + "\\KFM.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    // S[hirand_hash/ȂjAVX2ł̌ʂCłƈvȂꍇ̓G[ɂȂ
+    AVSValue args[] = { bits, 5 };
+    env->Invoke("KDebandBench", AVSValue(args, 2));
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KFMTest, DebandBench_8bit)
+{
+  DebandBenchTest(8);
+}
+
+TEST_F(KFMTest, DebandBench_16bit)
+{
+  DebandBenchTest(16);
 }
 
 #pragma endregion
@@ -7,23 +7,41 @@ protected:
   KTGMCTest() { }
 
   void MSuperTest(TEST_FRAMES tf, bool chroma, int pel, int level);
+  void MSuperCPUTest(TEST_FRAMES tf, bool chroma, int pel, bool mt);
   void AnalyzeTest(TEST_FRAMES tf, bool cuda, int blksize, bool chroma, int pel, int batch);
+  void AnalyzeMTTest(TEST_FRAMES tf, int blksize, bool chroma, int pel, int batch);
+  void AnalyzeKernelCPUTest(TEST_FRAMES tf, int blksize, bool chroma, int pel, int batch);
+  void AnalyzeCacheTest(TEST_FRAMES tf, int blksize, int pel);
+  void AnalyzeStatsTest(TEST_FRAMES tf, int blksize, bool mt);
+  void AnalyzeAdaptiveTest(TEST_FRAMES tf, int blksize, int search, int adaptive);
   void DegrainTest(TEST_FRAMES tf, int N, int blksize, int pel);
+  void DegrainKernelCPUTest(TEST_FRAMES tf, int N, int blksize, int pel);
+  void DegrainMTTest(TEST_FRAMES tf, int N, int blksize, int pel);
+  void DegrainCompactTest(TEST_FRAMES tf, int blksize, bool chroma);
   void DegrainBinomialTest(TEST_FRAMES tf, int N, int blksize, int pel);
   void CompensateTest(TEST_FRAMES tf, int blksize, int pel);
   void MVReplaceTest(TEST_FRAMES tf, bool kvm);
+  void SADBenchTest(int bits);
 
   void BobTest(TEST_FRAMES tf, bool parity);
+  void BobCPUTest(TEST_FRAMES tf, bool parity);
   void BinomialSoftenTest(TEST_FRAMES tf, int radius, bool chroma);
+  void BinomialSoftenCPUTest(TEST_FRAMES tf, int radius, bool chroma);
   void RemoveGrainTest(TEST_FRAMES tf, int mode, bool chroma);
+  void RemoveGrainCPUTest(TEST_FRAMES tf, int mode, bool chroma);
   void RepairTest(TEST_FRAMES tf, int mode, bool chroma);
+  void RepairCPUTest(TEST_FRAMES tf, int mode, bool chroma);
   void VerticalCleanerTest(TEST_FRAMES tf, int mode, bool chroma);
+  void VerticalCleanerCPUTest(TEST_FRAMES tf, int mode, bool chroma);
   void GaussResizeTest(TEST_FRAMES tf, bool chroma);
+  void GaussResizeCPUTest(TEST_FRAMES tf, bool chroma);
 
   void InpandVerticalX2Test(TEST_FRAMES tf, bool chroma);
+  void XpandVerticalX2CPUTest(TEST_FRAMES tf, bool expand, bool chroma);
   void ExpandVerticalX2Test(TEST_FRAMES tf, bool chroma);
   void MakeDiffTest(TEST_FRAMES tf, bool chroma, bool makediff);
   void LogicTest(TEST_FRAMES tf, const char* mode, bool chroma);
+  void ExprTest(TEST_FRAMES tf, bool cuda, bool chroma, const char* expr, int bits);
 
   void BobShimmerFixesMergeTest(TEST_FRAMES tf, int rep, bool chroma);
   void VResharpenTest(TEST_FRAMES tf);
@@ -36,6 +54,7 @@ protected:
 
   void MergeTest(TEST_FRAMES tf, bool chroma);
   void WeaveTest(TEST_FRAMES tf, bool parity, bool dbl);
+  void WeaveCPUTest(TEST_FRAMES tf, bool parity);
   void CopyTest(TEST_FRAMES tf, bool cuda);
 
   void NNEDI3Test(TEST_FRAMES tf, bool chroma, int nsize, int nns, int qual, int pscrn);
@@ -111,6 +130,53 @@ TEST_F(KTGMCTest, MSuper_NoCPel1Level0)
   MSuperTest(TF_MID, false, 1, 0);
 }
 
+void KTGMCTest::MSuperCPUTest(TEST_FRAMES tf, bool chroma, int pel, bool mt)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    const char* chromastr = chroma ? "true" : "false";
+
+    // CPUŁiAVX2AxƖʂ̕񏈗jMSuperƈv邩
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "ref = src.MSuper(chroma = " << chromastr << ", pel = " << pel << ")" << std::endl;
+    out << "cpu = src.KMSuper(chroma = " << chromastr << ", pel = " << pel << ", mt = " << (mt ? "true" : "false") << ")" << std::endl;
+    out << "KMSuperCheck(cpu, ref, src)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, MSuperCPU_WithCPel2MT)
+{
+  MSuperCPUTest(TF_MID, true, 2, true);
+}
+
+TEST_F(KTGMCTest, MSuperCPU_NoCPel1NoMT)
+{
+  MSuperCPUTest(TF_MID, false, 1, false);
+}
+
 #pragma endregion
 
 #pragma region Analyze
@@ -258,11 +324,7 @@ TEST_F(KTGMCTest, Analyze_Blk32NoCPel1Batch8End)
   AnalyzeTest(TF_END, true, 32, false, 1, 8);
 }
 
-#pragma endregion
-
-#pragma region Degrain
-
-void KTGMCTest::DegrainTest(TEST_FRAMES tf, int N, int blksize, int pel)
+void KTGMCTest::AnalyzeMTTest(TEST_FRAMES tf, int blksize, bool chroma, int pel, int batch)
 {
   PEnv env;
   try {
@@ -278,63 +340,16 @@ void KTGMCTest::DegrainTest(TEST_FRAMES tf, int N, int blksize, int pel)
 
     std::ofstream out(scriptpath);
 
-    // V[`FW肳ƃeXgłȂ̂łl10{ɂĂ
-
-    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
-    out << "srcuda = src.OnCPU(0)" << std::endl;
-    out << "s = src.KMSuper(pel = " << pel << ")" << std::endl;
-    out << "scuda = s.OnCPU(0)" << std::endl;
-    out << "pmvb = s.KMPartialSuper().KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
-      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
-    out << "pmvf = s.KMPartialSuper().KMAnalyse(isb = false, delta = 1, chroma = false, blksize = " << blksize <<
-      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
-    if (N >= 2) {
-      out << "pmvb1 = s.KMPartialSuper().KMAnalyse(isb = true, delta = 2, chroma = false, blksize = " << blksize <<
-        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
-      out << "pmvf1 = s.KMPartialSuper().KMAnalyse(isb = false, delta = 2, chroma = false, blksize = " << blksize <<
-        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
-    }
-    if (true) { // MV CUDA
-      out << "mvb = scuda.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
-        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb.OnCPU(0))" << std::endl;
-      out << "mvf = scuda.KMAnalyse(isb = false, delta = 1, chroma = false, blksize = " << blksize <<
-        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvf.OnCPU(0))" << std::endl;
-      if (N >= 2) {
-        out << "mvb1 = scuda.KMAnalyse(isb = true, delta = 2, chroma = false, blksize = " << blksize <<
-          ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb1.OnCPU(0))" << std::endl;
-        out << "mvf1 = scuda.KMAnalyse(isb = false, delta = 2, chroma = false, blksize = " << blksize <<
-          ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvf1.OnCPU(0))" << std::endl;
-      }
-      if (N == 1) {
-        out << "degref = src.KMDegrain1(s, mvb" << O_C(0) << ", mvf" << O_C(0) << ", thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << std::endl;
-        out << "degcuda = srcuda.KMDegrain1(scuda, mvb, mvf, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << O_C(0) << std::endl;
-      }
-      else if (N == 2) {
-        out << "degref = src.KMDegrain2(s, mvb" << O_C(0) << ", mvf" << O_C(0) << ", mvb1" << O_C(0) << ", mvf1" << O_C(0) << ", thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << std::endl;
-        out << "degcuda = srcuda.KMDegrain2(scuda, mvb, mvf, mvb1, mvf1, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << O_C(0) << std::endl;
-      }
-    }
-    else {
-      out << "mvb = s.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
-        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb)" << std::endl;
-      out << "mvf = s.KMAnalyse(isb = false, delta = 1, chroma = false, blksize = " << blksize <<
-        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvf)" << std::endl;
-      if (N >= 2) {
-        out << "mvb1 = s.KMAnalyse(isb = true, delta = 2, chroma = false, blksize = " << blksize <<
-          ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb1)" << std::endl;
-        out << "mvf1 = s.KMAnalyse(isb = false, delta = 2, chroma = false, blksize = " << blksize <<
-          ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvf1)" << std::endl;
-      }
-      if (N == 1) {
-        out << "degref = src.KMDegrain1(s, mvb, mvf, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << std::endl;
-        out << "degcuda = srcuda.KMDegrain1(scuda, mvb.OnCPU(0), mvf.OnCPU(0), thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << O_C(0) << std::endl;
-      }
-      else if (N == 2) {
-        out << "degref = src.KMDegrain2(s, mvb, mvf, mvb1, mvf1, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << std::endl;
-        out << "degcuda = srcuda.KMDegrain2(scuda, mvb.OnCPU(0), mvf.OnCPU(0), mvb1.OnCPU(0), mvf1.OnCPU(0), thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << O_C(0) << std::endl;
-      }
-    }
-    out << "ImageCompare(degref, degcuda)" << std::endl;
+    // CPUł̃EF[utgTAob`TTƈv邩
+    out << "LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "s = KMSuper(pel = " << pel << ")" << std::endl;
+    out << "karef = s.KMAnalyse(isb = true, delta = 1, chroma = " <<
+      (chroma ? "true" : "false") << ", blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, mt = false)" << std::endl;
+    out << "kamt = s.KMAnalyse(isb = true, delta = 1, chroma = " <<
+      (chroma ? "true" : "false") << ", blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, mt = true, batch = " << batch << ")" << std::endl;
+    out << "KMAnalyzeCheck2(karef, kamt, last)" << std::endl;
 
     out.close();
 
@@ -349,77 +364,113 @@ void KTGMCTest::DegrainTest(TEST_FRAMES tf, int N, int blksize, int pel)
   }
 }
 
-TEST_F(KTGMCTest, Degrain_1Blk8Pel2)
+TEST_F(KTGMCTest, AnalyzeMT_Blk8WithCPel2)
 {
-  DegrainTest(TF_MID, 1, 8, 2);
+  AnalyzeMTTest(TF_MID, 8, true, 2, 1);
 }
 
-TEST_F(KTGMCTest, Degrain_1Blk8Pel1)
+TEST_F(KTGMCTest, AnalyzeMT_Blk16NoCPel1)
 {
-  DegrainTest(TF_MID, 1, 8, 1);
+  AnalyzeMTTest(TF_MID, 16, false, 1, 1);
 }
 
-TEST_F(KTGMCTest, Degrain_1Blk16Pel2)
+TEST_F(KTGMCTest, AnalyzeMT_Blk32WithCPel1)
 {
-  DegrainTest(TF_MID, 1, 16, 2);
+  AnalyzeMTTest(TF_MID, 32, true, 1, 1);
 }
 
-TEST_F(KTGMCTest, Degrain_1Blk16Pel1)
+TEST_F(KTGMCTest, AnalyzeMT_Blk16WithCPel2Batch8)
 {
-  DegrainTest(TF_MID, 1, 16, 1);
+  AnalyzeMTTest(TF_MID, 16, true, 2, 8);
 }
 
-TEST_F(KTGMCTest, Degrain_1Blk32Pel2)
+// dirɂbasenamẽLbVt@CSďit@Cɂ̓p[^̃nbVtj
+static void DeleteAnalyzeCacheFiles(const std::string& dir, const std::string& basename)
 {
-  DegrainTest(TF_MID, 1, 32, 2);
+  WIN32_FIND_DATAA fd;
+  HANDLE hFind = FindFirstFileA((dir + "\\" + basename + "_*.kmvcache").c_str(), &fd);
+  if (hFind == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  do {
+    DeleteFileA((dir + "\\" + fd.cFileName).c_str());
+  } while (FindNextFileA(hFind, &fd));
+  FindClose(hFind);
 }
 
-TEST_F(KTGMCTest, Degrain_1Blk32Pel1)
+void KTGMCTest::AnalyzeCacheTest(TEST_FRAMES tf, int blksize, int pel)
 {
-  DegrainTest(TF_MID, 1, 32, 1);
-}
+  std::string cachename = "analyze-cache-test";
+  std::string cachepath = workDirPath + "\\" + cachename;
 
-TEST_F(KTGMCTest, Degrain_2Blk8Pel2)
-{
-  DegrainTest(TF_MID, 2, 8, 2);
-}
+  // O̎sŎcLbVŃqbgȂ悤ɏĂ
+  DeleteAnalyzeCacheFiles(workDirPath, cachename);
 
-TEST_F(KTGMCTest, Degrain_2Blk8Pel1)
-{
-  DegrainTest(TF_MID, 2, 8, 1);
-}
+  // 1ڂ̓LbVɏ݁A2ڂ̓LbVǂݏo
+  for (int pass = 0; pass < 2; ++pass) {
+    PEnv env;
+    try {
+      env = PEnv(CreateScriptEnvironment2());
 
-TEST_F(KTGMCTest, Degrain_2Blk16Pel2)
-{
-  DegrainTest(TF_MID, 2, 16, 2);
-}
+      AVSValue result;
+      std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+      env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+      std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+      env->LoadPlugin(ktgmcPath.c_str(), true, &result);
 
-TEST_F(KTGMCTest, Degrain_2Blk16Pel1)
-{
-  DegrainTest(TF_MID, 2, 16, 1);
-}
+      std::string scriptpath = workDirPath + "\\script.avs";
 
-TEST_F(KTGMCTest, Degrain_2Blk32Pel2)
-{
-  DegrainTest(TF_MID, 2, 32, 2);
-}
+      {
+        std::ofstream out(scriptpath);
 
-TEST_F(KTGMCTest, Degrain_2Blk32Pel1)
-{
-  DegrainTest(TF_MID, 2, 32, 1);
-}
+        // 1ڂ͑Să~XA2ڂ͑Săqbg邩
+        out << "LWLibavVideoSource(\"test.ts\")" << std::endl;
+        out << "s = KMSuper(pel = " << pel << ")" << std::endl;
+        out << "s.KMAnalyse(isb = true, delta = 1, chroma = true, blksize = " << blksize <<
+          ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, cache = \"" <<
+          cachepath << "\")" << std::endl;
 
-TEST_F(KTGMCTest, Degrain_2Blk16Pel2Begin)
-{
-  DegrainTest(TF_BEGIN, 2, 16, 2);
+        out.close();
+
+        PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+        for (int i = 0; i < 8; ++i) {
+          PVideoFrame frame = clip->GetFrame(100 + i, env.get());
+          EXPECT_EQ(pass, frame->GetProperty("KMVCacheHit", 0));
+        }
+      }
+
+      {
+        std::ofstream out(scriptpath);
+
+        // LbVʂʂʏ̒Tƈv邩
+        out << "LWLibavVideoSource(\"test.ts\")" << std::endl;
+        out << "s = KMSuper(pel = " << pel << ")" << std::endl;
+        out << "karef = s.KMAnalyse(isb = true, delta = 1, chroma = true, blksize = " << blksize <<
+          ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+        out << "kacache = s.KMAnalyse(isb = true, delta = 1, chroma = true, blksize = " << blksize <<
+          ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, cache = \"" <<
+          cachepath << "\")" << std::endl;
+        out << "KMAnalyzeCheck2(karef, kacache, last)" << std::endl;
+
+        out.close();
+
+        PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+        GetFrames(clip, tf, env.get());
+      }
+    }
+    catch (const AvisynthError& err) {
+      printf("%s\n", err.msg);
+      GTEST_FAIL();
+    }
+  }
 }
 
-TEST_F(KTGMCTest, Degrain_2Blk16Pel1End)
+TEST_F(KTGMCTest, AnalyzeCache_Blk16Pel2)
 {
-  DegrainTest(TF_END, 2, 16, 2);
+  AnalyzeCacheTest(TF_MID, 16, 2);
 }
 
-void KTGMCTest::DegrainBinomialTest(TEST_FRAMES tf, int N, int blksize, int pel)
+void KTGMCTest::AnalyzeStatsTest(TEST_FRAMES tf, int blksize, bool mt)
 {
   PEnv env;
   try {
@@ -433,39 +484,47 @@ void KTGMCTest::DegrainBinomialTest(TEST_FRAMES tf, int N, int blksize, int pel)
 
     std::string scriptpath = workDirPath + "\\script.avs";
 
-    std::ofstream out(scriptpath);
-
-    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
-    out << "srcuda = src.OnCPU(0)" << std::endl;
-    out << "s = src.KMSuper(pel = " << pel << ")" << std::endl;
-    out << "scuda = s.OnCPU(0)" << std::endl;
-    out << "pmvb = s.KMPartialSuper().KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
-      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
-    out << "pmvf = s.KMPartialSuper().KMAnalyse(isb = false, delta = 1, chroma = false, blksize = " << blksize <<
-      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
-    out << "pmvb1 = s.KMPartialSuper().KMAnalyse(isb = true, delta = 2, chroma = false, blksize = " << blksize <<
-      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
-    out << "pmvf1 = s.KMPartialSuper().KMAnalyse(isb = false, delta = 2, chroma = false, blksize = " << blksize <<
-      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
-    out << "mvb = scuda.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
-      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb.OnCPU(0))" << std::endl;
-    out << "mvf = scuda.KMAnalyse(isb = false, delta = 1, chroma = false, blksize = " << blksize <<
-      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvf.OnCPU(0))" << std::endl;
-    out << "mvb1 = scuda.KMAnalyse(isb = true, delta = 2, chroma = false, blksize = " << blksize <<
-      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb1.OnCPU(0))" << std::endl;
-    out << "mvf1 = scuda.KMAnalyse(isb = false, delta = 2, chroma = false, blksize = " << blksize <<
-      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvf1.OnCPU(0))" << std::endl;
+    {
+      std::ofstream out(scriptpath);
 
-    out << "bindeg = srcuda.KMDegrain2(scuda, mvb, mvf, mvb1, mvf1, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980, binomial = true)" O_C(0) << std::endl;
-    out << "deg1 = srcuda.KMDegrain1(scuda, mvb, mvf, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" O_C(0) << std::endl;
-    out << "deg2 = srcuda.KMDegrain1(scuda, mvb1, mvf1, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" O_C(0) << std::endl;
-    out << "binref = deg1.Merge(deg2, 0.2).Merge(src, 0.0625)" << std::endl;
+      // v̗݌vTubNƍĂ邩
+      out << "LWLibavVideoSource(\"test.ts\")" << std::endl;
+      out << "s = KMSuper(pel = 2)" << std::endl;
+      out << "s.KMAnalyse(isb = true, delta = 1, chroma = true, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, mt = " <<
+        (mt ? "true" : "false") << ", stats = true)" << std::endl;
 
-    out << "ImageCompare(binref, bindeg, 6)" << std::endl;
+      out.close();
 
-    out.close();
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      for (int i = 0; i < 8; ++i) {
+        PVideoFrame frame = clip->GetFrame(100 + i, env.get());
+        int64_t frames = frame->GetProperty("KMVStatFrames")->GetInt();
+        int64_t blkCount = frame->GetProperty("KMVStatBlkCount")->GetInt();
+        int64_t blocks = frame->GetProperty("KMVStatBlocks")->GetInt();
+        int64_t candidates = frame->GetProperty("KMVStatCandidates")->GetInt();
+        EXPECT_EQ(i + 1, frames);
+        EXPECT_EQ(blkCount * frames, blocks);
+        // 1ubNɂȂƂzero,global,coarse3͕]
+        EXPECT_GE(candidates, blocks * 3);
+      }
+    }
 
     {
+      std::ofstream out(scriptpath);
+
+      // vĂTʂςȂ
+      out << "LWLibavVideoSource(\"test.ts\")" << std::endl;
+      out << "s = KMSuper(pel = 2)" << std::endl;
+      out << "karef = s.KMAnalyse(isb = true, delta = 1, chroma = true, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, mt = false)" << std::endl;
+      out << "kastats = s.KMAnalyse(isb = true, delta = 1, chroma = true, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, mt = " <<
+        (mt ? "true" : "false") << ", stats = true)" << std::endl;
+      out << "KMAnalyzeCheck2(karef, kastats, last)" << std::endl;
+
+      out.close();
+
       PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
       GetFrames(clip, tf, env.get());
     }
@@ -476,16 +535,12 @@ void KTGMCTest::DegrainBinomialTest(TEST_FRAMES tf, int N, int blksize, int pel)
   }
 }
 
-TEST_F(KTGMCTest, DegrainBinomial_2Blk32Pel1)
+TEST_F(KTGMCTest, AnalyzeStats_Blk16MT)
 {
-  DegrainBinomialTest(TF_MID, 2, 32, 1);
+  AnalyzeStatsTest(TF_MID, 16, true);
 }
 
-#pragma endregion
-
-#pragma region Compensate
-
-void KTGMCTest::CompensateTest(TEST_FRAMES tf, int blksize, int pel)
+void KTGMCTest::AnalyzeAdaptiveTest(TEST_FRAMES tf, int blksize, int search, int adaptive)
 {
   PEnv env;
   try {
@@ -501,25 +556,16 @@ void KTGMCTest::CompensateTest(TEST_FRAMES tf, int blksize, int pel)
 
     std::ofstream out(scriptpath);
 
-    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
-    out << "srcuda = src.OnCPU(0)" << std::endl;
-    out << "s = src.KMSuper(pel = " << pel << ")" << std::endl;
-    out << "scuda = s.OnCPU(0)" << std::endl;
-    out << "pmvb = s.KMPartialSuper().KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
-      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
-    if (true) { // MV CUDA
-      out << "mvb = scuda.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
-        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb.OnCPU(0))" << std::endl;
-      out << "comref = src.KMCompensate(s, mvb" O_C(0) ",thSCD1=1800,thSCD2=980)" << std::endl;
-      out << "comcuda = srcuda.KMCompensate(scuda,mvb,thSCD1=1800,thSCD2=980)" O_C(0) "" << std::endl;
-    }
-    else {
-      out << "mvb = s.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
-        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb)" << std::endl;
-      out << "comref = src.KMCompensate(s, mvb, thSCD1=180,thSCD2=98)" << std::endl;
-      out << "comcuda = srcuda.KMCompensate(scuda, mvb.OnCPU(0), thSCD1=180,thSCD2=98)" O_C(0) "" << std::endl;
-    }
-    out << "ImageCompare(comref, comcuda)" << std::endl;
+    // KT͈͂łEF[utgTTƈv邩
+    out << "LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "s = KMSuper(pel = 2)" << std::endl;
+    out << "karef = s.KMAnalyse(isb = true, delta = 1, chroma = true, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", search = " << search <<
+      ", lambda = 400, global = true, meander = false, mt = false, adaptive = " << adaptive << ")" << std::endl;
+    out << "kamt = s.KMAnalyse(isb = true, delta = 1, chroma = true, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", search = " << search <<
+      ", lambda = 400, global = true, meander = false, mt = true, adaptive = " << adaptive << ")" << std::endl;
+    out << "KMAnalyzeCheck2(karef, kamt, last)" << std::endl;
 
     out.close();
 
@@ -527,6 +573,28 @@ void KTGMCTest::CompensateTest(TEST_FRAMES tf, int blksize, int pel)
       PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
       GetFrames(clip, tf, env.get());
     }
+
+    // KT͈͂Ŏۂɕ]␔ςĂ邩
+    int64_t candidates[2];
+    for (int i = 0; i < 2; ++i) {
+      std::ofstream out(scriptpath);
+
+      out << "LWLibavVideoSource(\"test.ts\")" << std::endl;
+      out << "s = KMSuper(pel = 2)" << std::endl;
+      out << "s.KMAnalyse(isb = true, delta = 1, chroma = true, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", search = " << search <<
+        ", lambda = 400, global = true, meander = false, stats = true, adaptive = " << (i ? adaptive : 0) << ")" << std::endl;
+
+      out.close();
+
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      PVideoFrame frame;
+      for (int f = 0; f < 8; ++f) {
+        frame = clip->GetFrame(100 + f, env.get());
+      }
+      candidates[i] = frame->GetProperty("KMVStatCandidates")->GetInt();
+    }
+    EXPECT_NE(candidates[0], candidates[1]);
   }
   catch (const AvisynthError& err) {
     printf("%s\n", err.msg);
@@ -534,51 +602,856 @@ void KTGMCTest::CompensateTest(TEST_FRAMES tf, int blksize, int pel)
   }
 }
 
-TEST_F(KTGMCTest, Compensate_Blk8Pel2)
+TEST_F(KTGMCTest, AnalyzeAdaptive_Blk16Hex2)
 {
-  CompensateTest(TF_MID, 8, 2);
+  AnalyzeAdaptiveTest(TF_MID, 16, 4, 200);
 }
 
-TEST_F(KTGMCTest, Compensate_Blk8Pel1)
+TEST_F(KTGMCTest, AnalyzeAdaptive_Blk8Exhaustive)
 {
-  CompensateTest(TF_MID, 8, 1);
+  AnalyzeAdaptiveTest(TF_MID, 8, 3, 200);
 }
 
-TEST_F(KTGMCTest, Compensate_Blk16Pel2)
+// cpukernel͓KT͈͂ɑΉĂȂ̂ŃG[ɂȂ邱
+TEST_F(KTGMCTest, AnalyzeAdaptive_CPUKernelError)
 {
-  CompensateTest(TF_MID, 16, 2);
-}
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
 
-TEST_F(KTGMCTest, Compensate_Blk16Pel1)
-{
-  CompensateTest(TF_MID, 16, 1);
-}
+    AVSValue result;
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
 
-TEST_F(KTGMCTest, Compensate_Blk32Pel2)
-{
-  CompensateTest(TF_MID, 32, 2);
-}
+    std::string scriptpath = workDirPath + "\\script.avs";
 
-TEST_F(KTGMCTest, Compensate_Blk32Pel1)
-{
-  CompensateTest(TF_MID, 32, 1);
-}
+    std::ofstream out(scriptpath);
 
-TEST_F(KTGMCTest, Compensate_Blk16Pel2Begin)
+    out << "LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "s = KMSuper(pel = 2, cpukernel = true)" << std::endl;
+    out << "s.KMAnalyse(isb = true, delta = 1, chroma = true, blksize = 16, overlap = 8, adaptive = 200)" << std::endl;
+
+    out.close();
+
+    PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+    EXPECT_THROW(clip->GetFrame(100, env.get()), AvisynthError);
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+void KTGMCTest::AnalyzeKernelCPUTest(TEST_FRAMES tf, int blksize, bool chroma, int pel, int batch)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    // J[lCPUCUDAłƈv邩
+    out << "LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "s = KMSuper(pel = " << pel << ")" << std::endl;
+    out << "scpu = KMSuper(pel = " << pel << ", cpukernel = true)" << std::endl;
+    out << "kap = s.KMPartialSuper().KMAnalyse(isb = true, delta = 1, chroma = " <<
+      (chroma ? "true" : "false") << ", blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    out << "kacuda = s.OnCPU(0).KMAnalyse(isb = true, delta = 1, chroma = " <<
+      (chroma ? "true" : "false") << ", blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, batch = " << batch <<
+      ", partial = kap.OnCPU(0))" << O_C(0) << std::endl;
+    out << "kacpu = scpu.KMAnalyse(isb = true, delta = 1, chroma = " <<
+      (chroma ? "true" : "false") << ", blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, batch = " << batch <<
+      ", partial = kap)" << std::endl;
+    out << "KMAnalyzeCheck2(kacuda, kacpu, last)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, AnalyzeKernelCPU_Blk8WithCPel2)
+{
+  AnalyzeKernelCPUTest(TF_MID, 8, true, 2, 4);
+}
+
+TEST_F(KTGMCTest, AnalyzeKernelCPU_Blk16NoCPel1)
+{
+  AnalyzeKernelCPUTest(TF_MID, 16, false, 1, 1);
+}
+
+TEST_F(KTGMCTest, AnalyzeKernelCPU_Blk32WithCPel1)
+{
+  AnalyzeKernelCPUTest(TF_MID, 32, true, 1, 4);
+}
+
+#pragma endregion
+
+#pragma region SADBench
+
+void KTGMCTest::SADBenchTest(int bits)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    // SIMDł̌ʂCƈvȂꍇ̓G[ɂȂ
+    AVSValue args[] = { bits, 1000000 };
+    env->Invoke("KMSADBench", AVSValue(args, 2));
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, SADBench_8bit)
+{
+  SADBenchTest(8);
+}
+
+TEST_F(KTGMCTest, SADBench_16bit)
+{
+  SADBenchTest(16);
+}
+
+#pragma endregion
+
+#pragma region Degrain
+
+void KTGMCTest::DegrainTest(TEST_FRAMES tf, int N, int blksize, int pel)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    // V[`FW肳ƃeXgłȂ̂łl10{ɂĂ
+
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "srcuda = src.OnCPU(0)" << std::endl;
+    out << "s = src.KMSuper(pel = " << pel << ")" << std::endl;
+    out << "scuda = s.OnCPU(0)" << std::endl;
+    out << "pmvb = s.KMPartialSuper().KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    out << "pmvf = s.KMPartialSuper().KMAnalyse(isb = false, delta = 1, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    if (N >= 2) {
+      out << "pmvb1 = s.KMPartialSuper().KMAnalyse(isb = true, delta = 2, chroma = false, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+      out << "pmvf1 = s.KMPartialSuper().KMAnalyse(isb = false, delta = 2, chroma = false, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    }
+    if (true) { // MV CUDA
+      out << "mvb = scuda.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb.OnCPU(0))" << std::endl;
+      out << "mvf = scuda.KMAnalyse(isb = false, delta = 1, chroma = false, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvf.OnCPU(0))" << std::endl;
+      if (N >= 2) {
+        out << "mvb1 = scuda.KMAnalyse(isb = true, delta = 2, chroma = false, blksize = " << blksize <<
+          ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb1.OnCPU(0))" << std::endl;
+        out << "mvf1 = scuda.KMAnalyse(isb = false, delta = 2, chroma = false, blksize = " << blksize <<
+          ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvf1.OnCPU(0))" << std::endl;
+      }
+      if (N == 1) {
+        out << "degref = src.KMDegrain1(s, mvb" << O_C(0) << ", mvf" << O_C(0) << ", thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << std::endl;
+        out << "degcuda = srcuda.KMDegrain1(scuda, mvb, mvf, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << O_C(0) << std::endl;
+      }
+      else if (N == 2) {
+        out << "degref = src.KMDegrain2(s, mvb" << O_C(0) << ", mvf" << O_C(0) << ", mvb1" << O_C(0) << ", mvf1" << O_C(0) << ", thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << std::endl;
+        out << "degcuda = srcuda.KMDegrain2(scuda, mvb, mvf, mvb1, mvf1, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << O_C(0) << std::endl;
+      }
+    }
+    else {
+      out << "mvb = s.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb)" << std::endl;
+      out << "mvf = s.KMAnalyse(isb = false, delta = 1, chroma = false, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvf)" << std::endl;
+      if (N >= 2) {
+        out << "mvb1 = s.KMAnalyse(isb = true, delta = 2, chroma = false, blksize = " << blksize <<
+          ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb1)" << std::endl;
+        out << "mvf1 = s.KMAnalyse(isb = false, delta = 2, chroma = false, blksize = " << blksize <<
+          ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvf1)" << std::endl;
+      }
+      if (N == 1) {
+        out << "degref = src.KMDegrain1(s, mvb, mvf, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << std::endl;
+        out << "degcuda = srcuda.KMDegrain1(scuda, mvb.OnCPU(0), mvf.OnCPU(0), thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << O_C(0) << std::endl;
+      }
+      else if (N == 2) {
+        out << "degref = src.KMDegrain2(s, mvb, mvf, mvb1, mvf1, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << std::endl;
+        out << "degcuda = srcuda.KMDegrain2(scuda, mvb.OnCPU(0), mvf.OnCPU(0), mvb1.OnCPU(0), mvf1.OnCPU(0), thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << O_C(0) << std::endl;
+      }
+    }
+    out << "ImageCompare(degref, degcuda)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, Degrain_1Blk8Pel2)
+{
+  DegrainTest(TF_MID, 1, 8, 2);
+}
+
+TEST_F(KTGMCTest, Degrain_1Blk8Pel1)
+{
+  DegrainTest(TF_MID, 1, 8, 1);
+}
+
+TEST_F(KTGMCTest, Degrain_1Blk16Pel2)
+{
+  DegrainTest(TF_MID, 1, 16, 2);
+}
+
+TEST_F(KTGMCTest, Degrain_1Blk16Pel1)
+{
+  DegrainTest(TF_MID, 1, 16, 1);
+}
+
+TEST_F(KTGMCTest, Degrain_1Blk32Pel2)
+{
+  DegrainTest(TF_MID, 1, 32, 2);
+}
+
+TEST_F(KTGMCTest, Degrain_1Blk32Pel1)
+{
+  DegrainTest(TF_MID, 1, 32, 1);
+}
+
+TEST_F(KTGMCTest, Degrain_2Blk8Pel2)
+{
+  DegrainTest(TF_MID, 2, 8, 2);
+}
+
+TEST_F(KTGMCTest, Degrain_2Blk8Pel1)
+{
+  DegrainTest(TF_MID, 2, 8, 1);
+}
+
+TEST_F(KTGMCTest, Degrain_2Blk16Pel2)
+{
+  DegrainTest(TF_MID, 2, 16, 2);
+}
+
+TEST_F(KTGMCTest, Degrain_2Blk16Pel1)
+{
+  DegrainTest(TF_MID, 2, 16, 1);
+}
+
+TEST_F(KTGMCTest, Degrain_2Blk32Pel2)
+{
+  DegrainTest(TF_MID, 2, 32, 2);
+}
+
+TEST_F(KTGMCTest, Degrain_2Blk32Pel1)
+{
+  DegrainTest(TF_MID, 2, 32, 1);
+}
+
+TEST_F(KTGMCTest, Degrain_2Blk16Pel2Begin)
+{
+  DegrainTest(TF_BEGIN, 2, 16, 2);
+}
+
+TEST_F(KTGMCTest, Degrain_2Blk16Pel1End)
+{
+  DegrainTest(TF_END, 2, 16, 2);
+}
+
+void KTGMCTest::DegrainKernelCPUTest(TEST_FRAMES tf, int N, int blksize, int pel)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    // J[lCPUCUDAłƈv邩ixN^͋ʁj
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "srcuda = src.OnCPU(0)" << std::endl;
+    out << "s = src.KMSuper(pel = " << pel << ")" << std::endl;
+    out << "scuda = s.OnCPU(0)" << std::endl;
+    out << "scpu = src.KMSuper(pel = " << pel << ", cpukernel = true)" << std::endl;
+    out << "mvb = s.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    out << "mvf = s.KMAnalyse(isb = false, delta = 1, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    if (N == 1) {
+      out << "degcuda = srcuda.KMDegrain1(scuda, mvb.OnCPU(0), mvf.OnCPU(0), thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << O_C(0) << std::endl;
+      out << "degcpu = src.KMDegrain1(scpu, mvb, mvf, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << std::endl;
+    }
+    else if (N == 2) {
+      out << "mvb1 = s.KMAnalyse(isb = true, delta = 2, chroma = false, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+      out << "mvf1 = s.KMAnalyse(isb = false, delta = 2, chroma = false, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+      out << "degcuda = srcuda.KMDegrain2(scuda, mvb.OnCPU(0), mvf.OnCPU(0), mvb1.OnCPU(0), mvf1.OnCPU(0), thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << O_C(0) << std::endl;
+      out << "degcpu = src.KMDegrain2(scpu, mvb, mvf, mvb1, mvf1, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << std::endl;
+    }
+    out << "ImageCompare(degcuda, degcpu)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, DegrainKernelCPU_1Blk8Pel2)
+{
+  DegrainKernelCPUTest(TF_MID, 1, 8, 2);
+}
+
+TEST_F(KTGMCTest, DegrainKernelCPU_2Blk16Pel1)
+{
+  DegrainKernelCPUTest(TF_MID, 2, 16, 1);
+}
+
+void KTGMCTest::DegrainMTTest(TEST_FRAMES tf, int N, int blksize, int pel)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    // CPUł̃ubNs񏈗ƈv邩ioverlap̌pڂ܂ށj
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "s = src.KMSuper(pel = " << pel << ")" << std::endl;
+    out << "mvb = s.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    out << "mvf = s.KMAnalyse(isb = false, delta = 1, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    if (N == 1) {
+      out << "degref = src.KMDegrain1(s, mvb, mvf, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980, mt = false)" << std::endl;
+      out << "degmt = src.KMDegrain1(s, mvb, mvf, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980, mt = true)" << std::endl;
+    }
+    else if (N == 2) {
+      out << "mvb1 = s.KMAnalyse(isb = true, delta = 2, chroma = false, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+      out << "mvf1 = s.KMAnalyse(isb = false, delta = 2, chroma = false, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+      out << "degref = src.KMDegrain2(s, mvb, mvf, mvb1, mvf1, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980, mt = false)" << std::endl;
+      out << "degmt = src.KMDegrain2(s, mvb, mvf, mvb1, mvf1, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980, mt = true)" << std::endl;
+    }
+    out << "ImageCompare(degref, degmt)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, DegrainMT_1Blk8Pel2)
+{
+  DegrainMTTest(TF_MID, 1, 8, 2);
+}
+
+TEST_F(KTGMCTest, DegrainMT_2Blk32Pel1)
+{
+  DegrainMTTest(TF_MID, 2, 32, 1);
+}
+
+void KTGMCTest::DegrainCompactTest(TEST_FRAMES tf, int blksize, bool chroma)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    // RpNg`̃xN^ŌʂςȂ
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "s = src.KMSuper(pel = 2)" << std::endl;
+    out << "mvb = s.KMAnalyse(isb = true, delta = 1, chroma = " << (chroma ? "true" : "false") <<
+      ", blksize = " << blksize << ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    out << "mvf = s.KMAnalyse(isb = false, delta = 1, chroma = " << (chroma ? "true" : "false") <<
+      ", blksize = " << blksize << ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    out << "mvbc = s.KMAnalyse(isb = true, compact = true, delta = 1, chroma = " << (chroma ? "true" : "false") <<
+      ", blksize = " << blksize << ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    out << "mvfc = s.KMAnalyse(isb = false, compact = true, delta = 1, chroma = " << (chroma ? "true" : "false") <<
+      ", blksize = " << blksize << ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    out << "degref = src.KMDegrain1(s, mvb, mvf, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << std::endl;
+    out << "degc = src.KMDegrain1(s, mvbc, mvfc, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" << std::endl;
+    out << "KMAnalyzeCheck2(mvb, mvbc, ImageCompare(degref, degc))" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, DegrainCompact_Blk16WithC)
+{
+  DegrainCompactTest(TF_MID, 16, true);
+}
+
+void KTGMCTest::DegrainBinomialTest(TEST_FRAMES tf, int N, int blksize, int pel)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "srcuda = src.OnCPU(0)" << std::endl;
+    out << "s = src.KMSuper(pel = " << pel << ")" << std::endl;
+    out << "scuda = s.OnCPU(0)" << std::endl;
+    out << "pmvb = s.KMPartialSuper().KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    out << "pmvf = s.KMPartialSuper().KMAnalyse(isb = false, delta = 1, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    out << "pmvb1 = s.KMPartialSuper().KMAnalyse(isb = true, delta = 2, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    out << "pmvf1 = s.KMPartialSuper().KMAnalyse(isb = false, delta = 2, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    out << "mvb = scuda.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb.OnCPU(0))" << std::endl;
+    out << "mvf = scuda.KMAnalyse(isb = false, delta = 1, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvf.OnCPU(0))" << std::endl;
+    out << "mvb1 = scuda.KMAnalyse(isb = true, delta = 2, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb1.OnCPU(0))" << std::endl;
+    out << "mvf1 = scuda.KMAnalyse(isb = false, delta = 2, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvf1.OnCPU(0))" << std::endl;
+
+    out << "bindeg = srcuda.KMDegrain2(scuda, mvb, mvf, mvb1, mvf1, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980, binomial = true)" O_C(0) << std::endl;
+    out << "deg1 = srcuda.KMDegrain1(scuda, mvb, mvf, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" O_C(0) << std::endl;
+    out << "deg2 = srcuda.KMDegrain1(scuda, mvb1, mvf1, thSAD = 6400, thSCD1 = 1800, thSCD2 = 980)" O_C(0) << std::endl;
+    out << "binref = deg1.Merge(deg2, 0.2).Merge(src, 0.0625)" << std::endl;
+
+    out << "ImageCompare(binref, bindeg, 6)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, DegrainBinomial_2Blk32Pel1)
+{
+  DegrainBinomialTest(TF_MID, 2, 32, 1);
+}
+
+#pragma endregion
+
+#pragma region Compensate
+
+void KTGMCTest::CompensateTest(TEST_FRAMES tf, int blksize, int pel)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "srcuda = src.OnCPU(0)" << std::endl;
+    out << "s = src.KMSuper(pel = " << pel << ")" << std::endl;
+    out << "scuda = s.OnCPU(0)" << std::endl;
+    out << "pmvb = s.KMPartialSuper().KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
+      ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false)" << std::endl;
+    if (true) { // MV CUDA
+      out << "mvb = scuda.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb.OnCPU(0))" << std::endl;
+      out << "comref = src.KMCompensate(s, mvb" O_C(0) ",thSCD1=1800,thSCD2=980)" << std::endl;
+      out << "comcuda = srcuda.KMCompensate(scuda,mvb,thSCD1=1800,thSCD2=980)" O_C(0) "" << std::endl;
+    }
+    else {
+      out << "mvb = s.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = " << blksize <<
+        ", overlap = " << (blksize / 2) << ", lambda = 400, global = true, meander = false, partial = pmvb)" << std::endl;
+      out << "comref = src.KMCompensate(s, mvb, thSCD1=180,thSCD2=98)" << std::endl;
+      out << "comcuda = srcuda.KMCompensate(scuda, mvb.OnCPU(0), thSCD1=180,thSCD2=98)" O_C(0) "" << std::endl;
+    }
+    out << "ImageCompare(comref, comcuda)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, Compensate_Blk8Pel2)
+{
+  CompensateTest(TF_MID, 8, 2);
+}
+
+TEST_F(KTGMCTest, Compensate_Blk8Pel1)
+{
+  CompensateTest(TF_MID, 8, 1);
+}
+
+TEST_F(KTGMCTest, Compensate_Blk16Pel2)
+{
+  CompensateTest(TF_MID, 16, 2);
+}
+
+TEST_F(KTGMCTest, Compensate_Blk16Pel1)
+{
+  CompensateTest(TF_MID, 16, 1);
+}
+
+TEST_F(KTGMCTest, Compensate_Blk32Pel2)
+{
+  CompensateTest(TF_MID, 32, 2);
+}
+
+TEST_F(KTGMCTest, Compensate_Blk32Pel1)
+{
+  CompensateTest(TF_MID, 32, 1);
+}
+
+TEST_F(KTGMCTest, Compensate_Blk16Pel2Begin)
+{
+  CompensateTest(TF_BEGIN, 16, 2);
+}
+
+TEST_F(KTGMCTest, Compensate_Blk16Pel2End)
+{
+  CompensateTest(TF_END, 16, 2);
+}
+
+#pragma endregion
+
+#pragma region MVReplace
+
+void KTGMCTest::MVReplaceTest(TEST_FRAMES tf, bool kvm)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+
+    out << "ks = src.KMSuper(pel = 2)" << std::endl;
+    out << "kmvb = ks.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = 32, overlap = 16, lambda = 400, global = true, meander = false)" << std::endl;
+    out << "ms = src.MSuper(pel = 2)" << std::endl;
+    out << "mmvb = ms.MAnalyse(isb = true, delta = 1, chroma = false, blksize = 32, overlap = 16, lambda = 400, global = true, meander = false)" << std::endl;
+
+    if (kvm) {
+      out << "kcom = src.KMCompensate(ks, kmvb,thSCD1=1800,thSCD2=980)" << std::endl;
+      out << "mcom = src.MCompensate(ms, MVReplaceWithKMV(mmvb, kmvb),thSCD1=1800,thSCD2=980)" << std::endl;
+    }
+    else {
+      out << "kcom = src.KMCompensate(ks, KMVReplaceWithMV(kmvb, mmvb),thSCD1=1800,thSCD2=980)" << std::endl;
+      out << "mcom = src.MCompensate(ms, mmvb,thSCD1=1800,thSCD2=980)" << std::endl;
+    }
+
+    out << "ImageCompare(kcom, mcom, 1)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, MVReplace_KMV)
+{
+  MVReplaceTest(TF_MID, true);
+}
+
+TEST_F(KTGMCTest, MVReplace_MV)
+{
+  MVReplaceTest(TF_MID, false);
+}
+
+#pragma endregion
+
+#pragma region Bob
+
+void KTGMCTest::BobTest(TEST_FRAMES tf, bool parity)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    out << "Import(\"QTGMC_Bob.avs\")" << std::endl;
+
+    out << "src = LWLibavVideoSource(\"test.ts\")" << (parity ? ".AssumeTFF()" : ".AssumeBFF()") << std::endl;
+    out << "srcuda = src.OnCPU(0)" << std::endl;
+
+    out << "ref = src.QTGMC_Bob( 0,0.5 )" << std::endl;
+    out << "cuda = srcuda.KTGMC_Bob( 0,0.5 )" O_C(0) "" << std::endl;
+
+    out << "ImageCompare(ref, cuda, 1)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, BobTest_TFF)
+{
+  BobTest(TF_MID, true);
+}
+
+TEST_F(KTGMCTest, BobTest_BFF)
+{
+  BobTest(TF_MID, false);
+}
+
+void KTGMCTest::BobCPUTest(TEST_FRAMES tf, bool parity)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    out << "Import(\"QTGMC_Bob.avs\")" << std::endl;
+
+    out << "src = LWLibavVideoSource(\"test.ts\")" << (parity ? ".AssumeTFF()" : ".AssumeBFF()") << std::endl;
+
+    // CPU
+    out << "ref = src.QTGMC_Bob( 0,0.5 )" << std::endl;
+    out << "cpu = src.KTGMC_Bob( 0,0.5 )" << std::endl;
+
+    out << "ImageCompare(ref, cpu, 1)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, BobCPUTest_TFF)
+{
+  BobCPUTest(TF_MID, true);
+}
+
+TEST_F(KTGMCTest, BobCPUTest_BFF)
+{
+  BobCPUTest(TF_MID, false);
+}
+
+#pragma endregion
+
+#pragma region BinomialSoften
+
+void KTGMCTest::BinomialSoftenTest(TEST_FRAMES tf, int radius, bool chroma)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    out << "Import(\"QTGMC_BinomialSoften.avs\")" << std::endl;
+
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "srcuda = src.OnCPU(0)" << std::endl;
+
+    out << "ref = src.QTGMC_BinomialSoften" << radius << "(" << (chroma ? "true" : "false") << ")" << std::endl;
+    out << "cuda = srcuda.KBinomialTemporalSoften(" << radius << ", 28, " << (chroma ? "true" : "false") << ")" O_C(0) "" << std::endl;
+
+    out << "ImageCompare(ref, cuda, 1" << (chroma ? "" : ", false") << ")" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, BinomialSoften_Rad1WithC)
 {
-  CompensateTest(TF_BEGIN, 16, 2);
+  BinomialSoftenTest(TF_MID, 1, true);
 }
 
-TEST_F(KTGMCTest, Compensate_Blk16Pel2End)
+TEST_F(KTGMCTest, BinomialSoften_Rad2WithC)
 {
-  CompensateTest(TF_END, 16, 2);
+  BinomialSoftenTest(TF_MID, 2, true);
 }
 
-#pragma endregion
+TEST_F(KTGMCTest, BinomialSoften_Rad1NoC)
+{
+  BinomialSoftenTest(TF_MID, 1, false);
+}
 
-#pragma region MVReplace
+TEST_F(KTGMCTest, BinomialSoften_Rad2NoC)
+{
+  BinomialSoftenTest(TF_MID, 2, false);
+}
 
-void KTGMCTest::MVReplaceTest(TEST_FRAMES tf, bool kvm)
+void KTGMCTest::BinomialSoftenCPUTest(TEST_FRAMES tf, int radius, bool chroma)
 {
   PEnv env;
   try {
@@ -594,27 +1467,19 @@ void KTGMCTest::MVReplaceTest(TEST_FRAMES tf, bool kvm)
 
     std::ofstream out(scriptpath);
 
-    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "Import(\"QTGMC_BinomialSoften.avs\")" << std::endl;
 
-    out << "ks = src.KMSuper(pel = 2)" << std::endl;
-    out << "kmvb = ks.KMAnalyse(isb = true, delta = 1, chroma = false, blksize = 32, overlap = 16, lambda = 400, global = true, meander = false)" << std::endl;
-    out << "ms = src.MSuper(pel = 2)" << std::endl;
-    out << "mmvb = ms.MAnalyse(isb = true, delta = 1, chroma = false, blksize = 32, overlap = 16, lambda = 400, global = true, meander = false)" << std::endl;
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
 
-    if (kvm) {
-      out << "kcom = src.KMCompensate(ks, kmvb,thSCD1=1800,thSCD2=980)" << std::endl;
-      out << "mcom = src.MCompensate(ms, MVReplaceWithKMV(mmvb, kmvb),thSCD1=1800,thSCD2=980)" << std::endl;
-    }
-    else {
-      out << "kcom = src.KMCompensate(ks, KMVReplaceWithMV(kmvb, mmvb),thSCD1=1800,thSCD2=980)" << std::endl;
-      out << "mcom = src.MCompensate(ms, mmvb,thSCD1=1800,thSCD2=980)" << std::endl;
-    }
+    out << "ref = src.QTGMC_BinomialSoften" << radius << "(" << (chroma ? "true" : "false") << ")" << std::endl;
+    out << "cpu = src.KBinomialTemporalSoften(" << radius << ", 28, " << (chroma ? "true" : "false") << ")" << std::endl;
 
-    out << "ImageCompare(kcom, mcom, 1)" << std::endl;
+    out << "ImageCompare(ref, cpu, 1" << (chroma ? "" : ", false") << ")" << std::endl;
 
     out.close();
 
     {
+      // TF_MID͘At[Ȃ̂SADLbVʂ
       PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
       GetFrames(clip, tf, env.get());
     }
@@ -625,21 +1490,21 @@ void KTGMCTest::MVReplaceTest(TEST_FRAMES tf, bool kvm)
   }
 }
 
-TEST_F(KTGMCTest, MVReplace_KMV)
+TEST_F(KTGMCTest, BinomialSoftenCPU_Rad1WithC)
 {
-  MVReplaceTest(TF_MID, true);
+  BinomialSoftenCPUTest(TF_MID, 1, true);
 }
 
-TEST_F(KTGMCTest, MVReplace_MV)
+TEST_F(KTGMCTest, BinomialSoftenCPU_Rad2NoC)
 {
-  MVReplaceTest(TF_MID, false);
+  BinomialSoftenCPUTest(TF_BEGIN, 2, false);
 }
 
 #pragma endregion
 
-#pragma region Bob
+#pragma region RemoveGrain
 
-void KTGMCTest::BobTest(TEST_FRAMES tf, bool parity)
+void KTGMCTest::RemoveGrainTest(TEST_FRAMES tf, int mode, bool chroma)
 {
   PEnv env;
   try {
@@ -655,15 +1520,13 @@ void KTGMCTest::BobTest(TEST_FRAMES tf, bool parity)
 
     std::ofstream out(scriptpath);
 
-    out << "Import(\"QTGMC_Bob.avs\")" << std::endl;
-
-    out << "src = LWLibavVideoSource(\"test.ts\")" << (parity ? ".AssumeTFF()" : ".AssumeBFF()") << std::endl;
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
     out << "srcuda = src.OnCPU(0)" << std::endl;
 
-    out << "ref = src.QTGMC_Bob( 0,0.5 )" << std::endl;
-    out << "cuda = srcuda.KTGMC_Bob( 0,0.5 )" O_C(0) "" << std::endl;
+    out << "ref = src.RemoveGrain(" << mode << (chroma ? "" : ", -1") << ")" << std::endl;
+    out << "cuda = srcuda.KRemoveGrain(" << mode << (chroma ? "" : ", -1") << ")" O_C(0) "" << std::endl;
 
-    out << "ImageCompare(ref, cuda, 1)" << std::endl;
+    out << "ImageCompare(ref, cuda, 1" << (chroma ? "" : ", false") << ")" << std::endl;
 
     out.close();
 
@@ -678,21 +1541,67 @@ void KTGMCTest::BobTest(TEST_FRAMES tf, bool parity)
   }
 }
 
-TEST_F(KTGMCTest, BobTest_TFF)
+TEST_F(KTGMCTest, RemoveGrain_Mode1WithC)
 {
-  BobTest(TF_MID, true);
+  RemoveGrainTest(TF_MID, 1, true);
 }
 
-TEST_F(KTGMCTest, BobTest_BFF)
+TEST_F(KTGMCTest, RemoveGrain_Mode1NoC)
 {
-  BobTest(TF_MID, false);
+  RemoveGrainTest(TF_MID, 1, false);
 }
 
-#pragma endregion
+TEST_F(KTGMCTest, RemoveGrain_Mode2WithC)
+{
+  RemoveGrainTest(TF_MID, 2, true);
+}
 
-#pragma region BinomialSoften
+TEST_F(KTGMCTest, RemoveGrain_Mode2NoC)
+{
+  RemoveGrainTest(TF_MID, 2, false);
+}
 
-void KTGMCTest::BinomialSoftenTest(TEST_FRAMES tf, int radius, bool chroma)
+TEST_F(KTGMCTest, RemoveGrain_Mode3WithC)
+{
+  RemoveGrainTest(TF_MID, 3, true);
+}
+
+TEST_F(KTGMCTest, RemoveGrain_Mode3NoC)
+{
+  RemoveGrainTest(TF_MID, 3, false);
+}
+
+TEST_F(KTGMCTest, RemoveGrain_Mode4WithC)
+{
+  RemoveGrainTest(TF_MID, 4, true);
+}
+
+TEST_F(KTGMCTest, RemoveGrain_Mode4NoC)
+{
+  RemoveGrainTest(TF_MID, 4, false);
+}
+
+TEST_F(KTGMCTest, RemoveGrain_Mode12WithC)
+{
+  RemoveGrainTest(TF_MID, 12, true);
+}
+
+TEST_F(KTGMCTest, RemoveGrain_Mode12NoC)
+{
+  RemoveGrainTest(TF_MID, 12, false);
+}
+
+TEST_F(KTGMCTest, RemoveGrain_Mode20WithC)
+{
+  RemoveGrainTest(TF_MID, 20, true);
+}
+
+TEST_F(KTGMCTest, RemoveGrain_Mode20NoC)
+{
+  RemoveGrainTest(TF_MID, 20, false);
+}
+
+void KTGMCTest::RemoveGrainCPUTest(TEST_FRAMES tf, int mode, bool chroma)
 {
   PEnv env;
   try {
@@ -708,15 +1617,12 @@ void KTGMCTest::BinomialSoftenTest(TEST_FRAMES tf, int radius, bool chroma)
 
     std::ofstream out(scriptpath);
 
-    out << "Import(\"QTGMC_BinomialSoften.avs\")" << std::endl;
-
     out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
-    out << "srcuda = src.OnCPU(0)" << std::endl;
 
-    out << "ref = src.QTGMC_BinomialSoften" << radius << "(" << (chroma ? "true" : "false") << ")" << std::endl;
-    out << "cuda = srcuda.KBinomialTemporalSoften(" << radius << ", 28, " << (chroma ? "true" : "false") << ")" O_C(0) "" << std::endl;
+    out << "ref = src.RemoveGrain(" << mode << (chroma ? "" : ", -1") << ")" << std::endl;
+    out << "cpu = src.KRemoveGrain(" << mode << (chroma ? "" : ", -1") << ")" << std::endl;
 
-    out << "ImageCompare(ref, cuda, 1" << (chroma ? "" : ", false") << ")" << std::endl;
+    out << "ImageCompare(ref, cpu, 1" << (chroma ? "" : ", false") << ")" << std::endl;
 
     out.close();
 
@@ -731,31 +1637,26 @@ void KTGMCTest::BinomialSoftenTest(TEST_FRAMES tf, int radius, bool chroma)
   }
 }
 
-TEST_F(KTGMCTest, BinomialSoften_Rad1WithC)
-{
-  BinomialSoftenTest(TF_MID, 1, true);
-}
-
-TEST_F(KTGMCTest, BinomialSoften_Rad2WithC)
+TEST_F(KTGMCTest, RemoveGrainCPU_Mode4WithC)
 {
-  BinomialSoftenTest(TF_MID, 2, true);
+  RemoveGrainCPUTest(TF_MID, 4, true);
 }
 
-TEST_F(KTGMCTest, BinomialSoften_Rad1NoC)
+TEST_F(KTGMCTest, RemoveGrainCPU_Mode12WithC)
 {
-  BinomialSoftenTest(TF_MID, 1, false);
+  RemoveGrainCPUTest(TF_MID, 12, true);
 }
 
-TEST_F(KTGMCTest, BinomialSoften_Rad2NoC)
+TEST_F(KTGMCTest, RemoveGrainCPU_Mode20NoC)
 {
-  BinomialSoftenTest(TF_MID, 2, false);
+  RemoveGrainCPUTest(TF_MID, 20, false);
 }
 
 #pragma endregion
 
-#pragma region RemoveGrain
+#pragma region Repair
 
-void KTGMCTest::RemoveGrainTest(TEST_FRAMES tf, int mode, bool chroma)
+void KTGMCTest::RepairTest(TEST_FRAMES tf, int mode, bool chroma)
 {
   PEnv env;
   try {
@@ -772,10 +1673,12 @@ void KTGMCTest::RemoveGrainTest(TEST_FRAMES tf, int mode, bool chroma)
     std::ofstream out(scriptpath);
 
     out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "sref = src.GaussResize(1920,1080,0,0,1920.0001,1080.0001,p=2)" << std::endl;
     out << "srcuda = src.OnCPU(0)" << std::endl;
+    out << "srefcuda = sref.OnCPU(0)" << std::endl;
 
-    out << "ref = src.RemoveGrain(" << mode << (chroma ? "" : ", -1") << ")" << std::endl;
-    out << "cuda = srcuda.KRemoveGrain(" << mode << (chroma ? "" : ", -1") << ")" O_C(0) "" << std::endl;
+    out << "ref = src.Repair(sref, " << mode << (chroma ? "" : ", -1") << ")" << std::endl;
+    out << "cuda = srcuda.KRepair(srefcuda, " << mode << (chroma ? "" : ", -1") << ")" O_C(0) "" << std::endl;
 
     out << "ImageCompare(ref, cuda, 1" << (chroma ? "" : ", false") << ")" << std::endl;
 
@@ -792,71 +1695,145 @@ void KTGMCTest::RemoveGrainTest(TEST_FRAMES tf, int mode, bool chroma)
   }
 }
 
-TEST_F(KTGMCTest, RemoveGrain_Mode1WithC)
+TEST_F(KTGMCTest, Repair_Mode1WithC)
 {
-  RemoveGrainTest(TF_MID, 1, true);
+  RepairTest(TF_MID, 1, true);
 }
 
-TEST_F(KTGMCTest, RemoveGrain_Mode1NoC)
+TEST_F(KTGMCTest, Repair_Mode1NoC)
 {
-  RemoveGrainTest(TF_MID, 1, false);
+  RepairTest(TF_MID, 1, false);
 }
 
-TEST_F(KTGMCTest, RemoveGrain_Mode2WithC)
+TEST_F(KTGMCTest, Repair_Mode2WithC)
 {
-  RemoveGrainTest(TF_MID, 2, true);
+  RepairTest(TF_MID, 2, true);
 }
 
-TEST_F(KTGMCTest, RemoveGrain_Mode2NoC)
+TEST_F(KTGMCTest, Repair_Mode2NoC)
 {
-  RemoveGrainTest(TF_MID, 2, false);
+  RepairTest(TF_MID, 2, false);
 }
 
-TEST_F(KTGMCTest, RemoveGrain_Mode3WithC)
+TEST_F(KTGMCTest, Repair_Mode3WithC)
 {
-  RemoveGrainTest(TF_MID, 3, true);
+  RepairTest(TF_MID, 3, true);
 }
 
-TEST_F(KTGMCTest, RemoveGrain_Mode3NoC)
+TEST_F(KTGMCTest, Repair_Mode3NoC)
 {
-  RemoveGrainTest(TF_MID, 3, false);
+  RepairTest(TF_MID, 3, false);
 }
 
-TEST_F(KTGMCTest, RemoveGrain_Mode4WithC)
+TEST_F(KTGMCTest, Repair_Mode4WithC)
 {
-  RemoveGrainTest(TF_MID, 4, true);
+  RepairTest(TF_MID, 4, true);
 }
 
-TEST_F(KTGMCTest, RemoveGrain_Mode4NoC)
+TEST_F(KTGMCTest, Repair_Mode4NoC)
 {
-  RemoveGrainTest(TF_MID, 4, false);
+  RepairTest(TF_MID, 4, false);
 }
 
-TEST_F(KTGMCTest, RemoveGrain_Mode12WithC)
+void KTGMCTest::RepairCPUTest(TEST_FRAMES tf, int mode, bool chroma)
 {
-  RemoveGrainTest(TF_MID, 12, true);
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "sref = src.GaussResize(1920,1080,0,0,1920.0001,1080.0001,p=2)" << std::endl;
+
+    out << "ref = src.Repair(sref, " << mode << (chroma ? "" : ", -1") << ")" << std::endl;
+    out << "cpu = src.KRepair(sref, " << mode << (chroma ? "" : ", -1") << ")" << std::endl;
+
+    out << "ImageCompare(ref, cpu, 1" << (chroma ? "" : ", false") << ")" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
 }
 
-TEST_F(KTGMCTest, RemoveGrain_Mode12NoC)
+TEST_F(KTGMCTest, RepairCPU_Mode1WithC)
 {
-  RemoveGrainTest(TF_MID, 12, false);
+  RepairCPUTest(TF_MID, 1, true);
 }
 
-TEST_F(KTGMCTest, RemoveGrain_Mode20WithC)
+TEST_F(KTGMCTest, RepairCPU_Mode4NoC)
 {
-  RemoveGrainTest(TF_MID, 20, true);
+  RepairCPUTest(TF_MID, 4, false);
 }
 
-TEST_F(KTGMCTest, RemoveGrain_Mode20NoC)
+#pragma endregion
+
+#pragma region VerticalCleaner
+
+void KTGMCTest::VerticalCleanerTest(TEST_FRAMES tf, int mode, bool chroma)
 {
-  RemoveGrainTest(TF_MID, 20, false);
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "srcuda = src.OnCPU(0)" << std::endl;
+
+    out << "ref = src.VerticalCleaner(" << mode << (chroma ? "" : ", 0") << ")" << std::endl;
+    out << "cuda = srcuda.KVerticalCleaner(" << mode << (chroma ? "" : ", 0") << ")" O_C(0) "" << std::endl;
+
+    out << "ImageCompare(ref, cuda, 1)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
 }
 
-#pragma endregion
+TEST_F(KTGMCTest, VerticalCleaner_WithC)
+{
+  VerticalCleanerTest(TF_MID, 1, true);
+}
 
-#pragma region Repair
+TEST_F(KTGMCTest, VerticalCleaner_NoC)
+{
+  VerticalCleanerTest(TF_MID, 1, false);
+}
 
-void KTGMCTest::RepairTest(TEST_FRAMES tf, int mode, bool chroma)
+void KTGMCTest::VerticalCleanerCPUTest(TEST_FRAMES tf, int mode, bool chroma)
 {
   PEnv env;
   try {
@@ -873,14 +1850,11 @@ void KTGMCTest::RepairTest(TEST_FRAMES tf, int mode, bool chroma)
     std::ofstream out(scriptpath);
 
     out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
-    out << "sref = src.GaussResize(1920,1080,0,0,1920.0001,1080.0001,p=2)" << std::endl;
-    out << "srcuda = src.OnCPU(0)" << std::endl;
-    out << "srefcuda = sref.OnCPU(0)" << std::endl;
 
-    out << "ref = src.Repair(sref, " << mode << (chroma ? "" : ", -1") << ")" << std::endl;
-    out << "cuda = srcuda.KRepair(srefcuda, " << mode << (chroma ? "" : ", -1") << ")" O_C(0) "" << std::endl;
+    out << "ref = src.VerticalCleaner(" << mode << (chroma ? "" : ", 0") << ")" << std::endl;
+    out << "cpu = src.KVerticalCleaner(" << mode << (chroma ? "" : ", 0") << ")" << std::endl;
 
-    out << "ImageCompare(ref, cuda, 1" << (chroma ? "" : ", false") << ")" << std::endl;
+    out << "ImageCompare(ref, cpu, 1)" << std::endl;
 
     out.close();
 
@@ -895,51 +1869,16 @@ void KTGMCTest::RepairTest(TEST_FRAMES tf, int mode, bool chroma)
   }
 }
 
-TEST_F(KTGMCTest, Repair_Mode1WithC)
-{
-  RepairTest(TF_MID, 1, true);
-}
-
-TEST_F(KTGMCTest, Repair_Mode1NoC)
-{
-  RepairTest(TF_MID, 1, false);
-}
-
-TEST_F(KTGMCTest, Repair_Mode2WithC)
-{
-  RepairTest(TF_MID, 2, true);
-}
-
-TEST_F(KTGMCTest, Repair_Mode2NoC)
-{
-  RepairTest(TF_MID, 2, false);
-}
-
-TEST_F(KTGMCTest, Repair_Mode3WithC)
-{
-  RepairTest(TF_MID, 3, true);
-}
-
-TEST_F(KTGMCTest, Repair_Mode3NoC)
-{
-  RepairTest(TF_MID, 3, false);
-}
-
-TEST_F(KTGMCTest, Repair_Mode4WithC)
-{
-  RepairTest(TF_MID, 4, true);
-}
-
-TEST_F(KTGMCTest, Repair_Mode4NoC)
+TEST_F(KTGMCTest, VerticalCleanerCPU_WithC)
 {
-  RepairTest(TF_MID, 4, false);
+  VerticalCleanerCPUTest(TF_MID, 1, true);
 }
 
 #pragma endregion
 
-#pragma region VerticalCleaner
+#pragma region GaussResize
 
-void KTGMCTest::VerticalCleanerTest(TEST_FRAMES tf, int mode, bool chroma)
+void KTGMCTest::GaussResizeTest(TEST_FRAMES tf, bool chroma)
 {
   PEnv env;
   try {
@@ -958,10 +1897,10 @@ void KTGMCTest::VerticalCleanerTest(TEST_FRAMES tf, int mode, bool chroma)
     out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
     out << "srcuda = src.OnCPU(0)" << std::endl;
 
-    out << "ref = src.VerticalCleaner(" << mode << (chroma ? "" : ", 0") << ")" << std::endl;
-    out << "cuda = srcuda.KVerticalCleaner(" << mode << (chroma ? "" : ", 0") << ")" O_C(0) "" << std::endl;
+    out << "ref = src.GaussResize(1920,1080,0,0,1920.0001,1080.0001,p=2)" << std::endl;
+    out << "cuda = srcuda.KGaussResize(p=2" << (chroma ? "" : ", chroma=false") << ")" O_C(0) "" << std::endl;
 
-    out << "ImageCompare(ref, cuda, 1)" << std::endl;
+    out << "ImageCompare(ref, cuda, 1" << (chroma ? "" : ", false") << ")" << std::endl;
 
     out.close();
 
@@ -976,21 +1915,17 @@ void KTGMCTest::VerticalCleanerTest(TEST_FRAMES tf, int mode, bool chroma)
   }
 }
 
-TEST_F(KTGMCTest, VerticalCleaner_WithC)
+TEST_F(KTGMCTest, GaussResizeTest_WithC)
 {
-  VerticalCleanerTest(TF_MID, 1, true);
+  GaussResizeTest(TF_MID, true);
 }
 
-TEST_F(KTGMCTest, VerticalCleaner_NoC)
+TEST_F(KTGMCTest, GaussResizeTest_NoC)
 {
-  VerticalCleanerTest(TF_MID, 1, false);
+  GaussResizeTest(TF_MID, false);
 }
 
-#pragma endregion
-
-#pragma region GaussResize
-
-void KTGMCTest::GaussResizeTest(TEST_FRAMES tf, bool chroma)
+void KTGMCTest::GaussResizeCPUTest(TEST_FRAMES tf, bool chroma)
 {
   PEnv env;
   try {
@@ -1007,12 +1942,11 @@ void KTGMCTest::GaussResizeTest(TEST_FRAMES tf, bool chroma)
     std::ofstream out(scriptpath);
 
     out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
-    out << "srcuda = src.OnCPU(0)" << std::endl;
 
     out << "ref = src.GaussResize(1920,1080,0,0,1920.0001,1080.0001,p=2)" << std::endl;
-    out << "cuda = srcuda.KGaussResize(p=2" << (chroma ? "" : ", chroma=false") << ")" O_C(0) "" << std::endl;
+    out << "cpu = src.KGaussResize(p=2" << (chroma ? "" : ", chroma=false") << ")" << std::endl;
 
-    out << "ImageCompare(ref, cuda, 1" << (chroma ? "" : ", false") << ")" << std::endl;
+    out << "ImageCompare(ref, cpu, 1" << (chroma ? "" : ", false") << ")" << std::endl;
 
     out.close();
 
@@ -1027,14 +1961,14 @@ void KTGMCTest::GaussResizeTest(TEST_FRAMES tf, bool chroma)
   }
 }
 
-TEST_F(KTGMCTest, GaussResizeTest_WithC)
+TEST_F(KTGMCTest, GaussResizeCPU_WithC)
 {
-  GaussResizeTest(TF_MID, true);
+  GaussResizeCPUTest(TF_MID, true);
 }
 
-TEST_F(KTGMCTest, GaussResizeTest_NoC)
+TEST_F(KTGMCTest, GaussResizeCPU_NoC)
 {
-  GaussResizeTest(TF_MID, false);
+  GaussResizeCPUTest(TF_MID, false);
 }
 
 #pragma endregion
@@ -1093,6 +2027,57 @@ TEST_F(KTGMCTest, InpandVerticalX2Test_NoC)
   InpandVerticalX2Test(TF_MID, false);
 }
 
+void KTGMCTest::XpandVerticalX2CPUTest(TEST_FRAMES tf, bool expand, bool chroma)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    int rc = chroma ? 3 : 1;
+    const char* mt = expand ? "mt_expand" : "mt_inpand";
+
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+
+    out << "ref = src." << mt << "(mode=\"vertical\", U=" << rc << ",V=" << rc <<
+      ")." << mt << "(mode=\"vertical\", U=" << rc << ",V=" << rc << ")" << std::endl;
+    out << "cpu = src." << (expand ? "KExpandVerticalX2" : "KInpandVerticalX2") <<
+      "(U = " << rc << ", V = " << rc << ")" << std::endl;
+
+    out << "ImageCompare(ref, cpu, 1" << (chroma ? "" : ", false") << ")" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, InpandVerticalX2CPU_WithC)
+{
+  XpandVerticalX2CPUTest(TF_MID, false, true);
+}
+
+TEST_F(KTGMCTest, ExpandVerticalX2CPU_NoC)
+{
+  XpandVerticalX2CPUTest(TF_MID, true, false);
+}
+
 #pragma endregion
 
 #pragma region ExpandVerticalX2
@@ -1293,6 +2278,148 @@ TEST_F(KTGMCTest, LogicTest_MaxNoC)
 
 #pragma endregion
 
+#pragma region Expr
+
+void KTGMCTest::ExprTest(TEST_FRAMES tf, bool cuda, bool chroma, const char* expr, int bits)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    int rc = (chroma ? 3 : 1);
+
+    out << "x = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    if (bits != 8) {
+      out << "x = x.ConvertBits(" << bits << ")" << std::endl;
+    }
+    out << "y = x.RemoveGrain(20)" << std::endl;
+
+    out << "ref = mt_lutxy(x, y,\"" << expr << "\",u=" << rc << ",v=" << rc << ")" << std::endl;
+    if (cuda) {
+      out << "cuda = KExpr(x.OnCPU(0), y.OnCPU(0), expr=\"" << expr << "\",u=" << rc << ",v=" << rc << ")" O_C(0) "" << std::endl;
+    }
+    else {
+      out << "cuda = KExpr(x, y, expr=\"" << expr << "\",u=" << rc << ",v=" << rc << ")" << std::endl;
+    }
+
+    out << "ImageCompare(ref, cuda, 1" << (chroma ? "" : ", false") << ")" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+// 3̉Zq(?)܂
+static const char* EXPR_COND_TEST = "x range_half - y range_half - * 0 < range_half x range_half - abs y range_half - abs < x y ? ?";
+// 萔̃rbg[xϊ scalef̓tW̐LAscaleb̓rbgVtg
+static const char* EXPR_SCALEF_TEST = "x 16 scalef - 255 scalef * 219 scalef / y max";
+static const char* EXPR_SCALEB_TEST = "x 16 scaleb - 255 scaleb * 219 scaleb / y max";
+// X^bN傤EXPR_MAX_STACK(16)܂Ŏg t̏Ԃ1̉Zqʂ
+static const char* EXPR_MAXSTACK_TEST = "x y x y x y x y x y x y x y x y abs + + + + + + + + + + + + + + + 16 /";
+// o͂̃Nv
+static const char* EXPR_CLAMP_TEST = "x 2 * y -";
+
+TEST_F(KTGMCTest, Expr_CUDAWithC)
+{
+  ExprTest(TF_MID, true, true, EXPR_COND_TEST, 8);
+}
+
+TEST_F(KTGMCTest, Expr_CPUWithC)
+{
+  ExprTest(TF_MID, false, true, EXPR_COND_TEST, 8);
+}
+
+TEST_F(KTGMCTest, Expr_CPUNoC)
+{
+  ExprTest(TF_MID, false, false, EXPR_COND_TEST, 8);
+}
+
+TEST_F(KTGMCTest, Expr_CPUScalef16)
+{
+  ExprTest(TF_MID, false, true, EXPR_SCALEF_TEST, 16);
+}
+
+TEST_F(KTGMCTest, Expr_CUDAScalef16)
+{
+  ExprTest(TF_MID, true, true, EXPR_SCALEF_TEST, 16);
+}
+
+TEST_F(KTGMCTest, Expr_CPUScaleb16)
+{
+  ExprTest(TF_MID, false, true, EXPR_SCALEB_TEST, 16);
+}
+
+TEST_F(KTGMCTest, Expr_ScaleTwiceError)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    // 萔2scalef,scalebƃG[
+    std::ofstream out(scriptpath);
+    out << "LWLibavVideoSource(\"test.ts\").ConvertBits(16)" << std::endl;
+    out << "KExpr(expr=\"x 16 scalef scaleb -\")" << std::endl;
+    out.close();
+
+    EXPECT_THROW(env->Invoke("Import", scriptpath.c_str()).AsClip(), AvisynthError);
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, Expr_CPUMaxStack)
+{
+  ExprTest(TF_MID, false, true, EXPR_MAXSTACK_TEST, 8);
+}
+
+TEST_F(KTGMCTest, Expr_CUDAMaxStack)
+{
+  ExprTest(TF_MID, true, true, EXPR_MAXSTACK_TEST, 8);
+}
+
+TEST_F(KTGMCTest, Expr_CPUClamp10)
+{
+  ExprTest(TF_MID, false, true, EXPR_CLAMP_TEST, 10);
+}
+
+TEST_F(KTGMCTest, Expr_CUDAClamp10)
+{
+  ExprTest(TF_MID, true, true, EXPR_CLAMP_TEST, 10);
+}
+
+TEST_F(KTGMCTest, Expr_CPUClamp12)
+{
+  ExprTest(TF_MID, false, true, EXPR_CLAMP_TEST, 12);
+}
+
+#pragma endregion
+
 #pragma region BobShimmerFixesMerge
 
 void KTGMCTest::BobShimmerFixesMergeTest(TEST_FRAMES tf, int rep, bool chroma)
@@ -1811,6 +2938,54 @@ TEST_F(KTGMCTest, WeaveTest_BFF)
   WeaveTest(TF_MID, false, false);
 }
 
+// SeparateFields͓t[̏㉺ir[ԂjƈႤt[̑giRs[j݂ɗ
+void KTGMCTest::WeaveCPUTest(TEST_FRAMES tf, bool parity)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    AVSValue result;
+    std::string debugtoolPath = modulePath + "\\KDebugTool.dll";
+    env->LoadPlugin(debugtoolPath.c_str(), true, &result);
+    std::string ktgmcPath = modulePath + "\\KTGMC.dll";
+    env->LoadPlugin(ktgmcPath.c_str(), true, &result);
+
+    std::string scriptpath = workDirPath + "\\script.avs";
+
+    std::ofstream out(scriptpath);
+
+    out << "src = LWLibavVideoSource(\"test.ts\")" << std::endl;
+    out << "src = src." << (parity ? "AssumeTFF()" : "AssumeBFF()") << std::endl;
+
+    out << "ref = src.SeparateFields().DoubleWeave()" << std::endl;
+    out << "cpu = src.SeparateFields().KDoubleWeave()" << std::endl;
+
+    out << "ImageCompare(ref, cpu, 0)" << std::endl;
+
+    out.close();
+
+    {
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      GetFrames(clip, tf, env.get());
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(KTGMCTest, WeaveCPU_DoubleTFF)
+{
+  WeaveCPUTest(TF_MID, true);
+}
+
+TEST_F(KTGMCTest, WeaveCPU_DoubleBFF)
+{
+  WeaveCPUTest(TF_MID, false);
+}
+
 #pragma endregion
 
 #pragma region Copy
@@ -4,6 +4,8 @@
 class MiscTest : public AvsTestBase {
 protected:
   MiscTest() { }
+
+  void CPUBenchTest(int bits);
 };
 
 TEST_F(MiscTest, UCFPerf)
@@ -122,6 +124,56 @@ TEST_F(MiscTest, GenericScriptTest)
   }
 }
 
+// CPUŎȃtB^ʂƂ̑xƃv
+// ͂KSynthClipȂ̂Ń\[XtB^eXgfނ͕sv
+// eiTimeň͂ł̂KBenchŒiƂ̎Ԃo
+void MiscTest::CPUBenchTest(int bits)
+{
+  PEnv env;
+  try {
+    env = PEnv(CreateScriptEnvironment2());
+
+    // KFM͕ʂ̌nȂ̂ŕČv
+    const char* outputs[] = { "rs", "fm" };
+    for (const char* output : outputs) {
+      std::string scriptpath = workDirPath + "\\script.avs";
+
+      std::ofstream out(scriptpath);
+
+      out << "src = KSynthClip(1920, 1080, bits=" << bits << ", length=300)" << std::endl;
+      out << "src = src.Time(\"source\", print=false)" << std::endl;
+      out << "sup = src.KMSuper(pel=1).Time(\"KMSuper\", print=false)" << std::endl;
+      out << "bv = sup.KMAnalyse(isb=true, delta=1).Time(\"KMAnalyse bwd\", print=false)" << std::endl;
+      out << "fv = sup.KMAnalyse(isb=false, delta=1).Time(\"KMAnalyse fwd\", print=false)" << std::endl;
+      out << "mc = src.KMDegrain1(sup, bv, fv, thSAD=400).Time(\"KMDegrain1\", print=false)" << std::endl;
+      out << "fm = src.KFMSuper(src.KFMPad()).KPreCycleAnalyze().Time(\"KFM\", print=false)" << std::endl;
+      out << "rs = mc.Spline36Resize(1280, 720).ConvertBits(8).Time(\"Resize\", print=false)" << std::endl;
+      out << output << std::endl;
+
+      out.close();
+
+      PClip clip = env->Invoke("Import", scriptpath.c_str()).AsClip();
+      std::string name = std::string("CPUBench ") + output;
+      AVSValue args[] = { clip, 100, 5, name.c_str() };
+      env->Invoke("KBench", AVSValue(args, 4));
+    }
+  }
+  catch (const AvisynthError& err) {
+    printf("%s\n", err.msg);
+    GTEST_FAIL();
+  }
+}
+
+TEST_F(MiscTest, CPUBench_8bit)
+{
+  CPUBenchTest(8);
+}
+
+TEST_F(MiscTest, CPUBench_16bit)
+{
+  CPUBenchTest(16);
+}
+
 #include "../KFM/SIMDSupport.hpp"
 
 TEST_F(MiscTest, SIMDSupportTest)
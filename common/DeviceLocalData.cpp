@@ -53,3 +53,40 @@ void* DeviceLocalBase::GetData_(PNeoEnv env)
 
   return ptr;
 }
+
+std::shared_ptr<DeviceLocalBase> DeviceLocalBase::SharedPool::Get(
+  const void* init_data, size_t length, const std::function<DeviceLocalBase*()>& create)
+{
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  const uint8_t* bytes = (const uint8_t*)init_data;
+  for (size_t i = 0; i < length; ++i) {
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto range = entries.equal_range((size_t)hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    std::shared_ptr<DeviceLocalBase> data = it->second.lock();
+    if (data && data->length == length &&
+      memcmp(data->dataPtrs[0].load(std::memory_order_relaxed), init_data, length) == 0)
+    {
+      return data;
+    }
+  }
+
+  // gȂȂ̂
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (it->second.expired()) {
+      it = entries.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  std::shared_ptr<DeviceLocalBase> data(create(), [](DeviceLocalBase* p) { delete p; });
+  entries.emplace((size_t)hash, data);
+  return data;
+}
@@ -3,6 +3,9 @@
 #include <avisynth.h>
 #include <mutex>
 #include <atomic>
+#include <memory>
+#include <functional>
+#include <unordered_map>
 
 class DeviceLocalBase
 {
@@ -16,6 +19,15 @@ protected:
   std::mutex mutex;
 
   void* GetData_(PNeoEnv env);
+
+  // eDeviceLocalDataL邽߂̕\i^Ƃ1j
+  class SharedPool {
+    std::mutex mutex;
+    std::unordered_multimap<size_t, std::weak_ptr<DeviceLocalBase>> entries;
+  public:
+    std::shared_ptr<DeviceLocalBase> Get(const void* init_data, size_t length,
+      const std::function<DeviceLocalBase*()>& create);
+  };
 };
 
 template <typename T>
@@ -29,4 +41,15 @@ public:
   T* GetData(PNeoEnv env) {
     return (T*)GetData_(env);
   }
+
+  // init_dataƓê̂ɂ΂Ԃ
+  // TCY̌We[û悤ɓ̂ƂAzXgƊefoCX̃E]1ōς
+  // Ԃ̂͋L̂ŏȂ
+  static std::shared_ptr<DeviceLocalData<T>> GetShared(const T* init_data, int size, PNeoEnv env) {
+    static SharedPool pool;
+    std::shared_ptr<DeviceLocalBase> data = pool.Get(init_data, size * sizeof(T),
+      [=]() -> DeviceLocalBase* { return new DeviceLocalData<T>(init_data, size, env); });
+    // DeviceLocalBaseprotectedpȂ̂static_pointer_cast͎gȂ
+    return std::shared_ptr<DeviceLocalData<T>>(data, static_cast<DeviceLocalData<T>*>(data.get()));
+  }
 };
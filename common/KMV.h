@@ -19,12 +19,19 @@ struct KMVParam
 {
   enum
   {
-    VERSION = 5,
+    VERSION = 7, // v6: mvFormatǉ v7: cpuKernelǉ
     MAGIC_KEY = 0x4A6C2DE4,
     SUPER_FRAME = 1,
     MV_FRAME = 2,
   };
 
+  // xN^t[̌`
+  enum
+  {
+    MV_FORMAT_VECTOR = 0, // VECTORz
+    MV_FORMAT_COMPACT = 1, // KMVCompact
+  };
+
   /*! \brief Unique identifier, not very useful */
   int nMagicKey; // placed to head in v.1.2.6
   int nVersion; // MVAnalysisData and outfile format version - added in v1.2.6
@@ -63,6 +70,8 @@ struct KMVParam
 
   int pixelType; // color format
 
+  bool cpuKernel; // CUDAłȂƂIKDeintKernelCPUg - v7
+
                  // Analyze Frame Parameter //
 
                  /*! \brief difference between the index of the reference and the index of the current frame */
@@ -85,14 +94,33 @@ struct KMVParam
 
   int chromaSADScale; // P.F. chroma SAD ratio, 0:stay(YV12) 1:div2 2:div4(e.g.YV24)
 
+  int mvFormat; // MV_FORMAT_XXX - v6
+
 
   KMVParam(int data_type)
     : nMagicKey(MAGIC_KEY)
     , nVersion(VERSION)
     , nDataType(data_type)
+    , cpuKernel(false)
     , levelInfo()
+    , mvFormat(MV_FORMAT_VECTOR)
   { }
 
+  bool IsCompactMV() const
+  {
+    return nVersion >= 6 && mvFormat == MV_FORMAT_COMPACT;
+  }
+
+  // SKw̃ubN
+  int GetTotalBlocks() const
+  {
+    int count = 0;
+    for (int i = 0; i < nAnalyzeLevels; ++i) {
+      count += levelInfo[i].nBlkX * levelInfo[i].nBlkY;
+    }
+    return count;
+  }
+
   static const KMVParam* GetParam(const VideoInfo& vi, PNeoEnv env)
   {
     if (vi.sample_type != MAGIC_KEY) {
@@ -112,3 +140,42 @@ struct KMVParam
     vi.num_audio_samples = (size_t)param;
   }
 };
+
+// RpNgȃxN^t[`iSoAj
+// [short x,y ~ nCount][SAD16bit ~ nCount][SAD8bit ~ nCount]
+// SAD24bitŖOai12bitȉ̃\[XȂOaȂj
+struct KMVCompact
+{
+  enum { MAX_SAD = (1 << 24) - 1 };
+
+  static int GetBytes(int nCount)
+  {
+    return nCount * (2 * sizeof(short) + sizeof(unsigned short) + 1);
+  }
+
+  static void Pack(const VECTOR* in, void* out, int nCount)
+  {
+    short* xy = (short*)out;
+    unsigned short* sadlo = (unsigned short*)(xy + 2 * nCount);
+    unsigned char* sadhi = (unsigned char*)(sadlo + nCount);
+    for (int i = 0; i < nCount; ++i) {
+      int sad = (in[i].sad < 0) ? 0 : (in[i].sad > MAX_SAD) ? MAX_SAD : in[i].sad;
+      xy[2 * i + 0] = (short)in[i].x;
+      xy[2 * i + 1] = (short)in[i].y;
+      sadlo[i] = (unsigned short)sad;
+      sadhi[i] = (unsigned char)(sad >> 16);
+    }
+  }
+
+  static void Unpack(const void* in, VECTOR* out, int nCount)
+  {
+    const short* xy = (const short*)in;
+    const unsigned short* sadlo = (const unsigned short*)(xy + 2 * nCount);
+    const unsigned char* sadhi = (const unsigned char*)(sadlo + nCount);
+    for (int i = 0; i < nCount; ++i) {
+      out[i].x = xy[2 * i + 0];
+      out[i].y = xy[2 * i + 1];
+      out[i].sad = sadlo[i] | (sadhi[i] << 16);
+    }
+  }
+};
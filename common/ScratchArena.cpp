@@ -0,0 +1,127 @@
+#include "CommonFunctions.h"
+#include "ScratchArena.h"
+
+#include <cuda_runtime.h>
+#include <malloc.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+struct ScratchArena
+{
+  struct Chunk {
+    uint8_t* ptr;
+    size_t size;
+    size_t used;
+  };
+
+  int devid;
+  std::vector<Chunk> chunks; // Ō̂̂؂o
+  size_t outstanding; // ԂĂȂoCg
+  size_t peak;
+
+  ScratchArena(int devid) : devid(devid), outstanding(0), peak(0) { }
+
+  ~ScratchArena() {
+    for (auto& c : chunks) {
+      Free(c.ptr);
+    }
+  }
+
+  uint8_t* Allocate(size_t size, PNeoEnv env) {
+    void* ptr = nullptr;
+    if (devid == 0) {
+      ptr = _aligned_malloc(size, ScratchBuffer::ALIGN);
+      if (ptr == nullptr) {
+        env->ThrowError("[ScratchBuffer] failed to allocate %lld bytes", (long long)size);
+      }
+    }
+    else {
+      // cudaMalloc256oCgE
+      CUDA_CHECK(cudaMalloc(&ptr, size));
+    }
+    return (uint8_t*)ptr;
+  }
+
+  void Free(uint8_t* ptr) {
+    if (devid == 0) {
+      _aligned_free(ptr);
+    }
+    else {
+      // XbhIɂCUDAɏIĂ邱Ƃ̂ŃG[͖
+      cudaFree(ptr);
+    }
+  }
+
+  uint8_t* Push(size_t bytes, int& chunk, size_t& offset, PNeoEnv env) {
+    if (chunks.empty() || chunks.back().used + bytes > chunks.back().size) {
+      size_t size = std::max(bytes, chunks.empty() ? 0 : chunks.back().size);
+      Chunk c = { Allocate(size, env), size, 0 };
+      chunks.push_back(c);
+    }
+    Chunk& c = chunks.back();
+    chunk = (int)chunks.size() - 1;
+    offset = c.used;
+    c.used += bytes;
+    outstanding += bytes;
+    peak = std::max(peak, outstanding);
+    return c.ptr + offset;
+  }
+
+  void Pop(int chunk, size_t offset, size_t bytes) {
+    chunks[chunk].used = offset;
+    outstanding -= bytes;
+    if (outstanding == 0 && chunks.size() > 1) {
+      // őgpʂ1ubNɂ܂Ƃ߂ ɊmۂƂɍ
+      for (auto& c : chunks) {
+        Free(c.ptr);
+      }
+      chunks.clear();
+    }
+  }
+
+  void Reserve(PNeoEnv env) {
+    if (chunks.empty() && peak > 0) {
+      Chunk c = { Allocate(peak, env), peak, 0 };
+      chunks.push_back(c);
+    }
+  }
+};
+
+namespace {
+
+struct ThreadArenas {
+  std::vector<std::unique_ptr<ScratchArena>> arenas; // foCXID
+
+  ScratchArena* Get(PNeoEnv env) {
+    int devid = env->GetDeviceId();
+    if ((int)arenas.size() <= devid) {
+      arenas.resize(devid + 1);
+    }
+    if (!arenas[devid]) {
+      arenas[devid] = std::unique_ptr<ScratchArena>(new ScratchArena(devid));
+    }
+    return arenas[devid].get();
+  }
+};
+
+thread_local ThreadArenas t_arenas;
+
+size_t AlignSize(size_t bytes) {
+  return (bytes + ScratchBuffer::ALIGN - 1) & ~(size_t)(ScratchBuffer::ALIGN - 1);
+}
+
+} // namespace
+
+ScratchBuffer::ScratchBuffer(size_t bytes_, PNeoEnv env)
+  : arena(t_arenas.Get(env))
+  , bytes(AlignSize(std::max<size_t>(bytes_, 1)))
+{
+  arena->Reserve(env);
+  ptr = arena->Push(bytes, chunk, offset, env);
+}
+
+ScratchBuffer::~ScratchBuffer()
+{
+  arena->Pop(chunk, offset, bytes);
+}
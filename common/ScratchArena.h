@@ -0,0 +1,40 @@
+#pragma once
+
+#include <avisynth.h>
+#include <stdint.h>
+
+// GetFrame̒ŎgꎞIȃ[N
+// ƗpBGR32̃t[NewVideoFrameōƖt[t[LbVʂ̂ŁAɂg
+//
+// XbhƁEfoCXƂ1̃A[iĂāAX^bNIɐ؂o
+// ȂȂƂ͒ǉŊmۂASԂꂽƂɍőgpʂ1̃ubNɍ蒼̂
+// JԂŏ̃t[ȍ~͊mۂNȂ
+// CUDAł͓Xbh͓Xg[ĝŁAǑĂяõJ[lgĂ̈
+// ̌Ăяo㏑邱Ƃ͂ȂiJ[l̓Xg[ŏɎsj
+// ̃SetMemoryMax̑ΏۊO
+//
+// ScratchBuffer̓[JϐƂĂgAmۂ̂Ƌt̏ɉ悤ɂ邱
+class ScratchBuffer
+{
+public:
+  enum { ALIGN = 256 };
+
+  // ݂̃foCXbytesoCgmۂiALIGNoCgEj
+  ScratchBuffer(size_t bytes, PNeoEnv env);
+  ~ScratchBuffer();
+
+  uint8_t* GetWritePtr() const { return ptr; }
+
+  template <typename T>
+  T* Get() const { return reinterpret_cast<T*>(ptr); }
+
+private:
+  ScratchBuffer(const ScratchBuffer&) = delete;
+  ScratchBuffer& operator=(const ScratchBuffer&) = delete;
+
+  struct ScratchArena* arena;
+  uint8_t* ptr;
+  int chunk;
+  size_t offset;
+  size_t bytes;
+};
@@ -0,0 +1,113 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int numWorkers)
+{
+  for (int i = 0; i < numWorkers; ++i) {
+    workers.emplace_back(&ThreadPool::WorkerMain, this);
+  }
+}
+
+ThreadPool& ThreadPool::GetInstance()
+{
+  // DLLA[hi[_bNjɃXbhjoinƃfbhbN̂
+  // 킴ƔjȂ
+  static ThreadPool* instance = new ThreadPool(
+    std::max(1, (int)std::thread::hardware_concurrency()) - 1);
+  return *instance;
+}
+
+void ThreadPool::RunItems(Job* job)
+{
+  int i;
+  while ((i = job->next.fetch_add(1)) < job->n) {
+    try {
+      (*job->func)(i);
+    }
+    catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!job->error) {
+        job->error = std::current_exception();
+      }
+      // c͎sȂ
+      job->next.store(job->n);
+    }
+  }
+}
+
+void ThreadPool::WorkerMain()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    jobCond.wait(lock, [this] { return !jobs.empty(); });
+    Job* job = jobs.front();
+    ++job->refs;
+    lock.unlock();
+
+    RunItems(job);
+
+    lock.lock();
+    // zIWu̓L[O
+    auto it = std::find(jobs.begin(), jobs.end(), job);
+    if (it != jobs.end()) {
+      jobs.erase(it);
+    }
+    if (--job->refs == 0) {
+      doneCond.notify_all();
+    }
+  }
+}
+
+void ThreadPool::ParallelFor(int n, const std::function<void(int)>& func)
+{
+  if (n <= 0) {
+    return;
+  }
+  if (n == 1 || workers.empty()) {
+    for (int i = 0; i < n; ++i) {
+      func(i);
+    }
+    return;
+  }
+
+  Job job;
+  job.func = &func;
+  job.n = n;
+  job.next.store(0);
+  job.refs = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back(&job);
+  }
+  jobCond.notify_all();
+
+  RunItems(&job);
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = std::find(jobs.begin(), jobs.end(), &job);
+    if (it != jobs.end()) {
+      jobs.erase(it);
+    }
+    // [J[jobGȂȂ܂ő҂
+    doneCond.wait(lock, [&job] { return job.refs == 0; });
+  }
+
+  if (job.error) {
+    std::rethrow_exception(job.error);
+  }
+}
+
+void ThreadPool::ParallelRows(int height, int rowsPerBand, const std::function<void(int, int)>& func)
+{
+  int nbands = std::min(GetNumThreads() * 2, height / rowsPerBand);
+  if (nbands <= 1) {
+    func(0, height);
+    return;
+  }
+  ParallelFor(nbands, [&](int i) {
+    func(height * i / nbands, height * (i + 1) / nbands);
+  });
+}
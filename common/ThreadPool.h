@@ -0,0 +1,50 @@
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <vector>
+#include <deque>
+
+// vZXŋLCPU[J[Xbhv[
+// GetFrame̒Ă΂邱Ƃz肵Ă̂ŁAĂяoXbhɎQ
+// i[J[S܂ĂĂĂяoXbhŊ̂ŃfbhbNȂj
+class ThreadPool
+{
+  struct Job {
+    const std::function<void(int)>* func;
+    int n;
+    std::atomic<int> next;
+    int refs; // ̃[J[iv[mutexŕیj
+    std::exception_ptr error;
+  };
+
+  std::vector<std::thread> workers;
+  std::deque<Job*> jobs;
+  std::mutex mutex;
+  std::condition_variable jobCond;
+  std::condition_variable doneCond;
+
+  ThreadPool(int numWorkers);
+
+  void WorkerMain();
+  void RunItems(Job* job);
+
+public:
+  static ThreadPool& GetInstance();
+
+  // [J[+ĂяoXbh
+  int GetNumThreads() const { return (int)workers.size() + 1; }
+
+  // func(0)`func(n-1)ɎsđSI܂ő҂
+  // ԍ͏珇ɎôŁAO̔ԍɈˑ鏈ł҂킹΃fbhbNȂ
+  // func̒œꂽO͌ĂяoXbhōđo
+  void ParallelFor(int n, const std::function<void(int)>& func);
+
+  // sтɕfunc(ystart, yend)Ɏs
+  // 1тrowsPerBandsɂȂقǏ摜̓XbhNقx̂ŕȂ
+  void ParallelRows(int height, int rowsPerBand, const std::function<void(int, int)>& func);
+};